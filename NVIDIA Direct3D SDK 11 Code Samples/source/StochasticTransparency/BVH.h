@@ -0,0 +1,299 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include <algorithm>
+#include <float.h>
+#include <assert.h>
+
+// Child slot of a BVH node: inner node index, leaf primitive (LEAF_BIT | PrimitiveId) or empty
+#define BVH_LEAF_BIT 0x80000000U
+#define BVH_EMPTY_SLOT 0xFFFFFFFFU
+
+// Structure-of-arrays node with 4 children, so that the 4 child boxes
+// are tested at once with DirectXMath vectors (one component per child)
+struct BVHNode4
+{
+    DirectX::XMFLOAT4A MinX, MinY, MinZ;
+    DirectX::XMFLOAT4A MaxX, MaxY, MaxZ;
+    UINT Child[4];
+};
+
+struct BoundingBoxAABB
+{
+    DirectX::XMFLOAT3 Min;
+    DirectX::XMFLOAT3 Max;
+};
+
+//--------------------------------------------------------------------------------------
+// Object-space side planes of the view frustum [Gribb and Hartmann 2001],
+// with the row-vector convention. The planes point inside and are normalized.
+//--------------------------------------------------------------------------------------
+inline void ExtractFrustumSidePlanes(DirectX::CXMMATRIX WorldViewProj, DirectX::XMVECTOR Planes[4])
+{
+    DirectX::XMMATRIX M = DirectX::XMMatrixTranspose(WorldViewProj);
+    Planes[0] = DirectX::XMPlaneNormalize(DirectX::XMVectorAdd(M.r[3], M.r[0]));         // Left
+    Planes[1] = DirectX::XMPlaneNormalize(DirectX::XMVectorSubtract(M.r[3], M.r[0]));    // Right
+    Planes[2] = DirectX::XMPlaneNormalize(DirectX::XMVectorAdd(M.r[3], M.r[1]));         // Bottom
+    Planes[3] = DirectX::XMPlaneNormalize(DirectX::XMVectorSubtract(M.r[3], M.r[1]));    // Top
+}
+
+//--------------------------------------------------------------------------------------
+// 4-wide bounding volume hierarchy over object-space AABBs, built once at load time.
+// The query returns the primitives intersecting the frustum side planes, and the
+// view-space depth range covered by their boxes.
+//--------------------------------------------------------------------------------------
+class BoundingVolumeHierarchy
+{
+public:
+    void Build(const std::vector<BoundingBoxAABB> &Boxes)
+    {
+        m_Nodes.clear();
+        m_Boxes = Boxes;
+        if (Boxes.empty()) return;
+
+        std::vector<UINT> Primitives(Boxes.size());
+        for (UINT i = 0; i < (UINT)Boxes.size(); ++i)
+        {
+            Primitives[i] = i;
+        }
+        m_Nodes.reserve(Boxes.size() / 2 + 1);
+        BuildNode(&Primitives[0], (UINT)Primitives.size());
+    }
+
+    void Clear()
+    {
+        m_Nodes.clear();
+        m_Boxes.clear();
+    }
+
+    // Appends the visible primitives to Visible, in traversal order.
+    // ViewDepth is the row vector mapping object-space points to view-space depth
+    // (the third column of the world-view matrix). MinDepth/MaxDepth are left untouched
+    // if nothing is visible.
+    void Cull(const DirectX::XMVECTOR Planes[4], DirectX::FXMVECTOR ViewDepth,
+              std::vector<UINT> &Visible, float &MinDepth, float &MaxDepth) const
+    {
+        using namespace DirectX;
+
+        if (m_Nodes.empty()) return;
+
+        XMVECTOR DepthMin = XMVectorReplicate(FLT_MAX);
+        XMVECTOR DepthMax = XMVectorReplicate(-FLT_MAX);
+
+        UINT Stack[64];
+        UINT StackSize = 0;
+        Stack[StackSize++] = 0;
+
+        while (StackSize > 0)
+        {
+            const BVHNode4 &Node = m_Nodes[Stack[--StackSize]];
+            XMVECTOR MinX = XMLoadFloat4A(&Node.MinX);
+            XMVECTOR MinY = XMLoadFloat4A(&Node.MinY);
+            XMVECTOR MinZ = XMLoadFloat4A(&Node.MinZ);
+            XMVECTOR MaxX = XMLoadFloat4A(&Node.MaxX);
+            XMVECTOR MaxY = XMLoadFloat4A(&Node.MaxY);
+            XMVECTOR MaxZ = XMLoadFloat4A(&Node.MaxZ);
+
+            // A box is outside if its corner the farthest along the plane normal is behind the plane.
+            // Empty slots have inverted boxes and always fail.
+            XMVECTOR Inside = XMVectorTrueInt();
+            for (UINT i = 0; i < 4; ++i)
+            {
+                XMFLOAT4 P;
+                XMStoreFloat4(&P, Planes[i]);
+                XMVECTOR Distance = XMVectorReplicate(P.w);
+                Distance = XMVectorMultiplyAdd(XMVectorReplicate(P.x), (P.x > 0.f) ? MaxX : MinX, Distance);
+                Distance = XMVectorMultiplyAdd(XMVectorReplicate(P.y), (P.y > 0.f) ? MaxY : MinY, Distance);
+                Distance = XMVectorMultiplyAdd(XMVectorReplicate(P.z), (P.z > 0.f) ? MaxZ : MinZ, Distance);
+                Inside = XMVectorAndInt(Inside, XMVectorGreaterOrEqual(Distance, XMVectorZero()));
+            }
+            Inside = XMVectorAndInt(Inside, XMVectorLessOrEqual(MinX, MaxX));
+
+            // View-space depth range of the 4 boxes
+            XMFLOAT4 D;
+            XMStoreFloat4(&D, ViewDepth);
+            XMVECTOR Near = XMVectorReplicate(D.w);
+            XMVECTOR Far = Near;
+            Near = XMVectorMultiplyAdd(XMVectorReplicate(D.x), (D.x > 0.f) ? MinX : MaxX, Near);
+            Near = XMVectorMultiplyAdd(XMVectorReplicate(D.y), (D.y > 0.f) ? MinY : MaxY, Near);
+            Near = XMVectorMultiplyAdd(XMVectorReplicate(D.z), (D.z > 0.f) ? MinZ : MaxZ, Near);
+            Far = XMVectorMultiplyAdd(XMVectorReplicate(D.x), (D.x > 0.f) ? MaxX : MinX, Far);
+            Far = XMVectorMultiplyAdd(XMVectorReplicate(D.y), (D.y > 0.f) ? MaxY : MinY, Far);
+            Far = XMVectorMultiplyAdd(XMVectorReplicate(D.z), (D.z > 0.f) ? MaxZ : MinZ, Far);
+
+            UINT Mask[4];
+            XMStoreInt4(Mask, Inside);
+            for (UINT i = 0; i < 4; ++i)
+            {
+                if (!Mask[i]) continue;
+
+                UINT Child = Node.Child[i];
+                if (Child & BVH_LEAF_BIT)
+                {
+                    Visible.push_back(Child & ~BVH_LEAF_BIT);
+                }
+                else
+                {
+                    assert(StackSize < sizeof(Stack) / sizeof(Stack[0]));
+                    Stack[StackSize++] = Child;
+                }
+            }
+
+            // Only the leaves contribute to the depth range
+            XMVECTOR IsLeaf = XMVectorSet(
+                (Node.Child[0] & BVH_LEAF_BIT) ? 1.f : 0.f,
+                (Node.Child[1] & BVH_LEAF_BIT) ? 1.f : 0.f,
+                (Node.Child[2] & BVH_LEAF_BIT) ? 1.f : 0.f,
+                (Node.Child[3] & BVH_LEAF_BIT) ? 1.f : 0.f);
+            XMVECTOR Contributes = XMVectorAndInt(Inside, XMVectorGreater(IsLeaf, XMVectorZero()));
+            DepthMin = XMVectorSelect(DepthMin, XMVectorMin(DepthMin, Near), Contributes);
+            DepthMax = XMVectorSelect(DepthMax, XMVectorMax(DepthMax, Far), Contributes);
+        }
+
+        XMFLOAT4 Min, Max;
+        XMStoreFloat4(&Min, DepthMin);
+        XMStoreFloat4(&Max, DepthMax);
+        float NewMin = std::min(std::min(Min.x, Min.y), std::min(Min.z, Min.w));
+        float NewMax = std::max(std::max(Max.x, Max.y), std::max(Max.z, Max.w));
+        if (NewMin <= NewMax)
+        {
+            MinDepth = std::min(MinDepth, NewMin);
+            MaxDepth = std::max(MaxDepth, NewMax);
+        }
+    }
+
+    UINT GetNumNodes() const { return (UINT)m_Nodes.size(); }
+    UINT GetNumPrimitives() const { return (UINT)m_Boxes.size(); }
+    const BoundingBoxAABB& GetBox(UINT PrimitiveId) const { return m_Boxes[PrimitiveId]; }
+
+protected:
+    struct CentroidLess
+    {
+        CentroidLess(const std::vector<BoundingBoxAABB> &Boxes, int Axis)
+            : m_Boxes(Boxes)
+            , m_Axis(Axis)
+        {
+        }
+
+        bool operator()(UINT a, UINT b) const
+        {
+            const float *pA = &m_Boxes[a].Min.x;
+            const float *pB = &m_Boxes[b].Min.x;
+            return pA[m_Axis] + pA[m_Axis + 3] < pB[m_Axis] + pB[m_Axis + 3];
+        }
+
+        const std::vector<BoundingBoxAABB> &m_Boxes;
+        int m_Axis;
+    };
+
+    BoundingBoxAABB ComputeBounds(const UINT *pPrimitives, UINT Count, bool Centroids) const
+    {
+        BoundingBoxAABB Bounds;
+        Bounds.Min = DirectX::XMFLOAT3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+        Bounds.Max = DirectX::XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for (UINT i = 0; i < Count; ++i)
+        {
+            const BoundingBoxAABB &Box = m_Boxes[pPrimitives[i]];
+            DirectX::XMFLOAT3 Lo = Box.Min;
+            DirectX::XMFLOAT3 Hi = Box.Max;
+            if (Centroids)
+            {
+                Lo = Hi = DirectX::XMFLOAT3((Box.Min.x + Box.Max.x) * 0.5f, (Box.Min.y + Box.Max.y) * 0.5f, (Box.Min.z + Box.Max.z) * 0.5f);
+            }
+            Bounds.Min.x = std::min(Bounds.Min.x, Lo.x); Bounds.Max.x = std::max(Bounds.Max.x, Hi.x);
+            Bounds.Min.y = std::min(Bounds.Min.y, Lo.y); Bounds.Max.y = std::max(Bounds.Max.y, Hi.y);
+            Bounds.Min.z = std::min(Bounds.Min.z, Lo.z); Bounds.Max.z = std::max(Bounds.Max.z, Hi.z);
+        }
+        return Bounds;
+    }
+
+    // Median split along the largest axis of the centroid bounds
+    UINT SplitMedian(UINT *pPrimitives, UINT Count) const
+    {
+        BoundingBoxAABB Bounds = ComputeBounds(pPrimitives, Count, true);
+        float ExtentX = Bounds.Max.x - Bounds.Min.x;
+        float ExtentY = Bounds.Max.y - Bounds.Min.y;
+        float ExtentZ = Bounds.Max.z - Bounds.Min.z;
+        int Axis = (ExtentX >= ExtentY && ExtentX >= ExtentZ) ? 0 : (ExtentY >= ExtentZ) ? 1 : 2;
+
+        UINT Half = Count / 2;
+        std::nth_element(pPrimitives, pPrimitives + Half, pPrimitives + Count, CentroidLess(m_Boxes, Axis));
+        return Half;
+    }
+
+    UINT BuildNode(UINT *pPrimitives, UINT Count)
+    {
+        UINT NodeId = (UINT)m_Nodes.size();
+        m_Nodes.push_back(BVHNode4());
+
+        // Up to 4 groups of primitives, from two levels of binary splits
+        UINT GroupStart[4] = { 0, 0, 0, 0 };
+        UINT GroupCount[4] = { 0, 0, 0, 0 };
+        UINT NumGroups = 0;
+        if (Count <= 4)
+        {
+            for (UINT i = 0; i < Count; ++i)
+            {
+                GroupStart[i] = i;
+                GroupCount[i] = 1;
+            }
+            NumGroups = Count;
+        }
+        else
+        {
+            UINT Half = SplitMedian(pPrimitives, Count);
+            UINT QuarterLo = SplitMedian(pPrimitives, Half);
+            UINT QuarterHi = SplitMedian(pPrimitives + Half, Count - Half);
+            GroupStart[0] = 0;                  GroupCount[0] = QuarterLo;
+            GroupStart[1] = QuarterLo;          GroupCount[1] = Half - QuarterLo;
+            GroupStart[2] = Half;               GroupCount[2] = QuarterHi;
+            GroupStart[3] = Half + QuarterHi;   GroupCount[3] = Count - Half - QuarterHi;
+            NumGroups = 4;
+        }
+
+        BVHNode4 Node;
+        float *pMin[3] = { &Node.MinX.x, &Node.MinY.x, &Node.MinZ.x };
+        float *pMax[3] = { &Node.MaxX.x, &Node.MaxY.x, &Node.MaxZ.x };
+        for (UINT i = 0; i < 4; ++i)
+        {
+            BoundingBoxAABB Bounds;
+            if (i < NumGroups && GroupCount[i] > 0)
+            {
+                UINT *pGroup = pPrimitives + GroupStart[i];
+                Bounds = ComputeBounds(pGroup, GroupCount[i], false);
+                Node.Child[i] = (GroupCount[i] == 1) ? (BVH_LEAF_BIT | pGroup[0]) : BuildNode(pGroup, GroupCount[i]);
+            }
+            else
+            {
+                Bounds.Min = DirectX::XMFLOAT3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+                Bounds.Max = DirectX::XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+                Node.Child[i] = BVH_EMPTY_SLOT;
+            }
+            pMin[0][i] = Bounds.Min.x; pMin[1][i] = Bounds.Min.y; pMin[2][i] = Bounds.Min.z;
+            pMax[0][i] = Bounds.Max.x; pMax[1][i] = Bounds.Max.y; pMax[2][i] = Bounds.Max.z;
+        }
+
+        // m_Nodes may have been reallocated by the recursive calls
+        m_Nodes[NodeId] = Node;
+        return NodeId;
+    }
+
+    std::vector<BVHNode4> m_Nodes;
+    std::vector<BoundingBoxAABB> m_Boxes;
+};
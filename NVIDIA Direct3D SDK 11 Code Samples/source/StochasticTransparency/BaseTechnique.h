@@ -1,297 +1,589 @@
-// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
-//
-// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
-// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
-// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
-// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA 
-// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR  
-// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS 
-// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY 
-// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE, 
-// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
-//
-// Please direct any bugs or questions to SDKFeedback@nvidia.com
-
-#pragma once
-#include "SimpleRT.h"
-#include "SDKmesh.h"
-#include "RandomColors.h"
-
-#include "BaseTechnique_GeometryVS.h"
-#include "BaseTechnique_FullScreenTriangleVS.h"
-
-class BaseTechnique
-{
-public:
-    BaseTechnique(ID3D11Device* pd3dDevice)
-        : m_pNoCullRS(NULL)
-        , m_pDepthNoStencilDS(NULL)
-        , m_pDepthNoWriteDS(NULL)
-        , m_pNoDepthNoStencilDS(NULL)
-        , m_pFrontToBackBlendBS(NULL)
-        , m_pBackToFrontBlendBS(NULL)
-        , m_pNoBlendBS(NULL)
-        , m_pGeometryVS(NULL)
-        , m_pFullScreenTriangleVS(NULL)
-        , m_pParamsCB(NULL)
-        , m_pShadingParamsCB(NULL)
-        , m_pInputLayout(NULL)
-        , m_BackgroundColor(DirectX::XMFLOAT3(1.f,1.f,1.f))
-    {
-        CreateRasterizerState(pd3dDevice);
-        CreateDepthStencilStates(pd3dDevice);
-        CreateBlendStates(pd3dDevice);
-        CreateVertexShaders(pd3dDevice);
-        CreateConstantBuffers(pd3dDevice);
-    }
-
-    void UpdateMatrices(DirectX::XMFLOAT4X4 &ModelViewProj, DirectX::XMFLOAT4X4 &ModelViewIT)
-    {
-        memcpy(&CBData.worldViewProj, &ModelViewProj, sizeof(DirectX::XMFLOAT4X4));
-        memcpy(&CBData.worldViewIT, &ModelViewIT, sizeof(DirectX::XMFLOAT4X4));
-    }
-
-    ~BaseTechnique()
-    {
-        SAFE_RELEASE(m_pNoCullRS);
-        SAFE_RELEASE(m_pDepthNoStencilDS);
-        SAFE_RELEASE(m_pDepthNoWriteDS);
-        SAFE_RELEASE(m_pNoDepthNoStencilDS);
-        SAFE_RELEASE(m_pFrontToBackBlendBS);
-        SAFE_RELEASE(m_pBackToFrontBlendBS);
-        SAFE_RELEASE(m_pNoBlendBS);
-        SAFE_RELEASE(m_pGeometryVS);
-        SAFE_RELEASE(m_pFullScreenTriangleVS);
-        SAFE_RELEASE(m_pParamsCB);
-        SAFE_RELEASE(m_pShadingParamsCB);
-        SAFE_RELEASE(m_pInputLayout);
-    }
-
-    void DrawMesh(ID3D11DeviceContext* pd3dImmediateContext, CDXUTSDKMesh &Mesh)
-    {
-        ++m_NumGeomPasses;
-
-        assert(Mesh.GetNumMeshes() == 1);
-        assert(Mesh.GetNumVBs() == 1);
-
-        UINT Strides[1];
-        UINT Offsets[1];
-        ID3D11Buffer* pVB[1];
-        pVB[0] = Mesh.GetVB11(0,0);
-        Strides[0] = (UINT)Mesh.GetVertexStride(0,0);
-        Offsets[0] = 0;
-        pd3dImmediateContext->IASetVertexBuffers(0, 1, pVB, Strides, Offsets);
-        pd3dImmediateContext->IASetIndexBuffer(Mesh.GetIB11(0), Mesh.GetIBFormat11(0), 0);
-
-        for (UINT SubsetId = 0; SubsetId < Mesh.GetNumSubsets(0); ++SubsetId)
-        {
-            SDKMESH_SUBSET* pSubset = Mesh.GetSubset(0, SubsetId);
-
-            D3D11_PRIMITIVE_TOPOLOGY PrimType = CDXUTSDKMesh::GetPrimitiveType11((SDKMESH_PRIMITIVE_TYPE)pSubset->PrimitiveType);
-            pd3dImmediateContext->IASetPrimitiveTopology(PrimType);
-
-            DirectX::XMFLOAT3 Color;
-            ComputeRandomColor(SubsetId, Color);
-
-            float data[4] = { Color.x, Color.y, Color.z, m_Alpha };
-            pd3dImmediateContext->UpdateSubresource(m_pShadingParamsCB, 0, NULL, data, 0, 0);
-
-            pd3dImmediateContext->DrawIndexed( (UINT)pSubset->IndexCount, (UINT)pSubset->IndexStart, (UINT)pSubset->VertexStart );
-        }
-    }
-
-    virtual void Render(ID3D11DeviceContext* pd3dImmediateContext, ID3D11RenderTargetView *pBackBuffer) = 0;
-
-    static UINT GetNumGeometryPasses()
-    {
-        return m_NumGeomPasses;
-    }
-
-    static void ResetNumGeometryPasses()
-    {
-        m_NumGeomPasses = 0;
-    }
-
-    static void SetAlpha(float alpha)
-    {
-        m_Alpha = alpha;
-    }
-
-    static float GetAlpha()
-    {
-        return m_Alpha;
-    }
-
-protected:
-    static UINT m_NumGeomPasses;
-    static float m_Alpha;
-
-    void CreateDepthStencilStates(ID3D11Device* pd3dDevice)
-    {
-        HRESULT hr;
-
-        D3D11_DEPTH_STENCIL_DESC depthstencilState;
-        depthstencilState.DepthEnable = TRUE;
-        depthstencilState.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-        depthstencilState.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-        depthstencilState.StencilEnable = FALSE;
-        V( pd3dDevice->CreateDepthStencilState( &depthstencilState, &m_pDepthNoStencilDS) );
-
-        depthstencilState.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
-        depthstencilState.DepthEnable = FALSE;
-        depthstencilState.StencilEnable = FALSE;
-        V( pd3dDevice->CreateDepthStencilState( &depthstencilState, &m_pNoDepthNoStencilDS) );
-
-        depthstencilState.DepthEnable = TRUE;
-        depthstencilState.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
-        depthstencilState.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-        depthstencilState.StencilEnable = FALSE;
-        pd3dDevice->CreateDepthStencilState( &depthstencilState, &m_pDepthNoWriteDS );
-    }
-
-    void CreateRasterizerState(ID3D11Device* pd3dDevice)
-    {
-        HRESULT hr;
-
-        D3D11_RASTERIZER_DESC rasterizerState;
-        rasterizerState.FillMode = D3D11_FILL_SOLID;
-        rasterizerState.CullMode = D3D11_CULL_NONE;
-        rasterizerState.FrontCounterClockwise = FALSE;
-        rasterizerState.DepthBias = FALSE;
-        rasterizerState.DepthBiasClamp = 0;
-        rasterizerState.SlopeScaledDepthBias = 0;
-        rasterizerState.DepthClipEnable = FALSE;
-        rasterizerState.ScissorEnable = FALSE;
-        rasterizerState.MultisampleEnable = FALSE;
-        rasterizerState.AntialiasedLineEnable = FALSE;
-        V( pd3dDevice->CreateRasterizerState( &rasterizerState, &m_pNoCullRS ) );
-    }
-
-    void CreateBlendStates(ID3D11Device* pd3dDevice)
-    {
-        HRESULT hr;
-
-        //--------------------------------------------------------------------------------------
-        // Front-to-back alpha-blending
-        //--------------------------------------------------------------------------------------
-
-        D3D11_BLEND_DESC blendState;
-        blendState.AlphaToCoverageEnable = FALSE;
-        // If IndependentBlendEnable==FALSE, only the RenderTarget[0] members are used.
-        blendState.IndependentBlendEnable = TRUE;
-        {
-            blendState.RenderTarget[0].BlendEnable = TRUE;
-            blendState.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-        }
-        for (int i = 1; i < 8; ++i)
-        {
-            blendState.RenderTarget[i].BlendEnable = FALSE;
-            blendState.RenderTarget[i].RenderTargetWriteMask = 0;
-        }
-        blendState.RenderTarget[0].SrcBlend = D3D11_BLEND_DEST_ALPHA;
-        blendState.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
-        blendState.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
-        blendState.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ZERO;
-        blendState.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
-        blendState.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-        V( pd3dDevice->CreateBlendState( &blendState, &m_pFrontToBackBlendBS ));
-
-        //--------------------------------------------------------------------------------------
-        // Back-to-front alpha-blending
-        //--------------------------------------------------------------------------------------
-
-        blendState.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
-        blendState.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
-        blendState.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
-        blendState.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ZERO;
-        blendState.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ONE;
-        blendState.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-        V( pd3dDevice->CreateBlendState( &blendState, &m_pBackToFrontBlendBS ));
-
-        //--------------------------------------------------------------------------------------
-        // No blending
-        //--------------------------------------------------------------------------------------
-
-        blendState.IndependentBlendEnable = FALSE;
-        for (int i = 0; i < 8; ++i)
-        {
-            blendState.RenderTarget[i].BlendEnable = FALSE;
-            blendState.RenderTarget[i].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-        }
-        V( pd3dDevice->CreateBlendState( &blendState, &m_pNoBlendBS ));
-
-        //--------------------------------------------------------------------------------------
-        // Default blend factor
-        //--------------------------------------------------------------------------------------
-
-        m_BlendFactor[0] =
-        m_BlendFactor[1] =
-        m_BlendFactor[2] =
-        m_BlendFactor[3] = 1.0f;
-    }
-
-    void CreateVertexShaders(ID3D11Device* pd3dDevice)
-    {
-        HRESULT hr;
-
-        // Input layout description for all the geometry passes
-        const D3D11_INPUT_ELEMENT_DESC InputLayoutDesc[] =
-        {
-            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-            { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        };
-        UINT NumElements = sizeof(InputLayoutDesc)/sizeof(InputLayoutDesc[0]);
-
-        // Vertex shader and input layout for the geometry passes
-		V(pd3dDevice->CreateVertexShader(g_GeometryVS, sizeof(g_GeometryVS), NULL, &m_pGeometryVS));
-		V(pd3dDevice->CreateInputLayout(InputLayoutDesc, NumElements, g_GeometryVS, sizeof(g_GeometryVS), &m_pInputLayout));
-
-        // Vertex shader for the full-screen passes
-        V( pd3dDevice->CreateVertexShader(g_FullScreenTriangleVS, sizeof(g_FullScreenTriangleVS), NULL, &m_pFullScreenTriangleVS) );
-    }
-
-    void CreateConstantBuffers(ID3D11Device* pd3dDevice)
-    {
-        HRESULT hr;
-
-        D3D11_BUFFER_DESC cbDesc;
-        cbDesc.ByteWidth = sizeof(CBData);
-        cbDesc.Usage = D3D11_USAGE_DEFAULT;
-        cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-        cbDesc.CPUAccessFlags = 0;
-        cbDesc.MiscFlags = 0;
-        cbDesc.StructureByteStride = 0; // new in D3D11
-        V( pd3dDevice->CreateBuffer(&cbDesc, NULL, &m_pParamsCB) );
-
-        cbDesc.ByteWidth = sizeof(float) * 4;
-        V( pd3dDevice->CreateBuffer(&cbDesc, NULL, &m_pShadingParamsCB) );
-    }
-
-    ID3D11RasterizerState* m_pNoCullRS;
-    ID3D11DepthStencilState *m_pDepthNoStencilDS;
-    ID3D11DepthStencilState *m_pNoDepthNoStencilDS;
-    ID3D11DepthStencilState *m_pDepthNoWriteDS;
-    ID3D11BlendState *m_pFrontToBackBlendBS;
-    ID3D11BlendState *m_pBackToFrontBlendBS;
-    ID3D11BlendState *m_pNoBlendBS;
-    ID3D11VertexShader *m_pGeometryVS;
-    ID3D11VertexShader *m_pFullScreenTriangleVS;
-    ID3D11Buffer *m_pParamsCB;
-    ID3D11Buffer *m_pShadingParamsCB;
-    ID3D11InputLayout *m_pInputLayout;
-    float m_BlendFactor[4];
-    DirectX::XMFLOAT3 m_BackgroundColor;
-
-    // With D3D10 and 11, constant buffers need to be float4 aligned
-    struct
-    {
-        // float4 aligned
-        DirectX::XMFLOAT4X4 worldViewProj;
-		DirectX::XMFLOAT4X4 worldViewIT;
-        // float4 aligned
-        UINT randMaskSizePowOf2MinusOne;
-        UINT randMaskAlphaValues;
-        UINT randomOffset;
-        UINT pad;
-    } CBData;
-};
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA 
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR  
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS 
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY 
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE, 
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+#include "SimpleRT.h"
+#include "RHI.h"
+#include "CommandList.h"
+#include "TileClassification.h"
+#include <DirectXMath.h>
+#include <string.h>
+
+#include "BaseTechnique_FullScreenTriangleVS.h"
+#include "BaseTechnique_OpaquePS.h"
+#include "BaseTechnique_TileClassificationPS.h"
+#include "BaseTechnique_TileClassificationOpaquePS.h"
+#include "BaseTechnique_ActiveTileVS.h"
+#include "BaseTechnique_InactiveTileVS.h"
+#include "BaseTechnique_TileCopyPS.h"
+#include "BaseTechnique_UpsamplePS.h"
+#include "BaseTechnique_UpsampleDepthPS.h"
+
+// Shader resource slot of the tile classes, read by the tile vertex shaders
+#define TILE_CLASSES_SLOT 3
+
+// Must match UPSAMPLE_DEPTH_SCALE and UPSAMPLE_MIN_WEIGHT in BaseTechnique.hlsli
+// Depth difference that rejects a low-resolution texel entirely: 1 / 64
+#define UPSAMPLE_DEPTH_SCALE 64.f
+// Total bilinear weight under which the texel of the nearest depth is taken instead
+#define UPSAMPLE_MIN_WEIGHT 1e-3f
+
+// Recorded variants of the passes, for the techniques that alternate between
+// resources from one frame to the next (see GetCommandListIndex)
+#define MAX_RECORDED_COMMAND_LISTS 2
+
+// Size of the internal render targets, rounded up so that they cover the back buffer
+inline UINT GetReducedSize(UINT Size, UINT ResolutionScale)
+{
+    return (Size + ResolutionScale - 1) / ResolutionScale;
+}
+
+//--------------------------------------------------------------------------------------
+// The techniques only create their resources through an RHIDevice and record their
+// passes in a CommandList, so they do not depend on the backend. The scene geometry
+// is drawn by the backend context for every CMD_DRAW_MESH (see RHI_D3D11.h).
+//--------------------------------------------------------------------------------------
+class BaseTechnique
+{
+public:
+    // The techniques render at Width / ResolutionScale x Height / ResolutionScale, and
+    // upsample their result into the Width x Height back buffer (see RecordUpsample)
+    BaseTechnique(RHIDevice* pDevice, UINT Width, UINT Height, UINT ResolutionScale)
+        : m_pNoCullRS(NULL)
+        , m_pDepthNoStencilDS(NULL)
+        , m_pNoDepthNoStencilDS(NULL)
+        , m_pDepthNoWriteDS(NULL)
+        , m_pFrontToBackBlendBS(NULL)
+        , m_pBackToFrontBlendBS(NULL)
+        , m_pNoBlendBS(NULL)
+        , m_pFullScreenTriangleVS(NULL)
+        , m_pOpaquePS(NULL)
+        , m_pActiveTileVS(NULL)
+        , m_pInactiveTileVS(NULL)
+        , m_pTileClassificationPS(NULL)
+        , m_pTileClassificationOpaquePS(NULL)
+        , m_pTileCopyPS(NULL)
+        , m_pUpsamplePS(NULL)
+        , m_pUpsampleDepthPS(NULL)
+        , m_pTileClasses(NULL)
+        , m_pTileTransmittance(NULL)
+        , m_pTileOpaqueDepth(NULL)
+        , m_TileClassification(false)
+        , m_pReducedTarget(NULL)
+        , m_pUpsampleDepth(NULL)
+        , m_ResolutionScale(ResolutionScale)
+        , m_Width(GetReducedSize(Width, ResolutionScale))
+        , m_Height(GetReducedSize(Height, ResolutionScale))
+        , m_BackgroundColor(DirectX::XMFLOAT3(1.f,1.f,1.f))
+        , m_PreserveTriangleOrder(false)
+        , m_OpaqueGeometry(false)
+    {
+        for (UINT i = 0; i < MAX_RECORDED_COMMAND_LISTS; ++i)
+        {
+            m_pRecordedBackBuffer[i] = NULL;
+            m_CommandsValid[i] = false;
+        }
+
+        CreateRasterizerState(pDevice);
+        CreateDepthStencilStates(pDevice);
+        CreateBlendStates(pDevice);
+        CreateVertexShaders(pDevice);
+        CreatePixelShaders(pDevice);
+        CreateUpsampleTargets(pDevice, Width, Height);
+
+        CBData.screenSize = DirectX::XMFLOAT4((float)m_Width, (float)m_Height, 1.f / (float)m_Width, 1.f / (float)m_Height);
+        CBData.upsampleSize = DirectX::XMFLOAT4((float)Width, (float)Height, 1.f / (float)Width, 1.f / (float)Height);
+        DirectX::XMStoreFloat4x4(&CBData.currentToPrevious, DirectX::XMMatrixIdentity());
+        CBData.temporalParams = DirectX::XMFLOAT4(0.f, 0.f, 0.f, 0.f);
+    }
+
+    void UpdateMatrices(DirectX::XMFLOAT4X4 &ModelViewProj, DirectX::XMFLOAT4X4 &ModelViewIT)
+    {
+        memcpy(&CBData.worldViewProj, &ModelViewProj, sizeof(DirectX::XMFLOAT4X4));
+        memcpy(&CBData.worldViewIT, &ModelViewIT, sizeof(DirectX::XMFLOAT4X4));
+    }
+
+    void SetPositionDequantization(const DirectX::XMFLOAT4 &PositionScale, const DirectX::XMFLOAT4 &PositionBias)
+    {
+        CBData.positionScale = PositionScale;
+        CBData.positionBias = PositionBias;
+    }
+
+    // Uploads the constants of the frame and submits the recorded passes of the frame,
+    // recording them first if the back buffer changed or InvalidateCommands was called
+    void Render(RHIContext &Context, RHIView *pBackBuffer)
+    {
+        BeginFrame();
+        Context.UploadConstants(&CBData, sizeof(CBData), m_Alpha);
+
+        const UINT Index = GetCommandListIndex();
+        CommandList &Commands = m_Commands[Index];
+        if (!m_CommandsValid[Index] || pBackBuffer != m_pRecordedBackBuffer[Index])
+        {
+            Commands.Clear();
+            RecordPasses(Commands, pBackBuffer);
+            m_pRecordedBackBuffer[Index] = pBackBuffer;
+            m_CommandsValid[Index] = true;
+        }
+
+        m_NumGeomPasses += Commands.GetNumMeshDraws(MESH_DRAW_LIST_TRANSPARENT);
+
+        Context.Submit(Commands, m_PreserveTriangleOrder);
+    }
+
+    // Called when a parameter that changes the pass sequence is modified
+    void InvalidateCommands()
+    {
+        for (UINT i = 0; i < MAX_RECORDED_COMMAND_LISTS; ++i)
+        {
+            m_CommandsValid[i] = false;
+        }
+    }
+
+    // Passes of the last frame
+    const CommandList& GetCommands() const
+    {
+        return m_Commands[GetCommandListIndex()];
+    }
+
+    // Renders the opaque draw list of the scene before the transparent passes,
+    // which then reject the fragments hidden by the opaque geometry
+    void SetOpaqueGeometry(bool OpaqueGeometry)
+    {
+        if (OpaqueGeometry != m_OpaqueGeometry)
+        {
+            m_OpaqueGeometry = OpaqueGeometry;
+            InvalidateCommands();
+        }
+    }
+
+    // Classifies the screen in tiles before the composite, which then only runs its
+    // shader on the tiles with transparent fragments and copies the background elsewhere
+    void SetTileClassification(bool TileClassification)
+    {
+        if (TileClassification != m_TileClassification)
+        {
+            m_TileClassification = TileClassification;
+            InvalidateCommands();
+        }
+    }
+
+    // R32_UINT target with the TileClass of every tile of the last frame,
+    // or NULL if the technique does not classify the tiles
+    RHITexture* GetTileClasses() const
+    {
+        return IsTileCompositeEnabled() ? m_pTileClasses->pTexture : NULL;
+    }
+
+    // Inputs of the classification of the last frame, for the CPU reference (see TileClassification.h).
+    // *ppOpaqueDepth is NULL without opaque geometry.
+    void GetTileClassificationInputs(RHITexture **ppTransmittance, RHITexture **ppOpaqueDepth) const
+    {
+        *ppTransmittance = m_pTileTransmittance ? m_pTileTransmittance->GetTexture() : NULL;
+        *ppOpaqueDepth = m_pTileOpaqueDepth ? m_pTileOpaqueDepth->GetTexture() : NULL;
+    }
+
+    // Divisor of the size of the internal render targets, fixed at creation
+    UINT GetResolutionScale() const
+    {
+        return m_ResolutionScale;
+    }
+
+    // Single-sampled D32_FLOAT depth of the opaque geometry of the last frame, read back
+    // for the Hi-Z occlusion culling, or NULL if the technique has none
+    virtual RHITexture* GetOpaqueDepth() const
+    {
+        return NULL;
+    }
+
+    ~BaseTechnique()
+    {
+        SAFE_DELETE(m_pNoCullRS);
+        SAFE_DELETE(m_pDepthNoStencilDS);
+        SAFE_DELETE(m_pDepthNoWriteDS);
+        SAFE_DELETE(m_pNoDepthNoStencilDS);
+        SAFE_DELETE(m_pFrontToBackBlendBS);
+        SAFE_DELETE(m_pBackToFrontBlendBS);
+        SAFE_DELETE(m_pNoBlendBS);
+        SAFE_DELETE(m_pFullScreenTriangleVS);
+        SAFE_DELETE(m_pOpaquePS);
+        SAFE_DELETE(m_pActiveTileVS);
+        SAFE_DELETE(m_pInactiveTileVS);
+        SAFE_DELETE(m_pTileClassificationPS);
+        SAFE_DELETE(m_pTileClassificationOpaquePS);
+        SAFE_DELETE(m_pTileCopyPS);
+        SAFE_DELETE(m_pUpsamplePS);
+        SAFE_DELETE(m_pUpsampleDepthPS);
+        SAFE_DELETE(m_pTileClasses);
+        SAFE_DELETE(m_pReducedTarget);
+        SAFE_DELETE(m_pUpsampleDepth);
+    }
+
+    // Records the state changes and draws of all the passes, without touching the device
+    virtual void RecordPasses(CommandList &Commands, RHIView *pBackBuffer) = 0;
+
+    // Called by Render before the upload of the constants, for the per-frame state
+    virtual void BeginFrame()
+    {
+    }
+
+    // Recorded variant of the passes used by the frame, after BeginFrame.
+    // RecordPasses records the variant of the current frame.
+    virtual UINT GetCommandListIndex() const
+    {
+        return 0;
+    }
+
+    static UINT GetNumGeometryPasses()
+    {
+        return m_NumGeomPasses;
+    }
+
+    static void ResetNumGeometryPasses()
+    {
+        m_NumGeomPasses = 0;
+    }
+
+    static void SetAlpha(float alpha)
+    {
+        m_Alpha = alpha;
+    }
+
+    static float GetAlpha()
+    {
+        return m_Alpha;
+    }
+
+protected:
+    static UINT m_NumGeomPasses;
+    static float m_Alpha;
+
+    void CreateDepthStencilStates(RHIDevice* pDevice)
+    {
+        RHIDepthStencilDesc depthstencilState;
+        depthstencilState.DepthEnable = true;
+        depthstencilState.DepthWriteEnable = true;
+        depthstencilState.DepthFunc = RHI_COMPARISON_LESS_EQUAL;
+        m_pDepthNoStencilDS = pDevice->CreateDepthStencilState(depthstencilState);
+
+        depthstencilState.DepthWriteEnable = false;
+        depthstencilState.DepthEnable = false;
+        m_pNoDepthNoStencilDS = pDevice->CreateDepthStencilState(depthstencilState);
+
+        depthstencilState.DepthEnable = true;
+        depthstencilState.DepthWriteEnable = false;
+        depthstencilState.DepthFunc = RHI_COMPARISON_LESS_EQUAL;
+        m_pDepthNoWriteDS = pDevice->CreateDepthStencilState(depthstencilState);
+    }
+
+    void CreateRasterizerState(RHIDevice* pDevice)
+    {
+        RHIRasterizerDesc rasterizerState;
+        rasterizerState.CullMode = RHI_CULL_NONE;
+        rasterizerState.FrontCounterClockwise = false;
+        rasterizerState.DepthClipEnable = false;
+        m_pNoCullRS = pDevice->CreateRasterizerState(rasterizerState);
+    }
+
+    void CreateBlendStates(RHIDevice* pDevice)
+    {
+        //--------------------------------------------------------------------------------------
+        // Front-to-back alpha-blending
+        //--------------------------------------------------------------------------------------
+
+        RHIBlendDesc blendState;
+        blendState.AlphaToCoverageEnable = false;
+        // If IndependentBlendEnable==false, only the RenderTarget[0] members are used.
+        blendState.IndependentBlendEnable = true;
+        {
+            blendState.RenderTarget[0].BlendEnable = true;
+            blendState.RenderTarget[0].RenderTargetWriteMask = RHI_COLOR_WRITE_ENABLE_ALL;
+        }
+        for (int i = 1; i < RHI_MAX_RENDER_TARGETS; ++i)
+        {
+            blendState.RenderTarget[i].BlendEnable = false;
+            blendState.RenderTarget[i].RenderTargetWriteMask = 0;
+        }
+        blendState.RenderTarget[0].SrcBlend = RHI_BLEND_DEST_ALPHA;
+        blendState.RenderTarget[0].DestBlend = RHI_BLEND_ONE;
+        blendState.RenderTarget[0].BlendOp = RHI_BLEND_OP_ADD;
+        blendState.RenderTarget[0].SrcBlendAlpha = RHI_BLEND_ZERO;
+        blendState.RenderTarget[0].DestBlendAlpha = RHI_BLEND_INV_SRC_ALPHA;
+        blendState.RenderTarget[0].BlendOpAlpha = RHI_BLEND_OP_ADD;
+        m_pFrontToBackBlendBS = pDevice->CreateBlendState(blendState);
+
+        //--------------------------------------------------------------------------------------
+        // Back-to-front alpha-blending
+        //--------------------------------------------------------------------------------------
+
+        blendState.RenderTarget[0].SrcBlend = RHI_BLEND_SRC_ALPHA;
+        blendState.RenderTarget[0].DestBlend = RHI_BLEND_INV_SRC_ALPHA;
+        blendState.RenderTarget[0].BlendOp = RHI_BLEND_OP_ADD;
+        blendState.RenderTarget[0].SrcBlendAlpha = RHI_BLEND_ZERO;
+        blendState.RenderTarget[0].DestBlendAlpha = RHI_BLEND_ONE;
+        blendState.RenderTarget[0].BlendOpAlpha = RHI_BLEND_OP_ADD;
+        m_pBackToFrontBlendBS = pDevice->CreateBlendState(blendState);
+
+        //--------------------------------------------------------------------------------------
+        // No blending
+        //--------------------------------------------------------------------------------------
+
+        blendState.IndependentBlendEnable = false;
+        for (int i = 0; i < RHI_MAX_RENDER_TARGETS; ++i)
+        {
+            blendState.RenderTarget[i].BlendEnable = false;
+            blendState.RenderTarget[i].RenderTargetWriteMask = RHI_COLOR_WRITE_ENABLE_ALL;
+        }
+        m_pNoBlendBS = pDevice->CreateBlendState(blendState);
+
+        //--------------------------------------------------------------------------------------
+        // Default blend factor
+        //--------------------------------------------------------------------------------------
+
+        m_BlendFactor[0] =
+        m_BlendFactor[1] =
+        m_BlendFactor[2] =
+        m_BlendFactor[3] = 1.0f;
+    }
+
+    void CreateVertexShaders(RHIDevice* pDevice)
+    {
+        // Vertex shader for the full-screen passes.
+        // The vertex shaders of the geometry passes belong to the backend context.
+        m_pFullScreenTriangleVS = pDevice->CreateVertexShader(g_FullScreenTriangleVS, sizeof(g_FullScreenTriangleVS));
+        m_pActiveTileVS = pDevice->CreateVertexShader(g_ActiveTileVS, sizeof(g_ActiveTileVS));
+        m_pInactiveTileVS = pDevice->CreateVertexShader(g_InactiveTileVS, sizeof(g_InactiveTileVS));
+    }
+
+    void CreatePixelShaders(RHIDevice* pDevice)
+    {
+        m_pOpaquePS = pDevice->CreatePixelShader(g_OpaquePS, sizeof(g_OpaquePS));
+        m_pTileClassificationPS = pDevice->CreatePixelShader(g_TileClassificationPS, sizeof(g_TileClassificationPS));
+        m_pTileClassificationOpaquePS = pDevice->CreatePixelShader(g_TileClassificationOpaquePS, sizeof(g_TileClassificationOpaquePS));
+        m_pTileCopyPS = pDevice->CreatePixelShader(g_TileCopyPS, sizeof(g_TileCopyPS));
+        m_pUpsamplePS = pDevice->CreatePixelShader(g_UpsamplePS, sizeof(g_UpsamplePS));
+        m_pUpsampleDepthPS = pDevice->CreatePixelShader(g_UpsampleDepthPS, sizeof(g_UpsampleDepthPS));
+    }
+
+    // At a reduced resolution, the final passes write the reduced target instead of the back buffer,
+    // and the depth-aware upsampling compares the opaque depth with its full-resolution copy
+    void CreateUpsampleTargets(RHIDevice* pDevice, UINT Width, UINT Height)
+    {
+        if (m_ResolutionScale == 1) return;
+
+        RHITextureDesc texDesc;
+        texDesc.Width = m_Width;
+        texDesc.Height = m_Height;
+        texDesc.ArraySize = 1;
+        texDesc.SampleCount = 1;
+        texDesc.BindFlags = RHI_BIND_RENDER_TARGET | RHI_BIND_SHADER_RESOURCE;
+        m_pReducedTarget = new SimpleRT(pDevice, &texDesc, RHI_FORMAT_R8G8B8A8_UNORM);
+
+        texDesc.Width = Width;
+        texDesc.Height = Height;
+        texDesc.BindFlags = RHI_BIND_DEPTH_STENCIL | RHI_BIND_SHADER_RESOURCE;
+        texDesc.Format = RHI_FORMAT_D32_FLOAT;
+        m_pUpsampleDepth = new SimpleDepthStencil(pDevice, &texDesc);
+    }
+
+    // Called by the techniques with a tile composite, at the size of their render targets
+    void CreateTileClasses(RHIDevice* pDevice)
+    {
+        RHITextureDesc texDesc;
+        texDesc.Width = GetNumTiles(m_Width);
+        texDesc.Height = GetNumTiles(m_Height);
+        texDesc.ArraySize = 1;
+        texDesc.SampleCount = 1;
+        texDesc.BindFlags = RHI_BIND_RENDER_TARGET | RHI_BIND_SHADER_RESOURCE;
+        m_pTileClasses = new SimpleRT(pDevice, &texDesc, RHI_FORMAT_R32_UINT);
+    }
+
+    bool IsTileCompositeEnabled() const
+    {
+        return m_TileClassification && m_pTileClasses;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Composite through the tile classes. The transparent tiles run pCompositePS with its
+    // NumSRVs resources, the other tiles copy pCopySource. pTransmittance holds the transmittance
+    // of the transparent layers in alpha, as cleared to 1.0, and pOpaqueDepth may be NULL.
+    // Expects the frame constants to be bound.
+    //--------------------------------------------------------------------------------------
+    void RecordTileComposite(CommandList &Commands, RHIView *pBackBuffer, RHIShader *pCompositePS, UINT NumSRVs, RHIView *const *ppSRVs,
+                             RHIView *pTransmittance, RHIView *pOpaqueDepth, RHIView *pCopySource)
+    {
+        const RHITextureDesc &Desc = m_pTileClasses->pTexture->GetDesc();
+        const UINT NumTileVertices = Desc.Width * Desc.Height * 6;
+
+        m_pTileTransmittance = pTransmittance;
+        m_pTileOpaqueDepth = pOpaqueDepth;
+
+        Commands.BeginEvent(L"Tile Classification");
+        Commands.SetRenderTargets(1, &m_pTileClasses->pRTV, NULL);
+        Commands.SetDepthStencilState(m_pNoDepthNoStencilDS, 0);
+        Commands.SetBlendState(m_pNoBlendBS, m_BlendFactor, 0xffffffff);
+        Commands.SetVertexShader(m_pFullScreenTriangleVS);
+        Commands.SetPixelShader(pOpaqueDepth ? m_pTileClassificationOpaquePS : m_pTileClassificationPS);
+        RHIView *pClassificationSRVs[2] = { pOpaqueDepth, pTransmittance };
+        Commands.SetPSResources(0, 2, pClassificationSRVs);
+        Commands.Draw(3, 0);
+        Commands.EndEvent();
+
+        Commands.SetRenderTargets(1, &pBackBuffer, NULL);
+        Commands.SetVSResources(TILE_CLASSES_SLOT, 1, &m_pTileClasses->pSRV);
+
+        Commands.SetVertexShader(m_pActiveTileVS);
+        Commands.SetPixelShader(pCompositePS);
+        Commands.SetPSResources(0, NumSRVs, ppSRVs);
+        Commands.Draw(NumTileVertices, 0);
+
+        Commands.SetVertexShader(m_pInactiveTileVS);
+        Commands.SetPixelShader(m_pTileCopyPS);
+        Commands.SetPSResources(0, 1, &pCopySource);
+        Commands.Draw(NumTileVertices, 0);
+
+        // The tile classes are the render target of the next classification
+        RHIView *pNULLSRV = NULL;
+        Commands.SetVSResources(TILE_CLASSES_SLOT, 1, &pNULLSRV);
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Renders the opaque draw list into pRTV and pDSV, which must have the same sample count.
+    // The depth pre-pass has no pixel shader, so the color pass only shades the visible surfaces.
+    // Expects the frame constants and the rasterizer state to be bound.
+    //--------------------------------------------------------------------------------------
+    void RecordOpaquePass(CommandList &Commands, RHIView *pRTV, RHIView *pDSV)
+    {
+        Commands.BeginEvent(L"Opaque Depth Pre-Pass");
+        Commands.SetRenderTargets(0, NULL, pDSV);
+        Commands.SetBlendState(m_pNoBlendBS, m_BlendFactor, 0xffffffff);
+        Commands.SetDepthStencilState(m_pDepthNoStencilDS, 0);
+        Commands.SetPixelShader(NULL);
+        Commands.DrawMesh(MESH_DRAW_LIST_OPAQUE);
+        Commands.EndEvent();
+
+        Commands.BeginEvent(L"Opaque Color Pass");
+        Commands.SetRenderTargets(1, &pRTV, pDSV);
+        Commands.SetDepthStencilState(m_pDepthNoWriteDS, 0);
+        Commands.SetPixelShader(m_pOpaquePS);
+        Commands.DrawMesh(MESH_DRAW_LIST_OPAQUE);
+        Commands.EndEvent();
+    }
+
+    // Target of the final passes: the back buffer, or the reduced target upsampled into it
+    RHIView* GetFinalTarget(RHIView *pBackBuffer) const
+    {
+        return m_pReducedTarget ? m_pReducedTarget->pRTV : pBackBuffer;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Upsamples the reduced target into the back buffer, after the final passes. With the
+    // single-sampled D32_FLOAT opaque depth of the internal resolution, the opaque draw list
+    // is first rendered again into a full-resolution depth buffer, and the bilinear weights
+    // of the 4 nearest texels are scaled down where their depth differs from the pixel, so
+    // that the silhouettes of the opaque geometry stay sharp. Does nothing at full resolution.
+    // Expects the frame constants and the rasterizer state to be bound.
+    //--------------------------------------------------------------------------------------
+    void RecordUpsample(CommandList &Commands, RHIView *pBackBuffer, RHIView *pOpaqueDepth)
+    {
+        if (!m_pReducedTarget) return;
+
+        Commands.BeginEvent(L"Upsample Pass");
+
+        RHIView *pSRVs[3] = { m_pReducedTarget->pSRV, pOpaqueDepth, m_pUpsampleDepth->pSRV };
+        if (pOpaqueDepth)
+        {
+            Commands.ClearDepth(m_pUpsampleDepth->pDSV, 1.0);
+            Commands.SetRenderTargets(0, NULL, m_pUpsampleDepth->pDSV);
+            Commands.SetBlendState(m_pNoBlendBS, m_BlendFactor, 0xffffffff);
+            Commands.SetDepthStencilState(m_pDepthNoStencilDS, 0);
+            Commands.SetPixelShader(NULL);
+            Commands.DrawMesh(MESH_DRAW_LIST_OPAQUE);
+        }
+
+        Commands.SetRenderTargets(1, &pBackBuffer, NULL);
+        Commands.SetDepthStencilState(m_pNoDepthNoStencilDS, 0);
+        Commands.SetBlendState(m_pNoBlendBS, m_BlendFactor, 0xffffffff);
+
+        Commands.SetVertexShader(m_pFullScreenTriangleVS);
+        Commands.SetPixelShader(pOpaqueDepth ? m_pUpsampleDepthPS : m_pUpsamplePS);
+        Commands.SetPSResources(0, pOpaqueDepth ? 3 : 1, pSRVs);
+
+        Commands.Draw(3, 0);
+
+        // The reduced target and the depth buffers are written by the next frame
+        RHIView *pNULLSRVs[3] = { NULL, NULL, NULL };
+        Commands.SetPSResources(0, 3, pNULLSRVs);
+
+        Commands.EndEvent();
+    }
+
+    RHIRasterizerState* m_pNoCullRS;
+    RHIDepthStencilState *m_pDepthNoStencilDS;
+    RHIDepthStencilState *m_pNoDepthNoStencilDS;
+    RHIDepthStencilState *m_pDepthNoWriteDS;
+    RHIBlendState *m_pFrontToBackBlendBS;
+    RHIBlendState *m_pBackToFrontBlendBS;
+    RHIBlendState *m_pNoBlendBS;
+    RHIShader *m_pFullScreenTriangleVS;
+    RHIShader *m_pOpaquePS;
+    RHIShader *m_pActiveTileVS;
+    RHIShader *m_pInactiveTileVS;
+    RHIShader *m_pTileClassificationPS;
+    RHIShader *m_pTileClassificationOpaquePS;
+    RHIShader *m_pTileCopyPS;
+    RHIShader *m_pUpsamplePS;
+    RHIShader *m_pUpsampleDepthPS;
+    SimpleRT *m_pTileClasses;
+    RHIView *m_pTileTransmittance;
+    RHIView *m_pTileOpaqueDepth;
+    bool m_TileClassification;
+    SimpleRT *m_pReducedTarget;
+    SimpleDepthStencil *m_pUpsampleDepth;
+    UINT m_ResolutionScale;
+    // Size of the internal render targets
+    UINT m_Width;
+    UINT m_Height;
+    CommandList m_Commands[MAX_RECORDED_COMMAND_LISTS];
+    RHIView *m_pRecordedBackBuffer[MAX_RECORDED_COMMAND_LISTS];
+    bool m_CommandsValid[MAX_RECORDED_COMMAND_LISTS];
+    float m_BlendFactor[4];
+    DirectX::XMFLOAT3 m_BackgroundColor;
+    // Techniques whose result depends on the draw order use the authoring triangle order
+    bool m_PreserveTriangleOrder;
+    bool m_OpaqueGeometry;
+
+    // With D3D10 and 11, constant buffers need to be float4 aligned
+    struct
+    {
+        // float4 aligned
+        DirectX::XMFLOAT4X4 worldViewProj;
+		DirectX::XMFLOAT4X4 worldViewIT;
+        // float4 aligned
+        DirectX::XMFLOAT4 positionScale;
+        DirectX::XMFLOAT4 positionBias;
+        // float4 aligned
+        UINT randMaskSizePowOf2MinusOne;
+        UINT randMaskAlphaValues;
+        UINT randomOffset;
+        float stochasticDepthBias;
+        // float4 aligned
+        DirectX::XMFLOAT4 screenSize;
+        DirectX::XMFLOAT4 upsampleSize;
+        // float4 aligned
+        DirectX::XMFLOAT4X4 currentToPrevious;
+        DirectX::XMFLOAT4 temporalParams;
+    } CBData;
+};
@@ -1,84 +1,295 @@
-// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
-//
-// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
-// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
-// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
-// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA 
-// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR  
-// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS 
-// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY 
-// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE, 
-// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
-//
-// Please direct any bugs or questions to SDKFeedback@nvidia.com
-
-#pragma pack_matrix(row_major)
-
-// Declare constant buffer at buffer slot 0
-cbuffer GlobalConstants : register(b0)
-{
-    // float4 aligned
-    float4x4 g_worldViewProj;
-    float4x4 g_worldViewIT;
-    // float4 aligned
-    uint g_randMaskSizePowOf2MinusOne;
-    uint g_randMaskAlphaValues;
-    uint g_randomOffset;
-    uint g_pad;
-};
-
-// Declare constant buffer at buffer slot 1
-cbuffer ShadingConstants : register(b1)
-{
-    float4 g_color;
-}
-
-//--------------------------------------------------------------------------------------
-// Geometry rendering
-//--------------------------------------------------------------------------------------
-
-struct Geometry_VSIn
-{
-    float4 position : position;
-    float3 normal   : normal;
-};
-
-// Use centroid interpolation for the normal to avoid any shading artifacts with MSAA
-struct Geometry_VSOut
-{
-    centroid float4 HPosition            : SV_Position;
-    centroid float3 Normal      : TexCoord;
-};
-
-Geometry_VSOut GeometryVS ( Geometry_VSIn IN )
-{
-    Geometry_VSOut OUT;
-    OUT.HPosition = mul(IN.position, g_worldViewProj);
-    OUT.Normal = normalize(mul(IN.normal, (float3x3)g_worldViewIT).xyz);
-    return OUT;
-}
-
-float4 ShadeFragment( float3 Normal )
-{
-    return float4(g_color.rgb * abs(Normal.z), g_color.a);
-}
-
-//--------------------------------------------------------------------------------------
-// Full-screen rendering
-//--------------------------------------------------------------------------------------
-
-struct FullscreenVSOut
-{
-    float4 pos : SV_Position;
-    float2 tex : TEXCOORD;
-};
-
-// Vertex shader that generates a full screen quad with texcoords from vertexIDs
-// To use, draw 3 vertices with primitive type triangle list
-FullscreenVSOut FullScreenTriangleVS( uint id : SV_VertexID )
-{
-    FullscreenVSOut output = (FullscreenVSOut)0.0f;
-    output.tex = float2( (id << 1) & 2, id & 2 );
-    output.pos = float4( output.tex * float2( 2.0f, -2.0f ) + float2( -1.0f, 1.0f), 0.0f, 1.0f );
-    return output;
-}
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA 
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR  
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS 
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY 
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE, 
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+#pragma pack_matrix(row_major)
+
+// Declare constant buffer at buffer slot 0
+cbuffer GlobalConstants : register(b0)
+{
+    // float4 aligned
+    float4x4 g_worldViewProj;
+    float4x4 g_worldViewIT;
+    // Dequantization of the compact vertex positions (see CompactMesh.h)
+    float4 g_positionScale;
+    float4 g_positionBias;
+    // float4 aligned
+    uint g_randMaskSizePowOf2MinusOne;
+    uint g_randMaskAlphaValues;
+    uint g_randomOffset;
+    // Rounding error of the stochastic depth format, subtracted from the fragment depths
+    float g_stochasticDepthBias;
+    // float4 aligned
+    // Width, height, 1/width and 1/height of the render targets, for the tile passes
+    float4 g_screenSize;
+    // Width, height, 1/width and 1/height of the back buffer, for the upsampling
+    float4 g_upsampleSize;
+    // float4 aligned
+    // Clip space of the frame to the one of the previous frame, for the temporal accumulation
+    float4x4 g_currentToPrevious;
+    // History weight, rejection scale, variance gamma and progressive flag (see TemporalAccumulation.h)
+    float4 g_temporalParams;
+};
+
+// Declare constant buffer at buffer slot 1
+cbuffer ShadingConstants : register(b1)
+{
+    float4 g_color;
+}
+
+// Per-instance transforms, replacing g_worldViewProj and g_worldViewIT (see Instances.h)
+struct InstanceTransform
+{
+    float4x4 worldViewProj;
+    float4x4 worldViewIT;
+};
+
+StructuredBuffer<InstanceTransform> g_instances : register(t0);
+
+//--------------------------------------------------------------------------------------
+// Geometry rendering
+//--------------------------------------------------------------------------------------
+
+// Compact vertex layout (see CompactMesh.h)
+struct Geometry_VSIn
+{
+    float4 position : position; // R16G16B16A16_UNORM, quantized to the mesh bounding box
+    float2 normal   : normal;   // R16G16_SNORM, octahedral-encoded
+};
+
+// Use centroid interpolation for the normal to avoid any shading artifacts with MSAA
+struct Geometry_VSOut
+{
+    centroid float4 HPosition            : SV_Position;
+    centroid float3 Normal      : TexCoord;
+};
+
+float4 DecodePosition( float4 position )
+{
+    return float4(position.xyz * g_positionScale.xyz + g_positionBias.xyz, 1.0);
+}
+
+// Must match DecodeOctahedral in CompactMesh.h
+float3 DecodeOctahedral( float2 e )
+{
+    float3 n = float3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += (n.xy >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+Geometry_VSOut GeometryVS ( Geometry_VSIn IN )
+{
+    Geometry_VSOut OUT;
+    OUT.HPosition = mul(DecodePosition(IN.position), g_worldViewProj);
+    OUT.Normal = normalize(mul(DecodeOctahedral(IN.normal), (float3x3)g_worldViewIT).xyz);
+    return OUT;
+}
+
+Geometry_VSOut InstancedGeometryVS ( Geometry_VSIn IN, uint InstanceId : SV_InstanceID )
+{
+    InstanceTransform Instance = g_instances[InstanceId];
+
+    Geometry_VSOut OUT;
+    OUT.HPosition = mul(DecodePosition(IN.position), Instance.worldViewProj);
+    OUT.Normal = normalize(mul(DecodeOctahedral(IN.normal), (float3x3)Instance.worldViewIT).xyz);
+    return OUT;
+}
+
+float4 ShadeFragment( float3 Normal )
+{
+    return float4(g_color.rgb * abs(Normal.z), g_color.a);
+}
+
+// Shading of the opaque draw list, after the depth pre-pass
+float4 OpaquePS ( Geometry_VSOut IN ) : SV_Target
+{
+    return float4(ShadeFragment(IN.Normal).rgb, 1.0);
+}
+
+// One per fragment, summed with additive blending by the depth complexity probe (see DepthComplexity.h)
+float DepthComplexityPS ( Geometry_VSOut IN ) : SV_Target
+{
+    return 1.0;
+}
+
+//--------------------------------------------------------------------------------------
+// Full-screen rendering
+//--------------------------------------------------------------------------------------
+
+struct FullscreenVSOut
+{
+    float4 pos : SV_Position;
+    float2 tex : TEXCOORD;
+};
+
+// Vertex shader that generates a full screen quad with texcoords from vertexIDs
+// To use, draw 3 vertices with primitive type triangle list
+FullscreenVSOut FullScreenTriangleVS( uint id : SV_VertexID )
+{
+    FullscreenVSOut output = (FullscreenVSOut)0.0f;
+    output.tex = float2( (id << 1) & 2, id & 2 );
+    output.pos = float4( output.tex * float2( 2.0f, -2.0f ) + float2( -1.0f, 1.0f), 0.0f, 1.0f );
+    return output;
+}
+
+//--------------------------------------------------------------------------------------
+// Tile classification, to run the composite only where transparent fragments landed
+//--------------------------------------------------------------------------------------
+
+// Must match TILE_SIZE and TileClass in TileClassification.h
+#define TILE_SIZE 16
+#define TILE_EMPTY 0
+#define TILE_TRANSPARENT 1
+#define TILE_OPAQUE 2
+
+Texture2D<float>  tTileOpaqueDepth   : register(t0);
+Texture2D<float4> tTileTransmittance : register(t1);    // Transmittance of the transparent layers in alpha
+Texture2D<float4> tTileCopySource    : register(t0);
+Texture2D<uint>   tTileClasses       : register(t3);    // Vertex shader resource, out of the way of the composite
+
+// A pixel without transparent fragment keeps the cleared transmittance of 1.0
+uint ClassifyTile(uint2 tile, bool opaqueDepth)
+{
+    uint2 first = tile * TILE_SIZE;
+    uint2 last = min(first + TILE_SIZE, (uint2)g_screenSize.xy);
+
+    bool covered = opaqueDepth;
+    [loop]
+    for (uint y = first.y; y < last.y; ++y)
+    {
+        [loop]
+        for (uint x = first.x; x < last.x; ++x)
+        {
+            if (tTileTransmittance.Load(int3(x, y, 0)).a < 1.0)
+            {
+                return TILE_TRANSPARENT;
+            }
+            if (opaqueDepth)
+            {
+                covered = covered && (tTileOpaqueDepth.Load(int3(x, y, 0)) < 1.0);
+            }
+        }
+    }
+    return covered ? TILE_OPAQUE : TILE_EMPTY;
+}
+
+// Rendered into the tile classes, one pixel per tile
+uint TileClassificationPS( FullscreenVSOut IN ) : SV_Target
+{
+    return ClassifyTile((uint2)IN.pos.xy, false);
+}
+
+uint TileClassificationOpaquePS( FullscreenVSOut IN ) : SV_Target
+{
+    return ClassifyTile((uint2)IN.pos.xy, true);
+}
+
+// Generates one quad (6 vertices) per tile, and moves the quad out of the
+// view volume unless the tile is transparent (or not, for the copy pass)
+FullscreenVSOut TileQuad( uint id, bool transparent )
+{
+    static const uint2 corners[6] = { uint2(0, 0), uint2(1, 0), uint2(0, 1), uint2(0, 1), uint2(1, 0), uint2(1, 1) };
+
+    uint tilesX = ((uint)g_screenSize.x + TILE_SIZE - 1) / TILE_SIZE;
+    uint2 tile = uint2((id / 6) % tilesX, (id / 6) / tilesX);
+    float2 pixel = min((float2)((tile + corners[id % 6]) * TILE_SIZE), g_screenSize.xy);
+
+    FullscreenVSOut output;
+    output.tex = pixel * g_screenSize.zw;
+    output.pos = float4( output.tex * float2( 2.0f, -2.0f ) + float2( -1.0f, 1.0f), 0.0f, 1.0f );
+    if ((tTileClasses.Load(int3(tile, 0)) == TILE_TRANSPARENT) != transparent)
+    {
+        output.pos = float4(2.0f, 2.0f, 2.0f, 1.0f);
+    }
+    return output;
+}
+
+FullscreenVSOut ActiveTileVS( uint id : SV_VertexID )
+{
+    return TileQuad(id, true);
+}
+
+FullscreenVSOut InactiveTileVS( uint id : SV_VertexID )
+{
+    return TileQuad(id, false);
+}
+
+// Copy-through of the pixels without transparency
+float4 TileCopyPS( FullscreenVSOut IN ) : SV_Target
+{
+    return float4(tTileCopySource.Load(int3(IN.pos.xy, 0)).rgb, 1.0);
+}
+
+//--------------------------------------------------------------------------------------
+// Upsampling of the reduced-resolution result into the back buffer
+//--------------------------------------------------------------------------------------
+
+// Must match UPSAMPLE_DEPTH_SCALE and UPSAMPLE_MIN_WEIGHT in BaseTechnique.h
+#define UPSAMPLE_DEPTH_SCALE 64.0
+#define UPSAMPLE_MIN_WEIGHT 1e-3
+
+Texture2D<float4> tUpsampleColor       : register(t0);
+Texture2D<float>  tUpsampleOpaqueDepth : register(t1);    // At the internal resolution
+Texture2D<float>  tUpsampleFullDepth   : register(t2);    // At the back buffer resolution
+
+// Bilinear filtering of the 4 nearest texels, each weighted by the similarity of its opaque depth
+// with the one of the pixel. Falls back to the texel with the nearest depth when none is similar.
+float4 UpsampleColor( float2 pixel, bool depthAware )
+{
+    float2 texel = pixel * g_upsampleSize.zw * g_screenSize.xy - 0.5;
+    int2 first = (int2)floor(texel);
+    float2 f = texel - first;
+    int2 last = (int2)g_screenSize.xy - 1;
+
+    float depth = depthAware ? tUpsampleFullDepth.Load(int3(pixel, 0)) : 0.0;
+
+    float4 sum = 0.0;
+    float sumWeights = 0.0;
+    float4 nearest = 0.0;
+    float nearestDifference = 2.0;
+    [unroll]
+    for (int j = 0; j < 2; ++j)
+    {
+        [unroll]
+        for (int i = 0; i < 2; ++i)
+        {
+            int2 t = clamp(first + int2(i, j), 0, last);
+            float4 color = tUpsampleColor.Load(int3(t, 0));
+            float weight = (i ? f.x : 1.0 - f.x) * (j ? f.y : 1.0 - f.y);
+            if (depthAware)
+            {
+                float difference = abs(tUpsampleOpaqueDepth.Load(int3(t, 0)) - depth);
+                weight *= saturate(1.0 - difference * UPSAMPLE_DEPTH_SCALE);
+                if (difference < nearestDifference)
+                {
+                    nearestDifference = difference;
+                    nearest = color;
+                }
+            }
+            sum += weight * color;
+            sumWeights += weight;
+        }
+    }
+    return (sumWeights > UPSAMPLE_MIN_WEIGHT) ? sum / sumWeights : nearest;
+}
+
+float4 UpsamplePS( FullscreenVSOut IN ) : SV_Target
+{
+    return float4(UpsampleColor(IN.pos.xy, false).rgb, 1.0);
+}
+
+float4 UpsampleDepthPS( FullscreenVSOut IN ) : SV_Target
+{
+    return float4(UpsampleColor(IN.pos.xy, true).rgb, 1.0);
+}
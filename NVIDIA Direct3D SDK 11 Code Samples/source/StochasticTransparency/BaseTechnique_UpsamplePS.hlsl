@@ -0,0 +1 @@
+#include "BaseTechnique.hlsli"
\ No newline at end of file
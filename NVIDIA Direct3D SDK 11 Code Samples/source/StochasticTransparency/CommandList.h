@@ -0,0 +1,327 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <assert.h>
+
+#include "RHI.h"
+
+// The command stream only stores the RHI objects as opaque pointers,
+// so it can be replayed into any CommandSink
+
+#define MAX_COMMAND_OBJECTS 4
+
+// Number of subset draws recorded by one job with parallel submission (see BuildSegments)
+#define PARALLEL_DRAWS_PER_SEGMENT 512
+
+enum CommandType
+{
+    CMD_SET_VERTEX_SHADER,
+    CMD_SET_PIXEL_SHADER,
+    CMD_SET_RASTERIZER_STATE,
+    CMD_SET_BLEND_STATE,
+    CMD_SET_DEPTH_STENCIL_STATE,
+    CMD_SET_RENDER_TARGETS,
+    CMD_SET_VS_RESOURCES,
+    CMD_SET_PS_RESOURCES,
+    CMD_CLEAR_RENDER_TARGET,
+    CMD_CLEAR_DEPTH,
+    CMD_DRAW,
+    CMD_RESOLVE,
+    CMD_BEGIN_EVENT,
+    CMD_END_EVENT,
+
+    // Engine-level commands, expanded by the sink with the data of the current frame
+    CMD_BIND_FRAME_CONSTANTS,
+    CMD_DRAW_MESH,
+};
+
+// Draw lists of the scene, selected by the CMD_DRAW_MESH commands
+enum MeshDrawListId
+{
+    MESH_DRAW_LIST_TRANSPARENT,
+    MESH_DRAW_LIST_OPAQUE,
+    NUM_MESH_DRAW_LISTS
+};
+
+struct Command
+{
+    CommandType Type;
+    UINT Slot;                                  // First slot, first vertex, or MeshDrawListId
+    UINT Count;                                 // Number of objects, or of vertices
+    UINT Value;                                 // Sample mask or stencil reference
+    float Values[4];                            // Clear color or blend factor. Clear depth in Values[0].
+    void *pObject;                              // State, shader, single view, or resolve destination
+    void *pObjects[MAX_COMMAND_OBJECTS];        // Render targets, shader resources, or resolve source
+    const wchar_t *pName;                       // Event name
+};
+
+// Part of a command list that can be replayed on its own, on a context with the default state
+struct CommandSegment
+{
+    size_t StateEnd;            // The state commands before StateEnd are replayed first
+    size_t Begin;               // Then all the commands in [Begin,End)
+    size_t End;
+    UINT FirstDraw;             // Range of the mesh draw list used by the CMD_DRAW_MESH commands
+    UINT EndDraw;
+};
+
+// Receives the commands of a CommandList on replay
+class CommandSink
+{
+public:
+    virtual ~CommandSink() {}
+    virtual void Execute(const Command &Cmd) = 0;
+};
+
+//--------------------------------------------------------------------------------------
+// Retained list of the state changes and draws of a technique.
+// Recorded once and replayed every frame; only the engine-level commands
+// (constants and mesh draws) depend on the frame being rendered.
+//--------------------------------------------------------------------------------------
+class CommandList
+{
+public:
+    CommandList()
+        : m_NumDraws(0)
+    {
+        memset(m_NumMeshDraws, 0, sizeof(m_NumMeshDraws));
+    }
+
+    void Clear()
+    {
+        m_Commands.clear();
+        m_NumDraws = 0;
+        memset(m_NumMeshDraws, 0, sizeof(m_NumMeshDraws));
+    }
+
+    void Replay(CommandSink &Sink) const
+    {
+        for (size_t i = 0; i < m_Commands.size(); ++i)
+        {
+            Sink.Execute(m_Commands[i]);
+        }
+    }
+
+    void Replay(CommandSink &Sink, const CommandSegment &Segment) const
+    {
+        for (size_t i = 0; i < Segment.StateEnd; ++i)
+        {
+            if (IsStateCommand(m_Commands[i].Type))
+            {
+                Sink.Execute(m_Commands[i]);
+            }
+        }
+        for (size_t i = Segment.Begin; i < Segment.End; ++i)
+        {
+            Sink.Execute(m_Commands[i]);
+        }
+    }
+
+    // Splits the list so that the segments can be recorded in parallel and executed in order.
+    // Each mesh draw of NumDraws[MeshDrawListId] draws is split in chunks of at most MaxDrawsPerSegment draws;
+    // the commands before a mesh draw go to its first chunk, the ones after the last mesh draw to a final segment.
+    void BuildSegments(const UINT NumDraws[NUM_MESH_DRAW_LISTS], UINT MaxDrawsPerSegment, std::vector<CommandSegment> &Segments) const
+    {
+        Segments.clear();
+
+        size_t Begin = 0;
+        for (size_t i = 0; i < m_Commands.size(); ++i)
+        {
+            if (m_Commands[i].Type != CMD_DRAW_MESH) continue;
+
+            const UINT NumListDraws = NumDraws[m_Commands[i].Slot];
+            UINT FirstDraw = 0;
+            do
+            {
+                CommandSegment Segment;
+                Segment.StateEnd = (FirstDraw == 0) ? Begin : i;
+                Segment.Begin = (FirstDraw == 0) ? Begin : i;
+                Segment.End = i + 1;
+                Segment.FirstDraw = FirstDraw;
+                Segment.EndDraw = std::min(FirstDraw + MaxDrawsPerSegment, NumListDraws);
+                Segments.push_back(Segment);
+                FirstDraw = Segment.EndDraw;
+            } while (FirstDraw < NumListDraws);
+
+            Begin = i + 1;
+        }
+
+        if (Begin < m_Commands.size())
+        {
+            CommandSegment Segment;
+            Segment.StateEnd = Begin;
+            Segment.Begin = Begin;
+            Segment.End = m_Commands.size();
+            Segment.FirstDraw = 0;
+            Segment.EndDraw = 0;
+            Segments.push_back(Segment);
+        }
+    }
+
+    static bool IsStateCommand(CommandType Type)
+    {
+        return (Type <= CMD_SET_PS_RESOURCES || Type == CMD_BIND_FRAME_CONSTANTS);
+    }
+
+    size_t GetNumCommands() const { return m_Commands.size(); }
+    UINT GetNumDraws() const { return m_NumDraws; }
+    UINT GetNumMeshDraws() const { return m_NumMeshDraws[MESH_DRAW_LIST_TRANSPARENT] + m_NumMeshDraws[MESH_DRAW_LIST_OPAQUE]; }
+    UINT GetNumMeshDraws(MeshDrawListId List) const { return m_NumMeshDraws[List]; }
+    const Command& GetCommand(size_t i) const { return m_Commands[i]; }
+
+    // The mesh draws bind their own vertex shader and input layout
+    void SetVertexShader(RHIShader *pShader)
+    {
+        Append(CMD_SET_VERTEX_SHADER).pObject = pShader;
+    }
+
+    void SetPixelShader(RHIShader *pShader)
+    {
+        Append(CMD_SET_PIXEL_SHADER).pObject = pShader;
+    }
+
+    void SetRasterizerState(RHIRasterizerState *pState)
+    {
+        Append(CMD_SET_RASTERIZER_STATE).pObject = pState;
+    }
+
+    void SetBlendState(RHIBlendState *pState, const float BlendFactor[4], UINT SampleMask)
+    {
+        Command &Cmd = Append(CMD_SET_BLEND_STATE);
+        Cmd.pObject = pState;
+        memcpy(Cmd.Values, BlendFactor, sizeof(Cmd.Values));
+        Cmd.Value = SampleMask;
+    }
+
+    void SetDepthStencilState(RHIDepthStencilState *pState, UINT StencilRef)
+    {
+        Command &Cmd = Append(CMD_SET_DEPTH_STENCIL_STATE);
+        Cmd.pObject = pState;
+        Cmd.Value = StencilRef;
+    }
+
+    void SetRenderTargets(UINT NumRTVs, RHIView *const *ppRTVs, RHIView *pDSV)
+    {
+        assert(NumRTVs <= MAX_COMMAND_OBJECTS);
+        Command &Cmd = Append(CMD_SET_RENDER_TARGETS);
+        Cmd.Count = NumRTVs;
+        for (UINT i = 0; i < NumRTVs; ++i)
+        {
+            Cmd.pObjects[i] = ppRTVs[i];
+        }
+        Cmd.pObject = pDSV;
+    }
+
+    // Only read by the full-screen vertex shaders; the mesh draws bind their own resources
+    void SetVSResources(UINT StartSlot, UINT NumSRVs, RHIView *const *ppSRVs)
+    {
+        assert(NumSRVs <= MAX_COMMAND_OBJECTS);
+        Command &Cmd = Append(CMD_SET_VS_RESOURCES);
+        Cmd.Slot = StartSlot;
+        Cmd.Count = NumSRVs;
+        for (UINT i = 0; i < NumSRVs; ++i)
+        {
+            Cmd.pObjects[i] = ppSRVs[i];
+        }
+    }
+
+    void SetPSResources(UINT StartSlot, UINT NumSRVs, RHIView *const *ppSRVs)
+    {
+        assert(NumSRVs <= MAX_COMMAND_OBJECTS);
+        Command &Cmd = Append(CMD_SET_PS_RESOURCES);
+        Cmd.Slot = StartSlot;
+        Cmd.Count = NumSRVs;
+        for (UINT i = 0; i < NumSRVs; ++i)
+        {
+            Cmd.pObjects[i] = ppSRVs[i];
+        }
+    }
+
+    void ClearRenderTarget(RHIView *pRTV, const float Color[4])
+    {
+        Command &Cmd = Append(CMD_CLEAR_RENDER_TARGET);
+        Cmd.pObject = pRTV;
+        memcpy(Cmd.Values, Color, sizeof(Cmd.Values));
+    }
+
+    void ClearDepth(RHIView *pDSV, float Depth)
+    {
+        Command &Cmd = Append(CMD_CLEAR_DEPTH);
+        Cmd.pObject = pDSV;
+        Cmd.Values[0] = Depth;
+    }
+
+    void Draw(UINT VertexCount, UINT StartVertex)
+    {
+        Command &Cmd = Append(CMD_DRAW);
+        Cmd.Count = VertexCount;
+        Cmd.Slot = StartVertex;
+        ++m_NumDraws;
+    }
+
+    // Resolves the multisampled pSrc into pDst, which must have the same format
+    void Resolve(RHITexture *pDst, RHITexture *pSrc)
+    {
+        assert(pDst->GetDesc().Format == pSrc->GetDesc().Format);
+        Command &Cmd = Append(CMD_RESOLVE);
+        Cmd.pObject = pDst;
+        Cmd.pObjects[0] = pSrc;
+    }
+
+    // The name must outlive the command list
+    void BeginEvent(const wchar_t *pName)
+    {
+        Append(CMD_BEGIN_EVENT).pName = pName;
+    }
+
+    void EndEvent()
+    {
+        Append(CMD_END_EVENT);
+    }
+
+    // Binds the constants uploaded for the current frame
+    void BindFrameConstants()
+    {
+        Append(CMD_BIND_FRAME_CONSTANTS);
+    }
+
+    // Draws the current draw list of the scene with the bound state,
+    // and the vertex shader and input layout of the scene geometry
+    void DrawMesh(MeshDrawListId List = MESH_DRAW_LIST_TRANSPARENT)
+    {
+        Append(CMD_DRAW_MESH).Slot = List;
+        ++m_NumDraws;
+        ++m_NumMeshDraws[List];
+    }
+
+protected:
+    Command& Append(CommandType Type)
+    {
+        m_Commands.resize(m_Commands.size() + 1);
+        Command &Cmd = m_Commands.back();
+        memset(&Cmd, 0, sizeof(Cmd));
+        Cmd.Type = Type;
+        return Cmd;
+    }
+
+    std::vector<Command> m_Commands;
+    UINT m_NumDraws;
+    UINT m_NumMeshDraws[NUM_MESH_DRAW_LISTS];
+};
@@ -0,0 +1,456 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+#pragma once
+
+#include "SDKmesh.h"
+#include "MeshOptimizer.h"
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+
+// Offsets of the attributes in the SDKMESH vertex stream
+// (R32G32B32_FLOAT position followed by R32G32B32_FLOAT normal)
+#define SOURCE_POSITION_OFFSET 0
+#define SOURCE_NORMAL_OFFSET 12
+
+// 12-byte vertex used by all the geometry passes:
+// R16G16B16A16_UNORM position quantized to the mesh bounding box and
+// R16G16_SNORM octahedral-encoded normal.
+struct CompactVertex
+{
+    USHORT Position[4];
+    SHORT Normal[2];
+};
+
+// One DrawIndexed call of a geometry pass
+struct SubsetDraw
+{
+    UINT SubsetId;          // For the per-subset shading constants
+    D3D11_PRIMITIVE_TOPOLOGY Topology;
+    UINT IndexCount;
+    UINT IndexStart;
+    INT BaseVertex;
+};
+
+// Index buffer and list of draws submitted by D3D11Context::DrawMesh
+struct MeshDrawList
+{
+    ID3D11Buffer *pIB;
+    DXGI_FORMAT IBFormat;
+    std::vector<SubsetDraw> Draws;
+
+    MeshDrawList()
+        : pIB(NULL)
+        , IBFormat(DXGI_FORMAT_R32_UINT)
+    {
+    }
+};
+
+//--------------------------------------------------------------------------------------
+// Scalar encoders/decoders, matching the D3D11 UNORM/SNORM conversion rules
+//--------------------------------------------------------------------------------------
+
+inline USHORT EncodeUNorm16(float x)
+{
+    x = std::max(0.f, std::min(1.f, x));
+    return (USHORT)(x * 65535.f + 0.5f);
+}
+
+inline float DecodeUNorm16(USHORT x)
+{
+    return (float)x / 65535.f;
+}
+
+inline SHORT EncodeSNorm16(float x)
+{
+    x = std::max(-1.f, std::min(1.f, x));
+    return (SHORT)floorf(x * 32767.f + 0.5f);
+}
+
+inline float DecodeSNorm16(SHORT x)
+{
+    return std::max((float)x / 32767.f, -1.f);
+}
+
+inline float SignNotZero(float x)
+{
+    return (x >= 0.f) ? 1.f : -1.f;
+}
+
+// Octahedral normal encoding [Meyer et al. 2010]
+// Projects the unit sphere onto the octahedron |x|+|y|+|z|=1 and unfolds it into [-1,1]^2
+inline void EncodeOctahedral(const DirectX::XMFLOAT3 &n, SHORT Encoded[2])
+{
+    float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+    float x = (l1 > 0.f) ? n.x / l1 : 0.f;
+    float y = (l1 > 0.f) ? n.y / l1 : 0.f;
+    if (n.z < 0.f)
+    {
+        float ox = (1.f - fabsf(y)) * SignNotZero(x);
+        float oy = (1.f - fabsf(x)) * SignNotZero(y);
+        x = ox;
+        y = oy;
+    }
+    Encoded[0] = EncodeSNorm16(x);
+    Encoded[1] = EncodeSNorm16(y);
+}
+
+// Must match DecodeOctahedral in BaseTechnique.hlsli
+inline void DecodeOctahedral(const SHORT Encoded[2], DirectX::XMFLOAT3 &n)
+{
+    float x = DecodeSNorm16(Encoded[0]);
+    float y = DecodeSNorm16(Encoded[1]);
+    float z = 1.f - fabsf(x) - fabsf(y);
+    float t = std::max(-z, 0.f);
+    x += (x >= 0.f) ? -t : t;
+    y += (y >= 0.f) ? -t : t;
+    float len = sqrtf(x*x + y*y + z*z);
+    n.x = x / len;
+    n.y = y / len;
+    n.z = z / len;
+}
+
+//--------------------------------------------------------------------------------------
+// Load-time conversion of the SDKMESH vertex and index streams:
+// - the vertices are converted to the compact layout,
+// - the triangles of each subset are reordered for the post-transform cache,
+// - the vertices of each subset are reordered for fetch locality.
+// The subsets keep their IndexStart/IndexCount/VertexStart, so the SDKMESH subset
+// table is still valid. The CPU copies are kept for decoding on the CPU.
+//--------------------------------------------------------------------------------------
+class CompactMesh
+{
+public:
+    CompactMesh()
+        : m_pVB(NULL)
+        , m_pIB(NULL)
+        , m_pAuthoringOrderIB(NULL)
+        , m_IBFormat(DXGI_FORMAT_R32_UINT)
+        , m_MaxPositionError(0.f)
+        , m_MaxNormalError(0.f)
+    {
+        m_PositionScale = DirectX::XMFLOAT4(1.f, 1.f, 1.f, 0.f);
+        m_PositionBias = DirectX::XMFLOAT4(0.f, 0.f, 0.f, 1.f);
+    }
+
+    ~CompactMesh()
+    {
+        Destroy();
+    }
+
+    HRESULT Create(ID3D11Device* pd3dDevice, CDXUTSDKMesh &Mesh)
+    {
+        HRESULT hr;
+
+        assert(Mesh.GetNumMeshes() == 1);
+        assert(Mesh.GetNumVBs() == 1);
+
+        const UINT NumVertices = (UINT)Mesh.GetNumVertices(0, 0);
+        const UINT SourceStride = Mesh.GetVertexStride(0, 0);
+        const BYTE *pSource = Mesh.GetRawVerticesAt(Mesh.GetMesh(0)->VertexBuffers[0]);
+        assert(SourceStride >= SOURCE_NORMAL_OFFSET + sizeof(DirectX::XMFLOAT3));
+
+        // D3D11 cannot create zero-sized buffers
+        if (NumVertices == 0 || Mesh.GetNumIndices(0) == 0)
+        {
+            return E_FAIL;
+        }
+
+        // Quantize to the actual bounds of the vertices rather than the SDKMESH
+        // bounding box, which is not guaranteed to be tight
+        DirectX::XMFLOAT3 BoxMin( FLT_MAX,  FLT_MAX,  FLT_MAX);
+        DirectX::XMFLOAT3 BoxMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for (UINT VertexId = 0; VertexId < NumVertices; ++VertexId)
+        {
+            const DirectX::XMFLOAT3 &P = *(const DirectX::XMFLOAT3*)(pSource + VertexId * SourceStride + SOURCE_POSITION_OFFSET);
+            BoxMin.x = std::min(BoxMin.x, P.x); BoxMax.x = std::max(BoxMax.x, P.x);
+            BoxMin.y = std::min(BoxMin.y, P.y); BoxMax.y = std::max(BoxMax.y, P.y);
+            BoxMin.z = std::min(BoxMin.z, P.z); BoxMax.z = std::max(BoxMax.z, P.z);
+        }
+
+        // position = unorm * scale + bias
+        m_PositionScale = DirectX::XMFLOAT4(
+            std::max(BoxMax.x - BoxMin.x, FLT_MIN),
+            std::max(BoxMax.y - BoxMin.y, FLT_MIN),
+            std::max(BoxMax.z - BoxMin.z, FLT_MIN),
+            0.f);
+        m_PositionBias = DirectX::XMFLOAT4(BoxMin.x, BoxMin.y, BoxMin.z, 1.f);
+
+        m_Vertices.resize(NumVertices);
+        m_MaxPositionError = 0.f;
+        m_MaxNormalError = 0.f;
+        for (UINT VertexId = 0; VertexId < NumVertices; ++VertexId)
+        {
+            const BYTE *pVertex = pSource + VertexId * SourceStride;
+            const DirectX::XMFLOAT3 &P = *(const DirectX::XMFLOAT3*)(pVertex + SOURCE_POSITION_OFFSET);
+            const DirectX::XMFLOAT3 &N = *(const DirectX::XMFLOAT3*)(pVertex + SOURCE_NORMAL_OFFSET);
+
+            CompactVertex &Vertex = m_Vertices[VertexId];
+            Vertex.Position[0] = EncodeUNorm16((P.x - m_PositionBias.x) / m_PositionScale.x);
+            Vertex.Position[1] = EncodeUNorm16((P.y - m_PositionBias.y) / m_PositionScale.y);
+            Vertex.Position[2] = EncodeUNorm16((P.z - m_PositionBias.z) / m_PositionScale.z);
+            Vertex.Position[3] = 0;
+            EncodeOctahedral(N, Vertex.Normal);
+
+            DirectX::XMFLOAT3 DecodedP, DecodedN;
+            DecodeVertex(VertexId, DecodedP, DecodedN);
+            m_MaxPositionError = std::max(m_MaxPositionError, fabsf(DecodedP.x - P.x));
+            m_MaxPositionError = std::max(m_MaxPositionError, fabsf(DecodedP.y - P.y));
+            m_MaxPositionError = std::max(m_MaxPositionError, fabsf(DecodedP.z - P.z));
+            float NLen = sqrtf(N.x*N.x + N.y*N.y + N.z*N.z);
+            if (NLen > 0.f)
+            {
+                float CosAngle = (DecodedN.x*N.x + DecodedN.y*N.y + DecodedN.z*N.z) / NLen;
+                m_MaxNormalError = std::max(m_MaxNormalError, acosf(std::min(CosAngle, 1.f)));
+            }
+        }
+
+        OptimizeIndices(Mesh);
+
+        D3D11_BUFFER_DESC vbDesc;
+        vbDesc.ByteWidth = NumVertices * sizeof(CompactVertex);
+        vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
+        vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+        vbDesc.CPUAccessFlags = 0;
+        vbDesc.MiscFlags = 0;
+        vbDesc.StructureByteStride = 0;
+
+        D3D11_SUBRESOURCE_DATA vbData;
+        vbData.pSysMem = m_Vertices.data();
+        vbData.SysMemPitch = 0;
+        vbData.SysMemSlicePitch = 0;
+
+        SAFE_RELEASE(m_pVB);
+        V_RETURN( pd3dDevice->CreateBuffer(&vbDesc, &vbData, &m_pVB) );
+
+        SAFE_RELEASE(m_pIB);
+        V_RETURN( CreateIndexBuffer(pd3dDevice, m_Indices, &m_pIB) );
+
+        SAFE_RELEASE(m_pAuthoringOrderIB);
+        V_RETURN( CreateIndexBuffer(pd3dDevice, m_AuthoringOrderIndices, &m_pAuthoringOrderIB) );
+
+        BuildDrawLists(Mesh);
+
+        return S_OK;
+    }
+
+    void Destroy()
+    {
+        SAFE_RELEASE(m_pVB);
+        SAFE_RELEASE(m_pIB);
+        SAFE_RELEASE(m_pAuthoringOrderIB);
+        m_Vertices.clear();
+        m_Indices.clear();
+        m_AuthoringOrderIndices.clear();
+        m_Subsets.clear();
+        m_DrawList = MeshDrawList();
+        m_AuthoringOrderDrawList = MeshDrawList();
+    }
+
+    // CPU decoder, matching DecodePosition/DecodeOctahedral in BaseTechnique.hlsli
+    void DecodeVertex(UINT VertexId, DirectX::XMFLOAT3 &Position, DirectX::XMFLOAT3 &Normal) const
+    {
+        const CompactVertex &Vertex = m_Vertices[VertexId];
+        Position.x = DecodeUNorm16(Vertex.Position[0]) * m_PositionScale.x + m_PositionBias.x;
+        Position.y = DecodeUNorm16(Vertex.Position[1]) * m_PositionScale.y + m_PositionBias.y;
+        Position.z = DecodeUNorm16(Vertex.Position[2]) * m_PositionScale.z + m_PositionBias.z;
+        DecodeOctahedral(Vertex.Normal, Normal);
+    }
+
+    ID3D11Buffer* GetVB() const { return m_pVB; }
+    UINT GetStride() const { return sizeof(CompactVertex); }
+    UINT GetNumVertices() const { return (UINT)m_Vertices.size(); }
+
+    // The cache-optimized triangle order is only valid for order-independent techniques.
+    // The authoring-order index buffer keeps the SDKMESH triangle order (with the remapped vertices).
+    ID3D11Buffer* GetIB(bool PreserveTriangleOrder = false) const { return PreserveTriangleOrder ? m_pAuthoringOrderIB : m_pIB; }
+    DXGI_FORMAT GetIBFormat() const { return m_IBFormat; }
+    const std::vector<UINT>& GetIndices() const { return m_Indices; }
+
+    // Draws every subset in full
+    const MeshDrawList& GetDrawList(bool PreserveTriangleOrder = false) const { return PreserveTriangleOrder ? m_AuthoringOrderDrawList : m_DrawList; }
+    const std::vector<SubsetDraw>& GetSubsets() const { return m_Subsets; }
+    const VertexCacheStats& GetStatsBefore() const { return m_StatsBefore; }
+    const VertexCacheStats& GetStatsAfter() const { return m_StatsAfter; }
+    const DirectX::XMFLOAT4& GetPositionScale() const { return m_PositionScale; }
+    const DirectX::XMFLOAT4& GetPositionBias() const { return m_PositionBias; }
+    float GetMaxPositionError() const { return m_MaxPositionError; }
+    float GetMaxNormalError() const { return m_MaxNormalError; }
+
+protected:
+    void OptimizeIndices(CDXUTSDKMesh &Mesh)
+    {
+        const UINT NumIndices = (UINT)Mesh.GetNumIndices(0);
+        const BYTE *pSource = Mesh.GetRawIndicesAt(Mesh.GetMesh(0)->IndexBuffer);
+
+        m_IBFormat = Mesh.GetIBFormat11(0);
+        m_Indices.resize(NumIndices);
+        for (UINT i = 0; i < NumIndices; ++i)
+        {
+            m_Indices[i] = (Mesh.GetIndexType(0) == IT_16BIT) ? ((const USHORT*)pSource)[i] : ((const UINT*)pSource)[i];
+        }
+        m_AuthoringOrderIndices = m_Indices;
+
+        // Vertex ranges referenced by each subset, relative to VertexStart
+        const UINT NumSubsets = Mesh.GetNumSubsets(0);
+        std::vector<UINT> RangeSize(NumSubsets, 0);
+        for (UINT SubsetId = 0; SubsetId < NumSubsets; ++SubsetId)
+        {
+            SDKMESH_SUBSET* pSubset = Mesh.GetSubset(0, SubsetId);
+            for (UINT i = 0; i < (UINT)pSubset->IndexCount; ++i)
+            {
+                RangeSize[SubsetId] = std::max(RangeSize[SubsetId], m_Indices[(UINT)pSubset->IndexStart + i] + 1);
+            }
+        }
+
+        // The vertices of a subset can only be renumbered if no other subset references them
+        std::vector<bool> IsVertexRangeShared(NumSubsets, false);
+        {
+            std::vector<std::pair<UINT,UINT> > Ranges; // (VertexStart, SubsetId), sorted by VertexStart
+            for (UINT SubsetId = 0; SubsetId < NumSubsets; ++SubsetId)
+            {
+                if (RangeSize[SubsetId] > 0)
+                {
+                    Ranges.push_back(std::make_pair((UINT)Mesh.GetSubset(0, SubsetId)->VertexStart, SubsetId));
+                }
+            }
+            std::sort(Ranges.begin(), Ranges.end());
+
+            UINT MaxEnd = 0;
+            for (size_t i = 0; i < Ranges.size(); ++i)
+            {
+                UINT Start = Ranges[i].first;
+                UINT End = Start + RangeSize[Ranges[i].second];
+                if (i > 0 && Start < MaxEnd)
+                {
+                    IsVertexRangeShared[Ranges[i].second] = true;
+                }
+                if (i + 1 < Ranges.size() && Ranges[i + 1].first < End)
+                {
+                    IsVertexRangeShared[Ranges[i].second] = true;
+                }
+                MaxEnd = std::max(MaxEnd, End);
+            }
+        }
+
+        m_StatsBefore = VertexCacheStats();
+        m_StatsAfter = VertexCacheStats();
+
+        for (UINT SubsetId = 0; SubsetId < NumSubsets; ++SubsetId)
+        {
+            SDKMESH_SUBSET* pSubset = Mesh.GetSubset(0, SubsetId);
+            if (pSubset->PrimitiveType != PT_TRIANGLE_LIST || pSubset->IndexCount == 0) continue;
+
+            UINT *pIndices = m_Indices.data() + (UINT)pSubset->IndexStart;
+            UINT *pAuthoringIndices = m_AuthoringOrderIndices.data() + (UINT)pSubset->IndexStart;
+            const UINT NumSubsetIndices = (UINT)pSubset->IndexCount;
+            const UINT VertexStart = (UINT)pSubset->VertexStart;
+            const UINT NumSubsetVertices = RangeSize[SubsetId];
+
+            m_StatsBefore.Accumulate(ComputeVertexCacheStats(pIndices, NumSubsetIndices, NumSubsetVertices));
+
+            OptimizeVertexCacheForsyth(pIndices, NumSubsetIndices, NumSubsetVertices);
+
+            if (!IsVertexRangeShared[SubsetId])
+            {
+                std::vector<UINT> Remap;
+                OptimizeVertexFetch(pIndices, NumSubsetIndices, NumSubsetVertices, Remap);
+
+                std::vector<CompactVertex> Reordered(NumSubsetVertices);
+                for (UINT VertexId = 0; VertexId < NumSubsetVertices; ++VertexId)
+                {
+                    Reordered[Remap[VertexId]] = m_Vertices[VertexStart + VertexId];
+                }
+                std::copy(Reordered.begin(), Reordered.end(), m_Vertices.begin() + VertexStart);
+
+                for (UINT i = 0; i < NumSubsetIndices; ++i)
+                {
+                    pAuthoringIndices[i] = Remap[pAuthoringIndices[i]];
+                }
+            }
+
+            m_StatsAfter.Accumulate(ComputeVertexCacheStats(pIndices, NumSubsetIndices, NumSubsetVertices));
+        }
+    }
+
+    void BuildDrawLists(CDXUTSDKMesh &Mesh)
+    {
+        m_Subsets.resize(Mesh.GetNumSubsets(0));
+        for (UINT SubsetId = 0; SubsetId < Mesh.GetNumSubsets(0); ++SubsetId)
+        {
+            SDKMESH_SUBSET* pSubset = Mesh.GetSubset(0, SubsetId);
+            SubsetDraw &Draw = m_Subsets[SubsetId];
+            Draw.SubsetId = SubsetId;
+            Draw.Topology = CDXUTSDKMesh::GetPrimitiveType11((SDKMESH_PRIMITIVE_TYPE)pSubset->PrimitiveType);
+            Draw.IndexCount = (UINT)pSubset->IndexCount;
+            Draw.IndexStart = (UINT)pSubset->IndexStart;
+            Draw.BaseVertex = (INT)pSubset->VertexStart;
+        }
+
+        m_DrawList.pIB = m_pIB;
+        m_DrawList.IBFormat = m_IBFormat;
+        m_DrawList.Draws = m_Subsets;
+
+        m_AuthoringOrderDrawList.pIB = m_pAuthoringOrderIB;
+        m_AuthoringOrderDrawList.IBFormat = m_IBFormat;
+        m_AuthoringOrderDrawList.Draws = m_Subsets;
+    }
+
+    HRESULT CreateIndexBuffer(ID3D11Device* pd3dDevice, const std::vector<UINT> &Indices, ID3D11Buffer **ppIB)
+    {
+        const UINT IndexSize = (m_IBFormat == DXGI_FORMAT_R16_UINT) ? sizeof(USHORT) : sizeof(UINT);
+        std::vector<BYTE> Data(Indices.size() * IndexSize);
+        for (size_t i = 0; i < Indices.size(); ++i)
+        {
+            if (IndexSize == sizeof(USHORT))
+                ((USHORT*)Data.data())[i] = (USHORT)Indices[i];
+            else
+                ((UINT*)Data.data())[i] = Indices[i];
+        }
+
+        D3D11_BUFFER_DESC ibDesc;
+        ibDesc.ByteWidth = (UINT)Data.size();
+        ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
+        ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+        ibDesc.CPUAccessFlags = 0;
+        ibDesc.MiscFlags = 0;
+        ibDesc.StructureByteStride = 0;
+
+        D3D11_SUBRESOURCE_DATA ibData;
+        ibData.pSysMem = Data.data();
+        ibData.SysMemPitch = 0;
+        ibData.SysMemSlicePitch = 0;
+
+        return pd3dDevice->CreateBuffer(&ibDesc, &ibData, ppIB);
+    }
+
+    std::vector<CompactVertex> m_Vertices;
+    std::vector<UINT> m_Indices;
+    std::vector<UINT> m_AuthoringOrderIndices;
+    ID3D11Buffer *m_pVB;
+    ID3D11Buffer *m_pIB;
+    ID3D11Buffer *m_pAuthoringOrderIB;
+    DXGI_FORMAT m_IBFormat;
+    VertexCacheStats m_StatsBefore;
+    VertexCacheStats m_StatsAfter;
+    std::vector<SubsetDraw> m_Subsets;
+    MeshDrawList m_DrawList;
+    MeshDrawList m_AuthoringOrderDrawList;
+    DirectX::XMFLOAT4 m_PositionScale;
+    DirectX::XMFLOAT4 m_PositionBias;
+    float m_MaxPositionError;
+    float m_MaxNormalError;
+};
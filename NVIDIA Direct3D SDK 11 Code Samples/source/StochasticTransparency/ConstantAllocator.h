@@ -0,0 +1,109 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+
+// This header does not depend on d3d11.h; see DynamicConstantBuffer in RHI_D3D11.h
+
+// Constant buffer offsets are in units of 16 constants (256 bytes)
+#define CONSTANT_ALIGNMENT 256
+#define CONSTANT_RING_SIZE (256 * 1024)
+
+// A ring grown for larger allocations holds at least this many of them between discards
+#define CONSTANT_RING_MIN_ALLOCATIONS 4
+
+struct ConstantAllocation
+{
+    UINT Offset;        // In bytes, multiple of CONSTANT_ALIGNMENT
+    UINT Size;          // In bytes, multiple of CONSTANT_ALIGNMENT
+    bool Discard;       // The ring wrapped: the buffer must be mapped with D3D11_MAP_WRITE_DISCARD
+
+    // Arguments of *SetConstantBuffers1
+    UINT GetFirstConstant() const { return Offset / 16; }
+    UINT GetNumConstants() const { return Size / 16; }
+};
+
+//--------------------------------------------------------------------------------------
+// Device-free linear allocator over a ring of Capacity bytes.
+// Allocations are appended (D3D11_MAP_WRITE_NO_OVERWRITE) until the ring is full;
+// the next allocation then restarts at 0 and requests a discard, which gives a new
+// buffer to the CPU without waiting for the GPU, so no fences are needed.
+//--------------------------------------------------------------------------------------
+class LinearConstantAllocator
+{
+public:
+    LinearConstantAllocator(UINT Capacity = CONSTANT_RING_SIZE)
+        : m_Capacity(Capacity)
+    {
+        Reset();
+    }
+
+    // Called when the underlying buffer is (re)created: its first map must discard
+    void Reset()
+    {
+        m_Head = 0;
+        m_NeedsDiscard = true;
+        m_NumDiscards = 0;
+        m_NumAllocatedBytes = 0;
+    }
+
+    // Called when the underlying buffer is recreated with a new capacity
+    void Resize(UINT Capacity)
+    {
+        m_Capacity = Capacity;
+        Reset();
+    }
+
+    // Capacity of a ring grown for allocations of Size bytes
+    static UINT GetCapacityFor(UINT Size)
+    {
+        UINT Capacity = ((Size + CONSTANT_ALIGNMENT - 1) & ~(CONSTANT_ALIGNMENT - 1)) * CONSTANT_RING_MIN_ALLOCATIONS;
+        return (Capacity > CONSTANT_RING_SIZE) ? Capacity : CONSTANT_RING_SIZE;
+    }
+
+    bool Allocate(UINT Size, ConstantAllocation &Allocation)
+    {
+        UINT AlignedSize = (Size + CONSTANT_ALIGNMENT - 1) & ~(CONSTANT_ALIGNMENT - 1);
+        if (AlignedSize == 0 || AlignedSize > m_Capacity) return false;
+
+        if (m_Head + AlignedSize > m_Capacity)
+        {
+            m_Head = 0;
+            m_NeedsDiscard = true;
+        }
+
+        Allocation.Offset = m_Head;
+        Allocation.Size = AlignedSize;
+        Allocation.Discard = m_NeedsDiscard;
+        if (m_NeedsDiscard) ++m_NumDiscards;
+
+        m_Head += AlignedSize;
+        m_NeedsDiscard = false;
+        m_NumAllocatedBytes += AlignedSize;
+        return true;
+    }
+
+    UINT GetCapacity() const { return m_Capacity; }
+    UINT GetHead() const { return m_Head; }
+    UINT GetNumDiscards() const { return m_NumDiscards; }
+    UINT GetNumAllocatedBytes() const { return m_NumAllocatedBytes; }
+
+protected:
+    UINT m_Capacity;
+    UINT m_Head;
+    bool m_NeedsDiscard;
+    UINT m_NumDiscards;
+    UINT m_NumAllocatedBytes;
+};
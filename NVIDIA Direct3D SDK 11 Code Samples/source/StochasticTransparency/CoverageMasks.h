@@ -0,0 +1,413 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+#include "MersenneTwister.h"
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <assert.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define COVERAGE_MASKS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define COVERAGE_MASKS_TARGET(Isa)
+#else
+#define COVERAGE_MASKS_TARGET(Isa) __attribute__((target(Isa)))
+#endif
+#else
+#define COVERAGE_MASKS_X86 0
+#endif
+
+//--------------------------------------------------------------------------------------
+// CPU version of randmaskwide (StochasticTransparency.hlsli): the SV_Coverage masks of the
+// stochastic depth pass, bit-identical to the pixel shader, for CPU and offline runs.
+// The kernels process 4 (SSE2), 8 (AVX2) or 16 (AVX-512) fragments at a time, and the
+// best one supported by the CPU is selected at run time.
+//--------------------------------------------------------------------------------------
+
+// CPU copy of the random mask texture (tRandoms), with the constants that index it
+struct CoverageMaskTable
+{
+    std::vector<UINT> Masks;        // (AlphaValues + 1) rows of SizeMinusOne + 1 masks
+    UINT SizeMinusOne;              // g_randMaskSizePowOf2MinusOne
+    UINT SizeShift;                 // log2 of the row size
+    UINT AlphaValues;               // g_randMaskAlphaValues
+    UINT RandomOffset;              // g_randomOffset
+
+    CoverageMaskTable()
+        : SizeMinusOne(0)
+        , SizeShift(0)
+        , AlphaValues(0)
+        , RandomOffset(0)
+    {
+    }
+};
+
+// Random masks with alpha * NumSamples bits set on average, for each quantized alpha.
+// Size must be a power of two.
+inline void BuildCoverageMaskTable(CoverageMaskTable &Table, UINT Size, UINT AlphaValues, UINT NumSamples)
+{
+    assert(Size && !(Size & (Size - 1)) && NumSamples <= 32);
+
+    Table.SizeMinusOne = Size - 1;
+    Table.SizeShift = 0;
+    while ((1U << Table.SizeShift) < Size) ++Table.SizeShift;
+    Table.AlphaValues = AlphaValues;
+    Table.RandomOffset = 0;
+    Table.Masks.resize(Size * (AlphaValues + 1));
+
+    MTRand rng;
+    rng.seed((unsigned)0);
+
+    int numbers[32];
+    for (UINT y = 0; y <= AlphaValues; y++) // Inclusive, we need alpha = 1.0
+    {
+        for (UINT x = 0; x < Size; x++)
+        {
+            // Initialize array
+            for (UINT i = 0; i < NumSamples; i++)
+            {
+                numbers[i] = i;
+            }
+
+            // Scramble!
+            for (UINT i = 0; i < NumSamples * 2; i++)
+            {
+                std::swap(numbers[rng.randInt() % NumSamples], numbers[rng.randInt() % NumSamples]);
+            }
+
+            // Create the mask
+            unsigned int mask = 0;
+            float nof_bits_to_set = (float(y) / float(AlphaValues)) * NumSamples;
+            for (int bit = 0; bit < int(nof_bits_to_set); bit++)
+            {
+                mask |= (1 << numbers[bit]);
+            }
+            float prob_of_last_bit = (nof_bits_to_set - floor(nof_bits_to_set));
+            if (rng.randExc() < prob_of_last_bit)
+            {
+                mask |= (1 << numbers[int(nof_bits_to_set)]);
+            }
+
+            Table.Masks[y * Size + x] = mask;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Scalar version, which the SIMD kernels must match
+//--------------------------------------------------------------------------------------
+
+// ihash, from http://www.concentric.net/~Ttwang/tech/inthash.htm
+inline UINT CoverageHash(UINT seed)
+{
+    seed = (seed+0x7ed55d16u) + (seed<<12);
+    seed = (seed^0xc761c23cu) ^ (seed>>19);
+    seed = (seed+0x165667b1u) + (seed<<5);
+    seed = (seed+0xd3a2646cu) ^ (seed<<9);
+    seed = (seed+0xfd7046c5u) + (seed<<3);
+    seed = (seed^0xb55a4f09u) ^ (seed>>16);
+    return seed;
+}
+
+// getlayerseed, with the wrap-around of the HLSL uint arithmetic
+inline UINT GetLayerSeed(UINT x, UINT y, int PrimitiveId, UINT RandomOffset)
+{
+    return (UINT)PrimitiveId * 32 + RandomOffset + (x << 10) + (y << 20);
+}
+
+// Row of the table for an alpha, as the HLSL float to uint conversion (NaN and negative values
+// convert to 0). Rows past AlphaValues are out of the texture, where Load returns 0.
+inline UINT GetCoverageMaskRow(const CoverageMaskTable &Table, float Alpha)
+{
+    const float Row = Alpha * (float)Table.AlphaValues;
+    if (!(Row > 0.f)) return 0;
+    return (Row >= (float)(Table.AlphaValues + 1)) ? Table.AlphaValues + 1 : (UINT)Row;
+}
+
+inline UINT ComputeCoverageMask(const CoverageMaskTable &Table, UINT x, UINT y, int PrimitiveId, float Alpha)
+{
+    const UINT Seed = CoverageHash(GetLayerSeed(x, y, PrimitiveId, Table.RandomOffset)) & Table.SizeMinusOne;
+    const UINT Row = GetCoverageMaskRow(Table, Alpha);
+    return (Row <= Table.AlphaValues) ? Table.Masks[(Row << Table.SizeShift) | Seed] : 0;
+}
+
+// Fragments in structure of arrays layout: pixel coordinates, SV_PrimitiveID and alpha
+typedef void (*CoverageMaskKernel)(const CoverageMaskTable &Table, const UINT *pX, const UINT *pY,
+                                   const int *pPrimitiveIds, const float *pAlphas, UINT Count, UINT *pMasks);
+
+inline void ComputeCoverageMasksScalar(const CoverageMaskTable &Table, const UINT *pX, const UINT *pY,
+                                       const int *pPrimitiveIds, const float *pAlphas, UINT Count, UINT *pMasks)
+{
+    for (UINT i = 0; i < Count; ++i)
+    {
+        pMasks[i] = ComputeCoverageMask(Table, pX[i], pY[i], pPrimitiveIds[i], pAlphas[i]);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// SIMD kernels. The rows are clamped to [0,AlphaValues+1] as floats before the conversion,
+// which gives the same rows as GetCoverageMaskRow; max returns 0 for NaN.
+//--------------------------------------------------------------------------------------
+#if COVERAGE_MASKS_X86
+
+inline void ComputeCoverageMasksSSE2(const CoverageMaskTable &Table, const UINT *pX, const UINT *pY,
+                                     const int *pPrimitiveIds, const float *pAlphas, UINT Count, UINT *pMasks)
+{
+    const __m128i Offset = _mm_set1_epi32((int)Table.RandomOffset);
+    const __m128i SizeMinusOne = _mm_set1_epi32((int)Table.SizeMinusOne);
+    const __m128 AlphaValues = _mm_set1_ps((float)Table.AlphaValues);
+    const __m128 MaxRow = _mm_set1_ps((float)(Table.AlphaValues + 1));
+
+    UINT i = 0;
+    for (; i + 4 <= Count; i += 4)
+    {
+        const __m128i x = _mm_loadu_si128((const __m128i*)(pX + i));
+        const __m128i y = _mm_loadu_si128((const __m128i*)(pY + i));
+        const __m128i PrimitiveId = _mm_loadu_si128((const __m128i*)(pPrimitiveIds + i));
+        __m128i s = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(PrimitiveId, 5), Offset),
+                                  _mm_add_epi32(_mm_slli_epi32(x, 10), _mm_slli_epi32(y, 20)));
+
+        s = _mm_add_epi32(_mm_add_epi32(s, _mm_set1_epi32(0x7ed55d16)), _mm_slli_epi32(s, 12));
+        s = _mm_xor_si128(_mm_xor_si128(s, _mm_set1_epi32((int)0xc761c23c)), _mm_srli_epi32(s, 19));
+        s = _mm_add_epi32(_mm_add_epi32(s, _mm_set1_epi32(0x165667b1)), _mm_slli_epi32(s, 5));
+        s = _mm_xor_si128(_mm_add_epi32(s, _mm_set1_epi32((int)0xd3a2646c)), _mm_slli_epi32(s, 9));
+        s = _mm_add_epi32(_mm_add_epi32(s, _mm_set1_epi32((int)0xfd7046c5)), _mm_slli_epi32(s, 3));
+        s = _mm_xor_si128(_mm_xor_si128(s, _mm_set1_epi32((int)0xb55a4f09)), _mm_srli_epi32(s, 16));
+        s = _mm_and_si128(s, SizeMinusOne);
+
+        const __m128 RowF = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(pAlphas + i), AlphaValues), _mm_setzero_ps()), MaxRow);
+        const __m128i Index = _mm_or_si128(_mm_slli_epi32(_mm_cvttps_epi32(RowF), (int)Table.SizeShift), s);
+
+        // No gather before AVX2
+        UINT Indices[4];
+        _mm_storeu_si128((__m128i*)Indices, Index);
+        for (UINT k = 0; k < 4; ++k)
+        {
+            pMasks[i + k] = (Indices[k] >> Table.SizeShift <= Table.AlphaValues) ? Table.Masks[Indices[k]] : 0;
+        }
+    }
+    ComputeCoverageMasksScalar(Table, pX + i, pY + i, pPrimitiveIds + i, pAlphas + i, Count - i, pMasks + i);
+}
+
+COVERAGE_MASKS_TARGET("avx2")
+inline void ComputeCoverageMasksAVX2(const CoverageMaskTable &Table, const UINT *pX, const UINT *pY,
+                                     const int *pPrimitiveIds, const float *pAlphas, UINT Count, UINT *pMasks)
+{
+    const __m256i Offset = _mm256_set1_epi32((int)Table.RandomOffset);
+    const __m256i SizeMinusOne = _mm256_set1_epi32((int)Table.SizeMinusOne);
+    const __m256i NumRows = _mm256_set1_epi32((int)(Table.AlphaValues + 1));
+    const __m256 AlphaValues = _mm256_set1_ps((float)Table.AlphaValues);
+    const __m256 MaxRow = _mm256_set1_ps((float)(Table.AlphaValues + 1));
+    const int *pTable = (const int*)&Table.Masks[0];
+
+    UINT i = 0;
+    for (; i + 8 <= Count; i += 8)
+    {
+        const __m256i x = _mm256_loadu_si256((const __m256i*)(pX + i));
+        const __m256i y = _mm256_loadu_si256((const __m256i*)(pY + i));
+        const __m256i PrimitiveId = _mm256_loadu_si256((const __m256i*)(pPrimitiveIds + i));
+        __m256i s = _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(PrimitiveId, 5), Offset),
+                                     _mm256_add_epi32(_mm256_slli_epi32(x, 10), _mm256_slli_epi32(y, 20)));
+
+        s = _mm256_add_epi32(_mm256_add_epi32(s, _mm256_set1_epi32(0x7ed55d16)), _mm256_slli_epi32(s, 12));
+        s = _mm256_xor_si256(_mm256_xor_si256(s, _mm256_set1_epi32((int)0xc761c23c)), _mm256_srli_epi32(s, 19));
+        s = _mm256_add_epi32(_mm256_add_epi32(s, _mm256_set1_epi32(0x165667b1)), _mm256_slli_epi32(s, 5));
+        s = _mm256_xor_si256(_mm256_add_epi32(s, _mm256_set1_epi32((int)0xd3a2646c)), _mm256_slli_epi32(s, 9));
+        s = _mm256_add_epi32(_mm256_add_epi32(s, _mm256_set1_epi32((int)0xfd7046c5)), _mm256_slli_epi32(s, 3));
+        s = _mm256_xor_si256(_mm256_xor_si256(s, _mm256_set1_epi32((int)0xb55a4f09)), _mm256_srli_epi32(s, 16));
+        s = _mm256_and_si256(s, SizeMinusOne);
+
+        const __m256 RowF = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(pAlphas + i), AlphaValues), _mm256_setzero_ps()), MaxRow);
+        const __m256i Row = _mm256_cvttps_epi32(RowF);
+        const __m256i Index = _mm256_or_si256(_mm256_slli_epi32(Row, (int)Table.SizeShift), s);
+        const __m256i Valid = _mm256_cmpgt_epi32(NumRows, Row);
+
+        const __m256i Masks = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), pTable, Index, Valid, 4);
+        _mm256_storeu_si256((__m256i*)(pMasks + i), Masks);
+    }
+    ComputeCoverageMasksScalar(Table, pX + i, pY + i, pPrimitiveIds + i, pAlphas + i, Count - i, pMasks + i);
+}
+
+COVERAGE_MASKS_TARGET("avx512f")
+inline void ComputeCoverageMasksAVX512(const CoverageMaskTable &Table, const UINT *pX, const UINT *pY,
+                                       const int *pPrimitiveIds, const float *pAlphas, UINT Count, UINT *pMasks)
+{
+    const __m512i Offset = _mm512_set1_epi32((int)Table.RandomOffset);
+    const __m512i SizeMinusOne = _mm512_set1_epi32((int)Table.SizeMinusOne);
+    const __m512i NumRows = _mm512_set1_epi32((int)(Table.AlphaValues + 1));
+    const __m512 AlphaValues = _mm512_set1_ps((float)Table.AlphaValues);
+    const __m512 MaxRow = _mm512_set1_ps((float)(Table.AlphaValues + 1));
+    const int *pTable = (const int*)&Table.Masks[0];
+
+    UINT i = 0;
+    for (; i + 16 <= Count; i += 16)
+    {
+        const __m512i x = _mm512_loadu_si512(pX + i);
+        const __m512i y = _mm512_loadu_si512(pY + i);
+        const __m512i PrimitiveId = _mm512_loadu_si512(pPrimitiveIds + i);
+        __m512i s = _mm512_add_epi32(_mm512_add_epi32(_mm512_slli_epi32(PrimitiveId, 5), Offset),
+                                     _mm512_add_epi32(_mm512_slli_epi32(x, 10), _mm512_slli_epi32(y, 20)));
+
+        s = _mm512_add_epi32(_mm512_add_epi32(s, _mm512_set1_epi32(0x7ed55d16)), _mm512_slli_epi32(s, 12));
+        s = _mm512_xor_si512(_mm512_xor_si512(s, _mm512_set1_epi32((int)0xc761c23c)), _mm512_srli_epi32(s, 19));
+        s = _mm512_add_epi32(_mm512_add_epi32(s, _mm512_set1_epi32(0x165667b1)), _mm512_slli_epi32(s, 5));
+        s = _mm512_xor_si512(_mm512_add_epi32(s, _mm512_set1_epi32((int)0xd3a2646c)), _mm512_slli_epi32(s, 9));
+        s = _mm512_add_epi32(_mm512_add_epi32(s, _mm512_set1_epi32((int)0xfd7046c5)), _mm512_slli_epi32(s, 3));
+        s = _mm512_xor_si512(_mm512_xor_si512(s, _mm512_set1_epi32((int)0xb55a4f09)), _mm512_srli_epi32(s, 16));
+        s = _mm512_and_si512(s, SizeMinusOne);
+
+        const __m512 RowF = _mm512_min_ps(_mm512_max_ps(_mm512_mul_ps(_mm512_loadu_ps(pAlphas + i), AlphaValues), _mm512_setzero_ps()), MaxRow);
+        const __m512i Row = _mm512_cvttps_epi32(RowF);
+        const __m512i Index = _mm512_or_si512(_mm512_slli_epi32(Row, Table.SizeShift), s);
+        const __mmask16 Valid = _mm512_cmplt_epi32_mask(Row, NumRows);
+
+        const __m512i Masks = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), Valid, Index, pTable, 4);
+        _mm512_storeu_si512(pMasks + i, Masks);
+    }
+    ComputeCoverageMasksScalar(Table, pX + i, pY + i, pPrimitiveIds + i, pAlphas + i, Count - i, pMasks + i);
+}
+
+#endif
+
+//--------------------------------------------------------------------------------------
+// Run-time dispatch
+//--------------------------------------------------------------------------------------
+
+enum CoverageMaskISA
+{
+    COVERAGE_MASK_SCALAR,
+    COVERAGE_MASK_SSE2,
+    COVERAGE_MASK_AVX2,
+    COVERAGE_MASK_AVX512,
+    NUM_COVERAGE_MASK_ISAS
+};
+
+inline const wchar_t* GetCoverageMaskISAName(CoverageMaskISA Isa)
+{
+    static const wchar_t *Names[NUM_COVERAGE_MASK_ISAS] = { L"Scalar", L"SSE2", L"AVX2", L"AVX-512" };
+    return Names[Isa];
+}
+
+inline bool IsCoverageMaskISASupported(CoverageMaskISA Isa)
+{
+#if COVERAGE_MASKS_X86
+    switch (Isa)
+    {
+    case COVERAGE_MASK_SCALAR:
+    case COVERAGE_MASK_SSE2:
+        return true;
+#ifdef _MSC_VER
+    case COVERAGE_MASK_AVX2:
+    case COVERAGE_MASK_AVX512:
+        {
+            // The OS must also save the YMM (and ZMM) registers
+            int Info[4];
+            __cpuid(Info, 0);
+            if (Info[0] < 7) return false;
+            __cpuid(Info, 1);
+            if (!(Info[2] & (1 << 27)) || !(Info[2] & (1 << 28))) return false;
+            const unsigned long long XCR0 = _xgetbv(0);
+            __cpuidex(Info, 7, 0);
+            if (Isa == COVERAGE_MASK_AVX2) return (Info[1] & (1 << 5)) && (XCR0 & 0x6) == 0x6;
+            return (Info[1] & (1 << 16)) && (XCR0 & 0xE6) == 0xE6;
+        }
+#else
+    case COVERAGE_MASK_AVX2:
+        return __builtin_cpu_supports("avx2") != 0;
+    case COVERAGE_MASK_AVX512:
+        return __builtin_cpu_supports("avx512f") != 0;
+#endif
+    default:
+        return false;
+    }
+#else
+    return (Isa == COVERAGE_MASK_SCALAR);
+#endif
+}
+
+inline CoverageMaskKernel GetCoverageMaskKernel(CoverageMaskISA Isa)
+{
+    assert(IsCoverageMaskISASupported(Isa));
+    switch (Isa)
+    {
+#if COVERAGE_MASKS_X86
+    case COVERAGE_MASK_SSE2:    return ComputeCoverageMasksSSE2;
+    case COVERAGE_MASK_AVX2:    return ComputeCoverageMasksAVX2;
+    case COVERAGE_MASK_AVX512:  return ComputeCoverageMasksAVX512;
+#endif
+    default:                    return ComputeCoverageMasksScalar;
+    }
+}
+
+// Widest kernel supported by the CPU, detected once
+inline CoverageMaskISA GetBestCoverageMaskISA()
+{
+    static const CoverageMaskISA BestIsa =
+        IsCoverageMaskISASupported(COVERAGE_MASK_AVX512) ? COVERAGE_MASK_AVX512 :
+        IsCoverageMaskISASupported(COVERAGE_MASK_AVX2) ? COVERAGE_MASK_AVX2 :
+        IsCoverageMaskISASupported(COVERAGE_MASK_SSE2) ? COVERAGE_MASK_SSE2 : COVERAGE_MASK_SCALAR;
+    return BestIsa;
+}
+
+inline void ComputeCoverageMasks(const CoverageMaskTable &Table, const UINT *pX, const UINT *pY,
+                                 const int *pPrimitiveIds, const float *pAlphas, UINT Count, UINT *pMasks)
+{
+    static const CoverageMaskKernel Kernel = GetCoverageMaskKernel(GetBestCoverageMaskISA());
+    Kernel(Table, pX, pY, pPrimitiveIds, pAlphas, Count, pMasks);
+}
+
+//--------------------------------------------------------------------------------------
+// Microbenchmark: fragments per second of a kernel on the calling thread, best of NumRuns.
+// The fragments cover a 256x256 tile, with 64 fragments per primitive and random alphas.
+// Returns 0 if the kernel does not match the scalar version.
+//--------------------------------------------------------------------------------------
+inline double BenchmarkCoverageMasks(const CoverageMaskTable &Table, CoverageMaskISA Isa,
+                                     UINT NumFragments = 1 << 18, UINT NumRuns = 8)
+{
+    std::vector<UINT> X(NumFragments), Y(NumFragments), Masks(NumFragments);
+    std::vector<int> PrimitiveIds(NumFragments);
+    std::vector<float> Alphas(NumFragments);
+
+    MTRand rng;
+    rng.seed((unsigned)1);
+    for (UINT i = 0; i < NumFragments; ++i)
+    {
+        X[i] = i & 255;
+        Y[i] = (i >> 8) & 255;
+        PrimitiveIds[i] = (int)(i / 64);
+        Alphas[i] = rng.randExc();
+    }
+
+    const CoverageMaskKernel Kernel = GetCoverageMaskKernel(Isa);
+    double BestSeconds = 1e30;
+    for (UINT Run = 0; Run < NumRuns; ++Run)
+    {
+        const std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+        Kernel(Table, &X[0], &Y[0], &PrimitiveIds[0], &Alphas[0], NumFragments, &Masks[0]);
+        const std::chrono::duration<double> Elapsed = std::chrono::high_resolution_clock::now() - Start;
+        BestSeconds = std::min(BestSeconds, Elapsed.count());
+    }
+
+    for (UINT i = 0; i < NumFragments; ++i)
+    {
+        if (Masks[i] != ComputeCoverageMask(Table, X[i], Y[i], PrimitiveIds[i], Alphas[i])) return 0.0;
+    }
+    return (BestSeconds > 0.0) ? NumFragments / BestSeconds : 0.0;
+}
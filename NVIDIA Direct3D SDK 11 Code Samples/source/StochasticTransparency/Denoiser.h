@@ -0,0 +1,339 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+#pragma once
+#include "CoverageMasks.h"
+#include "JobSystem.h"
+
+//--------------------------------------------------------------------------------------
+// Edge-aware denoiser of the accumulation targets, run before the under operator.
+// U and U1 are filtered with the same 5x5 joint bilateral weights, so that their ratio
+// in the composite stays consistent. The weights stop at the changes of the total alpha,
+// which is exact, and the strength of the filter grows with the spread of the stochastic
+// depths of the pixel: a single layer, where the alpha correction is exact, is not filtered.
+// Every pixel reads the same 25 taps, whatever the content.
+// The CPU version runs the same filter on planar images, by bands of rows on the job system.
+//--------------------------------------------------------------------------------------
+
+// Must match the DENOISE_* defines in StochasticTransparency.hlsli
+#define DENOISE_RADIUS 2
+
+// Total alpha difference that stops the filter: 1 / 8
+#define DENOISE_ALPHA_SCALE 8.f
+
+// Standard deviation of the stochastic depths that gives the full strength: 1 / 64
+#define DENOISE_DEPTH_SCALE 64.f
+
+// Rows per job of the CPU version
+#define DENOISE_ROWS_PER_JOB 16
+
+enum DenoisePlane
+{
+    DENOISE_U_R,
+    DENOISE_U_G,
+    DENOISE_U_B,
+    DENOISE_TRANSMITTANCE,
+    DENOISE_U1,
+    NUM_DENOISE_PLANES
+};
+
+// Planar float image of the accumulation targets, with the strength of each pixel
+struct DenoiseImage
+{
+    UINT Width;
+    UINT Height;
+    std::vector<float> Planes[NUM_DENOISE_PLANES];
+    std::vector<float> Strength;
+
+    DenoiseImage()
+        : Width(0)
+        , Height(0)
+    {
+    }
+
+    void Resize(UINT NewWidth, UINT NewHeight)
+    {
+        Width = NewWidth;
+        Height = NewHeight;
+        for (UINT Plane = 0; Plane < NUM_DENOISE_PLANES; ++Plane)
+        {
+            Planes[Plane].assign(Width * Height, 0.f);
+        }
+        Strength.assign(Width * Height, 0.f);
+    }
+};
+
+// Binomial weights (1 4 6 4 1) / 16
+inline float GetDenoiseKernelWeight(int Offset)
+{
+    static const float Weights[2 * DENOISE_RADIUS + 1] = { 1.f / 16.f, 4.f / 16.f, 6.f / 16.f, 4.f / 16.f, 1.f / 16.f };
+    return Weights[Offset + DENOISE_RADIUS];
+}
+
+// Strength of the filter from the NumSamples stochastic depths of a pixel. The samples at the
+// farthest depth are the uncovered ones (or the last layer), which says nothing of the noise:
+// the spread is measured over the nearer ones.
+inline float GetDenoiseStrength(const float *pDepths, UINT NumSamples)
+{
+    float zmax = pDepths[0];
+    for (UINT SampleId = 1; SampleId < NumSamples; ++SampleId)
+    {
+        zmax = std::max(zmax, pDepths[SampleId]);
+    }
+
+    float m1 = 0.f;
+    float m2 = 0.f;
+    float Count = 0.f;
+    for (UINT SampleId = 0; SampleId < NumSamples; ++SampleId)
+    {
+        const float z = pDepths[SampleId];
+        if (z < zmax)
+        {
+            m1 += z;
+            m2 += z * z;
+            Count += 1.f;
+        }
+    }
+    if (Count == 0.f) return 0.f;
+
+    m1 /= Count;
+    m2 /= Count;
+    return std::min(sqrtf(std::max(m2 - m1 * m1, 0.f)) * DENOISE_DEPTH_SCALE, 1.f);
+}
+
+// Filters the pixel (x,y), clamping the taps to the edges. The transmittance is the guide
+// and is copied as is.
+inline void DenoisePixel(const DenoiseImage &In, UINT x, UINT y, DenoiseImage &Out)
+{
+    const UINT Center = y * In.Width + x;
+    const float *pT = &In.Planes[DENOISE_TRANSMITTANCE][0];
+    const float T = pT[Center];
+    const float Strength = In.Strength[Center];
+
+    float Sum[4] = { 0.f, 0.f, 0.f, 0.f };
+    float SumW = 0.f;
+    for (int dy = -DENOISE_RADIUS; dy <= DENOISE_RADIUS; ++dy)
+    {
+        const int ny = std::min(std::max((int)y + dy, 0), (int)In.Height - 1);
+        for (int dx = -DENOISE_RADIUS; dx <= DENOISE_RADIUS; ++dx)
+        {
+            const int nx = std::min(std::max((int)x + dx, 0), (int)In.Width - 1);
+            const UINT Tap = ny * In.Width + nx;
+
+            float w = GetDenoiseKernelWeight(dy) * GetDenoiseKernelWeight(dx);
+            if (dx != 0 || dy != 0)
+            {
+                w *= Strength * std::min(std::max(1.f - fabsf(pT[Tap] - T) * DENOISE_ALPHA_SCALE, 0.f), 1.f);
+            }
+            Sum[0] += w * In.Planes[DENOISE_U_R][Tap];
+            Sum[1] += w * In.Planes[DENOISE_U_G][Tap];
+            Sum[2] += w * In.Planes[DENOISE_U_B][Tap];
+            Sum[3] += w * In.Planes[DENOISE_U1][Tap];
+            SumW += w;
+        }
+    }
+
+    // The center weight is never 0
+    Out.Planes[DENOISE_U_R][Center] = Sum[0] / SumW;
+    Out.Planes[DENOISE_U_G][Center] = Sum[1] / SumW;
+    Out.Planes[DENOISE_U_B][Center] = Sum[2] / SumW;
+    Out.Planes[DENOISE_U1][Center] = Sum[3] / SumW;
+    Out.Planes[DENOISE_TRANSMITTANCE][Center] = T;
+}
+
+inline void DenoiseRowsScalar(const DenoiseImage &In, UINT BeginY, UINT EndY, DenoiseImage &Out)
+{
+    for (UINT y = BeginY; y < EndY; ++y)
+    {
+        for (UINT x = 0; x < In.Width; ++x)
+        {
+            DenoisePixel(In, x, y, Out);
+        }
+    }
+}
+
+#if COVERAGE_MASKS_X86
+
+// 4 pixels of a row at a time. The columns whose taps would be clamped run the scalar version.
+inline void DenoiseRowsSSE2(const DenoiseImage &In, UINT BeginY, UINT EndY, DenoiseImage &Out)
+{
+    const __m128 Zero = _mm_setzero_ps();
+    const __m128 One = _mm_set1_ps(1.f);
+    const __m128 AbsMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 AlphaScale = _mm_set1_ps(DENOISE_ALPHA_SCALE);
+    const UINT EndX = (In.Width > DENOISE_RADIUS) ? In.Width - DENOISE_RADIUS : 0;
+
+    for (UINT y = BeginY; y < EndY; ++y)
+    {
+        UINT x = 0;
+        for (; x < DENOISE_RADIUS && x < In.Width; ++x)
+        {
+            DenoisePixel(In, x, y, Out);
+        }
+        for (; x + 4 <= EndX; x += 4)
+        {
+            const UINT Center = y * In.Width + x;
+            const __m128 T = _mm_loadu_ps(&In.Planes[DENOISE_TRANSMITTANCE][Center]);
+            const __m128 Strength = _mm_loadu_ps(&In.Strength[Center]);
+
+            __m128 Sum[4] = { Zero, Zero, Zero, Zero };
+            __m128 SumW = Zero;
+            for (int dy = -DENOISE_RADIUS; dy <= DENOISE_RADIUS; ++dy)
+            {
+                const int ny = std::min(std::max((int)y + dy, 0), (int)In.Height - 1);
+                for (int dx = -DENOISE_RADIUS; dx <= DENOISE_RADIUS; ++dx)
+                {
+                    const UINT Tap = ny * In.Width + x + dx;
+
+                    __m128 w = _mm_set1_ps(GetDenoiseKernelWeight(dy) * GetDenoiseKernelWeight(dx));
+                    if (dx != 0 || dy != 0)
+                    {
+                        __m128 Diff = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(&In.Planes[DENOISE_TRANSMITTANCE][Tap]), T), AbsMask);
+                        __m128 Edge = _mm_min_ps(_mm_max_ps(_mm_sub_ps(One, _mm_mul_ps(Diff, AlphaScale)), Zero), One);
+                        w = _mm_mul_ps(w, _mm_mul_ps(Strength, Edge));
+                    }
+                    Sum[0] = _mm_add_ps(Sum[0], _mm_mul_ps(w, _mm_loadu_ps(&In.Planes[DENOISE_U_R][Tap])));
+                    Sum[1] = _mm_add_ps(Sum[1], _mm_mul_ps(w, _mm_loadu_ps(&In.Planes[DENOISE_U_G][Tap])));
+                    Sum[2] = _mm_add_ps(Sum[2], _mm_mul_ps(w, _mm_loadu_ps(&In.Planes[DENOISE_U_B][Tap])));
+                    Sum[3] = _mm_add_ps(Sum[3], _mm_mul_ps(w, _mm_loadu_ps(&In.Planes[DENOISE_U1][Tap])));
+                    SumW = _mm_add_ps(SumW, w);
+                }
+            }
+
+            _mm_storeu_ps(&Out.Planes[DENOISE_U_R][Center], _mm_div_ps(Sum[0], SumW));
+            _mm_storeu_ps(&Out.Planes[DENOISE_U_G][Center], _mm_div_ps(Sum[1], SumW));
+            _mm_storeu_ps(&Out.Planes[DENOISE_U_B][Center], _mm_div_ps(Sum[2], SumW));
+            _mm_storeu_ps(&Out.Planes[DENOISE_U1][Center], _mm_div_ps(Sum[3], SumW));
+            _mm_storeu_ps(&Out.Planes[DENOISE_TRANSMITTANCE][Center], T);
+        }
+        for (; x < In.Width; ++x)
+        {
+            DenoisePixel(In, x, y, Out);
+        }
+    }
+}
+
+#endif
+
+// The SSE2 kernel is also used on the AVX2 and AVX-512 CPUs: the filter is bound by the loads
+inline void DenoiseRows(const DenoiseImage &In, UINT BeginY, UINT EndY, DenoiseImage &Out, CoverageMaskISA Isa)
+{
+    assert(IsCoverageMaskISASupported(Isa));
+#if COVERAGE_MASKS_X86
+    if (Isa != COVERAGE_MASK_SCALAR)
+    {
+        DenoiseRowsSSE2(In, BeginY, EndY, Out);
+        return;
+    }
+#endif
+    DenoiseRowsScalar(In, BeginY, EndY, Out);
+}
+
+struct DenoiseJobData
+{
+    const DenoiseImage *pIn;
+    DenoiseImage *pOut;
+    CoverageMaskISA Isa;
+};
+
+inline void DenoiseJob(void *pData, UINT JobIndex, UINT /*WorkerId*/)
+{
+    const DenoiseJobData &Data = *(const DenoiseJobData*)pData;
+    const UINT BeginY = JobIndex * DENOISE_ROWS_PER_JOB;
+    const UINT EndY = std::min(BeginY + DENOISE_ROWS_PER_JOB, Data.pIn->Height);
+    DenoiseRows(*Data.pIn, BeginY, EndY, *Data.pOut, Data.Isa);
+}
+
+// Filters In into Out, by bands of DENOISE_ROWS_PER_JOB rows spread over the workers
+inline void Denoise(JobSystem &Jobs, const DenoiseImage &In, DenoiseImage &Out, CoverageMaskISA Isa)
+{
+    if (Out.Width != In.Width || Out.Height != In.Height)
+    {
+        Out.Resize(In.Width, In.Height);
+    }
+
+    DenoiseJobData Data;
+    Data.pIn = &In;
+    Data.pOut = &Out;
+    Data.Isa = Isa;
+    Jobs.ParallelFor(DenoiseJob, &Data, (In.Height + DENOISE_ROWS_PER_JOB - 1) / DENOISE_ROWS_PER_JOB);
+}
+
+//--------------------------------------------------------------------------------------
+// Benchmark of the CPU denoiser on a Width x Height image of noisy layers. Returns the
+// milliseconds of the scalar version on the calling thread (ScalarMs) and of the Isa version
+// on all the workers (ParallelMs), best of NumRuns; false if they do not match.
+//--------------------------------------------------------------------------------------
+inline bool BenchmarkDenoise(JobSystem &Jobs, CoverageMaskISA Isa, UINT Width, UINT Height, double &ScalarMs, double &ParallelMs,
+                             UINT NumRuns = 4)
+{
+    // Noisy discs of transmittance 0.25 over an empty background
+    DenoiseImage In, ScalarOut, ParallelOut;
+    In.Resize(Width, Height);
+    ScalarOut.Resize(Width, Height);
+    MTRand rng;
+    rng.seed((unsigned)3);
+    for (UINT y = 0; y < Height; ++y)
+    {
+        for (UINT x = 0; x < Width; ++x)
+        {
+            const UINT PixelId = y * Width + x;
+            const float dx = (float)(x % 64) - 32.f;
+            const float dy = (float)(y % 64) - 32.f;
+            if (dx * dx + dy * dy < 24.f * 24.f)
+            {
+                const float T = 0.25f;
+                const float U1 = (1.f - T) * (0.5f + rng.rand());
+                In.Planes[DENOISE_U_R][PixelId] = U1 * rng.rand();
+                In.Planes[DENOISE_U_G][PixelId] = U1 * rng.rand();
+                In.Planes[DENOISE_U_B][PixelId] = U1 * rng.rand();
+                In.Planes[DENOISE_TRANSMITTANCE][PixelId] = T;
+                In.Planes[DENOISE_U1][PixelId] = U1;
+                In.Strength[PixelId] = rng.rand();
+            }
+            else
+            {
+                In.Planes[DENOISE_TRANSMITTANCE][PixelId] = 1.f;
+            }
+        }
+    }
+
+    double BestScalar = 1e30;
+    double BestParallel = 1e30;
+    for (UINT Run = 0; Run < NumRuns; ++Run)
+    {
+        std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+        DenoiseRowsScalar(In, 0, Height, ScalarOut);
+        std::chrono::duration<double> Elapsed = std::chrono::high_resolution_clock::now() - Start;
+        BestScalar = std::min(BestScalar, Elapsed.count());
+
+        Start = std::chrono::high_resolution_clock::now();
+        Denoise(Jobs, In, ParallelOut, Isa);
+        Elapsed = std::chrono::high_resolution_clock::now() - Start;
+        BestParallel = std::min(BestParallel, Elapsed.count());
+    }
+
+    ScalarMs = BestScalar * 1e3;
+    ParallelMs = BestParallel * 1e3;
+
+    // The SIMD sums are in the same order, but the compiler may contract them differently
+    for (UINT Plane = 0; Plane < NUM_DENOISE_PLANES; ++Plane)
+    {
+        for (UINT PixelId = 0; PixelId < Width * Height; ++PixelId)
+        {
+            if (fabsf(ScalarOut.Planes[Plane][PixelId] - ParallelOut.Planes[Plane][PixelId]) > 1e-5f) return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,259 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+
+#include "SimpleRT.h"
+#include "RHI.h"
+#include "CommandList.h"
+#include "BaseTechnique.h"
+#include <string.h>
+
+#include "BaseTechnique_DepthComplexityPS.h"
+
+//--------------------------------------------------------------------------------------
+// The depth complexity probe draws the transparent draw list of the scene at a fraction
+// of the back buffer size, and counts the fragments of every pixel with additive blending
+// into an R32_FLOAT target. With opaque geometry, the fragments hidden by it are rejected
+// first, as in the techniques. The counts are read back a few frames later, for the
+// automatic selection of the technique (see SelectTechnique in main.cpp).
+//--------------------------------------------------------------------------------------
+
+// The probe renders at 1/8 of the back buffer size, 1/64 of its pixels
+#define DEPTH_COMPLEXITY_SCALE 8
+
+// Frames between the copy of the counts to the CPU and their readback
+#define DEPTH_COMPLEXITY_READBACK_LATENCY 3
+
+// The counts above are clamped, in the histogram as in the mean
+#define MAX_DEPTH_COMPLEXITY 64
+
+// Histogram of the fragment counts of the covered pixels, over a frame
+class DepthComplexityStats
+{
+public:
+    DepthComplexityStats()
+        : m_NumPixels(0)
+        , m_NumFragments(0.0)
+    {
+        memset(m_Histogram, 0, sizeof(m_Histogram));
+    }
+
+    void Add(const float *pCounts, UINT Count)
+    {
+        for (UINT i = 0; i < Count; ++i)
+        {
+            UINT NumLayers = (UINT)(pCounts[i] + 0.5f);
+            NumLayers = (NumLayers < MAX_DEPTH_COMPLEXITY) ? NumLayers : MAX_DEPTH_COMPLEXITY;
+            ++m_Histogram[NumLayers];
+            m_NumFragments += NumLayers;
+        }
+        m_NumPixels += Count;
+    }
+
+    UINT GetNumCoveredPixels() const
+    {
+        return m_NumPixels - m_Histogram[0];
+    }
+
+    float GetCoveredFraction() const
+    {
+        return m_NumPixels ? (float)GetNumCoveredPixels() / (float)m_NumPixels : 0.f;
+    }
+
+    // Average number of layers of the covered pixels
+    float GetMeanLayers() const
+    {
+        const UINT NumCovered = GetNumCoveredPixels();
+        return NumCovered ? (float)(m_NumFragments / NumCovered) : 0.f;
+    }
+
+    UINT GetMaxLayers() const
+    {
+        UINT NumLayers = MAX_DEPTH_COMPLEXITY;
+        while (NumLayers > 0 && !m_Histogram[NumLayers]) --NumLayers;
+        return NumLayers;
+    }
+
+    // Smallest number of layers that includes the given fraction of the covered pixels,
+    // so that a few pixels of high complexity do not decide for the whole frame
+    UINT GetPercentileLayers(float Fraction) const
+    {
+        const UINT NumCovered = GetNumCoveredPixels();
+        UINT NumBelow = 0;
+        for (UINT NumLayers = 1; NumLayers < MAX_DEPTH_COMPLEXITY; ++NumLayers)
+        {
+            NumBelow += m_Histogram[NumLayers];
+            if ((float)NumBelow >= Fraction * (float)NumCovered) return NumLayers;
+        }
+        return MAX_DEPTH_COMPLEXITY;
+    }
+
+protected:
+    UINT m_Histogram[MAX_DEPTH_COMPLEXITY + 1];
+    UINT m_NumPixels;
+    double m_NumFragments;
+};
+
+class DepthComplexityProbe
+{
+public:
+    // Width x Height is the size of the back buffer
+    DepthComplexityProbe(RHIDevice* pDevice, UINT Width, UINT Height)
+        : m_pCounts(NULL)
+        , m_pDepth(NULL)
+        , m_pNoCullRS(NULL)
+        , m_pDepthNoStencilDS(NULL)
+        , m_pDepthNoWriteDS(NULL)
+        , m_pAdditiveBS(NULL)
+        , m_pNoBlendBS(NULL)
+        , m_pDepthComplexityPS(NULL)
+        , m_CommandsValid(false)
+        , m_OpaqueGeometry(false)
+    {
+        RHITextureDesc texDesc;
+        texDesc.Width = GetReducedSize(Width, DEPTH_COMPLEXITY_SCALE);
+        texDesc.Height = GetReducedSize(Height, DEPTH_COMPLEXITY_SCALE);
+        texDesc.ArraySize = 1;
+        texDesc.SampleCount = 1;
+        texDesc.BindFlags = RHI_BIND_RENDER_TARGET | RHI_BIND_SHADER_RESOURCE;
+        m_pCounts = new SimpleRT(pDevice, &texDesc, RHI_FORMAT_R32_FLOAT);
+
+        texDesc.BindFlags = RHI_BIND_DEPTH_STENCIL;
+        texDesc.Format = RHI_FORMAT_D32_FLOAT;
+        m_pDepth = new SimpleDepthStencil(pDevice, &texDesc);
+
+        RHIRasterizerDesc rasterizerState;
+        rasterizerState.CullMode = RHI_CULL_NONE;
+        rasterizerState.FrontCounterClockwise = false;
+        rasterizerState.DepthClipEnable = false;
+        m_pNoCullRS = pDevice->CreateRasterizerState(rasterizerState);
+
+        RHIDepthStencilDesc depthstencilState;
+        depthstencilState.DepthEnable = true;
+        depthstencilState.DepthWriteEnable = true;
+        depthstencilState.DepthFunc = RHI_COMPARISON_LESS_EQUAL;
+        m_pDepthNoStencilDS = pDevice->CreateDepthStencilState(depthstencilState);
+
+        depthstencilState.DepthWriteEnable = false;
+        m_pDepthNoWriteDS = pDevice->CreateDepthStencilState(depthstencilState);
+
+        RHIBlendDesc blendState;
+        blendState.RenderTarget[0].BlendEnable = true;
+        blendState.RenderTarget[0].SrcBlend = RHI_BLEND_ONE;
+        blendState.RenderTarget[0].DestBlend = RHI_BLEND_ONE;
+        blendState.RenderTarget[0].BlendOp = RHI_BLEND_OP_ADD;
+        blendState.RenderTarget[0].SrcBlendAlpha = RHI_BLEND_ONE;
+        blendState.RenderTarget[0].DestBlendAlpha = RHI_BLEND_ONE;
+        blendState.RenderTarget[0].BlendOpAlpha = RHI_BLEND_OP_ADD;
+        m_pAdditiveBS = pDevice->CreateBlendState(blendState);
+
+        blendState.RenderTarget[0].BlendEnable = false;
+        m_pNoBlendBS = pDevice->CreateBlendState(blendState);
+
+        m_pDepthComplexityPS = pDevice->CreatePixelShader(g_DepthComplexityPS, sizeof(g_DepthComplexityPS));
+
+        m_BlendFactor[0] =
+        m_BlendFactor[1] =
+        m_BlendFactor[2] =
+        m_BlendFactor[3] = 1.0f;
+    }
+
+    ~DepthComplexityProbe()
+    {
+        SAFE_DELETE(m_pCounts);
+        SAFE_DELETE(m_pDepth);
+        SAFE_DELETE(m_pNoCullRS);
+        SAFE_DELETE(m_pDepthNoStencilDS);
+        SAFE_DELETE(m_pDepthNoWriteDS);
+        SAFE_DELETE(m_pAdditiveBS);
+        SAFE_DELETE(m_pNoBlendBS);
+        SAFE_DELETE(m_pDepthComplexityPS);
+    }
+
+    void SetOpaqueGeometry(bool OpaqueGeometry)
+    {
+        if (OpaqueGeometry != m_OpaqueGeometry)
+        {
+            m_OpaqueGeometry = OpaqueGeometry;
+            m_CommandsValid = false;
+        }
+    }
+
+    // Must follow the Render of a technique, whose constants of the frame it binds
+    void Render(RHIContext &Context)
+    {
+        if (!m_CommandsValid)
+        {
+            m_Commands.Clear();
+            RecordPasses(m_Commands);
+            m_CommandsValid = true;
+        }
+
+        Context.Submit(m_Commands, false);
+    }
+
+    // R32_FLOAT target with the number of transparent fragments of every pixel of the last frame
+    RHITexture* GetCounts() const
+    {
+        return m_pCounts->pTexture;
+    }
+
+    const CommandList& GetCommands() const
+    {
+        return m_Commands;
+    }
+
+protected:
+    void RecordPasses(CommandList &Commands)
+    {
+        Commands.BeginEvent(L"Depth Complexity Probe");
+        Commands.BindFrameConstants();
+        Commands.SetRasterizerState(m_pNoCullRS);
+
+        float ClearCounts[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        Commands.ClearRenderTarget(m_pCounts->pRTV, ClearCounts);
+        Commands.ClearDepth(m_pDepth->pDSV, 1.0);
+
+        if (m_OpaqueGeometry)
+        {
+            Commands.SetRenderTargets(0, NULL, m_pDepth->pDSV);
+            Commands.SetBlendState(m_pNoBlendBS, m_BlendFactor, 0xffffffff);
+            Commands.SetDepthStencilState(m_pDepthNoStencilDS, 0);
+            Commands.SetPixelShader(NULL);
+            Commands.DrawMesh(MESH_DRAW_LIST_OPAQUE);
+        }
+
+        Commands.SetRenderTargets(1, &m_pCounts->pRTV, m_pDepth->pDSV);
+        Commands.SetBlendState(m_pAdditiveBS, m_BlendFactor, 0xffffffff);
+        Commands.SetDepthStencilState(m_pDepthNoWriteDS, 0);
+        Commands.SetPixelShader(m_pDepthComplexityPS);
+        Commands.DrawMesh();
+        Commands.EndEvent();
+    }
+
+    SimpleRT *m_pCounts;
+    SimpleDepthStencil *m_pDepth;
+    RHIRasterizerState *m_pNoCullRS;
+    RHIDepthStencilState *m_pDepthNoStencilDS;
+    RHIDepthStencilState *m_pDepthNoWriteDS;
+    RHIBlendState *m_pAdditiveBS;
+    RHIBlendState *m_pNoBlendBS;
+    RHIShader *m_pDepthComplexityPS;
+    float m_BlendFactor[4];
+    CommandList m_Commands;
+    bool m_CommandsValid;
+    bool m_OpaqueGeometry;
+};
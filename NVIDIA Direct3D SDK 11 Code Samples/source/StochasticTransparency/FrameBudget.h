@@ -0,0 +1,235 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+
+#include <algorithm>
+
+//--------------------------------------------------------------------------------------
+// Frame budget governor. Averages the GPU time of the technique's submissions, derives
+// the cost of one transparent geometry pass, and trades the number of peeling passes and
+// the internal resolution against a target time. The quality is lowered as soon as the
+// average exceeds the target, and only raised back when the predicted time of the next
+// step leaves a margin, so that a setting does not toggle from one frame to the next.
+//--------------------------------------------------------------------------------------
+
+// Lower the quality above Target * (1 + FRAME_BUDGET_HIGH_MARGIN)
+#define FRAME_BUDGET_HIGH_MARGIN 0.05f
+
+// Raise the quality if the prediction is under Target * (1 - FRAME_BUDGET_LOW_MARGIN)
+#define FRAME_BUDGET_LOW_MARGIN 0.15f
+
+// Weight of a new measurement in the average
+#define FRAME_BUDGET_SMOOTHING 0.1f
+
+// Measurements averaged before a decision, after a change of the settings. The timings
+// are read back a few frames late (see STATS_QUERY_LATENCY in RHI_D3D11.h), so the first
+// frames after a change are skipped.
+#define FRAME_BUDGET_SKIPPED_FRAMES 8
+#define FRAME_BUDGET_MEASURED_FRAMES 16
+
+// Peeling passes kept before lowering the resolution: fewer passes drop the middle layers
+#define FRAME_BUDGET_MIN_PEELING_PASSES 2
+
+struct FrameBudgetSettings
+{
+    UINT NumPeelingPasses;      // Of the dual depth peeling
+    UINT ResolutionLevel;       // Internal render targets at 1 / 2^ResolutionLevel of the back buffer size
+
+    FrameBudgetSettings()
+        : NumPeelingPasses(1)
+        , ResolutionLevel(0)
+    {
+    }
+};
+
+class FrameBudgetGovernor
+{
+public:
+    FrameBudgetGovernor()
+        : m_MaxPeelingPasses(1)
+        , m_MaxResolutionLevel(0)
+        , m_TargetTime(16.f)
+        , m_AverageTime(0.f)
+        , m_PassTime(0.f)
+        , m_PredictedTime(0.f)
+        , m_NumFrames(0)
+        , m_NumChanges(0)
+    {
+    }
+
+    // Highest settings the governor may raise to
+    void SetLimits(UINT MaxPeelingPasses, UINT MaxResolutionLevel)
+    {
+        m_MaxPeelingPasses = MaxPeelingPasses;
+        m_MaxResolutionLevel = MaxResolutionLevel;
+    }
+
+    // GPU time of the technique's passes, in milliseconds
+    void SetTargetTime(float TargetTime)
+    {
+        m_TargetTime = TargetTime;
+    }
+
+    float GetTargetTime() const
+    {
+        return m_TargetTime;
+    }
+
+    // Drops the measurements, when the technique or the scene changed
+    void Reset()
+    {
+        m_NumFrames = 0;
+        m_AverageTime = 0.f;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Called once per frame with the last GPU time read back, in milliseconds, and the number
+    // of transparent geometry passes of that submission. Settings holds the current settings,
+    // and PeelingPasses tells whether the technique uses NumPeelingPasses.
+    // Returns true if Settings was changed.
+    //--------------------------------------------------------------------------------------
+    bool Update(float GPUTime, UINT NumGeometryPasses, bool PeelingPasses, FrameBudgetSettings &Settings)
+    {
+        ++m_NumFrames;
+        if (m_NumFrames <= FRAME_BUDGET_SKIPPED_FRAMES || GPUTime <= 0.f)
+        {
+            return false;
+        }
+
+        const bool First = (m_NumFrames == FRAME_BUDGET_SKIPPED_FRAMES + 1);
+        m_AverageTime = First ? GPUTime : m_AverageTime + (GPUTime - m_AverageTime) * FRAME_BUDGET_SMOOTHING;
+        m_PassTime = m_AverageTime / (float)std::max(NumGeometryPasses, 1U);
+        if (m_NumFrames < FRAME_BUDGET_SKIPPED_FRAMES + FRAME_BUDGET_MEASURED_FRAMES)
+        {
+            return false;
+        }
+
+        FrameBudgetSettings Next = Settings;
+        float PredictedTime = 0.f;
+        if (m_AverageTime > m_TargetTime * (1.f + FRAME_BUDGET_HIGH_MARGIN))
+        {
+            if (!Lower(Settings, PeelingPasses, Next, PredictedTime)) return false;
+        }
+        else
+        {
+            if (!Raise(Settings, PeelingPasses, Next, PredictedTime)) return false;
+            if (PredictedTime > m_TargetTime * (1.f - FRAME_BUDGET_LOW_MARGIN)) return false;
+        }
+
+        Settings = Next;
+        m_PredictedTime = PredictedTime;
+        ++m_NumChanges;
+        Reset();
+        return true;
+    }
+
+    // Average GPU time of the current settings
+    float GetAverageTime() const
+    {
+        return m_AverageTime;
+    }
+
+    // Average GPU time divided by the number of transparent geometry passes
+    float GetPassTime() const
+    {
+        return m_PassTime;
+    }
+
+    // Time predicted for the settings of the last change, to compare with GetAverageTime
+    float GetPredictedTime() const
+    {
+        return m_PredictedTime;
+    }
+
+    UINT GetNumChanges() const
+    {
+        return m_NumChanges;
+    }
+
+protected:
+    // The fill-bound passes scale with the number of pixels, 4x per resolution level
+    float PredictResolution(UINT FromLevel, UINT ToLevel) const
+    {
+        float Scale = 1.f;
+        for (UINT Level = ToLevel; Level < FromLevel; ++Level) Scale *= 4.f;
+        for (UINT Level = FromLevel; Level < ToLevel; ++Level) Scale *= 0.25f;
+        return m_AverageTime * Scale;
+    }
+
+    // The passes other than the peeling passes are counted with them, which overestimates
+    // the time saved by removing a pass and the time added by adding one
+    float PredictPeeling(UINT FromPasses, UINT ToPasses) const
+    {
+        return m_AverageTime + m_PassTime * ((float)ToPasses - (float)FromPasses);
+    }
+
+    // Peeling passes down to FRAME_BUDGET_MIN_PEELING_PASSES, then the resolution, then the last passes
+    bool Lower(const FrameBudgetSettings &Settings, bool PeelingPasses, FrameBudgetSettings &Next, float &PredictedTime) const
+    {
+        if (PeelingPasses && Settings.NumPeelingPasses > FRAME_BUDGET_MIN_PEELING_PASSES)
+        {
+            Next.NumPeelingPasses = Settings.NumPeelingPasses - 1;
+            PredictedTime = PredictPeeling(Settings.NumPeelingPasses, Next.NumPeelingPasses);
+            return true;
+        }
+        if (Settings.ResolutionLevel < m_MaxResolutionLevel)
+        {
+            Next.ResolutionLevel = Settings.ResolutionLevel + 1;
+            PredictedTime = PredictResolution(Settings.ResolutionLevel, Next.ResolutionLevel);
+            return true;
+        }
+        if (PeelingPasses && Settings.NumPeelingPasses > 1)
+        {
+            Next.NumPeelingPasses = Settings.NumPeelingPasses - 1;
+            PredictedTime = PredictPeeling(Settings.NumPeelingPasses, Next.NumPeelingPasses);
+            return true;
+        }
+        return false;
+    }
+
+    // The reverse order of Lower
+    bool Raise(const FrameBudgetSettings &Settings, bool PeelingPasses, FrameBudgetSettings &Next, float &PredictedTime) const
+    {
+        if (PeelingPasses && Settings.NumPeelingPasses < FRAME_BUDGET_MIN_PEELING_PASSES)
+        {
+            Next.NumPeelingPasses = Settings.NumPeelingPasses + 1;
+            PredictedTime = PredictPeeling(Settings.NumPeelingPasses, Next.NumPeelingPasses);
+            return true;
+        }
+        if (Settings.ResolutionLevel > 0)
+        {
+            Next.ResolutionLevel = Settings.ResolutionLevel - 1;
+            PredictedTime = PredictResolution(Settings.ResolutionLevel, Next.ResolutionLevel);
+            return true;
+        }
+        if (PeelingPasses && Settings.NumPeelingPasses < m_MaxPeelingPasses)
+        {
+            Next.NumPeelingPasses = Settings.NumPeelingPasses + 1;
+            PredictedTime = PredictPeeling(Settings.NumPeelingPasses, Next.NumPeelingPasses);
+            return true;
+        }
+        return false;
+    }
+
+    UINT m_MaxPeelingPasses;
+    UINT m_MaxResolutionLevel;
+    float m_TargetTime;
+    float m_AverageTime;
+    float m_PassTime;
+    float m_PredictedTime;
+    UINT m_NumFrames;           // Since the last change or reset
+    UINT m_NumChanges;
+};
@@ -0,0 +1,272 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+
+#include "BVH.h"
+#include <vector>
+#include <algorithm>
+#include <float.h>
+#include <assert.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define HIZ_SSE2 1
+#include <emmintrin.h>
+#else
+#define HIZ_SSE2 0
+#endif
+
+//--------------------------------------------------------------------------------------
+// Min/max depth reduction of one row pair: Dst[x] covers the source texels 2x and 2x+1
+// of both rows, clamped to the last column for odd widths
+//--------------------------------------------------------------------------------------
+inline void ReduceHiZRowScalar(const float *pRow0, const float *pRow1, UINT SrcWidth, UINT Begin, UINT DstWidth,
+                               bool IsMax, float *pDst)
+{
+    for (UINT x = Begin; x < DstWidth; ++x)
+    {
+        const UINT x0 = 2 * x;
+        const UINT x1 = std::min(x0 + 1, SrcWidth - 1);
+        pDst[x] = IsMax ? std::max(std::max(pRow0[x0], pRow0[x1]), std::max(pRow1[x0], pRow1[x1]))
+                        : std::min(std::min(pRow0[x0], pRow0[x1]), std::min(pRow1[x0], pRow1[x1]));
+    }
+}
+
+#if HIZ_SSE2
+
+// 4 destination texels at a time, from 8 source columns of each row
+inline void ReduceHiZRowSSE2(const float *pRow0, const float *pRow1, UINT SrcWidth, UINT DstWidth,
+                             bool IsMax, float *pDst)
+{
+    UINT x = 0;
+    for (; x + 4 <= SrcWidth / 2; x += 4)
+    {
+        const __m128 a = _mm_loadu_ps(pRow0 + 2 * x);
+        const __m128 b = _mm_loadu_ps(pRow0 + 2 * x + 4);
+        const __m128 c = _mm_loadu_ps(pRow1 + 2 * x);
+        const __m128 d = _mm_loadu_ps(pRow1 + 2 * x + 4);
+        const __m128 v0 = IsMax ? _mm_max_ps(a, c) : _mm_min_ps(a, c);
+        const __m128 v1 = IsMax ? _mm_max_ps(b, d) : _mm_min_ps(b, d);
+        const __m128 Even = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 Odd = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(pDst + x, IsMax ? _mm_max_ps(Even, Odd) : _mm_min_ps(Even, Odd));
+    }
+    ReduceHiZRowScalar(pRow0, pRow1, SrcWidth, x, DstWidth, IsMax, pDst);
+}
+
+#endif
+
+//--------------------------------------------------------------------------------------
+// Hierarchical-Z pyramid of a depth buffer, built on the CPU. Level 0 is half the size of
+// the depth buffer, and every texel stores the nearest and the farthest depth of the
+// pixels it covers, up to a single texel.
+//
+// The queries are conservative: a box is occluded only if its nearest depth is behind
+// the farthest depth of every texel covering its screen rectangle, read at the level
+// where the rectangle spans at most 2x2 texels.
+//--------------------------------------------------------------------------------------
+class HiZPyramid
+{
+public:
+    struct Level
+    {
+        UINT Width;
+        UINT Height;
+        std::vector<float> MinDepth;
+        std::vector<float> MaxDepth;
+    };
+
+    HiZPyramid()
+        : m_Width(0)
+        , m_Height(0)
+        , m_Generation(0)
+        , m_UseSIMD(HIZ_SSE2 != 0)
+    {
+    }
+
+    // Depths in [0,1], with RowPitch in bytes
+    void Build(const float *pDepth, UINT Width, UINT Height, UINT RowPitch)
+    {
+        assert(Width > 0 && Height > 0);
+        if (Width != m_Width || Height != m_Height)
+        {
+            Allocate(Width, Height);
+        }
+        ++m_Generation;
+
+        Level &First = m_Levels[0];
+        for (UINT y = 0; y < First.Height; ++y)
+        {
+            const float *pRow0 = (const float*)((const BYTE*)pDepth + (2 * y) * RowPitch);
+            const float *pRow1 = (const float*)((const BYTE*)pDepth + std::min(2 * y + 1, Height - 1) * RowPitch);
+            ReduceRow(pRow0, pRow1, Width, First.Width, false, &First.MinDepth[y * First.Width]);
+            ReduceRow(pRow0, pRow1, Width, First.Width, true, &First.MaxDepth[y * First.Width]);
+        }
+
+        for (size_t LevelId = 1; LevelId < m_Levels.size(); ++LevelId)
+        {
+            const Level &Src = m_Levels[LevelId - 1];
+            Level &Dst = m_Levels[LevelId];
+            for (UINT y = 0; y < Dst.Height; ++y)
+            {
+                const UINT y0 = 2 * y;
+                const UINT y1 = std::min(y0 + 1, Src.Height - 1);
+                ReduceRow(&Src.MinDepth[y0 * Src.Width], &Src.MinDepth[y1 * Src.Width], Src.Width, Dst.Width,
+                          false, &Dst.MinDepth[y * Dst.Width]);
+                ReduceRow(&Src.MaxDepth[y0 * Src.Width], &Src.MaxDepth[y1 * Src.Width], Src.Width, Dst.Width,
+                          true, &Dst.MaxDepth[y * Dst.Width]);
+            }
+        }
+    }
+
+    void Clear()
+    {
+        m_Levels.clear();
+        m_Width = 0;
+        m_Height = 0;
+        ++m_Generation;
+    }
+
+    bool IsEmpty() const { return m_Levels.empty(); }
+
+    // Incremented by every Build and Clear, so that the users know when to query again
+    UINT GetGeneration() const { return m_Generation; }
+
+    UINT GetWidth() const { return m_Width; }
+    UINT GetHeight() const { return m_Height; }
+    UINT GetNumLevels() const { return (UINT)m_Levels.size(); }
+    const Level& GetLevel(UINT LevelId) const { return m_Levels[LevelId]; }
+
+    // The SSE2 kernel gives the same pyramid as the scalar one
+    void SetSIMD(bool Enable) { m_UseSIMD = Enable && HIZ_SSE2; }
+    bool GetSIMD() const { return m_UseSIMD; }
+
+    // Nearest and farthest depths of the pixels [MinX,MaxX]x[MinY,MaxY] (inclusive),
+    // possibly over a larger area
+    void GetDepthRange(UINT MinX, UINT MinY, UINT MaxX, UINT MaxY, float &MinDepth, float &MaxDepth) const
+    {
+        assert(!IsEmpty() && MinX <= MaxX && MinY <= MaxY);
+
+        // Level 0 texels cover 2x2 pixels
+        UINT LevelId = 0;
+        UINT Shift = 1;
+        while (LevelId + 1 < m_Levels.size() && ((MaxX >> Shift) - (MinX >> Shift) > 1 || (MaxY >> Shift) - (MinY >> Shift) > 1))
+        {
+            ++LevelId;
+            ++Shift;
+        }
+
+        const Level &L = m_Levels[LevelId];
+        const UINT x0 = std::min(MinX >> Shift, L.Width - 1);
+        const UINT x1 = std::min(MaxX >> Shift, L.Width - 1);
+        const UINT y0 = std::min(MinY >> Shift, L.Height - 1);
+        const UINT y1 = std::min(MaxY >> Shift, L.Height - 1);
+        MinDepth = FLT_MAX;
+        MaxDepth = -FLT_MAX;
+        for (UINT y = y0; y <= y1; ++y)
+        {
+            for (UINT x = x0; x <= x1; ++x)
+            {
+                MinDepth = std::min(MinDepth, L.MinDepth[y * L.Width + x]);
+                MaxDepth = std::max(MaxDepth, L.MaxDepth[y * L.Width + x]);
+            }
+        }
+    }
+
+    bool IsRectOccluded(UINT MinX, UINT MinY, UINT MaxX, UINT MaxY, float NearestDepth) const
+    {
+        float MinDepth, MaxDepth;
+        GetDepthRange(MinX, MinY, MaxX, MaxY, MinDepth, MaxDepth);
+        return NearestDepth > MaxDepth;
+    }
+
+    // Object-space box, with the transform that rendered the depth buffer (D3D clip space).
+    // Boxes crossing the plane of the eye are never occluded.
+    bool IsBoxOccluded(const BoundingBoxAABB &Box, DirectX::CXMMATRIX WorldViewProj) const
+    {
+        using namespace DirectX;
+
+        if (IsEmpty()) return false;
+
+        XMVECTOR RectMin = XMVectorReplicate(FLT_MAX);
+        XMVECTOR RectMax = XMVectorReplicate(-FLT_MAX);
+        for (UINT Corner = 0; Corner < 8; ++Corner)
+        {
+            XMVECTOR P = XMVectorSet((Corner & 1) ? Box.Max.x : Box.Min.x,
+                                     (Corner & 2) ? Box.Max.y : Box.Min.y,
+                                     (Corner & 4) ? Box.Max.z : Box.Min.z, 1.f);
+            XMVECTOR Clip = XMVector4Transform(P, WorldViewProj);
+            float w = XMVectorGetW(Clip);
+            if (w <= FLT_EPSILON) return false;
+
+            XMVECTOR Ndc = XMVectorScale(Clip, 1.f / w);
+            RectMin = XMVectorMin(RectMin, Ndc);
+            RectMax = XMVectorMax(RectMax, Ndc);
+        }
+
+        // The rasterizer states disable depth clipping, so the nearer depths are clamped to 0
+        float NearestDepth = XMVectorGetZ(RectMin);
+        if (NearestDepth <= 0.f) return false;
+
+        // NDC to pixels, with y pointing down
+        float MinX = (XMVectorGetX(RectMin) * 0.5f + 0.5f) * m_Width;
+        float MaxX = (XMVectorGetX(RectMax) * 0.5f + 0.5f) * m_Width;
+        float MinY = (0.5f - XMVectorGetY(RectMax) * 0.5f) * m_Height;
+        float MaxY = (0.5f - XMVectorGetY(RectMin) * 0.5f) * m_Height;
+        if (MaxX < 0.f || MaxY < 0.f || MinX >= (float)m_Width || MinY >= (float)m_Height) return false;
+
+        return IsRectOccluded((UINT)std::max(MinX, 0.f), (UINT)std::max(MinY, 0.f),
+                              (UINT)std::min(MaxX, (float)(m_Width - 1)), (UINT)std::min(MaxY, (float)(m_Height - 1)),
+                              NearestDepth);
+    }
+
+protected:
+    void Allocate(UINT Width, UINT Height)
+    {
+        m_Width = Width;
+        m_Height = Height;
+        m_Levels.clear();
+        do
+        {
+            Width = (Width + 1) / 2;
+            Height = (Height + 1) / 2;
+            Level L;
+            L.Width = Width;
+            L.Height = Height;
+            L.MinDepth.resize(Width * Height);
+            L.MaxDepth.resize(Width * Height);
+            m_Levels.push_back(L);
+        }
+        while (Width > 1 || Height > 1);
+    }
+
+    void ReduceRow(const float *pRow0, const float *pRow1, UINT SrcWidth, UINT DstWidth, bool IsMax, float *pDst) const
+    {
+#if HIZ_SSE2
+        if (m_UseSIMD)
+        {
+            ReduceHiZRowSSE2(pRow0, pRow1, SrcWidth, DstWidth, IsMax, pDst);
+            return;
+        }
+#endif
+        ReduceHiZRowScalar(pRow0, pRow1, SrcWidth, 0, DstWidth, IsMax, pDst);
+    }
+
+    std::vector<Level> m_Levels;
+    UINT m_Width;
+    UINT m_Height;
+    UINT m_Generation;
+    bool m_UseSIMD;
+};
@@ -0,0 +1,233 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+
+#include "BVH.h"
+#include "HiZ.h"
+#include "TransformState.h"
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+// Largest instance grid (MAX_INSTANCE_GRID_SIZE^2 instances)
+#define MAX_INSTANCE_GRID_SIZE 64
+#define MAX_NUM_INSTANCES (MAX_INSTANCE_GRID_SIZE * MAX_INSTANCE_GRID_SIZE)
+
+// Distance between neighboring instances, relative to the largest extent of the mesh
+#define INSTANCE_SPACING 1.25f
+
+//--------------------------------------------------------------------------------------
+// Copies of the mesh placed on a grid in model space. The instances are culled with a
+// BVH over their bounding boxes, and the transforms of the visible ones are uploaded to
+// a dynamic structured buffer read by InstancedGeometryVS. Each subset is then drawn
+// once with DrawIndexedInstanced, whatever the number of instances.
+//--------------------------------------------------------------------------------------
+class InstanceBuffer
+{
+public:
+    InstanceBuffer()
+        : m_pBuffer(NULL)
+        , m_pSRV(NULL)
+        , m_GridSize(0)
+        , m_NumVisibleInstances(0)
+        , m_NumOccludedInstances(0)
+        , m_CulledVersion(~0U)
+        , m_CulledHiZGeneration(0)
+        , m_UploadedVersion(~0U)
+        , m_MinDepth(0.f)
+        , m_MaxDepth(0.f)
+        , m_HasDepthRange(false)
+    {
+    }
+
+    ~InstanceBuffer()
+    {
+        Destroy();
+    }
+
+    HRESULT Create(ID3D11Device* pd3dDevice, const DirectX::XMFLOAT4 &MeshMin, const DirectX::XMFLOAT4 &MeshExtent)
+    {
+        HRESULT hr;
+
+        D3D11_BUFFER_DESC bufferDesc;
+        bufferDesc.ByteWidth = MAX_NUM_INSTANCES * sizeof(InstanceTransform);
+        bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+        bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        bufferDesc.StructureByteStride = sizeof(InstanceTransform);
+
+        SAFE_RELEASE(m_pBuffer);
+        V_RETURN( pd3dDevice->CreateBuffer(&bufferDesc, NULL, &m_pBuffer) );
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+        srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+        srvDesc.Buffer.FirstElement = 0;
+        srvDesc.Buffer.NumElements = MAX_NUM_INSTANCES;
+
+        SAFE_RELEASE(m_pSRV);
+        V_RETURN( pd3dDevice->CreateShaderResourceView(m_pBuffer, &srvDesc, &m_pSRV) );
+
+        m_MeshBox.Min = DirectX::XMFLOAT3(MeshMin.x, MeshMin.y, MeshMin.z);
+        m_MeshBox.Max = DirectX::XMFLOAT3(MeshMin.x + MeshExtent.x, MeshMin.y + MeshExtent.y, MeshMin.z + MeshExtent.z);
+        m_Transforms.resize(MAX_NUM_INSTANCES);
+        m_Visible.reserve(MAX_NUM_INSTANCES);
+        m_CulledVersion = ~0U;
+        m_UploadedVersion = ~0U;
+        SetGridSize(1);
+
+        return S_OK;
+    }
+
+    void Destroy()
+    {
+        SAFE_RELEASE(m_pSRV);
+        SAFE_RELEASE(m_pBuffer);
+        m_Local.clear();
+        m_Transforms.clear();
+        m_Visible.clear();
+        m_BVH.Clear();
+        m_GridSize = 0;
+        m_NumVisibleInstances = 0;
+        m_NumOccludedInstances = 0;
+    }
+
+    // GridSize x GridSize copies in the XZ plane, centered on the original mesh
+    void SetGridSize(UINT GridSize)
+    {
+        GridSize = std::max(1U, std::min(GridSize, (UINT)MAX_INSTANCE_GRID_SIZE));
+        if (GridSize == m_GridSize) return;
+        m_GridSize = GridSize;
+        m_CulledVersion = ~0U;
+
+        float Extent = std::max(m_MeshBox.Max.x - m_MeshBox.Min.x, m_MeshBox.Max.z - m_MeshBox.Min.z);
+        float Spacing = Extent * INSTANCE_SPACING;
+        float Center = 0.5f * (float)(GridSize - 1);
+
+        m_Local.resize(GridSize * GridSize);
+        std::vector<BoundingBoxAABB> Boxes(GridSize * GridSize);
+        for (UINT z = 0; z < GridSize; ++z)
+        {
+            for (UINT x = 0; x < GridSize; ++x)
+            {
+                UINT InstanceId = z * GridSize + x;
+                float dx = ((float)x - Center) * Spacing;
+                float dz = ((float)z - Center) * Spacing;
+                DirectX::XMStoreFloat4x4(&m_Local[InstanceId], DirectX::XMMatrixTranslation(dx, 0.f, dz));
+
+                BoundingBoxAABB &Box = Boxes[InstanceId];
+                Box.Min = DirectX::XMFLOAT3(m_MeshBox.Min.x + dx, m_MeshBox.Min.y, m_MeshBox.Min.z + dz);
+                Box.Max = DirectX::XMFLOAT3(m_MeshBox.Max.x + dx, m_MeshBox.Max.y, m_MeshBox.Max.z + dz);
+            }
+        }
+        m_BVH.Build(Boxes);
+    }
+
+    // Frustum culling of the instances, and view-space depth range of the visible ones.
+    // As for the meshlets, the frustum side planes do not depend on the depth range, and
+    // the instances behind the optional Hi-Z pyramid are removed after the depth range is found.
+    // Skipped if neither the transforms, the grid nor the pyramid changed.
+    void Cull(TransformState &Transforms, const HiZPyramid *pHiZ = NULL)
+    {
+        UINT Version = Transforms.GetVersion(TRANSFORM_WORLD_VIEW_PROJ);
+        UINT HiZGeneration = pHiZ ? pHiZ->GetGeneration() : 0;
+        if (Version == m_CulledVersion && HiZGeneration == m_CulledHiZGeneration) return;
+        m_CulledVersion = Version;
+        m_CulledHiZGeneration = HiZGeneration;
+
+        DirectX::XMVECTOR Planes[4];
+        ExtractFrustumSidePlanes(Transforms.Get(TRANSFORM_WORLD_VIEW_PROJ), Planes);
+
+        m_Visible.clear();
+        m_MinDepth = FLT_MAX;
+        m_MaxDepth = -FLT_MAX;
+        m_BVH.Cull(Planes, DirectX::XMMatrixTranspose(Transforms.Get(TRANSFORM_WORLD_VIEW)).r[2], m_Visible, m_MinDepth, m_MaxDepth);
+        m_HasDepthRange = (m_MinDepth <= m_MaxDepth);
+        m_UploadedVersion = ~0U;
+
+        m_NumOccludedInstances = 0;
+        if (pHiZ)
+        {
+            DirectX::XMMATRIX WorldViewProj = Transforms.Get(TRANSFORM_WORLD_VIEW_PROJ);
+            size_t NumVisible = 0;
+            for (size_t i = 0; i < m_Visible.size(); ++i)
+            {
+                if (pHiZ->IsBoxOccluded(m_BVH.GetBox(m_Visible[i]), WorldViewProj))
+                {
+                    ++m_NumOccludedInstances;
+                }
+                else
+                {
+                    m_Visible[NumVisible++] = m_Visible[i];
+                }
+            }
+            m_Visible.resize(NumVisible);
+        }
+    }
+
+    // Computes and uploads the transforms of the instances that passed the last Cull call.
+    // Skipped if neither the transforms nor the visible set changed.
+    void Update(ID3D11DeviceContext* pd3dImmediateContext, TransformState &Transforms)
+    {
+        UINT Version = Transforms.GetVersion(TRANSFORM_WORLD_VIEW_PROJ);
+        if (Version == m_UploadedVersion) return;
+        m_UploadedVersion = Version;
+
+        m_NumVisibleInstances = (UINT)m_Visible.size();
+        if (!m_pBuffer || m_NumVisibleInstances == 0) return;
+
+        Transforms.GetInstanceTransforms(&m_Local[0], &m_Visible[0], m_NumVisibleInstances, &m_Transforms[0]);
+
+        D3D11_MAPPED_SUBRESOURCE MappedResource;
+        if (SUCCEEDED(pd3dImmediateContext->Map(m_pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource)))
+        {
+            memcpy(MappedResource.pData, &m_Transforms[0], m_NumVisibleInstances * sizeof(InstanceTransform));
+            pd3dImmediateContext->Unmap(m_pBuffer, 0);
+        }
+    }
+
+    bool GetDepthRange(float &MinDepth, float &MaxDepth) const
+    {
+        MinDepth = m_MinDepth;
+        MaxDepth = m_MaxDepth;
+        return m_HasDepthRange;
+    }
+
+    ID3D11ShaderResourceView* GetSRV() const { return m_pSRV; }
+    UINT GetGridSize() const { return m_GridSize; }
+    UINT GetNumInstances() const { return (UINT)m_Local.size(); }
+    UINT GetNumVisibleInstances() const { return m_NumVisibleInstances; }
+    UINT GetNumOccludedInstances() const { return m_NumOccludedInstances; }
+
+protected:
+    ID3D11Buffer *m_pBuffer;
+    ID3D11ShaderResourceView *m_pSRV;
+    BoundingBoxAABB m_MeshBox;
+    UINT m_GridSize;
+    std::vector<DirectX::XMFLOAT4X4> m_Local;
+    std::vector<InstanceTransform> m_Transforms;
+    std::vector<UINT> m_Visible;
+    BoundingVolumeHierarchy m_BVH;
+    UINT m_NumVisibleInstances;
+    UINT m_NumOccludedInstances;
+    UINT m_CulledVersion;
+    UINT m_CulledHiZGeneration;
+    UINT m_UploadedVersion;
+    float m_MinDepth;
+    float m_MaxDepth;
+    bool m_HasDepthRange;
+};
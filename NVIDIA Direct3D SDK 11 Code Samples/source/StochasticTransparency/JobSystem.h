@@ -0,0 +1,203 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+
+//--------------------------------------------------------------------------------------
+// Minimal work-stealing job system.
+// ParallelFor spreads the job indices over one queue per worker. Each worker pops from
+// the back of its own queue and, once it is empty, steals from the front of the others.
+// The calling thread takes part as worker 0, so there is no GPU or device dependency.
+//--------------------------------------------------------------------------------------
+class JobSystem
+{
+public:
+    typedef void (*JobFunction)(void *pData, UINT JobIndex, UINT WorkerId);
+
+    // NumWorkers includes the calling thread; 0 picks one worker per hardware thread
+    JobSystem(UINT NumWorkers = 0)
+        : m_Function(NULL)
+        , m_pData(NULL)
+        , m_Generation(0)
+        , m_Quit(false)
+        , m_NumRemaining(0)
+        , m_NumSteals(0)
+    {
+        if (NumWorkers == 0)
+        {
+            NumWorkers = std::max(std::thread::hardware_concurrency(), 1U);
+        }
+
+        m_Queues.resize(NumWorkers);
+        for (UINT WorkerId = 0; WorkerId < NumWorkers; ++WorkerId)
+        {
+            m_Queues[WorkerId] = new WorkerQueue;
+        }
+        for (UINT WorkerId = 1; WorkerId < NumWorkers; ++WorkerId)
+        {
+            m_Threads.push_back(std::thread(&JobSystem::WorkerMain, this, WorkerId));
+        }
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            m_Quit = true;
+        }
+        m_WakeUp.notify_all();
+
+        for (size_t i = 0; i < m_Threads.size(); ++i)
+        {
+            m_Threads[i].join();
+        }
+        for (size_t i = 0; i < m_Queues.size(); ++i)
+        {
+            delete m_Queues[i];
+        }
+    }
+
+    // Calls Function(pData, i, WorkerId) for every i in [0,NumJobs), and returns once all the calls are done.
+    // Calls with the same WorkerId never overlap, so WorkerId can index per-thread resources.
+    void ParallelFor(JobFunction Function, void *pData, UINT NumJobs)
+    {
+        if (NumJobs == 0) return;
+
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            m_Function = Function;
+            m_pData = pData;
+            m_NumRemaining = NumJobs;
+
+            // Contiguous ranges per worker, so that neighboring jobs tend to run on the same thread
+            const UINT NumWorkers = GetNumWorkers();
+            for (UINT WorkerId = 0; WorkerId < NumWorkers; ++WorkerId)
+            {
+                WorkerQueue &Queue = *m_Queues[WorkerId];
+                std::lock_guard<std::mutex> QueueLock(Queue.Mutex);
+                for (UINT JobIndex = NumJobs * WorkerId / NumWorkers; JobIndex < NumJobs * (WorkerId + 1) / NumWorkers; ++JobIndex)
+                {
+                    Queue.Jobs.push_back(JobIndex);
+                }
+            }
+            ++m_Generation;
+        }
+        m_WakeUp.notify_all();
+
+        RunJobs(0);
+
+        std::unique_lock<std::mutex> Lock(m_Mutex);
+        while (m_NumRemaining != 0)
+        {
+            m_Done.wait(Lock);
+        }
+    }
+
+    UINT GetNumWorkers() const { return (UINT)m_Queues.size(); }
+
+    // Number of jobs executed by another worker than the one they were queued on
+    UINT GetNumSteals() const { return m_NumSteals; }
+    void ResetNumSteals() { m_NumSteals = 0; }
+
+protected:
+    struct WorkerQueue
+    {
+        std::mutex Mutex;
+        std::deque<UINT> Jobs;
+    };
+
+    void WorkerMain(UINT WorkerId)
+    {
+        UINT Generation = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> Lock(m_Mutex);
+                while (!m_Quit && m_Generation == Generation)
+                {
+                    m_WakeUp.wait(Lock);
+                }
+                if (m_Quit) return;
+                Generation = m_Generation;
+            }
+            RunJobs(WorkerId);
+        }
+    }
+
+    void RunJobs(UINT WorkerId)
+    {
+        UINT JobIndex;
+        while (PopOrSteal(WorkerId, JobIndex))
+        {
+            m_Function(m_pData, JobIndex, WorkerId);
+
+            if (--m_NumRemaining == 0)
+            {
+                std::lock_guard<std::mutex> Lock(m_Mutex);
+                m_Done.notify_all();
+            }
+        }
+    }
+
+    bool PopOrSteal(UINT WorkerId, UINT &JobIndex)
+    {
+        {
+            WorkerQueue &Queue = *m_Queues[WorkerId];
+            std::lock_guard<std::mutex> Lock(Queue.Mutex);
+            if (!Queue.Jobs.empty())
+            {
+                JobIndex = Queue.Jobs.back();
+                Queue.Jobs.pop_back();
+                return true;
+            }
+        }
+
+        const UINT NumWorkers = GetNumWorkers();
+        for (UINT i = 1; i < NumWorkers; ++i)
+        {
+            WorkerQueue &Victim = *m_Queues[(WorkerId + i) % NumWorkers];
+            std::lock_guard<std::mutex> Lock(Victim.Mutex);
+            if (!Victim.Jobs.empty())
+            {
+                JobIndex = Victim.Jobs.front();
+                Victim.Jobs.pop_front();
+                ++m_NumSteals;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<WorkerQueue*> m_Queues;
+    std::vector<std::thread> m_Threads;
+    JobFunction m_Function;
+    void *m_pData;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeUp;
+    std::condition_variable m_Done;
+    UINT m_Generation;
+    bool m_Quit;
+    std::atomic<UINT> m_NumRemaining;
+    std::atomic<UINT> m_NumSteals;
+};
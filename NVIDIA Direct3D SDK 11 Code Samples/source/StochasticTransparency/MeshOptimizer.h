@@ -0,0 +1,284 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+// Size of the FIFO used to measure the post-transform cache efficiency
+#define STATS_CACHE_SIZE 16
+
+// Size of the LRU cache modelled by the Forsyth optimizer
+#define FORSYTH_CACHE_SIZE 32
+
+// Post-transform vertex cache statistics for one triangle list
+struct VertexCacheStats
+{
+    UINT NumTriangles;
+    UINT NumVertices;       // Number of unique vertices referenced
+    UINT NumTransforms;     // Number of cache misses
+
+    VertexCacheStats()
+        : NumTriangles(0)
+        , NumVertices(0)
+        , NumTransforms(0)
+    {
+    }
+
+    void Accumulate(const VertexCacheStats &Other)
+    {
+        NumTriangles += Other.NumTriangles;
+        NumVertices += Other.NumVertices;
+        NumTransforms += Other.NumTransforms;
+    }
+
+    // Average Cache Miss Ratio: transformed vertices per triangle (0.5 is the ideal for regular grids)
+    float GetACMR() const
+    {
+        return NumTriangles ? (float)NumTransforms / (float)NumTriangles : 0.f;
+    }
+
+    // Average Transform to Vertex Ratio: transformed vertices per unique vertex (1.0 is the ideal)
+    float GetATVR() const
+    {
+        return NumVertices ? (float)NumTransforms / (float)NumVertices : 0.f;
+    }
+};
+
+//--------------------------------------------------------------------------------------
+// Simulates a FIFO post-transform cache over a triangle list with local vertex ids in [0,NumVertices)
+//--------------------------------------------------------------------------------------
+inline VertexCacheStats ComputeVertexCacheStats(const UINT *pIndices, UINT NumIndices, UINT NumVertices)
+{
+    VertexCacheStats Stats;
+    Stats.NumTriangles = NumIndices / 3;
+
+    // Each vertex stores the value of the miss counter when it entered the FIFO
+    std::vector<UINT> Timestamps(NumVertices, 0);
+    std::vector<bool> Referenced(NumVertices, false);
+
+    for (UINT i = 0; i < NumIndices; ++i)
+    {
+        UINT VertexId = pIndices[i];
+        if (!Referenced[VertexId])
+        {
+            Referenced[VertexId] = true;
+            ++Stats.NumVertices;
+        }
+        if (Timestamps[VertexId] == 0 || Stats.NumTransforms - Timestamps[VertexId] + 1 > STATS_CACHE_SIZE)
+        {
+            ++Stats.NumTransforms;
+            Timestamps[VertexId] = Stats.NumTransforms;
+        }
+    }
+    return Stats;
+}
+
+//--------------------------------------------------------------------------------------
+// Linear-speed vertex cache optimization [Forsyth 2006]
+// Reorders the triangles of a triangle list in place. The triangles are not modified,
+// only their submission order, so the result is only suitable for order-independent passes.
+//--------------------------------------------------------------------------------------
+inline float ForsythVertexScore(int CachePosition, UINT RemainingValence)
+{
+    const float CacheDecayPower = 1.5f;
+    const float LastTriScore = 0.75f;
+    const float ValenceBoostScale = 2.0f;
+    const float ValenceBoostPower = 0.5f;
+
+    // No triangle needs this vertex anymore
+    if (RemainingValence == 0)
+    {
+        return -1.f;
+    }
+
+    float Score = 0.f;
+    if (CachePosition >= 0)
+    {
+        if (CachePosition < 3)
+        {
+            // Used by the last triangle: fixed score to avoid favoring any of its edges
+            Score = LastTriScore;
+        }
+        else
+        {
+            const float Scaler = 1.f / (FORSYTH_CACHE_SIZE - 3);
+            Score = powf(1.f - (CachePosition - 3) * Scaler, CacheDecayPower);
+        }
+    }
+
+    // Bonus for vertices with few remaining triangles, to get rid of lone triangles early
+    Score += ValenceBoostScale * powf((float)RemainingValence, -ValenceBoostPower);
+    return Score;
+}
+
+inline void OptimizeVertexCacheForsyth(UINT *pIndices, UINT NumIndices, UINT NumVertices)
+{
+    const UINT NumTriangles = NumIndices / 3;
+    if (NumTriangles == 0) return;
+
+    // Vertex -> triangle adjacency, in CSR layout
+    std::vector<UINT> Valence(NumVertices, 0);
+    for (UINT i = 0; i < NumTriangles * 3; ++i)
+    {
+        ++Valence[pIndices[i]];
+    }
+    std::vector<UINT> AdjacencyOffset(NumVertices + 1, 0);
+    for (UINT VertexId = 0; VertexId < NumVertices; ++VertexId)
+    {
+        AdjacencyOffset[VertexId + 1] = AdjacencyOffset[VertexId] + Valence[VertexId];
+    }
+    std::vector<UINT> Adjacency(NumTriangles * 3);
+    {
+        std::vector<UINT> Fill(AdjacencyOffset.begin(), AdjacencyOffset.end() - 1);
+        for (UINT TriId = 0; TriId < NumTriangles; ++TriId)
+        {
+            for (UINT k = 0; k < 3; ++k)
+            {
+                UINT VertexId = pIndices[TriId * 3 + k];
+                Adjacency[Fill[VertexId]++] = TriId;
+            }
+        }
+    }
+
+    // Valence now holds the number of triangles still to be emitted per vertex
+    std::vector<int> CachePosition(NumVertices, -1);
+    std::vector<float> VertexScore(NumVertices);
+    for (UINT VertexId = 0; VertexId < NumVertices; ++VertexId)
+    {
+        VertexScore[VertexId] = ForsythVertexScore(-1, Valence[VertexId]);
+    }
+
+    std::vector<float> TriangleScore(NumTriangles);
+    std::vector<bool> TriangleEmitted(NumTriangles, false);
+    for (UINT TriId = 0; TriId < NumTriangles; ++TriId)
+    {
+        TriangleScore[TriId] = VertexScore[pIndices[TriId * 3 + 0]] +
+                               VertexScore[pIndices[TriId * 3 + 1]] +
+                               VertexScore[pIndices[TriId * 3 + 2]];
+    }
+
+    std::vector<UINT> Output;
+    Output.reserve(NumTriangles * 3);
+
+    UINT Cache[FORSYTH_CACHE_SIZE + 3];
+    UINT CacheSize = 0;
+    UINT NextCandidate = 0;     // Dead-end restart, in input order
+    int BestTriangle = -1;
+
+    for (UINT NumEmitted = 0; NumEmitted < NumTriangles; ++NumEmitted)
+    {
+        if (BestTriangle < 0)
+        {
+            // Nothing adjacent to the cache: restart from the next triangle left in input order
+            while (TriangleEmitted[NextCandidate]) ++NextCandidate;
+            BestTriangle = (int)NextCandidate;
+        }
+
+        const UINT *pTri = pIndices + BestTriangle * 3;
+        TriangleEmitted[BestTriangle] = true;
+        Output.push_back(pTri[0]);
+        Output.push_back(pTri[1]);
+        Output.push_back(pTri[2]);
+
+        // Remove the triangle from the adjacency of its vertices
+        for (UINT k = 0; k < 3; ++k)
+        {
+            UINT VertexId = pTri[k];
+            UINT *pBegin = Adjacency.data() + AdjacencyOffset[VertexId];
+            UINT *pEnd = pBegin + Valence[VertexId];
+            UINT *pFound = std::find(pBegin, pEnd, (UINT)BestTriangle);
+            assert(pFound != pEnd);
+            std::swap(*pFound, *(pEnd - 1));
+            --Valence[VertexId];
+        }
+
+        // Move the vertices of the triangle to the front of the LRU cache
+        UINT NewCache[FORSYTH_CACHE_SIZE + 3];
+        UINT NewCacheSize = 0;
+        for (UINT k = 0; k < 3; ++k)
+        {
+            NewCache[NewCacheSize++] = pTri[k];
+        }
+        for (UINT i = 0; i < CacheSize; ++i)
+        {
+            UINT VertexId = Cache[i];
+            if (VertexId != pTri[0] && VertexId != pTri[1] && VertexId != pTri[2])
+            {
+                NewCache[NewCacheSize++] = VertexId;
+            }
+        }
+
+        // Update the scores of the vertices in (or just evicted from) the cache,
+        // and of their remaining triangles, and pick the best one
+        float BestScore = -1.f;
+        BestTriangle = -1;
+        for (UINT i = 0; i < NewCacheSize; ++i)
+        {
+            UINT VertexId = NewCache[i];
+            CachePosition[VertexId] = (i < FORSYTH_CACHE_SIZE) ? (int)i : -1;
+            float NewScore = ForsythVertexScore(CachePosition[VertexId], Valence[VertexId]);
+            float Delta = NewScore - VertexScore[VertexId];
+            VertexScore[VertexId] = NewScore;
+
+            // A vertex with no triangles left may sit at the very end of the adjacency array
+            const UINT *pAdjacent = Adjacency.data() + AdjacencyOffset[VertexId];
+            for (UINT j = 0; j < Valence[VertexId]; ++j)
+            {
+                UINT TriId = pAdjacent[j];
+                TriangleScore[TriId] += Delta;
+                if (TriangleScore[TriId] > BestScore)
+                {
+                    BestScore = TriangleScore[TriId];
+                    BestTriangle = (int)TriId;
+                }
+            }
+        }
+
+        CacheSize = std::min(NewCacheSize, (UINT)FORSYTH_CACHE_SIZE);
+        std::copy(NewCache, NewCache + CacheSize, Cache);
+    }
+
+    std::copy(Output.begin(), Output.end(), pIndices);
+}
+
+//--------------------------------------------------------------------------------------
+// Vertex fetch optimization: renumbers the vertices in order of first use.
+// Remap[OldVertexId] = NewVertexId. Unreferenced vertices are moved to the end.
+//--------------------------------------------------------------------------------------
+inline void OptimizeVertexFetch(UINT *pIndices, UINT NumIndices, UINT NumVertices, std::vector<UINT> &Remap)
+{
+    const UINT Unassigned = ~0U;
+    Remap.assign(NumVertices, Unassigned);
+
+    UINT NextVertexId = 0;
+    for (UINT i = 0; i < NumIndices; ++i)
+    {
+        UINT &NewId = Remap[pIndices[i]];
+        if (NewId == Unassigned)
+        {
+            NewId = NextVertexId++;
+        }
+        pIndices[i] = NewId;
+    }
+    for (UINT VertexId = 0; VertexId < NumVertices; ++VertexId)
+    {
+        if (Remap[VertexId] == Unassigned)
+        {
+            Remap[VertexId] = NextVertexId++;
+        }
+    }
+}
@@ -0,0 +1,458 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+
+#include "CompactMesh.h"
+#include "BVH.h"
+#include "HiZ.h"
+#include "TransformState.h"
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+
+// Limits of a meshlet, in the range commonly used for mesh-shader clusters
+#define MAX_MESHLET_VERTICES 64
+#define MAX_MESHLET_TRIANGLES 124
+
+// Contiguous range of triangles of one subset, in the cache-optimized index buffer
+struct Meshlet
+{
+    UINT SubsetId;
+    UINT IndexStart;
+    UINT IndexCount;
+    DirectX::XMFLOAT4 BoundingSphere;   // Object-space center and radius, FLT_MAX radius for unbounded meshlets
+    BoundingBoxAABB Box;                // Object-space bounds
+    DirectX::XMFLOAT4 ConeAxisCutoff;   // Normal cone axis and sin of its half-angle, cutoff >= 1 disables cone culling
+};
+
+//--------------------------------------------------------------------------------------
+// Cluster culling: the triangle lists are cut into meshlets at load time, and once per
+// frame the meshlets outside of the view frustum are removed. The surviving indices are
+// compacted into a dynamic index buffer and the resulting draw list is shared by all the
+// geometry passes of the frame.
+//
+// The meshlet boxes are organized in a BVH, so that the frustum test is hierarchical and
+// also returns the view-space depth range of the visible geometry, used to fit the
+// near and far planes of the projection.
+//
+// Only the side planes of the frustum are tested: the rasterizer states of the techniques
+// disable depth clipping, so geometry outside of the near/far range is still visible.
+// Normal-cone culling is off by default since the transparent passes draw back faces.
+//
+// The meshlets behind the farthest depth of a Hi-Z pyramid are also removed, when a
+// pyramid rendered with the current transforms is given.
+//--------------------------------------------------------------------------------------
+class MeshletCuller
+{
+public:
+    MeshletCuller()
+        : m_pCompactedIB(NULL)
+        , m_NumVisibleMeshlets(0)
+        , m_NumOccludedMeshlets(0)
+        , m_CulledVersion(~0U)
+        , m_CulledHiZGeneration(0)
+        , m_MinDepth(0.f)
+        , m_MaxDepth(0.f)
+        , m_HasDepthRange(false)
+        , m_EnableConeCulling(false)
+    {
+    }
+
+    ~MeshletCuller()
+    {
+        Destroy();
+    }
+
+    HRESULT Create(ID3D11Device* pd3dDevice, const CompactMesh &Mesh)
+    {
+        HRESULT hr;
+
+        BuildMeshlets(Mesh);
+
+        // Until the first Cull call, the compacted index buffer holds the whole mesh
+        const std::vector<UINT> &Indices = Mesh.GetIndices();
+        m_CompactedIndices = Indices;
+        m_NumVisibleMeshlets = (UINT)m_Meshlets.size();
+        m_CulledVersion = ~0U;
+
+        const UINT IndexSize = (Mesh.GetIBFormat() == DXGI_FORMAT_R16_UINT) ? sizeof(USHORT) : sizeof(UINT);
+        std::vector<BYTE> Data(Indices.size() * IndexSize);
+        WriteIndices(&Data[0], Mesh.GetIBFormat());
+
+        D3D11_BUFFER_DESC ibDesc;
+        ibDesc.ByteWidth = (UINT)Data.size();
+        ibDesc.Usage = D3D11_USAGE_DYNAMIC;
+        ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+        ibDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        ibDesc.MiscFlags = 0;
+        ibDesc.StructureByteStride = 0;
+
+        D3D11_SUBRESOURCE_DATA ibData;
+        ibData.pSysMem = &Data[0];
+        ibData.SysMemPitch = 0;
+        ibData.SysMemSlicePitch = 0;
+
+        SAFE_RELEASE(m_pCompactedIB);
+        V_RETURN( pd3dDevice->CreateBuffer(&ibDesc, &ibData, &m_pCompactedIB) );
+
+        m_DrawList.pIB = m_pCompactedIB;
+        m_DrawList.IBFormat = Mesh.GetIBFormat();
+        m_DrawList.Draws = Mesh.GetSubsets();
+
+        // Unbounded meshlets are kept out of the BVH and never culled
+        std::vector<BoundingBoxAABB> Boxes;
+        m_BVHMeshlets.clear();
+        m_UnboundedMeshlets.clear();
+        for (UINT MeshletId = 0; MeshletId < (UINT)m_Meshlets.size(); ++MeshletId)
+        {
+            if (m_Meshlets[MeshletId].BoundingSphere.w == FLT_MAX)
+            {
+                m_UnboundedMeshlets.push_back(MeshletId);
+            }
+            else
+            {
+                m_BVHMeshlets.push_back(MeshletId);
+                Boxes.push_back(m_Meshlets[MeshletId].Box);
+            }
+        }
+        m_BVH.Build(Boxes);
+
+        return S_OK;
+    }
+
+    void Destroy()
+    {
+        SAFE_RELEASE(m_pCompactedIB);
+        m_Meshlets.clear();
+        m_CompactedIndices.clear();
+        m_BVH.Clear();
+        m_BVHMeshlets.clear();
+        m_UnboundedMeshlets.clear();
+        m_Visible.clear();
+        m_DrawList = MeshDrawList();
+        m_NumVisibleMeshlets = 0;
+        m_NumOccludedMeshlets = 0;
+        m_HasDepthRange = false;
+    }
+
+    // The side planes of the frustum do not depend on the near and far planes,
+    // so the depth range can be fitted after culling with any projection of the same field of view.
+    // pHiZ is optional, and must have been rendered with the current transforms; it does not
+    // change the depth range. Skipped if neither the transforms nor the pyramid changed.
+    void Cull(ID3D11DeviceContext* pd3dImmediateContext, const CompactMesh &Mesh, TransformState &Transforms,
+              const HiZPyramid *pHiZ = NULL)
+    {
+        if (!m_pCompactedIB) return;
+
+        UINT Version = Transforms.GetVersion(TRANSFORM_WORLD_VIEW_PROJ);
+        UINT HiZGeneration = pHiZ ? pHiZ->GetGeneration() : 0;
+        if (Version == m_CulledVersion && HiZGeneration == m_CulledHiZGeneration) return;
+        m_CulledVersion = Version;
+        m_CulledHiZGeneration = HiZGeneration;
+
+        DirectX::XMMATRIX WorldView = Transforms.Get(TRANSFORM_WORLD_VIEW);
+        DirectX::XMVECTOR Planes[4];
+        ExtractFrustumSidePlanes(Transforms.Get(TRANSFORM_WORLD_VIEW_PROJ), Planes);
+
+        // The eye is the origin of the view space, and the view depth is the third column of WorldView
+        DirectX::XMVECTOR ObjectSpaceEye = Transforms.Get(TRANSFORM_WORLD_VIEW_I).r[3];
+        DirectX::XMVECTOR ViewDepth = DirectX::XMMatrixTranspose(WorldView).r[2];
+
+        m_Visible.clear();
+        m_MinDepth = FLT_MAX;
+        m_MaxDepth = -FLT_MAX;
+        m_BVH.Cull(Planes, ViewDepth, m_Visible, m_MinDepth, m_MaxDepth);
+        m_HasDepthRange = (m_MinDepth <= m_MaxDepth);
+        for (size_t i = 0; i < m_Visible.size(); ++i)
+        {
+            m_Visible[i] = m_BVHMeshlets[m_Visible[i]];
+        }
+        if (!m_UnboundedMeshlets.empty())
+        {
+            m_Visible.insert(m_Visible.end(), m_UnboundedMeshlets.begin(), m_UnboundedMeshlets.end());
+            m_HasDepthRange = false;
+        }
+
+        // Back to the meshlet order, to keep the subsets and the cache-optimized order together
+        std::sort(m_Visible.begin(), m_Visible.end());
+
+        const std::vector<UINT> &Indices = Mesh.GetIndices();
+        const std::vector<SubsetDraw> &Subsets = Mesh.GetSubsets();
+
+        m_CompactedIndices.clear();
+        m_DrawList.Draws.clear();
+        m_NumVisibleMeshlets = 0;
+        m_NumOccludedMeshlets = 0;
+
+        DirectX::XMMATRIX WorldViewProj = Transforms.Get(TRANSFORM_WORLD_VIEW_PROJ);
+        for (size_t i = 0; i < m_Visible.size(); ++i)
+        {
+            const Meshlet &Cluster = m_Meshlets[m_Visible[i]];
+            if (m_EnableConeCulling && IsBackFacing(Cluster, ObjectSpaceEye)) continue;
+            if (pHiZ && pHiZ->IsBoxOccluded(Cluster.Box, WorldViewProj))
+            {
+                ++m_NumOccludedMeshlets;
+                continue;
+            }
+
+            ++m_NumVisibleMeshlets;
+
+            // Consecutive meshlets of the same subset are merged into one draw
+            if (m_DrawList.Draws.empty() || m_DrawList.Draws.back().SubsetId != Cluster.SubsetId)
+            {
+                SubsetDraw Draw = Subsets[Cluster.SubsetId];
+                Draw.IndexStart = (UINT)m_CompactedIndices.size();
+                Draw.IndexCount = 0;
+                m_DrawList.Draws.push_back(Draw);
+            }
+            m_DrawList.Draws.back().IndexCount += Cluster.IndexCount;
+            m_CompactedIndices.insert(m_CompactedIndices.end(),
+                                      Indices.begin() + Cluster.IndexStart,
+                                      Indices.begin() + Cluster.IndexStart + Cluster.IndexCount);
+        }
+
+        if (m_CompactedIndices.empty()) return;
+
+        D3D11_MAPPED_SUBRESOURCE MappedResource;
+        if (SUCCEEDED(pd3dImmediateContext->Map(m_pCompactedIB, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource)))
+        {
+            WriteIndices(MappedResource.pData, m_DrawList.IBFormat);
+            pd3dImmediateContext->Unmap(m_pCompactedIB, 0);
+        }
+    }
+
+    // Draw list of the last Cull call
+    const MeshDrawList& GetDrawList() const { return m_DrawList; }
+
+    UINT GetNumMeshlets() const { return (UINT)m_Meshlets.size(); }
+    UINT GetNumVisibleMeshlets() const { return m_NumVisibleMeshlets; }
+    UINT GetNumOccludedMeshlets() const { return m_NumOccludedMeshlets; }
+    UINT GetNumVisibleTriangles() const { return (UINT)m_CompactedIndices.size() / 3; }
+    const std::vector<Meshlet>& GetMeshlets() const { return m_Meshlets; }
+
+    // View-space depth range of the boxes of the meshlets that passed the frustum test.
+    // Returns false if nothing is visible or if the visible geometry is unbounded.
+    bool GetDepthRange(float &MinDepth, float &MaxDepth) const
+    {
+        MinDepth = m_MinDepth;
+        MaxDepth = m_MaxDepth;
+        return m_HasDepthRange;
+    }
+
+    void SetConeCulling(bool Enable)
+    {
+        if (Enable != m_EnableConeCulling) m_CulledVersion = ~0U;
+        m_EnableConeCulling = Enable;
+    }
+    bool GetConeCulling() const { return m_EnableConeCulling; }
+
+protected:
+    void WriteIndices(void *pDest, DXGI_FORMAT Format) const
+    {
+        if (Format == DXGI_FORMAT_R16_UINT)
+        {
+            for (size_t i = 0; i < m_CompactedIndices.size(); ++i)
+            {
+                ((USHORT*)pDest)[i] = (USHORT)m_CompactedIndices[i];
+            }
+        }
+        else if (!m_CompactedIndices.empty())
+        {
+            memcpy(pDest, &m_CompactedIndices[0], m_CompactedIndices.size() * sizeof(UINT));
+        }
+    }
+
+    // All the triangles face away from any point of the bounding sphere
+    bool IsBackFacing(const Meshlet &Cluster, DirectX::FXMVECTOR ObjectSpaceEye) const
+    {
+        DirectX::XMVECTOR Sphere = DirectX::XMLoadFloat4(&Cluster.BoundingSphere);
+        DirectX::XMVECTOR Center = DirectX::XMVectorSetW(Sphere, 1.f);
+        float Radius = DirectX::XMVectorGetW(Sphere);
+
+        if (Cluster.ConeAxisCutoff.w < 1.f)
+        {
+            DirectX::XMVECTOR View = DirectX::XMVectorSubtract(Center, DirectX::XMVectorSetW(ObjectSpaceEye, 1.f));
+            DirectX::XMVECTOR Axis = DirectX::XMLoadFloat4(&Cluster.ConeAxisCutoff);
+            float d = DirectX::XMVectorGetX(DirectX::XMVector3Dot(View, Axis));
+            float l = DirectX::XMVectorGetX(DirectX::XMVector3Length(View));
+            if (d >= Cluster.ConeAxisCutoff.w * l + Radius)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Greedy partition of each subset in the cache-optimized triangle order,
+    // which already groups neighboring triangles together
+    void BuildMeshlets(const CompactMesh &Mesh)
+    {
+        const std::vector<UINT> &Indices = Mesh.GetIndices();
+        const std::vector<SubsetDraw> &Subsets = Mesh.GetSubsets();
+
+        m_Meshlets.clear();
+
+        // Marker of the last meshlet that used each vertex
+        std::vector<UINT> LastMeshlet(Mesh.GetNumVertices(), ~0U);
+
+        for (UINT SubsetId = 0; SubsetId < (UINT)Subsets.size(); ++SubsetId)
+        {
+            const SubsetDraw &Subset = Subsets[SubsetId];
+            if (Subset.IndexCount == 0) continue;
+
+            if (Subset.Topology != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST)
+            {
+                // Never culled
+                Meshlet Cluster;
+                Cluster.SubsetId = SubsetId;
+                Cluster.IndexStart = Subset.IndexStart;
+                Cluster.IndexCount = Subset.IndexCount;
+                Cluster.BoundingSphere = DirectX::XMFLOAT4(0.f, 0.f, 0.f, FLT_MAX);
+                Cluster.Box.Min = DirectX::XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+                Cluster.Box.Max = DirectX::XMFLOAT3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+                Cluster.ConeAxisCutoff = DirectX::XMFLOAT4(0.f, 0.f, 1.f, 1.f);
+                m_Meshlets.push_back(Cluster);
+                continue;
+            }
+
+            UINT Start = Subset.IndexStart;
+            const UINT End = Subset.IndexStart + Subset.IndexCount;
+            while (Start < End)
+            {
+                const UINT MeshletId = (UINT)m_Meshlets.size();
+                UINT NumVertices = 0;
+                UINT Count = 0;
+                while (Start + Count + 3 <= End && Count / 3 < MAX_MESHLET_TRIANGLES)
+                {
+                    UINT NewVertices = 0;
+                    for (UINT k = 0; k < 3; ++k)
+                    {
+                        UINT VertexId = Subset.BaseVertex + Indices[Start + Count + k];
+                        if (LastMeshlet[VertexId] != MeshletId) ++NewVertices;
+                    }
+                    if (NumVertices + NewVertices > MAX_MESHLET_VERTICES) break;
+
+                    for (UINT k = 0; k < 3; ++k)
+                    {
+                        UINT VertexId = Subset.BaseVertex + Indices[Start + Count + k];
+                        if (LastMeshlet[VertexId] != MeshletId)
+                        {
+                            LastMeshlet[VertexId] = MeshletId;
+                            ++NumVertices;
+                        }
+                    }
+                    Count += 3;
+                }
+                if (Count == 0) break;
+
+                Meshlet Cluster;
+                Cluster.SubsetId = SubsetId;
+                Cluster.IndexStart = Start;
+                Cluster.IndexCount = Count;
+                ComputeBounds(Mesh, Subset.BaseVertex, &Indices[Start], Count, Cluster);
+                m_Meshlets.push_back(Cluster);
+
+                Start += Count;
+            }
+        }
+    }
+
+    static void ComputeBounds(const CompactMesh &Mesh, INT BaseVertex, const UINT *pIndices, UINT NumIndices, Meshlet &Cluster)
+    {
+        using namespace DirectX;
+
+        // Sphere centered on the bounding box
+        XMVECTOR BoxMin = XMVectorReplicate(FLT_MAX);
+        XMVECTOR BoxMax = XMVectorReplicate(-FLT_MAX);
+        for (UINT i = 0; i < NumIndices; ++i)
+        {
+            XMFLOAT3 P, N;
+            Mesh.DecodeVertex(BaseVertex + pIndices[i], P, N);
+            BoxMin = XMVectorMin(BoxMin, XMLoadFloat3(&P));
+            BoxMax = XMVectorMax(BoxMax, XMLoadFloat3(&P));
+        }
+        XMVECTOR Center = XMVectorScale(XMVectorAdd(BoxMin, BoxMax), 0.5f);
+        float Radius = 0.f;
+        for (UINT i = 0; i < NumIndices; ++i)
+        {
+            XMFLOAT3 P, N;
+            Mesh.DecodeVertex(BaseVertex + pIndices[i], P, N);
+            Radius = std::max(Radius, XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&P), Center))));
+        }
+        XMStoreFloat4(&Cluster.BoundingSphere, XMVectorSetW(Center, Radius));
+        XMStoreFloat3(&Cluster.Box.Min, BoxMin);
+        XMStoreFloat3(&Cluster.Box.Max, BoxMax);
+
+        // Normal cone of the face normals
+        std::vector<XMVECTOR> FaceNormals;
+        FaceNormals.reserve(NumIndices / 3);
+        XMVECTOR Axis = XMVectorZero();
+        for (UINT i = 0; i + 2 < NumIndices; i += 3)
+        {
+            XMFLOAT3 P0, P1, P2, N;
+            Mesh.DecodeVertex(BaseVertex + pIndices[i + 0], P0, N);
+            Mesh.DecodeVertex(BaseVertex + pIndices[i + 1], P1, N);
+            Mesh.DecodeVertex(BaseVertex + pIndices[i + 2], P2, N);
+            XMVECTOR V0 = XMLoadFloat3(&P0);
+            XMVECTOR Normal = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&P1), V0), XMVectorSubtract(XMLoadFloat3(&P2), V0));
+            if (XMVectorGetX(XMVector3LengthSq(Normal)) > 0.f)
+            {
+                Normal = XMVector3Normalize(Normal);
+                FaceNormals.push_back(Normal);
+                Axis = XMVectorAdd(Axis, Normal);
+            }
+        }
+
+        float Cutoff = 1.f;
+        if (!FaceNormals.empty() && XMVectorGetX(XMVector3LengthSq(Axis)) > 0.f)
+        {
+            Axis = XMVector3Normalize(Axis);
+            float MinDot = 1.f;
+            for (size_t i = 0; i < FaceNormals.size(); ++i)
+            {
+                MinDot = std::min(MinDot, XMVectorGetX(XMVector3Dot(Axis, FaceNormals[i])));
+            }
+            // Cones wider than ~85 degrees are almost never culled
+            if (MinDot > 0.1f)
+            {
+                Cutoff = sqrtf(1.f - MinDot * MinDot);
+            }
+        }
+        else
+        {
+            Axis = XMVectorSet(0.f, 0.f, 1.f, 0.f);
+        }
+        XMStoreFloat4(&Cluster.ConeAxisCutoff, XMVectorSetW(Axis, Cutoff));
+    }
+
+    std::vector<Meshlet> m_Meshlets;
+    std::vector<UINT> m_CompactedIndices;
+    ID3D11Buffer *m_pCompactedIB;
+    MeshDrawList m_DrawList;
+    UINT m_NumVisibleMeshlets;
+    UINT m_NumOccludedMeshlets;
+    UINT m_CulledVersion;
+    UINT m_CulledHiZGeneration;
+    BoundingVolumeHierarchy m_BVH;
+    std::vector<UINT> m_BVHMeshlets;        // BVH primitive -> meshlet
+    std::vector<UINT> m_UnboundedMeshlets;
+    std::vector<UINT> m_Visible;
+    float m_MinDepth;
+    float m_MaxDepth;
+    bool m_HasDepthRange;
+    bool m_EnableConeCulling;
+};
@@ -1,154 +1,151 @@
-// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
-//
-// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
-// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
-// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
-// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA 
-// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR  
-// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS 
-// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY 
-// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE, 
-// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
-//
-// Please direct any bugs or questions to SDKFeedback@nvidia.com
-
-#pragma once
-#include "SimpleRT.h"
-#include "BaseTechnique.h"
-#include "Scene.h"
-
-#include "PlainAlphaBlending_ShadingPS.h"
-#include "PlainAlphaBlending_FinalPS.h"
-
-#define NUM_MSAA_SAMPLES 8
-
-class PlainAlphaBlending : public BaseTechnique, public Scene
-{
-public:
-    PlainAlphaBlending(ID3D11Device* pd3dDevice, UINT Width, UINT Height)
-        : BaseTechnique(pd3dDevice)
-        , m_pShadingPS(NULL)
-        , m_pFinalPS(NULL)
-        , m_pColorRenderTarget(NULL)
-        , m_pColorRenderTarget1xAA(NULL)
-        , m_pDepthBuffer(NULL)
-    {
-        CreateRenderTargets(pd3dDevice, Width, Height);
-        CreateDepthBuffer(pd3dDevice, Width, Height);
-        CreateShaders(pd3dDevice);
-    }
-
-    virtual void Render(ID3D11DeviceContext* pd3dImmediateContext, ID3D11RenderTargetView *pBackBuffer)
-    {
-        // In a real application, the MSAA color and depth buffers would be initialized with opaque geometry
-        float ClearColorBack[4] = { m_BackgroundColor.x, m_BackgroundColor.y, m_BackgroundColor.z, 0 };
-        pd3dImmediateContext->ClearRenderTargetView( m_pColorRenderTarget->pRTV, ClearColorBack );
-        pd3dImmediateContext->ClearDepthStencilView( m_pDepthBuffer->pDSV, D3D11_CLEAR_DEPTH, 1.0, 0 );
-
-        // Update the constant buffer
-        pd3dImmediateContext->UpdateSubresource(m_pParamsCB, 0, NULL, &CBData, 0, 0);
-
-        // Set shared states
-        pd3dImmediateContext->IASetInputLayout(m_pInputLayout);
-        pd3dImmediateContext->VSSetShader(m_pGeometryVS, NULL, 0);
-        pd3dImmediateContext->GSSetShader(NULL, NULL, 0);
-        pd3dImmediateContext->RSSetState(m_pNoCullRS);
-        pd3dImmediateContext->VSSetConstantBuffers(0, 1, &m_pParamsCB);
-        pd3dImmediateContext->PSSetConstantBuffers(0, 1, &m_pParamsCB);
-        pd3dImmediateContext->PSSetConstantBuffers(1, 1, &m_pShadingParamsCB);
-
-        //----------------------------------------------------------------------------------
-        // Plain alpha blending with MSAA
-        //----------------------------------------------------------------------------------
-
-        pd3dImmediateContext->OMSetRenderTargets(1, &m_pColorRenderTarget->pRTV, m_pDepthBuffer->pDSV);
-        pd3dImmediateContext->OMSetBlendState(m_pBackToFrontBlendBS, m_BlendFactor, 0xffffffff);
-        pd3dImmediateContext->OMSetDepthStencilState(m_pDepthNoWriteDS, 0);
-        pd3dImmediateContext->PSSetShader(m_pShadingPS, NULL, 0);
-
-        DrawMesh(pd3dImmediateContext, m_Mesh);
-
-        //----------------------------------------------------------------------------------
-        // Resolve colors
-        //----------------------------------------------------------------------------------
-
-        pd3dImmediateContext->ResolveSubresource(m_pColorRenderTarget1xAA->pTexture, 0,
-                                                 m_pColorRenderTarget->pTexture, 0,
-                                                 DXGI_FORMAT_R16G16B16A16_FLOAT);
-
-        //----------------------------------------------------------------------------------
-        // Final full-screen pass, blending the transparent colors over the background
-        //----------------------------------------------------------------------------------
-
-        pd3dImmediateContext->OMSetRenderTargets(1, &pBackBuffer, NULL);
-        pd3dImmediateContext->OMSetDepthStencilState(m_pNoDepthNoStencilDS, 0);
-        pd3dImmediateContext->OMSetBlendState(m_pNoBlendBS, m_BlendFactor, 0xffffffff);
-
-        pd3dImmediateContext->VSSetShader(m_pFullScreenTriangleVS, NULL, 0);
-        pd3dImmediateContext->PSSetShader(m_pFinalPS, NULL, 0);
-        pd3dImmediateContext->PSSetShaderResources(0, 1, &m_pColorRenderTarget1xAA->pSRV);
-
-        pd3dImmediateContext->Draw(3, 0);
-    }
-
-    ~PlainAlphaBlending()
-    {
-        SAFE_RELEASE(m_pShadingPS);
-        SAFE_RELEASE(m_pFinalPS);
-        SAFE_DELETE(m_pColorRenderTarget);
-        SAFE_DELETE(m_pColorRenderTarget1xAA);
-        SAFE_DELETE(m_pDepthBuffer);
-    }
-
-protected:
-    void CreateShaders(ID3D11Device* pd3dDevice)
-    {
-        HRESULT hr;
-
-        V( pd3dDevice->CreatePixelShader(g_ShadingPS, sizeof(g_ShadingPS), NULL, &m_pShadingPS ) );
-
-        V( pd3dDevice->CreatePixelShader(g_FinalPS, sizeof(g_FinalPS), NULL, &m_pFinalPS ) );
-    }
-
-    void CreateRenderTargets(ID3D11Device* pd3dDevice, UINT Width, UINT Height)
-    {
-        D3D11_TEXTURE2D_DESC texDesc;
-        texDesc.Width = Width;
-        texDesc.Height = Height;
-        texDesc.ArraySize = 1;
-        texDesc.MiscFlags = 0;
-        texDesc.MipLevels = 1;
-        texDesc.SampleDesc.Count = NUM_MSAA_SAMPLES;
-        texDesc.SampleDesc.Quality = 0;
-        texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-        texDesc.Usage = D3D11_USAGE_DEFAULT;
-        texDesc.CPUAccessFlags = NULL;
-        m_pColorRenderTarget = new SimpleRT(pd3dDevice, &texDesc, DXGI_FORMAT_R16G16B16A16_FLOAT);
-
-        texDesc.SampleDesc.Count = 1;
-        m_pColorRenderTarget1xAA = new SimpleRT(pd3dDevice, &texDesc, DXGI_FORMAT_R16G16B16A16_FLOAT);
-    }
-
-    void CreateDepthBuffer(ID3D11Device* pd3dDevice, UINT Width, UINT Height)
-    {
-        D3D11_TEXTURE2D_DESC texDesc;
-        texDesc.ArraySize          = 1;
-        texDesc.BindFlags          = D3D11_BIND_DEPTH_STENCIL;
-        texDesc.CPUAccessFlags     = NULL;
-        texDesc.Format             = DXGI_FORMAT_D24_UNORM_S8_UINT;
-        texDesc.Width              = Width;
-        texDesc.Height             = Height;
-        texDesc.MipLevels          = 1;
-        texDesc.MiscFlags          = NULL;
-        texDesc.SampleDesc.Count   = NUM_MSAA_SAMPLES;
-        texDesc.SampleDesc.Quality = 0;
-        texDesc.Usage              = D3D11_USAGE_DEFAULT;
-        m_pDepthBuffer = new SimpleDepthStencil(pd3dDevice, &texDesc);
-    }
-
-    ID3D11PixelShader* m_pShadingPS;
-    ID3D11PixelShader* m_pFinalPS;
-    SimpleRT *m_pColorRenderTarget;
-    SimpleRT *m_pColorRenderTarget1xAA;
-    SimpleDepthStencil *m_pDepthBuffer;
-};
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA 
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR  
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS 
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY 
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE, 
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+#pragma once
+#include "SimpleRT.h"
+#include "BaseTechnique.h"
+
+#include "PlainAlphaBlending_ShadingPS.h"
+#include "PlainAlphaBlending_FinalPS.h"
+
+#define NUM_MSAA_SAMPLES 8
+
+class PlainAlphaBlending : public BaseTechnique
+{
+public:
+    PlainAlphaBlending(RHIDevice* pDevice, UINT Width, UINT Height, UINT ResolutionScale = 1)
+        : BaseTechnique(pDevice, Width, Height, ResolutionScale)
+        , m_pShadingPS(NULL)
+        , m_pFinalPS(NULL)
+        , m_pColorRenderTarget(NULL)
+        , m_pColorRenderTarget1xAA(NULL)
+        , m_pDepthBuffer(NULL)
+    {
+        CreateRenderTargets(pDevice, m_Width, m_Height);
+        CreateDepthBuffer(pDevice, m_Width, m_Height);
+        CreateShaders(pDevice);
+
+        // Back-to-front blending without sorting depends on the submission order
+        m_PreserveTriangleOrder = true;
+    }
+
+    virtual void RecordPasses(CommandList &Commands, RHIView *pBackBuffer)
+    {
+        float ClearColorBack[4] = { m_BackgroundColor.x, m_BackgroundColor.y, m_BackgroundColor.z, 0 };
+        Commands.ClearRenderTarget(m_pColorRenderTarget->pRTV, ClearColorBack);
+        Commands.ClearDepth(m_pDepthBuffer->pDSV, 1.0);
+
+        // Bind the constants uploaded for the frame
+        Commands.BindFrameConstants();
+
+        // Set shared states. The mesh draws bind the geometry vertex shader.
+        Commands.SetRasterizerState(m_pNoCullRS);
+
+        //----------------------------------------------------------------------------------
+        // Opaque geometry, initializing the MSAA color and depth buffers
+        //----------------------------------------------------------------------------------
+
+        if (m_OpaqueGeometry)
+        {
+            RecordOpaquePass(Commands, m_pColorRenderTarget->pRTV, m_pDepthBuffer->pDSV);
+        }
+
+        //----------------------------------------------------------------------------------
+        // Plain alpha blending with MSAA
+        //----------------------------------------------------------------------------------
+
+        Commands.SetRenderTargets(1, &m_pColorRenderTarget->pRTV, m_pDepthBuffer->pDSV);
+        Commands.SetBlendState(m_pBackToFrontBlendBS, m_BlendFactor, 0xffffffff);
+        Commands.SetDepthStencilState(m_pDepthNoWriteDS, 0);
+        Commands.SetPixelShader(m_pShadingPS);
+
+        Commands.DrawMesh();
+
+        //----------------------------------------------------------------------------------
+        // Resolve colors
+        //----------------------------------------------------------------------------------
+
+        Commands.Resolve(m_pColorRenderTarget1xAA->pTexture, m_pColorRenderTarget->pTexture);
+
+        //----------------------------------------------------------------------------------
+        // Final full-screen pass, blending the transparent colors over the background
+        //----------------------------------------------------------------------------------
+
+        RHIView *pFinalRTV = GetFinalTarget(pBackBuffer);
+        Commands.SetRenderTargets(1, &pFinalRTV, NULL);
+        Commands.SetDepthStencilState(m_pNoDepthNoStencilDS, 0);
+        Commands.SetBlendState(m_pNoBlendBS, m_BlendFactor, 0xffffffff);
+
+        Commands.SetVertexShader(m_pFullScreenTriangleVS);
+        Commands.SetPixelShader(m_pFinalPS);
+        Commands.SetPSResources(0, 1, &m_pColorRenderTarget1xAA->pSRV);
+
+        Commands.Draw(3, 0);
+
+        //----------------------------------------------------------------------------------
+        // Bilinear upsampling at a reduced resolution: the MSAA depth buffer is not readable
+        //----------------------------------------------------------------------------------
+
+        RecordUpsample(Commands, pBackBuffer, NULL);
+    }
+
+    ~PlainAlphaBlending()
+    {
+        SAFE_DELETE(m_pShadingPS);
+        SAFE_DELETE(m_pFinalPS);
+        SAFE_DELETE(m_pColorRenderTarget);
+        SAFE_DELETE(m_pColorRenderTarget1xAA);
+        SAFE_DELETE(m_pDepthBuffer);
+    }
+
+protected:
+    void CreateShaders(RHIDevice* pDevice)
+    {
+        m_pShadingPS = pDevice->CreatePixelShader(g_ShadingPS, sizeof(g_ShadingPS));
+
+        m_pFinalPS = pDevice->CreatePixelShader(g_FinalPS, sizeof(g_FinalPS));
+    }
+
+    void CreateRenderTargets(RHIDevice* pDevice, UINT Width, UINT Height)
+    {
+        RHITextureDesc texDesc;
+        texDesc.Width = Width;
+        texDesc.Height = Height;
+        texDesc.ArraySize = 1;
+        texDesc.SampleCount = NUM_MSAA_SAMPLES;
+        texDesc.BindFlags = RHI_BIND_RENDER_TARGET | RHI_BIND_SHADER_RESOURCE;
+        m_pColorRenderTarget = new SimpleRT(pDevice, &texDesc, RHI_FORMAT_R16G16B16A16_FLOAT);
+
+        texDesc.SampleCount = 1;
+        m_pColorRenderTarget1xAA = new SimpleRT(pDevice, &texDesc, RHI_FORMAT_R16G16B16A16_FLOAT);
+    }
+
+    void CreateDepthBuffer(RHIDevice* pDevice, UINT Width, UINT Height)
+    {
+        RHITextureDesc texDesc;
+        texDesc.ArraySize          = 1;
+        texDesc.BindFlags          = RHI_BIND_DEPTH_STENCIL;
+        texDesc.Format             = RHI_FORMAT_D24_UNORM_S8_UINT;
+        texDesc.Width              = Width;
+        texDesc.Height             = Height;
+        texDesc.SampleCount        = NUM_MSAA_SAMPLES;
+        m_pDepthBuffer = new SimpleDepthStencil(pDevice, &texDesc);
+    }
+
+    RHIShader* m_pShadingPS;
+    RHIShader* m_pFinalPS;
+    SimpleRT *m_pColorRenderTarget;
+    SimpleRT *m_pColorRenderTarget1xAA;
+    SimpleDepthStencil *m_pDepthBuffer;
+};
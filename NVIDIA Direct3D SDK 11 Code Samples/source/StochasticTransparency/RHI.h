@@ -0,0 +1,363 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+
+#include <stddef.h>
+
+//--------------------------------------------------------------------------------------
+// Thin render hardware interface used by the techniques.
+// Only the resources and states of the passes go through it: the scene geometry and its
+// constants are owned by the backend context, and drawn by the CMD_DRAW_MESH commands.
+// This header does not depend on d3d11.h; see RHI_D3D11.h and RHI_Software.h.
+//--------------------------------------------------------------------------------------
+
+#ifndef _WIN32
+typedef unsigned int UINT;
+typedef unsigned char UINT8;
+typedef unsigned char BYTE;
+#endif
+
+#ifndef SAFE_DELETE
+#define SAFE_DELETE(p) { if (p) { delete (p); (p) = NULL; } }
+#endif
+
+#define RHI_MAX_RENDER_TARGETS 8
+
+// Array slice value for the views covering all the slices of a texture
+#define RHI_ALL_SLICES (~0U)
+
+enum RHIFormat
+{
+    RHI_FORMAT_UNKNOWN,
+    RHI_FORMAT_R8G8B8A8_UNORM,
+    RHI_FORMAT_R16_FLOAT,
+    RHI_FORMAT_R16G16B16A16_FLOAT,
+    RHI_FORMAT_R32_FLOAT,
+    RHI_FORMAT_R32G32_FLOAT,
+    RHI_FORMAT_R32G32B32A32_FLOAT,
+    RHI_FORMAT_R32_UINT,
+    RHI_FORMAT_D16_UNORM,
+    RHI_FORMAT_D24_UNORM_S8_UINT,
+    RHI_FORMAT_D32_FLOAT,
+};
+
+enum RHIBindFlags
+{
+    RHI_BIND_SHADER_RESOURCE = 0x1,
+    RHI_BIND_RENDER_TARGET = 0x2,
+    RHI_BIND_DEPTH_STENCIL = 0x4,
+};
+
+// The values of the following enums match the D3D11 ones
+
+enum RHIBlend
+{
+    RHI_BLEND_ZERO = 1,
+    RHI_BLEND_ONE = 2,
+    RHI_BLEND_SRC_COLOR = 3,
+    RHI_BLEND_INV_SRC_COLOR = 4,
+    RHI_BLEND_SRC_ALPHA = 5,
+    RHI_BLEND_INV_SRC_ALPHA = 6,
+    RHI_BLEND_DEST_ALPHA = 7,
+    RHI_BLEND_INV_DEST_ALPHA = 8,
+    RHI_BLEND_DEST_COLOR = 9,
+    RHI_BLEND_INV_DEST_COLOR = 10,
+};
+
+enum RHIBlendOp
+{
+    RHI_BLEND_OP_ADD = 1,
+    RHI_BLEND_OP_SUBTRACT = 2,
+    RHI_BLEND_OP_REV_SUBTRACT = 3,
+    RHI_BLEND_OP_MIN = 4,
+    RHI_BLEND_OP_MAX = 5,
+};
+
+enum RHIComparison
+{
+    RHI_COMPARISON_NEVER = 1,
+    RHI_COMPARISON_LESS = 2,
+    RHI_COMPARISON_EQUAL = 3,
+    RHI_COMPARISON_LESS_EQUAL = 4,
+    RHI_COMPARISON_GREATER = 5,
+    RHI_COMPARISON_NOT_EQUAL = 6,
+    RHI_COMPARISON_GREATER_EQUAL = 7,
+    RHI_COMPARISON_ALWAYS = 8,
+};
+
+enum RHICullMode
+{
+    RHI_CULL_NONE = 1,
+    RHI_CULL_FRONT = 2,
+    RHI_CULL_BACK = 3,
+};
+
+#define RHI_COLOR_WRITE_ENABLE_ALL 0xF
+
+inline UINT GetFormatSize(RHIFormat Format)
+{
+    switch (Format)
+    {
+    case RHI_FORMAT_R16_FLOAT:
+    case RHI_FORMAT_D16_UNORM:
+        return 2;
+    case RHI_FORMAT_R8G8B8A8_UNORM:
+    case RHI_FORMAT_R32_FLOAT:
+    case RHI_FORMAT_R32_UINT:
+    case RHI_FORMAT_D24_UNORM_S8_UINT:
+    case RHI_FORMAT_D32_FLOAT:
+        return 4;
+    case RHI_FORMAT_R16G16B16A16_FLOAT:
+    case RHI_FORMAT_R32G32_FLOAT:
+        return 8;
+    case RHI_FORMAT_R32G32B32A32_FLOAT:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+inline bool IsDepthFormat(RHIFormat Format)
+{
+    return (Format == RHI_FORMAT_D16_UNORM || Format == RHI_FORMAT_D24_UNORM_S8_UINT || Format == RHI_FORMAT_D32_FLOAT);
+}
+
+//--------------------------------------------------------------------------------------
+// Descriptions. The constructors set the D3D11 defaults.
+//--------------------------------------------------------------------------------------
+
+struct RHITextureDesc
+{
+    UINT Width;
+    UINT Height;
+    UINT ArraySize;
+    UINT SampleCount;
+    RHIFormat Format;
+    UINT BindFlags;         // RHIBindFlags
+
+    RHITextureDesc()
+        : Width(0)
+        , Height(0)
+        , ArraySize(1)
+        , SampleCount(1)
+        , Format(RHI_FORMAT_UNKNOWN)
+        , BindFlags(RHI_BIND_RENDER_TARGET | RHI_BIND_SHADER_RESOURCE)
+    {
+    }
+};
+
+struct RHIRenderTargetBlendDesc
+{
+    bool BlendEnable;
+    RHIBlend SrcBlend;
+    RHIBlend DestBlend;
+    RHIBlendOp BlendOp;
+    RHIBlend SrcBlendAlpha;
+    RHIBlend DestBlendAlpha;
+    RHIBlendOp BlendOpAlpha;
+    UINT8 RenderTargetWriteMask;
+
+    RHIRenderTargetBlendDesc()
+        : BlendEnable(false)
+        , SrcBlend(RHI_BLEND_ONE)
+        , DestBlend(RHI_BLEND_ZERO)
+        , BlendOp(RHI_BLEND_OP_ADD)
+        , SrcBlendAlpha(RHI_BLEND_ONE)
+        , DestBlendAlpha(RHI_BLEND_ZERO)
+        , BlendOpAlpha(RHI_BLEND_OP_ADD)
+        , RenderTargetWriteMask(RHI_COLOR_WRITE_ENABLE_ALL)
+    {
+    }
+};
+
+struct RHIBlendDesc
+{
+    bool AlphaToCoverageEnable;
+    // If IndependentBlendEnable==false, only the RenderTarget[0] members are used.
+    bool IndependentBlendEnable;
+    RHIRenderTargetBlendDesc RenderTarget[RHI_MAX_RENDER_TARGETS];
+
+    RHIBlendDesc()
+        : AlphaToCoverageEnable(false)
+        , IndependentBlendEnable(false)
+    {
+    }
+};
+
+// The techniques do not use the stencil buffer, so it is always disabled
+struct RHIDepthStencilDesc
+{
+    bool DepthEnable;
+    bool DepthWriteEnable;
+    RHIComparison DepthFunc;
+
+    RHIDepthStencilDesc()
+        : DepthEnable(true)
+        , DepthWriteEnable(true)
+        , DepthFunc(RHI_COMPARISON_LESS)
+    {
+    }
+};
+
+struct RHIRasterizerDesc
+{
+    RHICullMode CullMode;
+    bool FrontCounterClockwise;
+    bool DepthClipEnable;
+
+    RHIRasterizerDesc()
+        : CullMode(RHI_CULL_BACK)
+        , FrontCounterClockwise(false)
+        , DepthClipEnable(true)
+    {
+    }
+};
+
+//--------------------------------------------------------------------------------------
+// Objects, created by an RHIDevice and released with delete (SAFE_DELETE).
+// The backends derive from these classes to attach their own objects.
+//--------------------------------------------------------------------------------------
+
+class RHIResource
+{
+public:
+    virtual ~RHIResource() {}
+};
+
+class RHITexture : public RHIResource
+{
+public:
+    RHITexture(const RHITextureDesc &Desc) : m_Desc(Desc) {}
+    const RHITextureDesc& GetDesc() const { return m_Desc; }
+
+protected:
+    RHITextureDesc m_Desc;
+};
+
+enum RHIViewType
+{
+    RHI_VIEW_RENDER_TARGET,
+    RHI_VIEW_SHADER_RESOURCE,
+    RHI_VIEW_DEPTH_STENCIL,
+};
+
+// Views do not own their texture, which must outlive them
+class RHIView : public RHIResource
+{
+public:
+    RHIView(RHIViewType Type, RHITexture *pTexture, UINT ArraySlice)
+        : m_Type(Type)
+        , m_pTexture(pTexture)
+        , m_ArraySlice(ArraySlice)
+    {
+    }
+    RHIViewType GetType() const { return m_Type; }
+    RHITexture* GetTexture() const { return m_pTexture; }
+    UINT GetArraySlice() const { return m_ArraySlice; }
+
+protected:
+    RHIViewType m_Type;
+    RHITexture *m_pTexture;
+    UINT m_ArraySlice;
+};
+
+class RHIBlendState : public RHIResource
+{
+public:
+    RHIBlendState(const RHIBlendDesc &Desc) : m_Desc(Desc) {}
+    const RHIBlendDesc& GetDesc() const { return m_Desc; }
+
+protected:
+    RHIBlendDesc m_Desc;
+};
+
+class RHIDepthStencilState : public RHIResource
+{
+public:
+    RHIDepthStencilState(const RHIDepthStencilDesc &Desc) : m_Desc(Desc) {}
+    const RHIDepthStencilDesc& GetDesc() const { return m_Desc; }
+
+protected:
+    RHIDepthStencilDesc m_Desc;
+};
+
+class RHIRasterizerState : public RHIResource
+{
+public:
+    RHIRasterizerState(const RHIRasterizerDesc &Desc) : m_Desc(Desc) {}
+    const RHIRasterizerDesc& GetDesc() const { return m_Desc; }
+
+protected:
+    RHIRasterizerDesc m_Desc;
+};
+
+enum RHIShaderStage
+{
+    RHI_SHADER_VERTEX,
+    RHI_SHADER_PIXEL,
+};
+
+class RHIShader : public RHIResource
+{
+public:
+    RHIShader(RHIShaderStage Stage) : m_Stage(Stage) {}
+    RHIShaderStage GetStage() const { return m_Stage; }
+
+protected:
+    RHIShaderStage m_Stage;
+};
+
+//--------------------------------------------------------------------------------------
+// Creates the resources and states. Returns NULL on failure.
+//--------------------------------------------------------------------------------------
+class RHIDevice
+{
+public:
+    virtual ~RHIDevice() {}
+
+    // pInitData is optional; the texture is immutable if it is only bound as a shader resource
+    virtual RHITexture* CreateTexture2D(const RHITextureDesc &Desc, const void *pInitData = NULL, UINT RowPitch = 0) = 0;
+
+    virtual RHIView* CreateRenderTargetView(RHITexture *pTexture, UINT ArraySlice = RHI_ALL_SLICES) = 0;
+    virtual RHIView* CreateShaderResourceView(RHITexture *pTexture) = 0;
+    virtual RHIView* CreateDepthStencilView(RHITexture *pTexture) = 0;
+
+    virtual RHIBlendState* CreateBlendState(const RHIBlendDesc &Desc) = 0;
+    virtual RHIDepthStencilState* CreateDepthStencilState(const RHIDepthStencilDesc &Desc) = 0;
+    virtual RHIRasterizerState* CreateRasterizerState(const RHIRasterizerDesc &Desc) = 0;
+
+    // Vertex shaders created here have no vertex input (full-screen passes)
+    virtual RHIShader* CreateVertexShader(const void *pBytecode, size_t BytecodeSize) = 0;
+    virtual RHIShader* CreatePixelShader(const void *pBytecode, size_t BytecodeSize) = 0;
+};
+
+class CommandList;
+
+//--------------------------------------------------------------------------------------
+// Executes the command lists of the techniques, with the scene geometry of the backend
+//--------------------------------------------------------------------------------------
+class RHIContext
+{
+public:
+    virtual ~RHIContext() {}
+
+    // Frame constants of the technique (constant buffer 0), and shading constants
+    // of every subset of the scene (constant buffer 1) with the given opacity
+    virtual void UploadConstants(const void *pData, UINT Size, float Alpha) = 0;
+
+    // Order-dependent techniques draw the scene in its authoring triangle order
+    virtual void Submit(const CommandList &Commands, bool PreserveTriangleOrder) = 0;
+};
@@ -0,0 +1,1300 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+#include "RHI.h"
+#include "CommandList.h"
+#include "CompactMesh.h"
+#include "Instances.h"
+#include "RandomColors.h"
+#include "ConstantAllocator.h"
+#include "JobSystem.h"
+
+#include "BaseTechnique_GeometryVS.h"
+#include "BaseTechnique_InstancedGeometryVS.h"
+
+// Submissions in flight before the pipeline statistics are read back
+#define STATS_QUERY_LATENCY 4
+
+//--------------------------------------------------------------------------------------
+// Formats
+//--------------------------------------------------------------------------------------
+
+inline DXGI_FORMAT GetDXGIFormat(RHIFormat Format)
+{
+    switch (Format)
+    {
+    case RHI_FORMAT_R8G8B8A8_UNORM:     return DXGI_FORMAT_R8G8B8A8_UNORM;
+    case RHI_FORMAT_R16_FLOAT:          return DXGI_FORMAT_R16_FLOAT;
+    case RHI_FORMAT_R16G16B16A16_FLOAT: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    case RHI_FORMAT_R32_FLOAT:          return DXGI_FORMAT_R32_FLOAT;
+    case RHI_FORMAT_R32G32_FLOAT:       return DXGI_FORMAT_R32G32_FLOAT;
+    case RHI_FORMAT_R32G32B32A32_FLOAT: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+    case RHI_FORMAT_R32_UINT:           return DXGI_FORMAT_R32_UINT;
+    case RHI_FORMAT_D16_UNORM:          return DXGI_FORMAT_D16_UNORM;
+    case RHI_FORMAT_D24_UNORM_S8_UINT:  return DXGI_FORMAT_D24_UNORM_S8_UINT;
+    case RHI_FORMAT_D32_FLOAT:          return DXGI_FORMAT_D32_FLOAT;
+    default:                            return DXGI_FORMAT_UNKNOWN;
+    }
+}
+
+// Depth textures that are also read by shaders are created typeless
+inline DXGI_FORMAT GetDXGITextureFormat(const RHITextureDesc &Desc)
+{
+    if ((Desc.BindFlags & RHI_BIND_DEPTH_STENCIL) && (Desc.BindFlags & RHI_BIND_SHADER_RESOURCE))
+    {
+        switch (Desc.Format)
+        {
+        case RHI_FORMAT_D16_UNORM:          return DXGI_FORMAT_R16_TYPELESS;
+        case RHI_FORMAT_D24_UNORM_S8_UINT:  return DXGI_FORMAT_R24G8_TYPELESS;
+        case RHI_FORMAT_D32_FLOAT:          return DXGI_FORMAT_R32_TYPELESS;
+        default:                            break;
+        }
+    }
+    return GetDXGIFormat(Desc.Format);
+}
+
+inline DXGI_FORMAT GetDXGIShaderResourceFormat(RHIFormat Format)
+{
+    switch (Format)
+    {
+    case RHI_FORMAT_D16_UNORM:          return DXGI_FORMAT_R16_UNORM;
+    case RHI_FORMAT_D24_UNORM_S8_UINT:  return DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+    case RHI_FORMAT_D32_FLOAT:          return DXGI_FORMAT_R32_FLOAT;
+    default:                            return GetDXGIFormat(Format);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Objects
+//--------------------------------------------------------------------------------------
+
+class D3D11Texture : public RHITexture
+{
+public:
+    D3D11Texture(const RHITextureDesc &Desc, ID3D11Texture2D *pTexture)
+        : RHITexture(Desc)
+        , m_pTexture(pTexture)
+    {
+    }
+    ~D3D11Texture()
+    {
+        SAFE_RELEASE(m_pTexture);
+    }
+    ID3D11Texture2D* GetTexture2D() const { return m_pTexture; }
+
+protected:
+    ID3D11Texture2D *m_pTexture;
+};
+
+// Holds one of the three view types, depending on GetType()
+class D3D11View : public RHIView
+{
+public:
+    D3D11View(RHIViewType Type, RHITexture *pTexture, UINT ArraySlice, ID3D11View *pView)
+        : RHIView(Type, pTexture, ArraySlice)
+        , m_pView(pView)
+    {
+    }
+    ~D3D11View()
+    {
+        SAFE_RELEASE(m_pView);
+    }
+
+    // The commands store NULL for unbound slots
+    static ID3D11RenderTargetView* GetRTV(void *pView)
+    {
+        return pView ? (ID3D11RenderTargetView*)((D3D11View*)pView)->m_pView : NULL;
+    }
+    static ID3D11ShaderResourceView* GetSRV(void *pView)
+    {
+        return pView ? (ID3D11ShaderResourceView*)((D3D11View*)pView)->m_pView : NULL;
+    }
+    static ID3D11DepthStencilView* GetDSV(void *pView)
+    {
+        return pView ? (ID3D11DepthStencilView*)((D3D11View*)pView)->m_pView : NULL;
+    }
+
+    // Viewport covering the texture of the view, which may be smaller than the back buffer.
+    // Queried from the resource, as the wrapped back buffer view has no RHITexture.
+    static void GetViewport(void *pView, D3D11_VIEWPORT &Viewport)
+    {
+        ID3D11Resource *pResource = NULL;
+        ((D3D11View*)pView)->m_pView->GetResource(&pResource);
+        D3D11_TEXTURE2D_DESC Desc;
+        static_cast<ID3D11Texture2D*>(pResource)->GetDesc(&Desc);
+        SAFE_RELEASE(pResource);
+
+        Viewport.TopLeftX = 0.f;
+        Viewport.TopLeftY = 0.f;
+        Viewport.Width = (float)Desc.Width;
+        Viewport.Height = (float)Desc.Height;
+        Viewport.MinDepth = 0.f;
+        Viewport.MaxDepth = 1.f;
+    }
+
+protected:
+    ID3D11View *m_pView;
+};
+
+class D3D11BlendState : public RHIBlendState
+{
+public:
+    D3D11BlendState(const RHIBlendDesc &Desc, ID3D11BlendState *pState) : RHIBlendState(Desc), m_pState(pState) {}
+    ~D3D11BlendState() { SAFE_RELEASE(m_pState); }
+    static ID3D11BlendState* Get(void *pState) { return pState ? ((D3D11BlendState*)pState)->m_pState : NULL; }
+
+protected:
+    ID3D11BlendState *m_pState;
+};
+
+class D3D11DepthStencilState : public RHIDepthStencilState
+{
+public:
+    D3D11DepthStencilState(const RHIDepthStencilDesc &Desc, ID3D11DepthStencilState *pState) : RHIDepthStencilState(Desc), m_pState(pState) {}
+    ~D3D11DepthStencilState() { SAFE_RELEASE(m_pState); }
+    static ID3D11DepthStencilState* Get(void *pState) { return pState ? ((D3D11DepthStencilState*)pState)->m_pState : NULL; }
+
+protected:
+    ID3D11DepthStencilState *m_pState;
+};
+
+class D3D11RasterizerState : public RHIRasterizerState
+{
+public:
+    D3D11RasterizerState(const RHIRasterizerDesc &Desc, ID3D11RasterizerState *pState) : RHIRasterizerState(Desc), m_pState(pState) {}
+    ~D3D11RasterizerState() { SAFE_RELEASE(m_pState); }
+    static ID3D11RasterizerState* Get(void *pState) { return pState ? ((D3D11RasterizerState*)pState)->m_pState : NULL; }
+
+protected:
+    ID3D11RasterizerState *m_pState;
+};
+
+class D3D11Shader : public RHIShader
+{
+public:
+    D3D11Shader(ID3D11VertexShader *pVS) : RHIShader(RHI_SHADER_VERTEX), m_pVS(pVS), m_pPS(NULL) {}
+    D3D11Shader(ID3D11PixelShader *pPS) : RHIShader(RHI_SHADER_PIXEL), m_pVS(NULL), m_pPS(pPS) {}
+    ~D3D11Shader()
+    {
+        SAFE_RELEASE(m_pVS);
+        SAFE_RELEASE(m_pPS);
+    }
+    static ID3D11VertexShader* GetVS(void *pShader) { return pShader ? ((D3D11Shader*)pShader)->m_pVS : NULL; }
+    static ID3D11PixelShader* GetPS(void *pShader) { return pShader ? ((D3D11Shader*)pShader)->m_pPS : NULL; }
+
+protected:
+    ID3D11VertexShader *m_pVS;
+    ID3D11PixelShader *m_pPS;
+};
+
+//--------------------------------------------------------------------------------------
+// Dynamic constant buffer sub-allocated with LinearConstantAllocator, bound with
+// VS/PSSetConstantBuffers1, on the immediate or on deferred contexts.
+// Requires the D3D 11.1 ConstantBufferOffsetting feature;
+// IsSupported() returns false otherwise and the caller keeps its UpdateSubresource path.
+//--------------------------------------------------------------------------------------
+class DynamicConstantBuffer
+{
+public:
+    DynamicConstantBuffer()
+        : m_pBuffer(NULL)
+    {
+    }
+
+    ~DynamicConstantBuffer()
+    {
+        Destroy();
+    }
+
+    HRESULT Create(ID3D11Device* pd3dDevice)
+    {
+        HRESULT hr;
+
+        Destroy();
+
+        D3D11_FEATURE_DATA_D3D11_OPTIONS Options;
+        ZeroMemory(&Options, sizeof(Options));
+        if (FAILED(pd3dDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &Options, sizeof(Options))) ||
+            !Options.ConstantBufferOffsetting || !Options.MapNoOverwriteOnDynamicConstantBuffer)
+        {
+            return S_FALSE;
+        }
+
+        // The ranges are bound through ID3D11DeviceContext1
+        ID3D11DeviceContext* pd3dImmediateContext = NULL;
+        ID3D11DeviceContext1* pd3dContext1 = NULL;
+        pd3dDevice->GetImmediateContext(&pd3dImmediateContext);
+        hr = pd3dImmediateContext->QueryInterface(IID_PPV_ARGS(&pd3dContext1));
+        SAFE_RELEASE(pd3dImmediateContext);
+        SAFE_RELEASE(pd3dContext1);
+        if (FAILED(hr)) return S_FALSE;
+
+        m_Allocator.Resize(CONSTANT_RING_SIZE);
+        return CreateBuffer(pd3dDevice);
+    }
+
+    // Grows the ring if an allocation of Size bytes does not fit in it. The previous buffer
+    // stays alive until the GPU is done with it, as the bound constant buffers hold a reference.
+    HRESULT Reserve(ID3D11Device* pd3dDevice, UINT Size)
+    {
+        if (!IsSupported() || Size <= m_Allocator.GetCapacity()) return S_OK;
+
+        Destroy();
+        m_Allocator.Resize(LinearConstantAllocator::GetCapacityFor(Size));
+        return CreateBuffer(pd3dDevice);
+    }
+
+    void Destroy()
+    {
+        SAFE_RELEASE(m_pBuffer);
+    }
+
+    bool IsSupported() const { return m_pBuffer != NULL; }
+
+    // Returns a CPU pointer to Size bytes, valid until Unmap. Several allocations can be
+    // written with a single Map by allocating them all at once and splitting the range.
+    BYTE* Map(ID3D11DeviceContext* pd3dImmediateContext, UINT Size, ConstantAllocation &Allocation)
+    {
+        if (!m_Allocator.Allocate(Size, Allocation)) return NULL;
+
+        D3D11_MAPPED_SUBRESOURCE MappedResource;
+        D3D11_MAP MapType = Allocation.Discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+        if (FAILED(pd3dImmediateContext->Map(m_pBuffer, 0, MapType, 0, &MappedResource))) return NULL;
+        return (BYTE*)MappedResource.pData + Allocation.Offset;
+    }
+
+    void Unmap(ID3D11DeviceContext* pd3dImmediateContext)
+    {
+        pd3dImmediateContext->Unmap(m_pBuffer, 0);
+    }
+
+    // Binds CONSTANT_ALIGNMENT-aligned windows of the buffer
+    void VSBind(ID3D11DeviceContext1* pd3dContext1, UINT Slot, UINT Offset, UINT Size)
+    {
+        UINT FirstConstant = Offset / 16;
+        UINT NumConstants = Size / 16;
+        pd3dContext1->VSSetConstantBuffers1(Slot, 1, &m_pBuffer, &FirstConstant, &NumConstants);
+    }
+
+    void PSBind(ID3D11DeviceContext1* pd3dContext1, UINT Slot, UINT Offset, UINT Size)
+    {
+        UINT FirstConstant = Offset / 16;
+        UINT NumConstants = Size / 16;
+        pd3dContext1->PSSetConstantBuffers1(Slot, 1, &m_pBuffer, &FirstConstant, &NumConstants);
+    }
+
+    const LinearConstantAllocator& GetAllocator() const { return m_Allocator; }
+
+protected:
+    HRESULT CreateBuffer(ID3D11Device* pd3dDevice)
+    {
+        HRESULT hr;
+
+        D3D11_BUFFER_DESC cbDesc;
+        cbDesc.ByteWidth = m_Allocator.GetCapacity();
+        cbDesc.Usage = D3D11_USAGE_DYNAMIC;
+        cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        cbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        cbDesc.MiscFlags = 0;
+        cbDesc.StructureByteStride = 0;
+        V_RETURN( pd3dDevice->CreateBuffer(&cbDesc, NULL, &m_pBuffer) );
+
+        m_Allocator.Reset();
+        return S_OK;
+    }
+
+    ID3D11Buffer *m_pBuffer;
+    LinearConstantAllocator m_Allocator;
+};
+
+//--------------------------------------------------------------------------------------
+// D3D11 device
+//--------------------------------------------------------------------------------------
+class D3D11Device : public RHIDevice
+{
+public:
+    D3D11Device(ID3D11Device* pd3dDevice)
+        : m_pd3dDevice(pd3dDevice)
+    {
+        m_pd3dDevice->AddRef();
+    }
+
+    ~D3D11Device()
+    {
+        SAFE_RELEASE(m_pd3dDevice);
+    }
+
+    virtual RHITexture* CreateTexture2D(const RHITextureDesc &Desc, const void *pInitData, UINT RowPitch)
+    {
+        HRESULT hr;
+
+        D3D11_TEXTURE2D_DESC texDesc;
+        texDesc.Width = Desc.Width;
+        texDesc.Height = Desc.Height;
+        texDesc.MipLevels = 1;
+        texDesc.ArraySize = Desc.ArraySize;
+        texDesc.Format = GetDXGITextureFormat(Desc);
+        texDesc.SampleDesc.Count = Desc.SampleCount;
+        texDesc.SampleDesc.Quality = 0;
+        texDesc.Usage = D3D11_USAGE_DEFAULT;
+        texDesc.BindFlags = 0;
+        texDesc.CPUAccessFlags = 0;
+        texDesc.MiscFlags = 0;
+        if (Desc.BindFlags & RHI_BIND_SHADER_RESOURCE) texDesc.BindFlags |= D3D11_BIND_SHADER_RESOURCE;
+        if (Desc.BindFlags & RHI_BIND_RENDER_TARGET) texDesc.BindFlags |= D3D11_BIND_RENDER_TARGET;
+        if (Desc.BindFlags & RHI_BIND_DEPTH_STENCIL) texDesc.BindFlags |= D3D11_BIND_DEPTH_STENCIL;
+
+        D3D11_SUBRESOURCE_DATA srDesc;
+        if (pInitData)
+        {
+            srDesc.pSysMem = pInitData;
+            srDesc.SysMemPitch = RowPitch ? RowPitch : Desc.Width * GetFormatSize(Desc.Format);
+            srDesc.SysMemSlicePitch = 0;
+            if (Desc.BindFlags == RHI_BIND_SHADER_RESOURCE)
+            {
+                texDesc.Usage = D3D11_USAGE_IMMUTABLE;
+            }
+        }
+
+        ID3D11Texture2D *pTexture = NULL;
+        V( m_pd3dDevice->CreateTexture2D(&texDesc, pInitData ? &srDesc : NULL, &pTexture) );
+        if (FAILED(hr)) return NULL;
+
+        return new D3D11Texture(Desc, pTexture);
+    }
+
+    virtual RHIView* CreateRenderTargetView(RHITexture *pTexture, UINT ArraySlice)
+    {
+        HRESULT hr;
+        const RHITextureDesc &Desc = pTexture->GetDesc();
+
+        D3D11_RENDER_TARGET_VIEW_DESC rtvDesc;
+        rtvDesc.Format = GetDXGIFormat(Desc.Format);
+        if (ArraySlice != RHI_ALL_SLICES)
+        {
+            rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+            rtvDesc.Texture2DArray.MipSlice = 0;
+            rtvDesc.Texture2DArray.FirstArraySlice = ArraySlice;
+            rtvDesc.Texture2DArray.ArraySize = 1;
+        }
+
+        ID3D11RenderTargetView *pRTV = NULL;
+        V( m_pd3dDevice->CreateRenderTargetView(GetTexture2D(pTexture), (ArraySlice != RHI_ALL_SLICES) ? &rtvDesc : NULL, &pRTV) );
+        if (FAILED(hr)) return NULL;
+
+        return new D3D11View(RHI_VIEW_RENDER_TARGET, pTexture, ArraySlice, pRTV);
+    }
+
+    virtual RHIView* CreateShaderResourceView(RHITexture *pTexture)
+    {
+        HRESULT hr;
+        const RHITextureDesc &Desc = pTexture->GetDesc();
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+        srvDesc.Format = GetDXGIShaderResourceFormat(Desc.Format);
+        if (Desc.SampleCount > 1 && Desc.ArraySize > 1)
+        {
+            srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DMSARRAY;
+            srvDesc.Texture2DMSArray.FirstArraySlice = 0;
+            srvDesc.Texture2DMSArray.ArraySize = Desc.ArraySize;
+        }
+        else if (Desc.SampleCount > 1)
+        {
+            srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DMS;
+        }
+        else if (Desc.ArraySize > 1)
+        {
+            srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+            srvDesc.Texture2DArray.MostDetailedMip = 0;
+            srvDesc.Texture2DArray.MipLevels = 1;
+            srvDesc.Texture2DArray.FirstArraySlice = 0;
+            srvDesc.Texture2DArray.ArraySize = Desc.ArraySize;
+        }
+        else
+        {
+            srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+            srvDesc.Texture2D.MostDetailedMip = 0;
+            srvDesc.Texture2D.MipLevels = 1;
+        }
+
+        ID3D11ShaderResourceView *pSRV = NULL;
+        V( m_pd3dDevice->CreateShaderResourceView(GetTexture2D(pTexture), &srvDesc, &pSRV) );
+        if (FAILED(hr)) return NULL;
+
+        return new D3D11View(RHI_VIEW_SHADER_RESOURCE, pTexture, RHI_ALL_SLICES, pSRV);
+    }
+
+    virtual RHIView* CreateDepthStencilView(RHITexture *pTexture)
+    {
+        HRESULT hr;
+        const RHITextureDesc &Desc = pTexture->GetDesc();
+
+        D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
+        dsvDesc.Format = GetDXGIFormat(Desc.Format);
+        dsvDesc.ViewDimension = (Desc.SampleCount > 1) ? D3D11_DSV_DIMENSION_TEXTURE2DMS : D3D11_DSV_DIMENSION_TEXTURE2D;
+        dsvDesc.Flags = 0U;
+        dsvDesc.Texture2D.MipSlice = 0;
+
+        ID3D11DepthStencilView *pDSV = NULL;
+        V( m_pd3dDevice->CreateDepthStencilView(GetTexture2D(pTexture), &dsvDesc, &pDSV) );
+        if (FAILED(hr)) return NULL;
+
+        return new D3D11View(RHI_VIEW_DEPTH_STENCIL, pTexture, RHI_ALL_SLICES, pDSV);
+    }
+
+    virtual RHIBlendState* CreateBlendState(const RHIBlendDesc &Desc)
+    {
+        HRESULT hr;
+
+        // The blend enums have the D3D11 values
+        D3D11_BLEND_DESC blendState;
+        blendState.AlphaToCoverageEnable = Desc.AlphaToCoverageEnable;
+        blendState.IndependentBlendEnable = Desc.IndependentBlendEnable;
+        for (int i = 0; i < RHI_MAX_RENDER_TARGETS; ++i)
+        {
+            const RHIRenderTargetBlendDesc &Src = Desc.RenderTarget[i];
+            D3D11_RENDER_TARGET_BLEND_DESC &Dst = blendState.RenderTarget[i];
+            Dst.BlendEnable = Src.BlendEnable;
+            Dst.SrcBlend = (D3D11_BLEND)Src.SrcBlend;
+            Dst.DestBlend = (D3D11_BLEND)Src.DestBlend;
+            Dst.BlendOp = (D3D11_BLEND_OP)Src.BlendOp;
+            Dst.SrcBlendAlpha = (D3D11_BLEND)Src.SrcBlendAlpha;
+            Dst.DestBlendAlpha = (D3D11_BLEND)Src.DestBlendAlpha;
+            Dst.BlendOpAlpha = (D3D11_BLEND_OP)Src.BlendOpAlpha;
+            Dst.RenderTargetWriteMask = Src.RenderTargetWriteMask;
+        }
+
+        ID3D11BlendState *pState = NULL;
+        V( m_pd3dDevice->CreateBlendState(&blendState, &pState) );
+        if (FAILED(hr)) return NULL;
+
+        return new D3D11BlendState(Desc, pState);
+    }
+
+    virtual RHIDepthStencilState* CreateDepthStencilState(const RHIDepthStencilDesc &Desc)
+    {
+        HRESULT hr;
+
+        D3D11_DEPTH_STENCIL_DESC depthstencilState;
+        memset(&depthstencilState, 0, sizeof(depthstencilState));
+        depthstencilState.DepthEnable = Desc.DepthEnable;
+        depthstencilState.DepthWriteMask = Desc.DepthWriteEnable ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO;
+        depthstencilState.DepthFunc = (D3D11_COMPARISON_FUNC)Desc.DepthFunc;
+        depthstencilState.StencilEnable = FALSE;
+
+        ID3D11DepthStencilState *pState = NULL;
+        V( m_pd3dDevice->CreateDepthStencilState(&depthstencilState, &pState) );
+        if (FAILED(hr)) return NULL;
+
+        return new D3D11DepthStencilState(Desc, pState);
+    }
+
+    virtual RHIRasterizerState* CreateRasterizerState(const RHIRasterizerDesc &Desc)
+    {
+        HRESULT hr;
+
+        D3D11_RASTERIZER_DESC rasterizerState;
+        rasterizerState.FillMode = D3D11_FILL_SOLID;
+        rasterizerState.CullMode = (D3D11_CULL_MODE)Desc.CullMode;
+        rasterizerState.FrontCounterClockwise = Desc.FrontCounterClockwise;
+        rasterizerState.DepthBias = FALSE;
+        rasterizerState.DepthBiasClamp = 0;
+        rasterizerState.SlopeScaledDepthBias = 0;
+        rasterizerState.DepthClipEnable = Desc.DepthClipEnable;
+        rasterizerState.ScissorEnable = FALSE;
+        rasterizerState.MultisampleEnable = FALSE;
+        rasterizerState.AntialiasedLineEnable = FALSE;
+
+        ID3D11RasterizerState *pState = NULL;
+        V( m_pd3dDevice->CreateRasterizerState(&rasterizerState, &pState) );
+        if (FAILED(hr)) return NULL;
+
+        return new D3D11RasterizerState(Desc, pState);
+    }
+
+    virtual RHIShader* CreateVertexShader(const void *pBytecode, size_t BytecodeSize)
+    {
+        HRESULT hr;
+
+        ID3D11VertexShader *pShader = NULL;
+        V( m_pd3dDevice->CreateVertexShader(pBytecode, BytecodeSize, NULL, &pShader) );
+        if (FAILED(hr)) return NULL;
+
+        return new D3D11Shader(pShader);
+    }
+
+    virtual RHIShader* CreatePixelShader(const void *pBytecode, size_t BytecodeSize)
+    {
+        HRESULT hr;
+
+        ID3D11PixelShader *pShader = NULL;
+        V( m_pd3dDevice->CreatePixelShader(pBytecode, BytecodeSize, NULL, &pShader) );
+        if (FAILED(hr)) return NULL;
+
+        return new D3D11Shader(pShader);
+    }
+
+    // Wraps a view created outside of the RHI, such as the back buffer of the swap chain
+    RHIView* WrapRenderTargetView(ID3D11RenderTargetView *pRTV)
+    {
+        pRTV->AddRef();
+        return new D3D11View(RHI_VIEW_RENDER_TARGET, NULL, RHI_ALL_SLICES, pRTV);
+    }
+
+    static ID3D11Texture2D* GetTexture2D(RHITexture *pTexture)
+    {
+        return pTexture ? ((D3D11Texture*)pTexture)->GetTexture2D() : NULL;
+    }
+
+protected:
+    ID3D11Device *m_pd3dDevice;
+};
+
+//--------------------------------------------------------------------------------------
+// D3D11 context: executes the command lists on the immediate context, or in parallel
+// on deferred contexts, and draws the scene geometry for the CMD_DRAW_MESH commands
+//--------------------------------------------------------------------------------------
+// Pipeline statistics of a submitted command list
+struct D3D11SubmitStats
+{
+    UINT64 PSInvocations;
+    float GPUTime;              // Milliseconds between the timestamps around the submission, 0 if disjoint
+    UINT NumDraws;              // Of the command list
+    UINT NumMeshDraws;
+    UINT NumOpaqueMeshDraws;    // Included in NumMeshDraws
+
+    D3D11SubmitStats()
+        : PSInvocations(0)
+        , GPUTime(0.f)
+        , NumDraws(0)
+        , NumMeshDraws(0)
+        , NumOpaqueMeshDraws(0)
+    {
+    }
+};
+
+class D3D11Context : public RHIContext
+{
+public:
+    D3D11Context(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext)
+        : m_pd3dDevice(pd3dDevice)
+        , m_pd3dImmediateContext(pd3dImmediateContext)
+        , m_pGeometryVS(NULL)
+        , m_pInstancedGeometryVS(NULL)
+        , m_pInputLayout(NULL)
+        , m_pParamsCB(NULL)
+        , m_pShadingParamsCB(NULL)
+        , m_ParamsCBSize(0)
+        , m_UseDynamicCB(false)
+        , m_ParamsOffset(0)
+        , m_ShadingParamsOffset(0)
+        , m_ParamsSize(0)
+        , m_NumConstantFallbacks(0)
+        , m_Alpha(1.f)
+        , m_pMesh(NULL)
+        , m_pInstances(NULL)
+        , m_pDrawList(NULL)
+        , m_pOrderedDrawList(NULL)
+        , m_pOpaqueDrawList(NULL)
+        , m_pJobSystem(NULL)
+        , m_ParallelSubmission(false)
+        , m_NumSubmittedSegments(0)
+        , m_NumSubmits(0)
+        , m_NumReadSubmits(0)
+        , m_HasSubmitStats(false)
+        , m_SubmitStats(true)
+    {
+        m_pd3dDevice->AddRef();
+        m_pd3dImmediateContext->AddRef();
+        CreateVertexShaders();
+        CreateConstantBuffers();
+        CreateQueries();
+    }
+
+    ~D3D11Context()
+    {
+        ReleaseDeferredContexts();
+        SAFE_RELEASE(m_pGeometryVS);
+        SAFE_RELEASE(m_pInstancedGeometryVS);
+        SAFE_RELEASE(m_pInputLayout);
+        SAFE_RELEASE(m_pParamsCB);
+        SAFE_RELEASE(m_pShadingParamsCB);
+        for (UINT i = 0; i < STATS_QUERY_LATENCY; ++i)
+        {
+            SAFE_RELEASE(m_pStatsQueries[i]);
+            SAFE_RELEASE(m_pDisjointQueries[i]);
+            SAFE_RELEASE(m_pTimestampQueries[i][0]);
+            SAFE_RELEASE(m_pTimestampQueries[i][1]);
+        }
+        SAFE_RELEASE(m_pd3dImmediateContext);
+        SAFE_RELEASE(m_pd3dDevice);
+    }
+
+    // Geometry drawn by CMD_DRAW_MESH, set every frame after culling.
+    // OrderedDrawList is used by the techniques that preserve the triangle order,
+    // OpaqueDrawList by the mesh draws of MESH_DRAW_LIST_OPAQUE.
+    void SetGeometry(const CompactMesh &Mesh, const InstanceBuffer &Instances,
+                     const MeshDrawList &DrawList, const MeshDrawList &OrderedDrawList, const MeshDrawList &OpaqueDrawList)
+    {
+        m_pMesh = &Mesh;
+        m_pInstances = &Instances;
+        m_pDrawList = &DrawList;
+        m_pOrderedDrawList = &OrderedDrawList;
+        m_pOpaqueDrawList = &OpaqueDrawList;
+    }
+
+    // Writes the frame constants and the shading constants of every subset with a single map,
+    // growing the ring for meshes with many subsets. Without D3D 11.1 constant buffer offsetting,
+    // or if the ring cannot be mapped, falls back to UpdateSubresource (see GetNumConstantFallbacks).
+    virtual void UploadConstants(const void *pData, UINT Size, float Alpha)
+    {
+        HRESULT hr;
+
+        assert(m_pMesh);
+
+        const UINT NumSubsets = (UINT)m_pMesh->GetSubsets().size();
+        const UINT ParamsSize = (Size + CONSTANT_ALIGNMENT - 1) & ~(CONSTANT_ALIGNMENT - 1);
+        const UINT UploadSize = ParamsSize + NumSubsets * CONSTANT_ALIGNMENT;
+
+        m_Alpha = Alpha;
+
+        BYTE *pMapped = NULL;
+        ConstantAllocation Allocation;
+        if (m_DynamicCB.IsSupported())
+        {
+            V( m_DynamicCB.Reserve(m_pd3dDevice, UploadSize) );
+        }
+        if (m_DynamicCB.IsSupported())
+        {
+            pMapped = m_DynamicCB.Map(m_pd3dImmediateContext, UploadSize, Allocation);
+        }
+
+        m_UseDynamicCB = (pMapped != NULL);
+        if (!m_UseDynamicCB)
+        {
+            ++m_NumConstantFallbacks;
+            if (Size != m_ParamsCBSize)
+            {
+                CreateParamsCB(Size);
+            }
+            m_pd3dImmediateContext->UpdateSubresource(m_pParamsCB, 0, NULL, pData, 0, 0);
+            return;
+        }
+
+        memcpy(pMapped, pData, Size);
+        for (UINT SubsetId = 0; SubsetId < NumSubsets; ++SubsetId)
+        {
+            DirectX::XMFLOAT3 Color;
+            ComputeRandomColor(SubsetId, Color);
+
+            float data[4] = { Color.x, Color.y, Color.z, m_Alpha };
+            memcpy(pMapped + ParamsSize + SubsetId * CONSTANT_ALIGNMENT, data, sizeof(data));
+        }
+        m_DynamicCB.Unmap(m_pd3dImmediateContext);
+
+        m_ParamsOffset = Allocation.Offset;
+        m_ParamsSize = ParamsSize;
+        m_ShadingParamsOffset = Allocation.Offset + ParamsSize;
+    }
+
+    virtual void Submit(const CommandList &Commands, bool PreserveTriangleOrder)
+    {
+        assert(m_pDrawList && m_pOrderedDrawList && m_pOpaqueDrawList);
+        const MeshDrawList *pDrawLists[NUM_MESH_DRAW_LISTS];
+        pDrawLists[MESH_DRAW_LIST_TRANSPARENT] = PreserveTriangleOrder ? m_pOrderedDrawList : m_pDrawList;
+        pDrawLists[MESH_DRAW_LIST_OPAQUE] = m_pOpaqueDrawList;
+
+        // Drop the oldest statistics if the GPU is more than STATS_QUERY_LATENCY submissions behind
+        const UINT Slot = m_NumSubmits % STATS_QUERY_LATENCY;
+        if (m_SubmitStats && m_NumSubmits - m_NumReadSubmits == STATS_QUERY_LATENCY)
+        {
+            ++m_NumReadSubmits;
+        }
+        ID3D11Query *pQuery = m_SubmitStats ? m_pStatsQueries[Slot] : NULL;
+        if (pQuery) m_pd3dImmediateContext->Begin(pQuery);
+        ID3D11Query *pDisjointQuery = m_SubmitStats ? m_pDisjointQueries[Slot] : NULL;
+        if (pDisjointQuery)
+        {
+            m_pd3dImmediateContext->Begin(pDisjointQuery);
+            m_pd3dImmediateContext->End(m_pTimestampQueries[Slot][0]);
+        }
+
+        if (m_ParallelSubmission && m_pJobSystem)
+        {
+            SubmitParallel(Commands, pDrawLists);
+        }
+        else
+        {
+            ContextSink Sink(this, m_pd3dImmediateContext, pDrawLists, true);
+            Commands.Replay(Sink);
+        }
+
+        if (pDisjointQuery)
+        {
+            m_pd3dImmediateContext->End(m_pTimestampQueries[Slot][1]);
+            m_pd3dImmediateContext->End(pDisjointQuery);
+        }
+        if (pQuery) m_pd3dImmediateContext->End(pQuery);
+        if (!m_SubmitStats) return;
+
+        m_PendingStats[Slot].NumDraws = Commands.GetNumDraws();
+        m_PendingStats[Slot].NumMeshDraws = Commands.GetNumMeshDraws();
+        m_PendingStats[Slot].NumOpaqueMeshDraws = Commands.GetNumMeshDraws(MESH_DRAW_LIST_OPAQUE);
+        ++m_NumSubmits;
+
+        ReadSubmitStats();
+    }
+
+    // Statistics of the last submission read back, a few frames old; false until the first one
+    bool GetLastSubmitStats(D3D11SubmitStats &Stats) const
+    {
+        Stats = m_LastSubmitStats;
+        return m_HasSubmitStats;
+    }
+
+    // The submissions made while disabled, such as the measurement passes of the sample,
+    // are left out of the statistics of the technique's submissions
+    void SetSubmitStats(bool Enable)
+    {
+        m_SubmitStats = Enable;
+    }
+
+    // The job system is owned by the caller. Creates one deferred context per worker.
+    void CreateDeferredContexts(JobSystem *pJobSystem)
+    {
+        HRESULT hr;
+
+        ReleaseDeferredContexts();
+
+        m_DeferredContexts.resize(pJobSystem->GetNumWorkers(), NULL);
+        for (size_t WorkerId = 0; WorkerId < m_DeferredContexts.size(); ++WorkerId)
+        {
+            V( m_pd3dDevice->CreateDeferredContext(0, &m_DeferredContexts[WorkerId]) );
+            if (FAILED(hr))
+            {
+                ReleaseDeferredContexts();
+                return;
+            }
+        }
+        m_pJobSystem = pJobSystem;
+    }
+
+    void ReleaseDeferredContexts()
+    {
+        for (size_t WorkerId = 0; WorkerId < m_DeferredContexts.size(); ++WorkerId)
+        {
+            SAFE_RELEASE(m_DeferredContexts[WorkerId]);
+        }
+        m_DeferredContexts.clear();
+        m_pJobSystem = NULL;
+    }
+
+    void SetParallelSubmission(bool Enable)
+    {
+        m_ParallelSubmission = Enable;
+    }
+
+    bool GetParallelSubmission() const
+    {
+        return m_ParallelSubmission && (m_pJobSystem != NULL);
+    }
+
+    UINT GetNumSubmittedSegments() const
+    {
+        return m_NumSubmittedSegments;
+    }
+
+    // Uploads made with UpdateSubresource, one constant buffer update per subset draw
+    UINT GetNumConstantFallbacks() const
+    {
+        return m_NumConstantFallbacks;
+    }
+
+    // 0 without D3D 11.1 constant buffer offsetting
+    UINT GetConstantRingCapacity() const
+    {
+        return m_DynamicCB.IsSupported() ? m_DynamicCB.GetAllocator().GetCapacity() : 0;
+    }
+
+protected:
+    // Reads the statistics of the completed submissions, without waiting for the GPU
+    void ReadSubmitStats()
+    {
+        while (m_NumReadSubmits != m_NumSubmits)
+        {
+            const UINT Slot = m_NumReadSubmits % STATS_QUERY_LATENCY;
+            if (!m_pStatsQueries[Slot]) break;
+
+            D3D11_QUERY_DATA_PIPELINE_STATISTICS Data;
+            if (m_pd3dImmediateContext->GetData(m_pStatsQueries[Slot], &Data, sizeof(Data), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+            {
+                break;
+            }
+
+            // The timestamps end before the statistics, but are only valid if the clock was steady
+            float GPUTime = 0.f;
+            if (m_pDisjointQueries[Slot])
+            {
+                D3D11_QUERY_DATA_TIMESTAMP_DISJOINT Disjoint;
+                UINT64 Timestamps[2];
+                if (m_pd3dImmediateContext->GetData(m_pDisjointQueries[Slot], &Disjoint, sizeof(Disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+                    m_pd3dImmediateContext->GetData(m_pTimestampQueries[Slot][0], &Timestamps[0], sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+                    m_pd3dImmediateContext->GetData(m_pTimestampQueries[Slot][1], &Timestamps[1], sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+                {
+                    break;
+                }
+                if (!Disjoint.Disjoint && Disjoint.Frequency)
+                {
+                    GPUTime = (float)((double)(Timestamps[1] - Timestamps[0]) * 1e3 / (double)Disjoint.Frequency);
+                }
+            }
+
+            m_LastSubmitStats = m_PendingStats[Slot];
+            m_LastSubmitStats.PSInvocations = Data.PSInvocations;
+            m_LastSubmitStats.GPUTime = GPUTime;
+            m_HasSubmitStats = true;
+            ++m_NumReadSubmits;
+        }
+    }
+
+    void CreateQueries()
+    {
+        HRESULT hr;
+
+        D3D11_QUERY_DESC QueryDesc;
+        QueryDesc.Query = D3D11_QUERY_PIPELINE_STATISTICS;
+        QueryDesc.MiscFlags = 0;
+        for (UINT i = 0; i < STATS_QUERY_LATENCY; ++i)
+        {
+            m_pStatsQueries[i] = NULL;
+            V( m_pd3dDevice->CreateQuery(&QueryDesc, &m_pStatsQueries[i]) );
+        }
+
+        // The GPU time of a submission is measured only if all its queries exist
+        for (UINT i = 0; i < STATS_QUERY_LATENCY; ++i)
+        {
+            m_pDisjointQueries[i] = NULL;
+            m_pTimestampQueries[i][0] = NULL;
+            m_pTimestampQueries[i][1] = NULL;
+
+            QueryDesc.Query = D3D11_QUERY_TIMESTAMP;
+            V( m_pd3dDevice->CreateQuery(&QueryDesc, &m_pTimestampQueries[i][0]) );
+            V( m_pd3dDevice->CreateQuery(&QueryDesc, &m_pTimestampQueries[i][1]) );
+            if (m_pTimestampQueries[i][0] && m_pTimestampQueries[i][1])
+            {
+                QueryDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+                V( m_pd3dDevice->CreateQuery(&QueryDesc, &m_pDisjointQueries[i]) );
+            }
+        }
+    }
+
+    // Binds the constants written by the last UploadConstants
+    void BindConstants(ID3D11DeviceContext* pd3dContext, ID3D11DeviceContext1* pd3dContext1)
+    {
+        if (m_UseDynamicCB)
+        {
+            m_DynamicCB.VSBind(pd3dContext1, 0, m_ParamsOffset, m_ParamsSize);
+            m_DynamicCB.PSBind(pd3dContext1, 0, m_ParamsOffset, m_ParamsSize);
+        }
+        else
+        {
+            pd3dContext->VSSetConstantBuffers(0, 1, &m_pParamsCB);
+            pd3dContext->PSSetConstantBuffers(0, 1, &m_pParamsCB);
+            pd3dContext->PSSetConstantBuffers(1, 1, &m_pShadingParamsCB);
+        }
+    }
+
+    // Issues the draws [FirstDraw,EndDraw) of DrawList.
+    // With more than one instance, the transforms come from the instance buffer
+    // instead of the frame constants, and each draw renders all the visible instances
+    void DrawMesh(ID3D11DeviceContext* pd3dContext, ID3D11DeviceContext1* pd3dContext1, const MeshDrawList &DrawList,
+                  size_t FirstDraw, size_t EndDraw)
+    {
+        if (FirstDraw >= EndDraw) return;
+
+        const CompactMesh &Vertices = *m_pMesh;
+        const InstanceBuffer &Instances = *m_pInstances;
+
+        const bool IsInstanced = (Instances.GetNumInstances() > 1);
+        const UINT NumInstances = Instances.GetNumVisibleInstances();
+        if (IsInstanced)
+        {
+            if (NumInstances == 0) return;
+
+            ID3D11ShaderResourceView *pSRV = Instances.GetSRV();
+            pd3dContext->VSSetShader(m_pInstancedGeometryVS, NULL, 0);
+            pd3dContext->VSSetShaderResources(0, 1, &pSRV);
+        }
+        else
+        {
+            pd3dContext->VSSetShader(m_pGeometryVS, NULL, 0);
+        }
+        pd3dContext->GSSetShader(NULL, NULL, 0);
+        pd3dContext->IASetInputLayout(m_pInputLayout);
+
+        // The geometry passes read the compact vertex stream instead of the SDKMESH one
+        UINT Strides[1];
+        UINT Offsets[1];
+        ID3D11Buffer* pVB[1];
+        pVB[0] = Vertices.GetVB();
+        Strides[0] = Vertices.GetStride();
+        Offsets[0] = 0;
+        pd3dContext->IASetVertexBuffers(0, 1, pVB, Strides, Offsets);
+        pd3dContext->IASetIndexBuffer(DrawList.pIB, DrawList.IBFormat, 0);
+
+        for (size_t DrawId = FirstDraw; DrawId < EndDraw; ++DrawId)
+        {
+            const SubsetDraw &Draw = DrawList.Draws[DrawId];
+
+            pd3dContext->IASetPrimitiveTopology(Draw.Topology);
+
+            if (m_UseDynamicCB)
+            {
+                m_DynamicCB.PSBind(pd3dContext1, 1, m_ShadingParamsOffset + Draw.SubsetId * CONSTANT_ALIGNMENT, CONSTANT_ALIGNMENT);
+            }
+            else
+            {
+                DirectX::XMFLOAT3 Color;
+                ComputeRandomColor(Draw.SubsetId, Color);
+
+                float data[4] = { Color.x, Color.y, Color.z, m_Alpha };
+                pd3dContext->UpdateSubresource(m_pShadingParamsCB, 0, NULL, data, 0, 0);
+            }
+
+            if (IsInstanced)
+            {
+                pd3dContext->DrawIndexedInstanced( Draw.IndexCount, NumInstances, Draw.IndexStart, Draw.BaseVertex, 0 );
+            }
+            else
+            {
+                pd3dContext->DrawIndexed( Draw.IndexCount, Draw.IndexStart, Draw.BaseVertex );
+            }
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Executes the commands on a D3D11 context, with the draw lists and constants of the frame
+    //--------------------------------------------------------------------------------------
+    class ContextSink : public CommandSink
+    {
+    public:
+        ContextSink(D3D11Context *pOwner, ID3D11DeviceContext* pd3dContext, const MeshDrawList *const pDrawLists[NUM_MESH_DRAW_LISTS], bool EnableMarkers)
+            : m_pOwner(pOwner)
+            , m_pd3dContext(pd3dContext)
+            , m_pd3dContext1(NULL)
+            , m_pPerf(NULL)
+            , m_FirstDraw(0)
+            , m_EndDraw(~(size_t)0)
+        {
+            for (UINT ListId = 0; ListId < NUM_MESH_DRAW_LISTS; ++ListId)
+            {
+                m_pDrawLists[ListId] = pDrawLists[ListId];
+            }
+            if (m_pOwner->m_UseDynamicCB && FAILED(m_pd3dContext->QueryInterface(IID_PPV_ARGS(&m_pd3dContext1))))
+            {
+                m_pd3dContext1 = NULL;
+            }
+            if (!EnableMarkers || FAILED(m_pd3dContext->QueryInterface(IID_PPV_ARGS(&m_pPerf))))
+            {
+                m_pPerf = NULL;
+            }
+        }
+
+        ~ContextSink()
+        {
+            SAFE_RELEASE(m_pd3dContext1);
+            SAFE_RELEASE(m_pPerf);
+        }
+
+        // Range of the draw list used by CMD_DRAW_MESH
+        void SetDrawRange(size_t FirstDraw, size_t EndDraw)
+        {
+            m_FirstDraw = FirstDraw;
+            m_EndDraw = EndDraw;
+        }
+
+        virtual void Execute(const Command &Cmd)
+        {
+            switch (Cmd.Type)
+            {
+            case CMD_SET_VERTEX_SHADER:
+                m_pd3dContext->VSSetShader(D3D11Shader::GetVS(Cmd.pObject), NULL, 0);
+                break;
+            case CMD_SET_PIXEL_SHADER:
+                m_pd3dContext->PSSetShader(D3D11Shader::GetPS(Cmd.pObject), NULL, 0);
+                break;
+            case CMD_SET_RASTERIZER_STATE:
+                m_pd3dContext->RSSetState(D3D11RasterizerState::Get(Cmd.pObject));
+                break;
+            case CMD_SET_BLEND_STATE:
+                m_pd3dContext->OMSetBlendState(D3D11BlendState::Get(Cmd.pObject), Cmd.Values, Cmd.Value);
+                break;
+            case CMD_SET_DEPTH_STENCIL_STATE:
+                m_pd3dContext->OMSetDepthStencilState(D3D11DepthStencilState::Get(Cmd.pObject), Cmd.Value);
+                break;
+            case CMD_SET_RENDER_TARGETS:
+                {
+                    ID3D11RenderTargetView *pRTVs[MAX_COMMAND_OBJECTS];
+                    for (UINT i = 0; i < Cmd.Count; ++i)
+                    {
+                        pRTVs[i] = D3D11View::GetRTV(Cmd.pObjects[i]);
+                    }
+                    m_pd3dContext->OMSetRenderTargets(Cmd.Count, pRTVs, D3D11View::GetDSV(Cmd.pObject));
+
+                    // The targets of the reduced-resolution passes are smaller than the back buffer
+                    void *pFirstView = Cmd.Count ? Cmd.pObjects[0] : Cmd.pObject;
+                    if (pFirstView)
+                    {
+                        D3D11_VIEWPORT Viewport;
+                        D3D11View::GetViewport(pFirstView, Viewport);
+                        m_pd3dContext->RSSetViewports(1, &Viewport);
+                    }
+                }
+                break;
+            case CMD_SET_VS_RESOURCES:
+                {
+                    ID3D11ShaderResourceView *pSRVs[MAX_COMMAND_OBJECTS];
+                    for (UINT i = 0; i < Cmd.Count; ++i)
+                    {
+                        pSRVs[i] = D3D11View::GetSRV(Cmd.pObjects[i]);
+                    }
+                    m_pd3dContext->VSSetShaderResources(Cmd.Slot, Cmd.Count, pSRVs);
+                }
+                break;
+            case CMD_SET_PS_RESOURCES:
+                {
+                    ID3D11ShaderResourceView *pSRVs[MAX_COMMAND_OBJECTS];
+                    for (UINT i = 0; i < Cmd.Count; ++i)
+                    {
+                        pSRVs[i] = D3D11View::GetSRV(Cmd.pObjects[i]);
+                    }
+                    m_pd3dContext->PSSetShaderResources(Cmd.Slot, Cmd.Count, pSRVs);
+                }
+                break;
+            case CMD_CLEAR_RENDER_TARGET:
+                m_pd3dContext->ClearRenderTargetView(D3D11View::GetRTV(Cmd.pObject), Cmd.Values);
+                break;
+            case CMD_CLEAR_DEPTH:
+                m_pd3dContext->ClearDepthStencilView(D3D11View::GetDSV(Cmd.pObject), D3D11_CLEAR_DEPTH, Cmd.Values[0], 0);
+                break;
+            case CMD_DRAW:
+                m_pd3dContext->Draw(Cmd.Count, Cmd.Slot);
+                break;
+            case CMD_RESOLVE:
+                {
+                    RHITexture *pDst = (RHITexture*)Cmd.pObject;
+                    RHITexture *pSrc = (RHITexture*)Cmd.pObjects[0];
+                    m_pd3dContext->ResolveSubresource(D3D11Device::GetTexture2D(pDst), 0, D3D11Device::GetTexture2D(pSrc), 0, GetDXGIFormat(pDst->GetDesc().Format));
+                }
+                break;
+            case CMD_BEGIN_EVENT:
+                if (m_pPerf) m_pPerf->BeginEvent(Cmd.pName);
+                break;
+            case CMD_END_EVENT:
+                if (m_pPerf) m_pPerf->EndEvent();
+                break;
+            case CMD_BIND_FRAME_CONSTANTS:
+                m_pOwner->BindConstants(m_pd3dContext, m_pd3dContext1);
+                break;
+            case CMD_DRAW_MESH:
+            {
+                const MeshDrawList &DrawList = *m_pDrawLists[Cmd.Slot];
+                m_pOwner->DrawMesh(m_pd3dContext, m_pd3dContext1, DrawList, m_FirstDraw, std::min(m_EndDraw, DrawList.Draws.size()));
+                break;
+            }
+            }
+        }
+
+    protected:
+        D3D11Context *m_pOwner;
+        ID3D11DeviceContext *m_pd3dContext;
+        ID3D11DeviceContext1 *m_pd3dContext1;
+        ID3DUserDefinedAnnotation *m_pPerf;
+        const MeshDrawList *m_pDrawLists[NUM_MESH_DRAW_LISTS];
+        size_t m_FirstDraw;
+        size_t m_EndDraw;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Parallel submission: the command list is split into segments (see BuildSegments),
+    // each segment is replayed on the deferred context of the worker that runs it,
+    // and the resulting command lists are executed in order on the immediate context.
+    // The perf markers are not recorded in this mode.
+    // A deferred context starts from the default state, without any viewport, and executing
+    // its command list resets the immediate context to the default state: each segment starts
+    // with the viewport of the immediate context, and the state left by the serial replay is
+    // restored on the immediate context once all the segments are executed.
+    //--------------------------------------------------------------------------------------
+    struct SubmissionJob
+    {
+        D3D11Context *pOwner;
+        const CommandList *pCommands;
+        const MeshDrawList *const *pDrawLists;
+        UINT NumViewports;
+        D3D11_VIEWPORT Viewport;        // Of the immediate context
+    };
+
+    static void RecordSegment(void *pData, UINT SegmentId, UINT WorkerId)
+    {
+        const SubmissionJob &Job = *(const SubmissionJob*)pData;
+        D3D11Context *pOwner = Job.pOwner;
+        const CommandSegment &Segment = pOwner->m_Segments[SegmentId];
+        ID3D11DeviceContext *pDeferredContext = pOwner->m_DeferredContexts[WorkerId];
+
+        // Overridden by the CMD_SET_RENDER_TARGETS of the state prefix, if any
+        if (Job.NumViewports)
+        {
+            pDeferredContext->RSSetViewports(1, &Job.Viewport);
+        }
+
+        {
+            ContextSink Sink(pOwner, pDeferredContext, Job.pDrawLists, false);
+            Sink.SetDrawRange(Segment.FirstDraw, Segment.EndDraw);
+            Job.pCommands->Replay(Sink, Segment);
+        }
+
+        pOwner->m_SegmentCommandLists[SegmentId] = NULL;
+        pDeferredContext->FinishCommandList(FALSE, &pOwner->m_SegmentCommandLists[SegmentId]);
+    }
+
+    void SubmitParallel(const CommandList &Commands, const MeshDrawList *const pDrawLists[NUM_MESH_DRAW_LISTS])
+    {
+        UINT NumDraws[NUM_MESH_DRAW_LISTS];
+        for (UINT ListId = 0; ListId < NUM_MESH_DRAW_LISTS; ++ListId)
+        {
+            NumDraws[ListId] = (UINT)pDrawLists[ListId]->Draws.size();
+        }
+        Commands.BuildSegments(NumDraws, PARALLEL_DRAWS_PER_SEGMENT, m_Segments);
+        m_SegmentCommandLists.assign(m_Segments.size(), NULL);
+        m_NumSubmittedSegments = (UINT)m_Segments.size();
+
+        SubmissionJob Job;
+        Job.pOwner = this;
+        Job.pCommands = &Commands;
+        Job.pDrawLists = pDrawLists;
+        Job.NumViewports = 1;
+        m_pd3dImmediateContext->RSGetViewports(&Job.NumViewports, &Job.Viewport);
+        m_pJobSystem->ParallelFor(RecordSegment, &Job, (UINT)m_Segments.size());
+
+        for (size_t SegmentId = 0; SegmentId < m_SegmentCommandLists.size(); ++SegmentId)
+        {
+            if (m_SegmentCommandLists[SegmentId])
+            {
+                m_pd3dImmediateContext->ExecuteCommandList(m_SegmentCommandLists[SegmentId], FALSE);
+            }
+            SAFE_RELEASE(m_SegmentCommandLists[SegmentId]);
+        }
+
+        // Replaying all the state commands in order leaves the render targets, viewport,
+        // shaders and states bound by the last commands, as the serial replay does
+        CommandSegment StateSegment;
+        StateSegment.StateEnd = Commands.GetNumCommands();
+        StateSegment.Begin = StateSegment.End = Commands.GetNumCommands();
+        StateSegment.FirstDraw = StateSegment.EndDraw = 0;
+        ContextSink Sink(this, m_pd3dImmediateContext, pDrawLists, false);
+        Commands.Replay(Sink, StateSegment);
+    }
+
+    void CreateVertexShaders()
+    {
+        HRESULT hr;
+
+        // Input layout description for all the geometry passes (see CompactVertex)
+        const D3D11_INPUT_ELEMENT_DESC InputLayoutDesc[] =
+        {
+            { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        };
+        UINT NumElements = sizeof(InputLayoutDesc)/sizeof(InputLayoutDesc[0]);
+
+        // Vertex shader and input layout for the geometry passes
+        V( m_pd3dDevice->CreateVertexShader(g_GeometryVS, sizeof(g_GeometryVS), NULL, &m_pGeometryVS) );
+        V( m_pd3dDevice->CreateInputLayout(InputLayoutDesc, NumElements, g_GeometryVS, sizeof(g_GeometryVS), &m_pInputLayout) );
+
+        // Same input signature, with the transforms read from the instance buffer
+        V( m_pd3dDevice->CreateVertexShader(g_InstancedGeometryVS, sizeof(g_InstancedGeometryVS), NULL, &m_pInstancedGeometryVS) );
+    }
+
+    void CreateParamsCB(UINT Size)
+    {
+        HRESULT hr;
+
+        SAFE_RELEASE(m_pParamsCB);
+
+        D3D11_BUFFER_DESC cbDesc;
+        cbDesc.ByteWidth = Size;
+        cbDesc.Usage = D3D11_USAGE_DEFAULT;
+        cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        cbDesc.CPUAccessFlags = 0;
+        cbDesc.MiscFlags = 0;
+        cbDesc.StructureByteStride = 0; // new in D3D11
+        V( m_pd3dDevice->CreateBuffer(&cbDesc, NULL, &m_pParamsCB) );
+        m_ParamsCBSize = SUCCEEDED(hr) ? Size : 0;
+    }
+
+    void CreateConstantBuffers()
+    {
+        HRESULT hr;
+
+        D3D11_BUFFER_DESC cbDesc;
+        cbDesc.ByteWidth = sizeof(float) * 4;
+        cbDesc.Usage = D3D11_USAGE_DEFAULT;
+        cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        cbDesc.CPUAccessFlags = 0;
+        cbDesc.MiscFlags = 0;
+        cbDesc.StructureByteStride = 0; // new in D3D11
+        V( m_pd3dDevice->CreateBuffer(&cbDesc, NULL, &m_pShadingParamsCB) );
+
+        // Ring buffer for the per-frame constants, if the device supports binding sub-ranges
+        V( m_DynamicCB.Create(m_pd3dDevice) );
+    }
+
+    ID3D11Device *m_pd3dDevice;
+    ID3D11DeviceContext *m_pd3dImmediateContext;
+    ID3D11VertexShader *m_pGeometryVS;
+    ID3D11VertexShader *m_pInstancedGeometryVS;
+    ID3D11InputLayout *m_pInputLayout;
+    ID3D11Buffer *m_pParamsCB;      // Created with the size of the frame constants of the techniques
+    ID3D11Buffer *m_pShadingParamsCB;
+    UINT m_ParamsCBSize;
+    DynamicConstantBuffer m_DynamicCB;
+    bool m_UseDynamicCB;
+    UINT m_ParamsOffset;            // In bytes, in m_DynamicCB
+    UINT m_ShadingParamsOffset;     // One CONSTANT_ALIGNMENT block per subset
+    UINT m_ParamsSize;
+    UINT m_NumConstantFallbacks;
+    float m_Alpha;
+    const CompactMesh *m_pMesh;
+    const InstanceBuffer *m_pInstances;
+    const MeshDrawList *m_pDrawList;
+    const MeshDrawList *m_pOrderedDrawList;
+    const MeshDrawList *m_pOpaqueDrawList;
+    JobSystem *m_pJobSystem;
+    std::vector<ID3D11DeviceContext*> m_DeferredContexts;
+    bool m_ParallelSubmission;
+    UINT m_NumSubmittedSegments;
+    std::vector<CommandSegment> m_Segments;
+    std::vector<ID3D11CommandList*> m_SegmentCommandLists;
+    ID3D11Query *m_pStatsQueries[STATS_QUERY_LATENCY];
+    ID3D11Query *m_pDisjointQueries[STATS_QUERY_LATENCY];
+    ID3D11Query *m_pTimestampQueries[STATS_QUERY_LATENCY][2];
+    D3D11SubmitStats m_PendingStats[STATS_QUERY_LATENCY];
+    UINT m_NumSubmits;
+    UINT m_NumReadSubmits;
+    D3D11SubmitStats m_LastSubmitStats;
+    bool m_HasSubmitStats;
+    bool m_SubmitStats;
+};
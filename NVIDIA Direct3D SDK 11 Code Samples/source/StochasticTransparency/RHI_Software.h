@@ -0,0 +1,1036 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+#include "RHI.h"
+#include "CommandList.h"
+#include <vector>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+// Define SOFTWARE_SSE2 to 0 to force the plain C++ output merger (see Tests/CMakeLists.txt)
+#ifndef SOFTWARE_SSE2
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define SOFTWARE_SSE2 1
+#else
+#define SOFTWARE_SSE2 0
+#endif
+#endif
+
+#if SOFTWARE_SSE2
+#include <emmintrin.h>
+#endif
+
+//--------------------------------------------------------------------------------------
+// Validation mock of the RHI, for headless runs of the techniques. It has no rasterizer
+// and runs no shaders: the draws are only checked against the bound state and counted.
+// Textures live in system memory, and the clears and resolves are executed with the
+// D3D11 format conversions. SoftwareContext::MergePixels applies the bound blend and
+// depth states to shaded pixels given by the caller, as the D3D11 output merger; only
+// Tests/SoftwareOutputMergerTest.cpp calls it.
+//--------------------------------------------------------------------------------------
+
+#define SOFTWARE_MAX_SRVS 16
+
+//--------------------------------------------------------------------------------------
+// Format conversions
+//--------------------------------------------------------------------------------------
+
+// Round to nearest even, with denormals, infinities and NaNs
+inline unsigned short FloatToHalf(float Value)
+{
+    UINT Bits;
+    memcpy(&Bits, &Value, sizeof(Bits));
+
+    const UINT Sign = (Bits >> 16) & 0x8000;
+    const UINT Abs = Bits & 0x7FFFFFFF;
+
+    if (Abs >= 0x7F800000)
+    {
+        // Infinity or NaN
+        return (unsigned short)(Sign | 0x7C00 | ((Abs > 0x7F800000) ? 0x200 : 0));
+    }
+    if (Abs >= 0x477FF000)
+    {
+        // Rounds to a value above the largest half
+        return (unsigned short)(Sign | 0x7C00);
+    }
+    if (Abs < 0x38800000)
+    {
+        // Denormal half: shift the mantissa with its implicit bit.
+        // Below 2^-25, the 24-bit mantissa is shifted out and rounds to 0.
+        const UINT Shift = 113 - (Abs >> 23);
+        if (Shift > 11) return (unsigned short)Sign;
+        const UINT Mantissa = (Abs & 0x7FFFFF) | 0x800000;
+        const UINT Half = Mantissa >> (Shift + 13);
+        const UINT Rest = Mantissa & ((1U << (Shift + 13)) - 1);
+        const UINT HalfWay = 1U << (Shift + 12);
+        const UINT Round = (Rest > HalfWay || (Rest == HalfWay && (Half & 1))) ? 1 : 0;
+        return (unsigned short)(Sign | (Half + Round));
+    }
+
+    const UINT Rebiased = Abs - 0x38000000;
+    const UINT Round = ((Rebiased & 0x1FFF) > 0x1000 || ((Rebiased & 0x1FFF) == 0x1000 && (Rebiased & 0x2000))) ? 1 : 0;
+    return (unsigned short)(Sign | ((Rebiased >> 13) + Round));
+}
+
+inline float HalfToFloat(unsigned short Half)
+{
+    const UINT Sign = (UINT)(Half & 0x8000) << 16;
+    const UINT Exponent = (Half >> 10) & 0x1F;
+    UINT Mantissa = Half & 0x3FF;
+
+    UINT Bits;
+    if (Exponent == 0x1F)
+    {
+        Bits = Sign | 0x7F800000 | (Mantissa << 13);
+    }
+    else if (Exponent != 0)
+    {
+        Bits = Sign | ((Exponent + 112) << 23) | (Mantissa << 13);
+    }
+    else if (Mantissa == 0)
+    {
+        Bits = Sign;
+    }
+    else
+    {
+        // Normalize the denormal
+        UINT Shift = 0;
+        while (!(Mantissa & 0x400))
+        {
+            Mantissa <<= 1;
+            ++Shift;
+        }
+        Bits = Sign | ((113 - Shift) << 23) | ((Mantissa & 0x3FF) << 13);
+    }
+
+    float Value;
+    memcpy(&Value, &Bits, sizeof(Value));
+    return Value;
+}
+
+// Saturates and rounds to nearest, as for D3D11 UNORM conversions. NaN converts to 0.
+inline UINT FloatToUNorm(float Value, UINT MaxValue)
+{
+    if (!(Value > 0.f)) return 0;
+    if (Value >= 1.f) return MaxValue;
+    return (UINT)(Value * (float)MaxValue + 0.5f);
+}
+
+// Writes the components of Color supported by the format.
+// Depth formats take the depth in Color[0]; the stencil bits are left unchanged.
+inline void EncodeTexel(RHIFormat Format, const float Color[4], BYTE *pTexel)
+{
+    switch (Format)
+    {
+    case RHI_FORMAT_R8G8B8A8_UNORM:
+        for (int i = 0; i < 4; ++i)
+        {
+            pTexel[i] = (BYTE)FloatToUNorm(Color[i], 255);
+        }
+        break;
+    case RHI_FORMAT_R16_FLOAT:
+        {
+            unsigned short Half = FloatToHalf(Color[0]);
+            memcpy(pTexel, &Half, sizeof(Half));
+        }
+        break;
+    case RHI_FORMAT_R16G16B16A16_FLOAT:
+        for (int i = 0; i < 4; ++i)
+        {
+            unsigned short Half = FloatToHalf(Color[i]);
+            memcpy(pTexel + i * sizeof(Half), &Half, sizeof(Half));
+        }
+        break;
+    case RHI_FORMAT_R32_FLOAT:
+    case RHI_FORMAT_D32_FLOAT:
+        memcpy(pTexel, Color, sizeof(float));
+        break;
+    case RHI_FORMAT_R32G32_FLOAT:
+        memcpy(pTexel, Color, 2 * sizeof(float));
+        break;
+    case RHI_FORMAT_R32G32B32A32_FLOAT:
+        memcpy(pTexel, Color, 4 * sizeof(float));
+        break;
+    case RHI_FORMAT_R32_UINT:
+        {
+            UINT Value = (UINT)Color[0];
+            memcpy(pTexel, &Value, sizeof(Value));
+        }
+        break;
+    case RHI_FORMAT_D16_UNORM:
+        {
+            unsigned short Value = (unsigned short)FloatToUNorm(Color[0], 0xFFFF);
+            memcpy(pTexel, &Value, sizeof(Value));
+        }
+        break;
+    case RHI_FORMAT_D24_UNORM_S8_UINT:
+        {
+            UINT Value;
+            memcpy(&Value, pTexel, sizeof(Value));
+            Value = (Value & 0xFF000000) | FloatToUNorm(Color[0], 0xFFFFFF);
+            memcpy(pTexel, &Value, sizeof(Value));
+        }
+        break;
+    default:
+        assert(0);
+        break;
+    }
+}
+
+// Missing components read as 0, and alpha as 1
+inline void DecodeTexel(RHIFormat Format, const BYTE *pTexel, float Color[4])
+{
+    Color[0] = Color[1] = Color[2] = 0.f;
+    Color[3] = 1.f;
+
+    switch (Format)
+    {
+    case RHI_FORMAT_R8G8B8A8_UNORM:
+        for (int i = 0; i < 4; ++i)
+        {
+            Color[i] = (float)pTexel[i] / 255.f;
+        }
+        break;
+    case RHI_FORMAT_R16_FLOAT:
+        {
+            unsigned short Half;
+            memcpy(&Half, pTexel, sizeof(Half));
+            Color[0] = HalfToFloat(Half);
+        }
+        break;
+    case RHI_FORMAT_R16G16B16A16_FLOAT:
+        for (int i = 0; i < 4; ++i)
+        {
+            unsigned short Half;
+            memcpy(&Half, pTexel + i * sizeof(Half), sizeof(Half));
+            Color[i] = HalfToFloat(Half);
+        }
+        break;
+    case RHI_FORMAT_R32_FLOAT:
+    case RHI_FORMAT_D32_FLOAT:
+        memcpy(Color, pTexel, sizeof(float));
+        break;
+    case RHI_FORMAT_R32G32_FLOAT:
+        memcpy(Color, pTexel, 2 * sizeof(float));
+        break;
+    case RHI_FORMAT_R32G32B32A32_FLOAT:
+        memcpy(Color, pTexel, 4 * sizeof(float));
+        break;
+    case RHI_FORMAT_R32_UINT:
+        {
+            UINT Value;
+            memcpy(&Value, pTexel, sizeof(Value));
+            Color[0] = (float)Value;
+        }
+        break;
+    case RHI_FORMAT_D16_UNORM:
+        {
+            unsigned short Value;
+            memcpy(&Value, pTexel, sizeof(Value));
+            Color[0] = (float)Value / (float)0xFFFF;
+        }
+        break;
+    case RHI_FORMAT_D24_UNORM_S8_UINT:
+        {
+            UINT Value;
+            memcpy(&Value, pTexel, sizeof(Value));
+            Color[0] = (float)(Value & 0xFFFFFF) / (float)0xFFFFFF;
+        }
+        break;
+    default:
+        assert(0);
+        break;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Four lanes of a pixel batch. Without SSE2, the plain C++ fallback gives the same results,
+// including for NaNs: min and max return their second operand when the comparison fails.
+//--------------------------------------------------------------------------------------
+
+#if SOFTWARE_SSE2
+
+typedef __m128 OMVector;
+
+inline OMVector OMLoad(const float *p)              { return _mm_loadu_ps(p); }
+inline void OMStore(float *p, OMVector a)           { _mm_storeu_ps(p, a); }
+inline OMVector OMSplat(float f)                    { return _mm_set1_ps(f); }
+inline OMVector OMAdd(OMVector a, OMVector b)       { return _mm_add_ps(a, b); }
+inline OMVector OMSub(OMVector a, OMVector b)       { return _mm_sub_ps(a, b); }
+inline OMVector OMMul(OMVector a, OMVector b)       { return _mm_mul_ps(a, b); }
+inline OMVector OMMin(OMVector a, OMVector b)       { return _mm_min_ps(a, b); }
+inline OMVector OMMax(OMVector a, OMVector b)       { return _mm_max_ps(a, b); }
+
+// Truncates toward zero, for values in [0,2^24]
+inline OMVector OMTruncate(OMVector a)              { return _mm_cvtepi32_ps(_mm_cvttps_epi32(a)); }
+
+// One bit per lane
+inline UINT OMCompare(RHIComparison Func, OMVector a, OMVector b)
+{
+    switch (Func)
+    {
+    case RHI_COMPARISON_LESS:           return (UINT)_mm_movemask_ps(_mm_cmplt_ps(a, b));
+    case RHI_COMPARISON_EQUAL:          return (UINT)_mm_movemask_ps(_mm_cmpeq_ps(a, b));
+    case RHI_COMPARISON_LESS_EQUAL:     return (UINT)_mm_movemask_ps(_mm_cmple_ps(a, b));
+    case RHI_COMPARISON_GREATER:        return (UINT)_mm_movemask_ps(_mm_cmpgt_ps(a, b));
+    case RHI_COMPARISON_NOT_EQUAL:      return (UINT)_mm_movemask_ps(_mm_cmpneq_ps(a, b));
+    case RHI_COMPARISON_GREATER_EQUAL:  return (UINT)_mm_movemask_ps(_mm_cmpge_ps(a, b));
+    case RHI_COMPARISON_ALWAYS:         return 0xF;
+    default:                            return 0;
+    }
+}
+
+#else
+
+struct OMVector
+{
+    float v[4];
+};
+
+inline OMVector OMLoad(const float *p)              { OMVector r; for (int i = 0; i < 4; ++i) r.v[i] = p[i]; return r; }
+inline void OMStore(float *p, OMVector a)           { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+inline OMVector OMSplat(float f)                    { OMVector r; for (int i = 0; i < 4; ++i) r.v[i] = f; return r; }
+inline OMVector OMAdd(OMVector a, OMVector b)       { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+inline OMVector OMSub(OMVector a, OMVector b)       { for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+inline OMVector OMMul(OMVector a, OMVector b)       { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+inline OMVector OMMin(OMVector a, OMVector b)       { for (int i = 0; i < 4; ++i) a.v[i] = (a.v[i] < b.v[i]) ? a.v[i] : b.v[i]; return a; }
+inline OMVector OMMax(OMVector a, OMVector b)       { for (int i = 0; i < 4; ++i) a.v[i] = (a.v[i] > b.v[i]) ? a.v[i] : b.v[i]; return a; }
+inline OMVector OMTruncate(OMVector a)              { for (int i = 0; i < 4; ++i) a.v[i] = (float)(int)a.v[i]; return a; }
+
+inline UINT OMCompare(RHIComparison Func, OMVector a, OMVector b)
+{
+    UINT Mask = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        bool Pass;
+        switch (Func)
+        {
+        case RHI_COMPARISON_LESS:           Pass = (a.v[i] < b.v[i]); break;
+        case RHI_COMPARISON_EQUAL:          Pass = (a.v[i] == b.v[i]); break;
+        case RHI_COMPARISON_LESS_EQUAL:     Pass = (a.v[i] <= b.v[i]); break;
+        case RHI_COMPARISON_GREATER:        Pass = (a.v[i] > b.v[i]); break;
+        case RHI_COMPARISON_NOT_EQUAL:      Pass = (a.v[i] != b.v[i]); break;
+        case RHI_COMPARISON_GREATER_EQUAL:  Pass = (a.v[i] >= b.v[i]); break;
+        case RHI_COMPARISON_ALWAYS:         Pass = true; break;
+        default:                            Pass = false; break;
+        }
+        Mask |= Pass ? (1U << i) : 0;
+    }
+    return Mask;
+}
+
+#endif
+
+// Clamps to [0,1], with NaN converted to 0
+inline OMVector OMSaturate(OMVector a)
+{
+    return OMMin(OMMax(a, OMSplat(0.f)), OMSplat(1.f));
+}
+
+// Same results as FloatToUNorm, as floats holding the integer values
+inline OMVector OMToUNorm(OMVector a, UINT MaxValue)
+{
+    const OMVector Max = OMSplat((float)MaxValue);
+    return OMTruncate(OMMin(OMAdd(OMMul(OMSaturate(a), Max), OMSplat(0.5f)), Max));
+}
+
+inline OMVector OMBlendFactor(RHIBlend Blend, OMVector Src, OMVector SrcAlpha, OMVector Dst, OMVector DstAlpha)
+{
+    const OMVector One = OMSplat(1.f);
+    switch (Blend)
+    {
+    case RHI_BLEND_ONE:             return One;
+    case RHI_BLEND_SRC_COLOR:       return Src;
+    case RHI_BLEND_INV_SRC_COLOR:   return OMSub(One, Src);
+    case RHI_BLEND_SRC_ALPHA:       return SrcAlpha;
+    case RHI_BLEND_INV_SRC_ALPHA:   return OMSub(One, SrcAlpha);
+    case RHI_BLEND_DEST_ALPHA:      return DstAlpha;
+    case RHI_BLEND_INV_DEST_ALPHA:  return OMSub(One, DstAlpha);
+    case RHI_BLEND_DEST_COLOR:      return Dst;
+    case RHI_BLEND_INV_DEST_COLOR:  return OMSub(One, Dst);
+    default:                        return OMSplat(0.f);
+    }
+}
+
+// MIN and MAX ignore the blend factors, as in D3D11
+inline OMVector OMBlendOp(RHIBlendOp Op, OMVector Src, OMVector SrcFactor, OMVector Dst, OMVector DstFactor)
+{
+    switch (Op)
+    {
+    case RHI_BLEND_OP_SUBTRACT:     return OMSub(OMMul(Src, SrcFactor), OMMul(Dst, DstFactor));
+    case RHI_BLEND_OP_REV_SUBTRACT: return OMSub(OMMul(Dst, DstFactor), OMMul(Src, SrcFactor));
+    case RHI_BLEND_OP_MIN:          return OMMin(Src, Dst);
+    case RHI_BLEND_OP_MAX:          return OMMax(Src, Dst);
+    default:                        return OMAdd(OMMul(Src, SrcFactor), OMMul(Dst, DstFactor));
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Objects
+//--------------------------------------------------------------------------------------
+
+// Texels are stored slice by slice, row by row, with the samples of a pixel next to each other
+class SoftwareTexture : public RHITexture
+{
+public:
+    SoftwareTexture(const RHITextureDesc &Desc)
+        : RHITexture(Desc)
+        , m_TexelSize(GetFormatSize(Desc.Format))
+    {
+        m_Data.resize((size_t)Desc.Width * Desc.Height * Desc.ArraySize * Desc.SampleCount * m_TexelSize, 0);
+    }
+
+    BYTE* GetTexel(UINT x, UINT y, UINT Sample = 0, UINT Slice = 0)
+    {
+        return &m_Data[GetTexelOffset(x, y, Sample, Slice)];
+    }
+
+    const BYTE* GetTexel(UINT x, UINT y, UINT Sample = 0, UINT Slice = 0) const
+    {
+        return &m_Data[GetTexelOffset(x, y, Sample, Slice)];
+    }
+
+    void Read(UINT x, UINT y, UINT Sample, UINT Slice, float Color[4]) const
+    {
+        DecodeTexel(m_Desc.Format, GetTexel(x, y, Sample, Slice), Color);
+    }
+
+    void Write(UINT x, UINT y, UINT Sample, UINT Slice, const float Color[4])
+    {
+        EncodeTexel(m_Desc.Format, Color, GetTexel(x, y, Sample, Slice));
+    }
+
+    // Writes Color to every texel of the slice, or of all the slices
+    void Fill(UINT Slice, const float Color[4])
+    {
+        const UINT FirstSlice = (Slice == RHI_ALL_SLICES) ? 0 : Slice;
+        const UINT EndSlice = (Slice == RHI_ALL_SLICES) ? m_Desc.ArraySize : Slice + 1;
+        for (UINT s = FirstSlice; s < EndSlice; ++s)
+        {
+            for (UINT y = 0; y < m_Desc.Height; ++y)
+            {
+                for (UINT x = 0; x < m_Desc.Width; ++x)
+                {
+                    for (UINT Sample = 0; Sample < m_Desc.SampleCount; ++Sample)
+                    {
+                        Write(x, y, Sample, s, Color);
+                    }
+                }
+            }
+        }
+    }
+
+    UINT GetTexelSize() const { return m_TexelSize; }
+    const std::vector<BYTE>& GetData() const { return m_Data; }
+    std::vector<BYTE>& GetData() { return m_Data; }
+
+protected:
+    size_t GetTexelOffset(UINT x, UINT y, UINT Sample, UINT Slice) const
+    {
+        assert(x < m_Desc.Width && y < m_Desc.Height && Sample < m_Desc.SampleCount && Slice < m_Desc.ArraySize);
+        return ((((size_t)Slice * m_Desc.Height + y) * m_Desc.Width + x) * m_Desc.SampleCount + Sample) * m_TexelSize;
+    }
+
+    UINT m_TexelSize;
+    std::vector<BYTE> m_Data;
+};
+
+class SoftwareShader : public RHIShader
+{
+public:
+    SoftwareShader(RHIShaderStage Stage, const void *pBytecode, size_t BytecodeSize)
+        : RHIShader(Stage)
+        , m_Bytecode((const BYTE*)pBytecode, (const BYTE*)pBytecode + BytecodeSize)
+    {
+    }
+    const std::vector<BYTE>& GetBytecode() const { return m_Bytecode; }
+
+protected:
+    std::vector<BYTE> m_Bytecode;
+};
+
+//--------------------------------------------------------------------------------------
+// Output merger: depth test and blending of shaded pixels, by batches of
+// SOFTWARE_PIXEL_BATCH_SIZE pixels processed four lanes at a time
+//--------------------------------------------------------------------------------------
+
+#define SOFTWARE_PIXEL_BATCH_SIZE 8
+#define SOFTWARE_MAX_SAMPLES 32
+
+// Shaded pixels of a draw, in structure of arrays layout.
+// A batch must not hold the same pixel twice, since the lanes are blended independently.
+struct SoftwarePixelBatch
+{
+    UINT NumPixels;
+    UINT X[SOFTWARE_PIXEL_BATCH_SIZE];
+    UINT Y[SOFTWARE_PIXEL_BATCH_SIZE];
+    UINT Coverage[SOFTWARE_PIXEL_BATCH_SIZE];       // Covered samples, combined with SV_Coverage
+    float Depth[SOFTWARE_PIXEL_BATCH_SIZE];         // Same depth for all the covered samples
+    float Color[RHI_MAX_RENDER_TARGETS][4][SOFTWARE_PIXEL_BATCH_SIZE];     // SV_Target outputs
+};
+
+// Bound output-merger state, without NULL descs
+struct SoftwareOutputState
+{
+    const RHIBlendDesc *pBlendDesc;
+    UINT SampleMask;
+    const RHIDepthStencilDesc *pDepthStencilDesc;
+    RHIView *const *ppRTVs;
+    UINT NumRTVs;
+    RHIView *pDSV;
+};
+
+// Writes the channels of Color selected by WriteMask; the other bits of the texel are left unchanged.
+// UNORM colors are already converted (see OMToUNorm).
+inline void StoreMaskedTexel(RHIFormat Format, const float Color[4], UINT WriteMask, BYTE *pTexel)
+{
+    switch (Format)
+    {
+    case RHI_FORMAT_R8G8B8A8_UNORM:
+        for (int i = 0; i < 4; ++i)
+        {
+            if (WriteMask & (1 << i)) pTexel[i] = (BYTE)Color[i];
+        }
+        break;
+    case RHI_FORMAT_R16_FLOAT:
+    case RHI_FORMAT_R16G16B16A16_FLOAT:
+        for (int i = 0; i < ((Format == RHI_FORMAT_R16_FLOAT) ? 1 : 4); ++i)
+        {
+            if (!(WriteMask & (1 << i))) continue;
+            unsigned short Half = FloatToHalf(Color[i]);
+            memcpy(pTexel + i * sizeof(Half), &Half, sizeof(Half));
+        }
+        break;
+    case RHI_FORMAT_R32_FLOAT:
+    case RHI_FORMAT_R32G32_FLOAT:
+    case RHI_FORMAT_R32G32B32A32_FLOAT:
+        for (int i = 0; i < (int)(GetFormatSize(Format) / sizeof(float)); ++i)
+        {
+            if (WriteMask & (1 << i)) memcpy(pTexel + i * sizeof(float), &Color[i], sizeof(float));
+        }
+        break;
+    case RHI_FORMAT_R32_UINT:
+        if (WriteMask & 1) EncodeTexel(Format, Color, pTexel);
+        break;
+    default:
+        assert(0);
+        break;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Depth test and blending of a batch, following the D3D11 rules:
+// - the depth is clamped to [0,1] and converted to the depth format before the test,
+// - UNORM targets clamp the shader outputs to [0,1] before blending,
+// - float targets blend in 32-bit and round the result to the format (to nearest even, as WARP),
+// - integer targets are not blended, and formats without alpha read a destination alpha of 1.
+// Returns the number of samples that passed the depth test.
+//--------------------------------------------------------------------------------------
+inline UINT MergePixels(const SoftwareOutputState &State, const SoftwarePixelBatch &Batch)
+{
+    const UINT N = SOFTWARE_PIXEL_BATCH_SIZE;
+    assert(Batch.NumPixels <= N);
+    const UINT ActiveLanes = (1U << Batch.NumPixels) - 1;
+
+    RHITexture *pSizeTexture = State.pDSV ? State.pDSV->GetTexture() : (State.NumRTVs && State.ppRTVs[0]) ? State.ppRTVs[0]->GetTexture() : NULL;
+    if (!pSizeTexture || !ActiveLanes) return 0;
+    const UINT SampleCount = pSizeTexture->GetDesc().SampleCount;
+    assert(SampleCount <= SOFTWARE_MAX_SAMPLES);
+
+    // Lanes covering each sample
+    UINT SampleLanes[SOFTWARE_MAX_SAMPLES];
+    for (UINT Sample = 0; Sample < SampleCount; ++Sample)
+    {
+        SampleLanes[Sample] = 0;
+        for (UINT i = 0; i < Batch.NumPixels; ++i)
+        {
+            SampleLanes[Sample] |= ((Batch.Coverage[i] & State.SampleMask) >> Sample & 1) << i;
+        }
+    }
+
+    // Depth test, in the domain of the depth format: integers for D16 and D24, so that the comparisons are exact
+    const RHIDepthStencilDesc &DSDesc = *State.pDepthStencilDesc;
+    if (State.pDSV && DSDesc.DepthEnable)
+    {
+        SoftwareTexture *pDepthTexture = (SoftwareTexture*)State.pDSV->GetTexture();
+        const RHIFormat DepthFormat = pDepthTexture->GetDesc().Format;
+        const UINT DepthMax = (DepthFormat == RHI_FORMAT_D16_UNORM) ? 0xFFFF :
+                              (DepthFormat == RHI_FORMAT_D24_UNORM_S8_UINT) ? 0xFFFFFF : 0;
+        const bool IsUNorm = (DepthMax != 0);
+        const UINT TexelSize = GetFormatSize(DepthFormat);
+
+        float SrcDepth[N];
+        for (UINT i = 0; i < N; i += 4)
+        {
+            const OMVector Depth = OMLoad(Batch.Depth + i);
+            OMStore(SrcDepth + i, IsUNorm ? OMToUNorm(Depth, DepthMax) : OMSaturate(Depth));
+        }
+
+        for (UINT Sample = 0; Sample < SampleCount; ++Sample)
+        {
+            if (!SampleLanes[Sample]) continue;
+
+            BYTE *pTexels[N];
+            float DstDepth[N];
+            for (UINT i = 0; i < N; ++i)
+            {
+                DstDepth[i] = 0.f;
+                if (!(SampleLanes[Sample] & (1U << i))) continue;
+
+                pTexels[i] = pDepthTexture->GetTexel(Batch.X[i], Batch.Y[i], Sample);
+                UINT Bits = 0;
+                memcpy(&Bits, pTexels[i], TexelSize);
+                if (IsUNorm) DstDepth[i] = (float)(Bits & DepthMax);
+                else memcpy(&DstDepth[i], &Bits, sizeof(float));
+            }
+
+            UINT Pass = 0;
+            for (UINT i = 0; i < N; i += 4)
+            {
+                Pass |= OMCompare(DSDesc.DepthFunc, OMLoad(SrcDepth + i), OMLoad(DstDepth + i)) << i;
+            }
+            SampleLanes[Sample] &= Pass;
+
+            if (!DSDesc.DepthWriteEnable) continue;
+            for (UINT i = 0; i < N; ++i)
+            {
+                if (!(SampleLanes[Sample] & (1U << i))) continue;
+
+                UINT Bits = 0;
+                memcpy(&Bits, pTexels[i], TexelSize);
+                if (IsUNorm) Bits = (Bits & ~DepthMax) | (UINT)SrcDepth[i];
+                else memcpy(&Bits, &SrcDepth[i], sizeof(Bits));
+                memcpy(pTexels[i], &Bits, TexelSize);
+            }
+        }
+    }
+
+    UINT NumPassed = 0;
+    for (UINT Sample = 0; Sample < SampleCount; ++Sample)
+    {
+        for (UINT Lanes = SampleLanes[Sample]; Lanes; Lanes &= Lanes - 1) ++NumPassed;
+    }
+
+    const RHIBlendDesc &BSDesc = *State.pBlendDesc;
+    for (UINT RT = 0; RT < State.NumRTVs; ++RT)
+    {
+        if (!State.ppRTVs[RT]) continue;
+
+        // Without independent blending, all the targets use the RenderTarget[0] state
+        const RHIRenderTargetBlendDesc &Desc = BSDesc.RenderTarget[BSDesc.IndependentBlendEnable ? RT : 0];
+        if (!Desc.RenderTargetWriteMask) continue;
+
+        SoftwareTexture *pTexture = (SoftwareTexture*)State.ppRTVs[RT]->GetTexture();
+        const RHIFormat Format = pTexture->GetDesc().Format;
+        const UINT Slice = (State.ppRTVs[RT]->GetArraySlice() == RHI_ALL_SLICES) ? 0 : State.ppRTVs[RT]->GetArraySlice();
+        const bool IsUNorm = (Format == RHI_FORMAT_R8G8B8A8_UNORM);
+        const bool Blend = Desc.BlendEnable && (Format != RHI_FORMAT_R32_UINT);
+        assert(pTexture->GetDesc().SampleCount == SampleCount);
+
+        float Src[4][N];
+        for (int c = 0; c < 4; ++c)
+        {
+            for (UINT i = 0; i < N; i += 4)
+            {
+                const OMVector Color = OMLoad(Batch.Color[RT][c] + i);
+                OMStore(Src[c] + i, IsUNorm ? OMSaturate(Color) : Color);
+            }
+        }
+
+        for (UINT Sample = 0; Sample < SampleCount; ++Sample)
+        {
+            const UINT Lanes = SampleLanes[Sample];
+            if (!Lanes) continue;
+
+            BYTE *pTexels[N];
+            float Dst[4][N];
+            for (UINT i = 0; i < N; ++i)
+            {
+                float Color[4] = { 0.f, 0.f, 0.f, 0.f };
+                if (Lanes & (1U << i))
+                {
+                    pTexels[i] = pTexture->GetTexel(Batch.X[i], Batch.Y[i], Sample, Slice);
+                    if (Blend) DecodeTexel(Format, pTexels[i], Color);
+                }
+                for (int c = 0; c < 4; ++c) Dst[c][i] = Color[c];
+            }
+
+            float Result[4][N];
+            for (UINT i = 0; i < N; i += 4)
+            {
+                const OMVector SrcAlpha = OMLoad(Src[3] + i);
+                const OMVector DstAlpha = OMLoad(Dst[3] + i);
+                for (int c = 0; c < 4; ++c)
+                {
+                    OMVector Color = OMLoad(Src[c] + i);
+                    if (Blend)
+                    {
+                        const bool IsAlpha = (c == 3);
+                        const OMVector DstColor = OMLoad(Dst[c] + i);
+                        const OMVector SrcFactor = OMBlendFactor(IsAlpha ? Desc.SrcBlendAlpha : Desc.SrcBlend, Color, SrcAlpha, DstColor, DstAlpha);
+                        const OMVector DstFactor = OMBlendFactor(IsAlpha ? Desc.DestBlendAlpha : Desc.DestBlend, Color, SrcAlpha, DstColor, DstAlpha);
+                        Color = OMBlendOp(IsAlpha ? Desc.BlendOpAlpha : Desc.BlendOp, Color, SrcFactor, DstColor, DstFactor);
+                    }
+                    OMStore(Result[c] + i, IsUNorm ? OMToUNorm(Color, 255) : Color);
+                }
+            }
+
+            for (UINT i = 0; i < N; ++i)
+            {
+                if (!(Lanes & (1U << i))) continue;
+
+                const float Color[4] = { Result[0][i], Result[1][i], Result[2][i], Result[3][i] };
+                StoreMaskedTexel(Format, Color, Desc.RenderTargetWriteMask, pTexels[i]);
+            }
+        }
+    }
+    return NumPassed;
+}
+
+//--------------------------------------------------------------------------------------
+// Software device
+//--------------------------------------------------------------------------------------
+class SoftwareDevice : public RHIDevice
+{
+public:
+    virtual RHITexture* CreateTexture2D(const RHITextureDesc &Desc, const void *pInitData, UINT RowPitch)
+    {
+        if (GetFormatSize(Desc.Format) == 0 || Desc.Width == 0 || Desc.Height == 0) return NULL;
+
+        SoftwareTexture *pTexture = new SoftwareTexture(Desc);
+        if (pInitData)
+        {
+            // Slice 0, single sample
+            assert(Desc.SampleCount == 1);
+            const UINT RowSize = Desc.Width * pTexture->GetTexelSize();
+            if (!RowPitch) RowPitch = RowSize;
+            for (UINT y = 0; y < Desc.Height; ++y)
+            {
+                memcpy(pTexture->GetTexel(0, y), (const BYTE*)pInitData + (size_t)y * RowPitch, RowSize);
+            }
+        }
+        return pTexture;
+    }
+
+    virtual RHIView* CreateRenderTargetView(RHITexture *pTexture, UINT ArraySlice)
+    {
+        if (!(pTexture->GetDesc().BindFlags & RHI_BIND_RENDER_TARGET)) return NULL;
+        return new RHIView(RHI_VIEW_RENDER_TARGET, pTexture, ArraySlice);
+    }
+
+    virtual RHIView* CreateShaderResourceView(RHITexture *pTexture)
+    {
+        if (!(pTexture->GetDesc().BindFlags & RHI_BIND_SHADER_RESOURCE)) return NULL;
+        return new RHIView(RHI_VIEW_SHADER_RESOURCE, pTexture, RHI_ALL_SLICES);
+    }
+
+    virtual RHIView* CreateDepthStencilView(RHITexture *pTexture)
+    {
+        if (!(pTexture->GetDesc().BindFlags & RHI_BIND_DEPTH_STENCIL) || !IsDepthFormat(pTexture->GetDesc().Format)) return NULL;
+        return new RHIView(RHI_VIEW_DEPTH_STENCIL, pTexture, RHI_ALL_SLICES);
+    }
+
+    virtual RHIBlendState* CreateBlendState(const RHIBlendDesc &Desc)
+    {
+        return new RHIBlendState(Desc);
+    }
+
+    virtual RHIDepthStencilState* CreateDepthStencilState(const RHIDepthStencilDesc &Desc)
+    {
+        return new RHIDepthStencilState(Desc);
+    }
+
+    virtual RHIRasterizerState* CreateRasterizerState(const RHIRasterizerDesc &Desc)
+    {
+        return new RHIRasterizerState(Desc);
+    }
+
+    virtual RHIShader* CreateVertexShader(const void *pBytecode, size_t BytecodeSize)
+    {
+        return new SoftwareShader(RHI_SHADER_VERTEX, pBytecode, BytecodeSize);
+    }
+
+    virtual RHIShader* CreatePixelShader(const void *pBytecode, size_t BytecodeSize)
+    {
+        return new SoftwareShader(RHI_SHADER_PIXEL, pBytecode, BytecodeSize);
+    }
+};
+
+//--------------------------------------------------------------------------------------
+// Counters of a SoftwareContext, accumulated until ResetStats
+//--------------------------------------------------------------------------------------
+struct SoftwareStats
+{
+    UINT NumCommands;
+    UINT NumStateChanges;
+    UINT NumClears;
+    UINT NumResolves;
+    UINT NumDraws;              // Full-screen draws
+    UINT NumMeshDraws;          // CMD_DRAW_MESH commands
+    UINT NumSubsetDraws;        // Subset draws issued by the mesh draws
+    UINT NumHazards;            // Draws reading a texture bound as render target or depth buffer
+    unsigned long long NumClearedBytes;
+    unsigned long long NumMergedSamples;    // Samples of MergePixels that passed the depth test
+
+    SoftwareStats()
+    {
+        memset(this, 0, sizeof(*this));
+    }
+};
+
+//--------------------------------------------------------------------------------------
+// Software context: tracks the bound state, executes the clears and resolves,
+// and checks the draws against the bound state without rasterizing them
+//--------------------------------------------------------------------------------------
+class SoftwareContext : public RHIContext, public CommandSink
+{
+public:
+    SoftwareContext()
+        : m_Alpha(1.f)
+        , m_NumDraws(0)
+        , m_NumOrderedDraws(0)
+        , m_NumOpaqueDraws(0)
+        , m_NumSubmitDraws(0)
+        , m_MarkerDepth(0)
+    {
+        ResetState();
+    }
+
+    // Number of subset draws per mesh draw, in the optimized and authoring triangle orders,
+    // and per mesh draw of MESH_DRAW_LIST_OPAQUE
+    void SetGeometry(UINT NumDraws, UINT NumOrderedDraws, UINT NumOpaqueDraws = 0)
+    {
+        m_NumDraws = NumDraws;
+        m_NumOrderedDraws = NumOrderedDraws;
+        m_NumOpaqueDraws = NumOpaqueDraws;
+    }
+
+    virtual void UploadConstants(const void *pData, UINT Size, float Alpha)
+    {
+        m_Constants.assign((const BYTE*)pData, (const BYTE*)pData + Size);
+        m_Alpha = Alpha;
+    }
+
+    // Like a D3D11 immediate context, the state is kept from one submission to the next
+    virtual void Submit(const CommandList &Commands, bool PreserveTriangleOrder)
+    {
+        m_NumSubmitDraws = PreserveTriangleOrder ? m_NumOrderedDraws : m_NumDraws;
+        Commands.Replay(*this);
+        assert(m_MarkerDepth == 0);
+    }
+
+    virtual void Execute(const Command &Cmd)
+    {
+        ++m_Stats.NumCommands;
+        if (CommandList::IsStateCommand(Cmd.Type))
+        {
+            ++m_Stats.NumStateChanges;
+        }
+
+        switch (Cmd.Type)
+        {
+        case CMD_SET_VERTEX_SHADER:
+            m_pVS = (RHIShader*)Cmd.pObject;
+            break;
+        case CMD_SET_PIXEL_SHADER:
+            m_pPS = (RHIShader*)Cmd.pObject;
+            break;
+        case CMD_SET_RASTERIZER_STATE:
+            m_pRS = (RHIRasterizerState*)Cmd.pObject;
+            break;
+        case CMD_SET_BLEND_STATE:
+            m_pBS = (RHIBlendState*)Cmd.pObject;
+            memcpy(m_BlendFactor, Cmd.Values, sizeof(m_BlendFactor));
+            m_SampleMask = Cmd.Value;
+            break;
+        case CMD_SET_DEPTH_STENCIL_STATE:
+            m_pDSS = (RHIDepthStencilState*)Cmd.pObject;
+            break;
+        case CMD_SET_RENDER_TARGETS:
+            for (UINT i = 0; i < RHI_MAX_RENDER_TARGETS; ++i)
+            {
+                m_pRTVs[i] = (i < Cmd.Count) ? (RHIView*)Cmd.pObjects[i] : NULL;
+            }
+            m_NumRTVs = Cmd.Count;
+            m_pDSV = (RHIView*)Cmd.pObject;
+            break;
+        case CMD_SET_VS_RESOURCES:
+            for (UINT i = 0; i < Cmd.Count; ++i)
+            {
+                assert(Cmd.Slot + i < SOFTWARE_MAX_SRVS);
+                m_pVSSRVs[Cmd.Slot + i] = (RHIView*)Cmd.pObjects[i];
+            }
+            break;
+        case CMD_SET_PS_RESOURCES:
+            for (UINT i = 0; i < Cmd.Count; ++i)
+            {
+                assert(Cmd.Slot + i < SOFTWARE_MAX_SRVS);
+                m_pSRVs[Cmd.Slot + i] = (RHIView*)Cmd.pObjects[i];
+            }
+            break;
+        case CMD_CLEAR_RENDER_TARGET:
+            Clear((RHIView*)Cmd.pObject, Cmd.Values);
+            break;
+        case CMD_CLEAR_DEPTH:
+            Clear((RHIView*)Cmd.pObject, Cmd.Values);
+            break;
+        case CMD_DRAW:
+            ValidateDraw();
+            ++m_Stats.NumDraws;
+            break;
+        case CMD_RESOLVE:
+            Resolve((SoftwareTexture*)Cmd.pObject, (const SoftwareTexture*)Cmd.pObjects[0]);
+            break;
+        case CMD_BEGIN_EVENT:
+            ++m_MarkerDepth;
+            break;
+        case CMD_END_EVENT:
+            assert(m_MarkerDepth > 0);
+            --m_MarkerDepth;
+            break;
+        case CMD_BIND_FRAME_CONSTANTS:
+            break;
+        case CMD_DRAW_MESH:
+            ValidateDraw();
+            ++m_Stats.NumMeshDraws;
+            m_Stats.NumSubsetDraws += (Cmd.Slot == MESH_DRAW_LIST_OPAQUE) ? m_NumOpaqueDraws : m_NumSubmitDraws;
+            break;
+        }
+    }
+
+    void ResetState()
+    {
+        m_pVS = NULL;
+        m_pPS = NULL;
+        m_pRS = NULL;
+        m_pBS = NULL;
+        m_pDSS = NULL;
+        m_BlendFactor[0] = m_BlendFactor[1] = m_BlendFactor[2] = m_BlendFactor[3] = 1.f;
+        m_SampleMask = 0xFFFFFFFF;
+        m_NumRTVs = 0;
+        m_pDSV = NULL;
+        memset(m_pRTVs, 0, sizeof(m_pRTVs));
+        memset(m_pVSSRVs, 0, sizeof(m_pVSSRVs));
+        memset(m_pSRVs, 0, sizeof(m_pSRVs));
+    }
+
+    // Depth test and blending of shaded pixels, with the bound state
+    void MergePixels(const SoftwarePixelBatch &Batch)
+    {
+        static const RHIBlendDesc DefaultBlendDesc;
+        static const RHIDepthStencilDesc DefaultDepthStencilDesc;
+
+        SoftwareOutputState State;
+        State.pBlendDesc = m_pBS ? &m_pBS->GetDesc() : &DefaultBlendDesc;
+        State.SampleMask = m_SampleMask;
+        State.pDepthStencilDesc = m_pDSS ? &m_pDSS->GetDesc() : &DefaultDepthStencilDesc;
+        State.ppRTVs = m_pRTVs;
+        State.NumRTVs = m_NumRTVs;
+        State.pDSV = m_pDSV;
+        m_Stats.NumMergedSamples += ::MergePixels(State, Batch);
+    }
+
+    const SoftwareStats& GetStats() const { return m_Stats; }
+    void ResetStats() { m_Stats = SoftwareStats(); }
+
+    const std::vector<BYTE>& GetConstants() const { return m_Constants; }
+    float GetAlpha() const { return m_Alpha; }
+
+protected:
+    void Clear(RHIView *pView, const float Color[4])
+    {
+        if (!pView) return;
+        SoftwareTexture *pTexture = (SoftwareTexture*)pView->GetTexture();
+        pTexture->Fill(pView->GetArraySlice(), Color);
+
+        const RHITextureDesc &Desc = pTexture->GetDesc();
+        const UINT NumSlices = (pView->GetArraySlice() == RHI_ALL_SLICES) ? Desc.ArraySize : 1;
+        ++m_Stats.NumClears;
+        m_Stats.NumClearedBytes += (unsigned long long)Desc.Width * Desc.Height * Desc.SampleCount * NumSlices * pTexture->GetTexelSize();
+    }
+
+    // Box filter over the samples of slice 0, as ResolveSubresource
+    void Resolve(SoftwareTexture *pDst, const SoftwareTexture *pSrc)
+    {
+        const RHITextureDesc &Desc = pSrc->GetDesc();
+        assert(pDst->GetDesc().Width == Desc.Width && pDst->GetDesc().Height == Desc.Height);
+        assert(pDst->GetDesc().SampleCount == 1);
+
+        const float Scale = 1.f / (float)Desc.SampleCount;
+        for (UINT y = 0; y < Desc.Height; ++y)
+        {
+            for (UINT x = 0; x < Desc.Width; ++x)
+            {
+                float Sum[4] = { 0.f, 0.f, 0.f, 0.f };
+                for (UINT Sample = 0; Sample < Desc.SampleCount; ++Sample)
+                {
+                    float Color[4];
+                    pSrc->Read(x, y, Sample, 0, Color);
+                    for (int i = 0; i < 4; ++i) Sum[i] += Color[i];
+                }
+                for (int i = 0; i < 4; ++i) Sum[i] *= Scale;
+                pDst->Write(x, y, 0, 0, Sum);
+            }
+        }
+        ++m_Stats.NumResolves;
+    }
+
+    // D3D11 unbinds the shader resources that are also bound for output
+    void ValidateDraw()
+    {
+        assert(m_pPS || m_NumRTVs == 0);
+        for (UINT Slot = 0; Slot < 2 * SOFTWARE_MAX_SRVS; ++Slot)
+        {
+            const RHIView *pSRV = (Slot < SOFTWARE_MAX_SRVS) ? m_pVSSRVs[Slot] : m_pSRVs[Slot - SOFTWARE_MAX_SRVS];
+            if (!pSRV) continue;
+
+            const RHITexture *pTexture = pSRV->GetTexture();
+            bool IsHazard = (m_pDSV && m_pDSV->GetTexture() == pTexture);
+            for (UINT i = 0; i < m_NumRTVs; ++i)
+            {
+                IsHazard = IsHazard || (m_pRTVs[i] && m_pRTVs[i]->GetTexture() == pTexture);
+            }
+            if (IsHazard)
+            {
+                ++m_Stats.NumHazards;
+            }
+        }
+    }
+
+    RHIShader *m_pVS;
+    RHIShader *m_pPS;
+    RHIRasterizerState *m_pRS;
+    RHIBlendState *m_pBS;
+    RHIDepthStencilState *m_pDSS;
+    float m_BlendFactor[4];
+    UINT m_SampleMask;
+    RHIView *m_pRTVs[RHI_MAX_RENDER_TARGETS];
+    UINT m_NumRTVs;
+    RHIView *m_pDSV;
+    RHIView *m_pVSSRVs[SOFTWARE_MAX_SRVS];
+    RHIView *m_pSRVs[SOFTWARE_MAX_SRVS];
+
+    std::vector<BYTE> m_Constants;
+    float m_Alpha;
+    UINT m_NumDraws;
+    UINT m_NumOrderedDraws;
+    UINT m_NumOpaqueDraws;
+    UINT m_NumSubmitDraws;
+    UINT m_MarkerDepth;
+    SoftwareStats m_Stats;
+};
@@ -1,37 +1,383 @@
-// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
-//
-// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
-// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
-// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
-// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA 
-// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR  
-// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS 
-// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY 
-// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE, 
-// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
-//
-// Please direct any bugs or questions to SDKFeedback@nvidia.com
-
-#pragma once
-
-#include "SDKmesh.h"
-
-#define MAX_PATH_STR 512
-
-class Scene
-{
-public:
-    static void CreateMesh(ID3D11Device* pd3dDevice)
-    {
-        HRESULT hr;
-        V( m_Mesh.Create(pd3dDevice, L"..\\Media\\StochasticTransparency\\motor.sdkmesh") );
-    }
-
-    static void ReleaseMesh()
-    {
-        m_Mesh.Destroy();
-    }
-
-protected:
-    static CDXUTSDKMesh m_Mesh;
-};
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA 
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR  
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS 
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY 
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE, 
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+#pragma once
+
+#include "SDKmesh.h"
+#include "CompactMesh.h"
+#include "Meshlets.h"
+#include "Instances.h"
+#include "HiZ.h"
+#include <chrono>
+
+#define MAX_PATH_STR 512
+
+// With opaque subsets enabled, one subset out of OPAQUE_SUBSET_STRIDE is drawn as opaque geometry
+#define OPAQUE_SUBSET_STRIDE 4
+
+// Frames between the copy of the opaque depth and its read on the CPU
+#define HIZ_READBACK_LATENCY 3
+
+//--------------------------------------------------------------------------------------
+// Copies the opaque depth of every frame to a staging texture, and builds the Hi-Z pyramid
+// from the oldest copy once the GPU is done with it, without stalling. Each copy is tagged
+// with the version of the transforms it was rendered with: the pyramid is only used for
+// culling while the view does not change, so that the late depth never removes visible
+// geometry. The culled geometry does not change the depth it is tested against, as the
+// nearest depth of a box is never behind the surfaces inside of it.
+//--------------------------------------------------------------------------------------
+class HiZReadback
+{
+public:
+    HiZReadback()
+        : m_NextSlot(0)
+        , m_Version(~0U)
+        , m_BuildTime(0.0)
+    {
+        for (UINT i = 0; i < HIZ_READBACK_LATENCY; ++i)
+        {
+            m_Slots[i].pStaging = NULL;
+            m_Slots[i].Version = ~0U;
+            m_Slots[i].Pending = false;
+        }
+    }
+
+    ~HiZReadback()
+    {
+        Destroy();
+    }
+
+    void Destroy()
+    {
+        for (UINT i = 0; i < HIZ_READBACK_LATENCY; ++i)
+        {
+            SAFE_RELEASE(m_Slots[i].pStaging);
+            m_Slots[i].Pending = false;
+        }
+        m_HiZ.Clear();
+        m_Version = ~0U;
+    }
+
+    // Drops the pyramid and the copies in flight, when the opaque geometry changed
+    void Invalidate()
+    {
+        for (UINT i = 0; i < HIZ_READBACK_LATENCY; ++i)
+        {
+            m_Slots[i].Pending = false;
+        }
+        if (!m_HiZ.IsEmpty()) m_HiZ.Clear();
+        m_Version = ~0U;
+    }
+
+    // Called after the frame is rendered, with a single-sampled D32_FLOAT depth buffer
+    void Copy(ID3D11DeviceContext* pd3dImmediateContext, ID3D11Texture2D *pDepth, UINT Version)
+    {
+        HRESULT hr;
+
+        D3D11_TEXTURE2D_DESC Desc;
+        pDepth->GetDesc(&Desc);
+        assert(Desc.SampleDesc.Count == 1);
+
+        Slot &Copy = m_Slots[m_NextSlot];
+        if (Copy.pStaging)
+        {
+            D3D11_TEXTURE2D_DESC StagingDesc;
+            Copy.pStaging->GetDesc(&StagingDesc);
+            if (StagingDesc.Width != Desc.Width || StagingDesc.Height != Desc.Height) SAFE_RELEASE(Copy.pStaging);
+        }
+        if (!Copy.pStaging)
+        {
+            Desc.Usage = D3D11_USAGE_STAGING;
+            Desc.BindFlags = 0;
+            Desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+            Desc.MiscFlags = 0;
+
+            ID3D11Device *pd3dDevice = NULL;
+            pd3dImmediateContext->GetDevice(&pd3dDevice);
+            hr = pd3dDevice->CreateTexture2D(&Desc, NULL, &Copy.pStaging);
+            SAFE_RELEASE(pd3dDevice);
+            if (FAILED(hr)) return;
+        }
+
+        pd3dImmediateContext->CopyResource(Copy.pStaging, pDepth);
+        Copy.Version = Version;
+        Copy.Pending = true;
+        m_NextSlot = (m_NextSlot + 1) % HIZ_READBACK_LATENCY;
+    }
+
+    // Called once per frame before the culling. Builds the pyramid from the oldest copy
+    // if the GPU is done with it, otherwise keeps the previous one.
+    void Update(ID3D11DeviceContext* pd3dImmediateContext)
+    {
+        Slot &Copy = m_Slots[m_NextSlot];
+        if (!Copy.Pending) return;
+
+        D3D11_MAPPED_SUBRESOURCE Mapped;
+        if (pd3dImmediateContext->Map(Copy.pStaging, 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &Mapped) != S_OK) return;
+
+        D3D11_TEXTURE2D_DESC Desc;
+        Copy.pStaging->GetDesc(&Desc);
+
+        const std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+        m_HiZ.Build((const float*)Mapped.pData, Desc.Width, Desc.Height, Mapped.RowPitch);
+        const std::chrono::duration<double> Elapsed = std::chrono::high_resolution_clock::now() - Start;
+        m_BuildTime = Elapsed.count();
+
+        pd3dImmediateContext->Unmap(Copy.pStaging, 0);
+        Copy.Pending = false;
+        m_Version = Copy.Version;
+    }
+
+    // The pyramid, if it was rendered with the given version of the transforms
+    const HiZPyramid* GetHiZ(UINT Version) const
+    {
+        return (!m_HiZ.IsEmpty() && Version == m_Version) ? &m_HiZ : NULL;
+    }
+
+    const HiZPyramid& GetPyramid() const { return m_HiZ; }
+
+    // Seconds spent in the last Build
+    double GetBuildTime() const { return m_BuildTime; }
+
+protected:
+    struct Slot
+    {
+        ID3D11Texture2D *pStaging;
+        UINT Version;
+        bool Pending;
+    };
+
+    Slot m_Slots[HIZ_READBACK_LATENCY];
+    UINT m_NextSlot;
+    HiZPyramid m_HiZ;
+    UINT m_Version;
+    double m_BuildTime;
+};
+
+class Scene
+{
+public:
+    static void CreateMesh(ID3D11Device* pd3dDevice)
+    {
+        HRESULT hr;
+        V( m_Mesh.Create(pd3dDevice, L"..\\Media\\StochasticTransparency\\motor.sdkmesh") );
+        V( m_CompactMesh.Create(pd3dDevice, m_Mesh) );
+        V( m_MeshletCuller.Create(pd3dDevice, m_CompactMesh) );
+        V( m_Instances.Create(pd3dDevice, m_CompactMesh.GetPositionBias(), m_CompactMesh.GetPositionScale()) );
+    }
+
+    static void ReleaseMesh()
+    {
+        m_HiZReadback.Destroy();
+        m_Instances.Destroy();
+        m_MeshletCuller.Destroy();
+        m_CompactMesh.Destroy();
+        m_Mesh.Destroy();
+    }
+
+    static const CompactMesh& GetCompactMesh()
+    {
+        return m_CompactMesh;
+    }
+
+    // Called once per frame, before the techniques render.
+    // Also computes the depth range of the visible meshlets, even if culling is disabled.
+    static void CullMeshlets(ID3D11DeviceContext* pd3dImmediateContext, TransformState &Transforms)
+    {
+        m_HiZReadback.Update(pd3dImmediateContext);
+        const HiZPyramid *pHiZ = m_EnableOcclusionCulling ?
+            m_HiZReadback.GetHiZ(Transforms.GetVersion(TRANSFORM_WORLD_VIEW_PROJ)) : NULL;
+
+        if (m_Instances.GetNumInstances() > 1)
+        {
+            m_Instances.Cull(Transforms, pHiZ);
+        }
+        else
+        {
+            m_MeshletCuller.Cull(pd3dImmediateContext, m_CompactMesh, Transforms, pHiZ);
+        }
+    }
+
+    // Called once per frame after the techniques rendered, with their opaque depth
+    // (single-sampled D32_FLOAT) and the version of the transforms of the frame
+    static void CopyOpaqueDepth(ID3D11DeviceContext* pd3dImmediateContext, ID3D11Texture2D *pDepth, UINT Version)
+    {
+        if (m_EnableOcclusionCulling)
+        {
+            m_HiZReadback.Copy(pd3dImmediateContext, pDepth, Version);
+        }
+    }
+
+    // Called once per frame after CullMeshlets, with the final projection
+    static void UpdateInstances(ID3D11DeviceContext* pd3dImmediateContext, TransformState &Transforms)
+    {
+        if (m_Instances.GetNumInstances() > 1)
+        {
+            m_Instances.Update(pd3dImmediateContext, Transforms);
+        }
+    }
+
+    // View-space depth range of the visible instances or meshlets
+    static bool GetDepthRange(float &MinDepth, float &MaxDepth)
+    {
+        if (m_Instances.GetNumInstances() > 1)
+        {
+            return m_Instances.GetDepthRange(MinDepth, MaxDepth);
+        }
+        return m_MeshletCuller.GetDepthRange(MinDepth, MaxDepth);
+    }
+
+    static InstanceBuffer& GetInstances()
+    {
+        return m_Instances;
+    }
+
+    // The instances hide each other
+    static void SetInstanceGridSize(UINT GridSize)
+    {
+        if (GridSize != m_Instances.GetGridSize())
+        {
+            m_Instances.SetGridSize(GridSize);
+            m_HiZReadback.Invalidate();
+        }
+    }
+
+    static MeshletCuller& GetMeshletCuller()
+    {
+        return m_MeshletCuller;
+    }
+
+    static void SetClusterCulling(bool Enable)
+    {
+        m_EnableClusterCulling = Enable;
+    }
+
+    static bool GetClusterCulling()
+    {
+        return m_EnableClusterCulling;
+    }
+
+    static void SetOpaqueSubsets(bool Enable)
+    {
+        if (Enable != m_EnableOpaqueSubsets)
+        {
+            m_EnableOpaqueSubsets = Enable;
+            m_HiZReadback.Invalidate();
+        }
+    }
+
+    static bool GetOpaqueSubsets()
+    {
+        return m_EnableOpaqueSubsets;
+    }
+
+    // Culls the meshlets or instances hidden by the opaque subsets, with a Hi-Z pyramid of
+    // the opaque depth of a previous frame rendered from the same view
+    static void SetOcclusionCulling(bool Enable)
+    {
+        if (Enable != m_EnableOcclusionCulling)
+        {
+            m_EnableOcclusionCulling = Enable;
+            m_HiZReadback.Invalidate();
+        }
+    }
+
+    static bool GetOcclusionCulling()
+    {
+        return m_EnableOcclusionCulling;
+    }
+
+    static HiZReadback& GetHiZReadback()
+    {
+        return m_HiZReadback;
+    }
+
+    static bool IsOpaqueSubset(UINT SubsetId)
+    {
+        return m_EnableOpaqueSubsets && (SubsetId % OPAQUE_SUBSET_STRIDE) == 0;
+    }
+
+    // Called once per frame after CullMeshlets.
+    // Splits the draw lists of the frame into their transparent and opaque subsets.
+    static void SplitDrawLists()
+    {
+        m_OpaqueDrawList.Draws.clear();
+        if (!m_EnableOpaqueSubsets) return;
+
+        for (int Ordered = 0; Ordered < 2; ++Ordered)
+        {
+            const MeshDrawList &DrawList = GetFullDrawList(Ordered != 0);
+            MeshDrawList &TransparentDrawList = m_TransparentDrawLists[Ordered];
+            TransparentDrawList.pIB = DrawList.pIB;
+            TransparentDrawList.IBFormat = DrawList.IBFormat;
+            TransparentDrawList.Draws.clear();
+
+            for (size_t DrawId = 0; DrawId < DrawList.Draws.size(); ++DrawId)
+            {
+                const SubsetDraw &Draw = DrawList.Draws[DrawId];
+                if (!IsOpaqueSubset(Draw.SubsetId))
+                {
+                    TransparentDrawList.Draws.push_back(Draw);
+                }
+                else if (!Ordered)
+                {
+                    // The opaque geometry does not depend on the draw order
+                    m_OpaqueDrawList.Draws.push_back(Draw);
+                }
+            }
+        }
+        m_OpaqueDrawList.pIB = m_TransparentDrawLists[0].pIB;
+        m_OpaqueDrawList.IBFormat = m_TransparentDrawLists[0].IBFormat;
+    }
+
+    // Transparent subsets of the frame
+    static const MeshDrawList& GetDrawList(bool PreserveTriangleOrder)
+    {
+        if (m_EnableOpaqueSubsets)
+        {
+            return m_TransparentDrawLists[PreserveTriangleOrder ? 1 : 0];
+        }
+        return GetFullDrawList(PreserveTriangleOrder);
+    }
+
+    // Opaque subsets of the frame, empty unless opaque subsets are enabled
+    static const MeshDrawList& GetOpaqueDrawList()
+    {
+        return m_OpaqueDrawList;
+    }
+
+protected:
+    // The culled draw list is in the cache-optimized triangle order,
+    // so order-dependent techniques always draw the whole mesh.
+    // The meshlets are culled in model space, so only for a single instance.
+    static const MeshDrawList& GetFullDrawList(bool PreserveTriangleOrder)
+    {
+        if (m_EnableClusterCulling && !PreserveTriangleOrder && m_Instances.GetNumInstances() == 1)
+        {
+            return m_MeshletCuller.GetDrawList();
+        }
+        return m_CompactMesh.GetDrawList(PreserveTriangleOrder);
+    }
+
+    static CDXUTSDKMesh m_Mesh;
+    static CompactMesh m_CompactMesh;
+    static MeshletCuller m_MeshletCuller;
+    static InstanceBuffer m_Instances;
+    static bool m_EnableClusterCulling;
+    static bool m_EnableOpaqueSubsets;
+    static bool m_EnableOcclusionCulling;
+    static HiZReadback m_HiZReadback;
+    static MeshDrawList m_TransparentDrawLists[2];     // Optimized and authoring triangle orders
+    static MeshDrawList m_OpaqueDrawList;
+};
@@ -0,0 +1,118 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA 
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR  
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS 
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY 
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE, 
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+
+#include "DXUT.h"
+
+#define MAX_STAGING_READBACK_LATENCY 4
+
+// Reads the mapped copy of a StagingReadback, with the Tag given to the ReadBack call that made it
+typedef void (*StagingDecodeFunction)(const BYTE *pData, UINT RowPitch, UINT Width, UINT Height, UINT Tag);
+
+//--------------------------------------------------------------------------------------
+// Reads a GPU texture back without stalling: every call copies the texture to the next
+// of Latency staging textures, after decoding the copy made Latency calls earlier in
+// the same texture. The call is skipped if the GPU is not done with that copy.
+//--------------------------------------------------------------------------------------
+class StagingReadback
+{
+public:
+    StagingReadback(UINT Latency)
+        : m_Latency(Latency)
+        , m_Next(0)
+    {
+        assert(Latency > 0 && Latency <= MAX_STAGING_READBACK_LATENCY);
+        for (UINT i = 0; i < MAX_STAGING_READBACK_LATENCY; ++i)
+        {
+            m_pStaging[i] = NULL;
+            m_Tags[i] = 0;
+        }
+    }
+
+    ~StagingReadback()
+    {
+        Destroy();
+    }
+
+    void Destroy()
+    {
+        for (UINT i = 0; i < m_Latency; ++i)
+        {
+            SAFE_RELEASE(m_pStaging[i]);
+        }
+        Invalidate();
+    }
+
+    // Drops the copies that are not decoded yet
+    void Invalidate()
+    {
+        for (UINT i = 0; i < m_Latency; ++i)
+        {
+            m_Tags[i] = 0;
+        }
+    }
+
+    // Tag is passed to pDecode with the copy, and must not be 0
+    void ReadBack(ID3D11DeviceContext* pd3dImmediateContext, ID3D11Texture2D *pSource, UINT Tag, StagingDecodeFunction pDecode)
+    {
+        HRESULT hr;
+        assert(Tag != 0);
+
+        ID3D11Texture2D *&pStaging = m_pStaging[m_Next];
+        UINT &PendingTag = m_Tags[m_Next];
+
+        D3D11_TEXTURE2D_DESC Desc;
+        pSource->GetDesc(&Desc);
+
+        if (PendingTag)
+        {
+            D3D11_MAPPED_SUBRESOURCE Mapped;
+            if (pd3dImmediateContext->Map(pStaging, 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &Mapped) != S_OK) return;
+
+            D3D11_TEXTURE2D_DESC StagingDesc;
+            pStaging->GetDesc(&StagingDesc);
+            pDecode((const BYTE*)Mapped.pData, Mapped.RowPitch, StagingDesc.Width, StagingDesc.Height, PendingTag);
+            pd3dImmediateContext->Unmap(pStaging, 0);
+            PendingTag = 0;
+
+            if (StagingDesc.Width != Desc.Width || StagingDesc.Height != Desc.Height) SAFE_RELEASE(pStaging);
+        }
+
+        if (!pStaging)
+        {
+            Desc.Usage = D3D11_USAGE_STAGING;
+            Desc.BindFlags = 0;
+            Desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+            Desc.MiscFlags = 0;
+
+            ID3D11Device *pd3dDevice = NULL;
+            pd3dImmediateContext->GetDevice(&pd3dDevice);
+            hr = pd3dDevice->CreateTexture2D(&Desc, NULL, &pStaging);
+            SAFE_RELEASE(pd3dDevice);
+            if (FAILED(hr)) return;
+        }
+
+        pd3dImmediateContext->CopyResource(pStaging, pSource);
+        PendingTag = Tag;
+        m_Next = (m_Next + 1) % m_Latency;
+    }
+
+protected:
+    ID3D11Texture2D *m_pStaging[MAX_STAGING_READBACK_LATENCY];
+    UINT m_Tags[MAX_STAGING_READBACK_LATENCY];      // Of the pending copies, 0 if none
+    UINT m_Latency;
+    UINT m_Next;
+};
@@ -1,444 +1,958 @@
-// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
-//
-// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
-// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
-// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
-// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA 
-// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR  
-// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS 
-// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY 
-// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE, 
-// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
-//
-// Please direct any bugs or questions to SDKFeedback@nvidia.com
-
-#pragma once
-#include "SimpleRT.h"
-#include "BaseTechnique.h"
-#include "Scene.h"
-#include "MersenneTwister.h"
-#include <algorithm>
-
-#include "StochasticTransparency_StochasticDepthPS.h"
-#include "StochasticTransparency_AccumulateAndTotalAlphaPS.h"
-#include "StochasticTransparency_CompositePS.h"
-
-#define RANDOM_SIZE 2048
-#define ALPHA_VALUES 256
-#define NUM_MSAA_SAMPLES 8
-#define MAX_NUM_PASSES 8
-
-//The AccumulationBuffer may not be MSAA
-#define STOCHASTIC_COLOR_FORMAT DXGI_FORMAT_R8G8B8A8_UNORM
-
-// Consists of a depth-stencil buffer //Texture2D //D24_UNORM_S8_UINT or D32_FLOAT
-// and the associated depth-stencil view for binding.
-class StochasticDepth
-{
-public:
-	ID3D11Texture2D *pTexture;
-	ID3D11DepthStencilView *pDSV;
-	ID3D11ShaderResourceView *pSRV;
-
-	StochasticDepth(ID3D11Device* pd3dDevice, UINT Width, UINT Height)
-		: pTexture(NULL)
-		, pDSV(NULL)
-		, pSRV(NULL)
-	{
-		HRESULT hr;
-		D3D11_TEXTURE2D_DESC texDesc;
-		texDesc.ArraySize = 1;
-		texDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
-		texDesc.CPUAccessFlags = NULL;
-		texDesc.Format = DXGI_FORMAT_R32_TYPELESS;
-		texDesc.Width = Width;
-		texDesc.Height = Height;
-		texDesc.MipLevels = 1;
-		texDesc.MiscFlags = NULL;
-		texDesc.SampleDesc.Count = NUM_MSAA_SAMPLES;
-		texDesc.SampleDesc.Quality = 0;
-		texDesc.Usage = D3D11_USAGE_DEFAULT;
-		V(pd3dDevice->CreateTexture2D(&texDesc, NULL, &pTexture));
-		D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
-		dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
-		dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DMS;
-		dsvDesc.Flags = 0U;
-		//dsvDesc.Texture2DMS.UnusedField_NothingToDefine
-		V(pd3dDevice->CreateDepthStencilView(pTexture, &dsvDesc, &pDSV));
-		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
-		srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
-		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DMS;
-		//srvDesc.Texture2DMS.UnusedField_NothingToDefine
-		V(pd3dDevice->CreateShaderResourceView(pTexture, &srvDesc, &pSRV));
-	}
-
-	~StochasticDepth()
-	{
-		SAFE_RELEASE(pTexture);
-		SAFE_RELEASE(pDSV);
-		SAFE_RELEASE(pSRV);
-	}
-};
-
-class StochasticTransparency : public BaseTechnique, public Scene
-{
-public:
-    StochasticTransparency(ID3D11Device* pd3dDevice, UINT Width, UINT Height)
-        : BaseTechnique(pd3dDevice)
-        , m_pBackgroundRenderTarget(NULL)
-        , m_pBackgroundDepth(NULL)
-		, m_pStochasticColorAndCorrectTotalAlphaRenderTarget(NULL)
-		, m_pStochasticTotalAlphaRenderTarget(NULL)
-		, m_pStochasticDepth(NULL)
-		, m_pStochasticDepthPS(NULL)
-		, m_pTotalAlphaAndAccumulatePS(NULL)
-		, m_pCompositePS(NULL)
-        , m_pRndTexture(NULL)
-        , m_pRndTextureSRV(NULL)
-        , m_pTotalAlphaAndAccumulateBS(NULL)
-    {
-		CreateFrameBuffer(pd3dDevice, Width, Height);
-		CreateStochasticDepth(pd3dDevice, Width, Height);
-        CreateRandomBitmasks(pd3dDevice);
-        CreateBlendStates(pd3dDevice);
-        CreateShaders(pd3dDevice);
-        CBData.randMaskSizePowOf2MinusOne = RANDOM_SIZE - 1;
-        CBData.randMaskAlphaValues = ALPHA_VALUES;
-    }
-
-    virtual void Render(ID3D11DeviceContext* pd3dImmediateContext, ID3D11RenderTargetView *pBackBuffer)
-    {
-		ID3DUserDefinedAnnotation *pPerf;
-		pd3dImmediateContext->QueryInterface(IID_PPV_ARGS(&pPerf));
-
-		//The BackgroudColor may not be MSAA
-		
-		//----------------------------------------------------------------------------------
-		// 1. Render Opaque Background
-		//----------------------------------------------------------------------------------
-        //The background colors should be initialized by drawing the opaque objects in the scene.
-		pPerf->BeginEvent(L"Opaque Pass");
-		float ClearColorBack[4] = { m_BackgroundColor.x, m_BackgroundColor.y, m_BackgroundColor.z, 0 };
-		pd3dImmediateContext->ClearRenderTargetView(m_pBackgroundRenderTarget->pRTV, ClearColorBack);
-		float ClearDepthBack = 1.0f;
-		pd3dImmediateContext->ClearDepthStencilView(m_pBackgroundDepth->pDSV, D3D11_CLEAR_DEPTH, ClearDepthBack, 0U);
-		pPerf->EndEvent();
-
-        // Update the constant buffer
-        pd3dImmediateContext->UpdateSubresource(m_pParamsCB, 0, NULL, &CBData, 0, 0);
-
-        // Set shared states
-        pd3dImmediateContext->IASetInputLayout(m_pInputLayout);
-        pd3dImmediateContext->VSSetShader(m_pGeometryVS, NULL, 0);
-        pd3dImmediateContext->GSSetShader(NULL, NULL, 0);
-        pd3dImmediateContext->RSSetState(m_pNoCullRS);
-        pd3dImmediateContext->VSSetConstantBuffers(0, 1, &m_pParamsCB);
-        pd3dImmediateContext->PSSetConstantBuffers(0, 1, &m_pParamsCB);
-        pd3dImmediateContext->PSSetConstantBuffers(1, 1, &m_pShadingParamsCB);
-
-		//By the limit of the hardware, the maximum sample count of MSAA is 8X MSAA.
-		//The author proposed that we can use multiple passes to simulate more sample counts.
-		//Due to the performance issue, we only use one pass.
-        //for (UINT LayerId = 0; LayerId < m_NumPasses; ++LayerId)
-        {
-			CBData.randomOffset = 0;
-            pd3dImmediateContext->UpdateSubresource(m_pParamsCB, 0, NULL, &CBData, 0, 0);
-
-            //----------------------------------------------------------------------------------
-            // 2. Render MSAA "stochastic depths", writting SV_Coverage in the pixel shader
-            //----------------------------------------------------------------------------------
-			pPerf->BeginEvent(L"Stochastic Depth Pass");
-
-            //In Application, We Should Copy From Background Depth To Stochastic Depth
-            //We Simplify This In The Sample.
-            pd3dImmediateContext->ClearDepthStencilView(m_pStochasticDepth->pDSV, D3D11_CLEAR_DEPTH, 1.0, 0);
-
-            pd3dImmediateContext->OMSetRenderTargets(0, NULL, m_pStochasticDepth->pDSV);
-            pd3dImmediateContext->OMSetBlendState(m_pNoBlendBS, m_BlendFactor, 0XFFFFFFFF);
-            pd3dImmediateContext->OMSetDepthStencilState(m_pDepthNoStencilDS, 0);
-
-            pd3dImmediateContext->PSSetShader(m_pStochasticDepthPS, NULL, 0);
-            pd3dImmediateContext->PSSetShaderResources(0, 1, &m_pRndTextureSRV);
-
-            DrawMesh(pd3dImmediateContext, m_Mesh);
-
-			pPerf->EndEvent();
-
-            //----------------------------------------------------------------------------------
-            // 3. We Merge TotalAlpha And Accumulate Together
-            //----------------------------------------------------------------------------------
-			pPerf->BeginEvent(L"TotalAlpha And Accumulate Pass");
-
-            float ClearStochasticColorAndCorrectTotalAlpha[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
-            pd3dImmediateContext->ClearRenderTargetView(m_pStochasticColorAndCorrectTotalAlphaRenderTarget->pRTV, ClearStochasticColorAndCorrectTotalAlpha);
-
-            float ClearStochasticTotalAlpha[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-            pd3dImmediateContext->ClearRenderTargetView(m_pStochasticTotalAlphaRenderTarget->pRTV, ClearStochasticTotalAlpha);
-
-			//UnBind Stochastic Depth
-			//DSV->SRV
-            ID3D11RenderTargetView *pRTVs[2] =
-            {
-            	m_pStochasticColorAndCorrectTotalAlphaRenderTarget->pRTV,
-            	m_pStochasticTotalAlphaRenderTarget->pRTV
-            };
-            pd3dImmediateContext->OMSetRenderTargets(2, pRTVs, m_pBackgroundDepth->pDSV);
-
-			pd3dImmediateContext->OMSetBlendState(m_pTotalAlphaAndAccumulateBS, m_BlendFactor, 0xffffffff);
-            pd3dImmediateContext->OMSetDepthStencilState(m_pDepthNoWriteDS, 0);
-
-			pd3dImmediateContext->PSSetShader(m_pTotalAlphaAndAccumulatePS, NULL, 0);
-
-			ID3D11ShaderResourceView *pSRVs[1] =
-			{
-				m_pStochasticDepth->pSRV
-			};
-			pd3dImmediateContext->PSSetShaderResources(0, 1, pSRVs);
-
-
-            DrawMesh(pd3dImmediateContext, m_Mesh);
-
-			pPerf->EndEvent();
-        }
-
-        //----------------------------------------------------------------------------------
-        // 5. Final full-screen pass, blending the transparent colors over the background
-        //----------------------------------------------------------------------------------
-		pPerf->BeginEvent(L"Composite Pass"); //Total Alpha Correction And Under Operator
-
-        pd3dImmediateContext->OMSetRenderTargets(1, &pBackBuffer, NULL);
-        pd3dImmediateContext->OMSetDepthStencilState(m_pNoDepthNoStencilDS, 0);
-        pd3dImmediateContext->OMSetBlendState(m_pNoBlendBS, m_BlendFactor, 0xffffffff);
-
-        pd3dImmediateContext->VSSetShader(m_pFullScreenTriangleVS, NULL, 0);
-        pd3dImmediateContext->PSSetShader(m_pCompositePS, NULL, 0);
-
-		ID3D11ShaderResourceView *pSRVs[3] =
-		{
-			m_pBackgroundRenderTarget->pSRV,
-			m_pStochasticColorAndCorrectTotalAlphaRenderTarget->pSRV,
-			m_pStochasticTotalAlphaRenderTarget->pSRV
-		};
-        pd3dImmediateContext->PSSetShaderResources(0, 3, pSRVs);
-
-        pd3dImmediateContext->Draw(3, 0);
-
-		//UnBind SRV->RTV
-		ID3D11ShaderResourceView *pNULLSRVs[3] =
-		{
-			NULL,
-			NULL,
-			NULL
-		};
-		pd3dImmediateContext->PSSetShaderResources(0, 3, pNULLSRVs);
-
-
-		pPerf->EndEvent();
-
-		pPerf->Release();
-    }
-
-    void SetNumPasses(UINT NumPasses)
-    {
-
-    }
-
-    ~StochasticTransparency()
-    {
-		SAFE_DELETE(m_pBackgroundRenderTarget);
-		SAFE_DELETE(m_pBackgroundDepth);
-		SAFE_DELETE(m_pStochasticDepth);
-		SAFE_DELETE(m_pStochasticColorAndCorrectTotalAlphaRenderTarget);
-        SAFE_DELETE(m_pStochasticTotalAlphaRenderTarget);
-		SAFE_RELEASE(m_pStochasticDepthPS);
-		SAFE_RELEASE(m_pTotalAlphaAndAccumulatePS);
-		SAFE_RELEASE(m_pCompositePS);
-        SAFE_RELEASE(m_pRndTexture);
-        SAFE_RELEASE(m_pRndTextureSRV);
-        SAFE_RELEASE(m_pTotalAlphaAndAccumulateBS);
-        SAFE_RELEASE(m_pDepthNoWriteDS);
-
-    }
-
-protected:
-    void CreateShaders(ID3D11Device* pd3dDevice)
-    {
-        HRESULT hr;
-
-        V(pd3dDevice->CreatePixelShader(g_StochasticDepthPS, sizeof(g_StochasticDepthPS), NULL, &m_pStochasticDepthPS));
-
-        V(pd3dDevice->CreatePixelShader(g_AccumulateAndTotalAlphaPS, sizeof(g_AccumulateAndTotalAlphaPS), NULL, &m_pTotalAlphaAndAccumulatePS));
-
-        V(pd3dDevice->CreatePixelShader(g_CompositePS, sizeof(g_CompositePS), NULL, &m_pCompositePS));
-
-    }
-
-    void CreateBlendStates(ID3D11Device* pd3dDevice)
-    {
-        D3D11_BLEND_DESC BlendStateDesc;
-        //To ensure uncorrelated, the AlphaToCoverage can't be used
-        BlendStateDesc.AlphaToCoverageEnable = FALSE;
-
-        //0 For Accumulate
-        //1 For TotalAlpha
-        BlendStateDesc.IndependentBlendEnable = TRUE;
-
-        //DestColor/*ToRT*/ = BlendOp(DestBlend*DestColor/*FromRT*/, SrcBlend*SrcColor/*FromPS*/)
-        //DestAlpha/*ToRT*/ = BlendOpAlpha(DestBlendAlpha*DestAlpha/*FromRT*/, SrcBlendAlpha*SrcAlpha/*FromPS*/)
-
-        //StochasticColor+CorrectTotalAlpha
-        BlendStateDesc.RenderTarget[0].BlendEnable = TRUE;
-        BlendStateDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
-        BlendStateDesc.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
-        BlendStateDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
-        BlendStateDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ZERO;
-        BlendStateDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
-        BlendStateDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-        BlendStateDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-
-        //StochasticTotalAlpha
-        BlendStateDesc.RenderTarget[1].BlendEnable = TRUE;
-        BlendStateDesc.RenderTarget[1].SrcBlend = D3D11_BLEND_ONE;
-        BlendStateDesc.RenderTarget[1].DestBlend = D3D11_BLEND_ONE;
-        BlendStateDesc.RenderTarget[1].BlendOp = D3D11_BLEND_OP_ADD;
-        BlendStateDesc.RenderTarget[1].SrcBlendAlpha = D3D11_BLEND_ONE;
-        BlendStateDesc.RenderTarget[1].DestBlendAlpha = D3D11_BLEND_ONE;
-        BlendStateDesc.RenderTarget[1].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-        BlendStateDesc.RenderTarget[1].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-
-        for (int i = 2; i < 8; ++i)
-        {
-        	BlendStateDesc.RenderTarget[i].BlendEnable = FALSE;
-        	BlendStateDesc.RenderTarget[i].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-        }
-
-        pd3dDevice->CreateBlendState(&BlendStateDesc, &m_pTotalAlphaAndAccumulateBS);
-    }
-
-    void CreateRandomBitmasks(ID3D11Device* pd3dDevice)
-    {
-        MTRand rng;
-        rng.seed((unsigned)0);
-
-        int numbers[NUM_MSAA_SAMPLES];
-        unsigned int *allmasks = new unsigned int[RANDOM_SIZE * (ALPHA_VALUES + 1)];
-
-        for (int y = 0; y <= ALPHA_VALUES; y++) // Inclusive, we need alpha = 1.0
-        {
-            for (int x = 0; x < RANDOM_SIZE; x++)
-            {
-                // Initialize array
-                for (int i = 0; i < NUM_MSAA_SAMPLES; i++)
-                {
-                    numbers[i] = i;
-                }
-
-                // Scramble!
-                for (int i = 0; i < NUM_MSAA_SAMPLES * 2; i++)
-                {
-                    std::swap(numbers[rng.randInt() % NUM_MSAA_SAMPLES], numbers[rng.randInt() % NUM_MSAA_SAMPLES]);
-                }
-
-                // Create the mask
-                unsigned int mask = 0;
-                float nof_bits_to_set = (float(y) / float(ALPHA_VALUES)) * NUM_MSAA_SAMPLES;
-                for (int bit = 0; bit < int(nof_bits_to_set); bit++)
-                {
-                    mask |= (1 << numbers[bit]);
-                }
-                float prob_of_last_bit = (nof_bits_to_set - floor(nof_bits_to_set));
-                if (rng.randExc() < prob_of_last_bit)
-                {
-                    mask |= (1 << numbers[int(nof_bits_to_set)]);
-                }
-
-                allmasks[y * RANDOM_SIZE + x] = mask;
-            }
-        }
-
-        D3D11_TEXTURE2D_DESC texDesc;
-        texDesc.Width            = RANDOM_SIZE;
-        texDesc.Height           = ALPHA_VALUES + 1;
-        texDesc.MipLevels        = 1;
-        texDesc.ArraySize        = 1;
-        texDesc.Format           = DXGI_FORMAT_R32_UINT;
-        texDesc.SampleDesc.Count = 1;
-        texDesc.SampleDesc.Quality = 0;
-        texDesc.Usage            = D3D11_USAGE_IMMUTABLE;
-        texDesc.BindFlags        = D3D11_BIND_SHADER_RESOURCE;
-        texDesc.CPUAccessFlags   = 0;
-        texDesc.MiscFlags        = 0;
-
-        D3D11_SUBRESOURCE_DATA srDesc;
-        srDesc.pSysMem          = allmasks;
-        srDesc.SysMemPitch      = texDesc.Width * sizeof(unsigned int);
-        srDesc.SysMemSlicePitch = 0;
-
-        SAFE_RELEASE(m_pRndTexture);
-        pd3dDevice->CreateTexture2D(&texDesc, &srDesc, &m_pRndTexture);
-
-        SAFE_RELEASE(m_pRndTextureSRV);
-        pd3dDevice->CreateShaderResourceView(m_pRndTexture, NULL, &m_pRndTextureSRV);
-
-        delete[] allmasks;
-    }
-
-    void CreateFrameBuffer(ID3D11Device* pd3dDevice, UINT Width, UINT Height)
-    {
-		//Turning on MSAA in StochasticDepthPass is to random sample
-		//and the stochastic transparency intrinsically doesn't demand other passes to turn on the MSAA.
-        {
-        D3D11_TEXTURE2D_DESC texDesc;
-        texDesc.Width = Width;
-        texDesc.Height = Height;
-        texDesc.ArraySize = 1;
-        texDesc.MiscFlags = 0;
-        texDesc.MipLevels = 1;
-        texDesc.SampleDesc.Count = 1U;
-        texDesc.SampleDesc.Quality = 0U;
-        texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-        texDesc.Usage = D3D11_USAGE_DEFAULT;
-        texDesc.CPUAccessFlags = NULL;
-
-        m_pBackgroundRenderTarget = new SimpleRT(pd3dDevice, &texDesc, DXGI_FORMAT_R8G8B8A8_UNORM);
-        m_pStochasticColorAndCorrectTotalAlphaRenderTarget = new SimpleRT(pd3dDevice, &texDesc, DXGI_FORMAT_R8G8B8A8_UNORM);
-        m_pStochasticTotalAlphaRenderTarget = new SimpleRT(pd3dDevice, &texDesc, DXGI_FORMAT_R16_FLOAT); //STOCHASTIC_COLOR_FORMAT;
-        }
-
-        {
-        D3D11_TEXTURE2D_DESC texDesc;
-        texDesc.ArraySize = 1;
-        texDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-        texDesc.CPUAccessFlags = NULL;
-        texDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-        texDesc.Width = Width;
-        texDesc.Height = Height;
-        texDesc.MipLevels = 1;
-        texDesc.MiscFlags = NULL;
-        texDesc.SampleDesc.Count = 1U;
-        texDesc.SampleDesc.Quality = 0U;
-        texDesc.Usage = D3D11_USAGE_DEFAULT;
-        m_pBackgroundDepth = new SimpleDepthStencil(pd3dDevice, &texDesc);
-        }
-    }
-
-    void CreateStochasticDepth(ID3D11Device* pd3dDevice, UINT Width, UINT Height)
-    {
-        m_pStochasticDepth = new StochasticDepth(pd3dDevice, Width, Height);
-    }
-	
-	SimpleRT *m_pBackgroundRenderTarget;
-	SimpleDepthStencil *m_pBackgroundDepth;
-    StochasticDepth* m_pStochasticDepth;
-	SimpleRT *m_pStochasticColorAndCorrectTotalAlphaRenderTarget;
-    SimpleRT *m_pStochasticTotalAlphaRenderTarget;
-
-	ID3D11PixelShader *m_pStochasticDepthPS;
-	ID3D11PixelShader *m_pTotalAlphaAndAccumulatePS;
-	ID3D11PixelShader *m_pCompositePS;
-
-	ID3D11Texture2D *m_pRndTexture;
-	ID3D11ShaderResourceView *m_pRndTextureSRV;
-
-	ID3D11BlendState *m_pTotalAlphaAndAccumulateBS;
-};
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA 
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR  
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS 
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY 
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE, 
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+#pragma once
+#include "SimpleRT.h"
+#include "BaseTechnique.h"
+#include "CoverageMasks.h"
+#include "TemporalAccumulation.h"
+#include "Denoiser.h"
+#include <algorithm>
+
+#include "StochasticTransparency_StochasticDepthPS.h"
+#include "StochasticTransparency_AccumulateAndTotalAlphaPS.h"
+#include "StochasticTransparency_CompositePS.h"
+#include "StochasticTransparency_SortStochasticDepthPS.h"
+#include "StochasticTransparency_AccumulateAndTotalAlphaSortedPS.h"
+#include "StochasticTransparency_CopyOpaqueDepthPS.h"
+#include "StochasticTransparency_FarthestStochasticDepthPS.h"
+#include "StochasticTransparency_SortFarthestStochasticDepthPS.h"
+#include "StochasticTransparency_TemporalPS.h"
+#include "StochasticTransparency_TemporalDepthPS.h"
+#include "StochasticTransparency_ProgressiveChangePS.h"
+#include "StochasticTransparency_DenoisePS.h"
+
+#define RANDOM_SIZE 2048
+#define ALPHA_VALUES 256
+#define NUM_MSAA_SAMPLES 8
+#define MAX_NUM_PASSES 8
+
+// Transparent geometry passes of every frame: the stochastic depths, then the accumulation
+#define NUM_STOCHASTIC_GEOMETRY_PASSES 2
+
+// The sorted stochastic depths are stored 4 per RGBA32F texel
+#define NUM_SORTED_DEPTH_TARGETS (NUM_MSAA_SAMPLES / 4)
+
+//The AccumulationBuffer may not be MSAA
+#define STOCHASTIC_COLOR_FORMAT RHI_FORMAT_R8G8B8A8_UNORM
+
+// Consists of a depth-stencil buffer //Texture2D //D16_UNORM or D32_FLOAT
+// and the associated depth-stencil view for binding.
+class StochasticDepth
+{
+public:
+	RHITexture *pTexture;
+	RHIView *pDSV;
+	RHIView *pSRV;
+
+	StochasticDepth(RHIDevice* pDevice, UINT Width, UINT Height, RHIFormat Format)
+		: pTexture(NULL)
+		, pDSV(NULL)
+		, pSRV(NULL)
+	{
+		//Read as R32_FLOAT or R16_UNORM by the TotalAlpha And Accumulate pass
+		RHITextureDesc texDesc;
+		texDesc.ArraySize = 1;
+		texDesc.BindFlags = RHI_BIND_DEPTH_STENCIL | RHI_BIND_SHADER_RESOURCE;
+		texDesc.Format = Format;
+		texDesc.Width = Width;
+		texDesc.Height = Height;
+		texDesc.SampleCount = NUM_MSAA_SAMPLES;
+		pTexture = pDevice->CreateTexture2D(texDesc);
+		assert(pTexture);
+		pDSV = pDevice->CreateDepthStencilView(pTexture);
+		pSRV = pDevice->CreateShaderResourceView(pTexture);
+	}
+
+	~StochasticDepth()
+	{
+		SAFE_DELETE(pDSV);
+		SAFE_DELETE(pSRV);
+		SAFE_DELETE(pTexture);
+	}
+};
+
+class StochasticTransparency : public BaseTechnique
+{
+public:
+    StochasticTransparency(RHIDevice* pDevice, UINT Width, UINT Height, UINT ResolutionScale = 1)
+        : BaseTechnique(pDevice, Width, Height, ResolutionScale)
+        , m_pBackgroundRenderTarget(NULL)
+        , m_pBackgroundDepth(NULL)
+        , m_pFarthestDepth(NULL)
+        , m_pTemporalCurrent(NULL)
+        , m_pTemporalDepth(NULL)
+        , m_pProgressiveChange(NULL)
+		, m_pStochasticDepth(NULL)
+		, m_pStochasticColorAndCorrectTotalAlphaRenderTarget(NULL)
+		, m_pStochasticTotalAlphaRenderTarget(NULL)
+		, m_pDenoisedColorAndCorrectTotalAlphaRenderTarget(NULL)
+		, m_pDenoisedTotalAlphaRenderTarget(NULL)
+		, m_pStochasticDepthPS(NULL)
+		, m_pTotalAlphaAndAccumulatePS(NULL)
+		, m_pCompositePS(NULL)
+		, m_pSortStochasticDepthPS(NULL)
+		, m_pAccumulateAndTotalAlphaSortedPS(NULL)
+		, m_pCopyOpaqueDepthPS(NULL)
+		, m_pFarthestStochasticDepthPS(NULL)
+		, m_pSortFarthestStochasticDepthPS(NULL)
+		, m_pTemporalPS(NULL)
+		, m_pTemporalDepthPS(NULL)
+		, m_pProgressiveChangePS(NULL)
+		, m_pDenoisePS(NULL)
+        , m_SortedDepths(false)
+        , m_FarthestDepthRejection(false)
+        , m_Denoise(false)
+        , m_TemporalAccumulation(false)
+        , m_TemporalDepthOutput(false)
+        , m_HistoryValid(false)
+        , m_HistoryIndex(0)
+        , m_ProgressiveRefinement(false)
+        , m_NumProgressiveFrames(0)
+        , m_pRndTexture(NULL)
+        , m_pRndTextureSRV(NULL)
+        , m_pTotalAlphaAndAccumulateBS(NULL)
+        , m_pDepthAlwaysDS(NULL)
+    {
+        for (UINT i = 0; i < NUM_SORTED_DEPTH_TARGETS; ++i)
+        {
+            m_pSortedStochasticDepth[i] = NULL;
+        }
+        m_pTemporalHistory[0] = NULL;
+        m_pTemporalHistory[1] = NULL;
+
+		CreateFrameBuffer(pDevice, m_Width, m_Height);
+		CreateStochasticDepth(pDevice, m_Width, m_Height);
+		CreateTileClasses(pDevice);
+        CreateRandomBitmasks(pDevice);
+        CreateBlendStates(pDevice);
+        CreateDepthStencilStates(pDevice);
+        CreateShaders(pDevice);
+        CBData.randMaskSizePowOf2MinusOne = RANDOM_SIZE - 1;
+        CBData.randMaskAlphaValues = ALPHA_VALUES;
+        CBData.randomOffset = 0;
+        CBData.stochasticDepthBias = 0.f;
+    }
+
+    virtual void RecordPasses(CommandList &Commands, RHIView *pBackBuffer)
+    {
+		//The BackgroudColor may not be MSAA
+		
+        // Bind the constants uploaded for the frame
+        Commands.BindFrameConstants();
+
+        // Set shared states. The mesh draws bind the geometry vertex shader.
+        Commands.SetRasterizerState(m_pNoCullRS);
+
+		//----------------------------------------------------------------------------------
+		// 1. Render Opaque Background
+		//----------------------------------------------------------------------------------
+        //The background colors and depths are initialized by drawing the opaque objects in the scene.
+		Commands.BeginEvent(L"Opaque Pass");
+		float ClearColorBack[4] = { m_BackgroundColor.x, m_BackgroundColor.y, m_BackgroundColor.z, 0 };
+		Commands.ClearRenderTarget(m_pBackgroundRenderTarget->pRTV, ClearColorBack);
+		float ClearDepthBack = 1.0f;
+		Commands.ClearDepth(m_pBackgroundDepth->pDSV, ClearDepthBack);
+		if (m_OpaqueGeometry)
+		{
+			RecordOpaquePass(Commands, m_pBackgroundRenderTarget->pRTV, m_pBackgroundDepth->pDSV);
+		}
+		Commands.EndEvent();
+
+		//By the limit of the hardware, the maximum sample count of MSAA is 8X MSAA.
+		//The author proposed that we can use multiple passes to simulate more sample counts.
+		//Due to the performance issue, we only use one pass.
+        //for (UINT LayerId = 0; LayerId < m_NumPasses; ++LayerId)
+        {
+            //----------------------------------------------------------------------------------
+            // 2. Render MSAA "stochastic depths", writting SV_Coverage in the pixel shader
+            //----------------------------------------------------------------------------------
+			Commands.BeginEvent(L"Stochastic Depth Pass");
+
+            //Copy From Background Depth To Every Sample Of The Stochastic Depth,
+            //So That The Fragments Hidden By The Opaque Geometry Are Rejected
+            if (m_OpaqueGeometry)
+            {
+                Commands.SetRenderTargets(0, NULL, m_pStochasticDepth->pDSV);
+                Commands.SetDepthStencilState(m_pDepthAlwaysDS, 0);
+
+                Commands.SetVertexShader(m_pFullScreenTriangleVS);
+                Commands.SetPixelShader(m_pCopyOpaqueDepthPS);
+                Commands.SetPSResources(0, 1, &m_pBackgroundDepth->pSRV);
+
+                Commands.Draw(3, 0);
+            }
+            else
+            {
+                Commands.ClearDepth(m_pStochasticDepth->pDSV, 1.0);
+            }
+
+            Commands.SetRenderTargets(0, NULL, m_pStochasticDepth->pDSV);
+            Commands.SetBlendState(m_pNoBlendBS, m_BlendFactor, 0XFFFFFFFF);
+            Commands.SetDepthStencilState(m_pDepthNoStencilDS, 0);
+
+            Commands.SetPixelShader(m_pStochasticDepthPS);
+            Commands.SetPSResources(0, 1, &m_pRndTextureSRV);
+
+            Commands.DrawMesh();
+
+			Commands.EndEvent();
+
+            //----------------------------------------------------------------------------------
+            // 2b. Optionally sort the stochastic depths of each pixel, once for all the layers.
+            //     With the farthest depth rejection, the same pass writes the farthest depth.
+            //----------------------------------------------------------------------------------
+            RHIView *pAccumulateDSV = m_pBackgroundDepth->pDSV;
+            if (m_SortedDepths)
+            {
+                Commands.BeginEvent(L"Sort Stochastic Depth Pass");
+
+                RHIView *pSortedRTVs[NUM_SORTED_DEPTH_TARGETS];
+                for (UINT i = 0; i < NUM_SORTED_DEPTH_TARGETS; ++i)
+                {
+                    pSortedRTVs[i] = m_pSortedStochasticDepth[i]->pRTV;
+                }
+                if (m_FarthestDepthRejection)
+                {
+                    Commands.SetRenderTargets(NUM_SORTED_DEPTH_TARGETS, pSortedRTVs, m_pFarthestDepth->pDSV);
+                    Commands.SetDepthStencilState(m_pDepthAlwaysDS, 0);
+                    Commands.SetPixelShader(m_pSortFarthestStochasticDepthPS);
+                    pAccumulateDSV = m_pFarthestDepth->pDSV;
+                }
+                else
+                {
+                    Commands.SetRenderTargets(NUM_SORTED_DEPTH_TARGETS, pSortedRTVs, NULL);
+                    Commands.SetDepthStencilState(m_pNoDepthNoStencilDS, 0);
+                    Commands.SetPixelShader(m_pSortStochasticDepthPS);
+                }
+
+                Commands.SetVertexShader(m_pFullScreenTriangleVS);
+                Commands.SetPSResources(0, 1, &m_pStochasticDepth->pSRV);
+
+                Commands.Draw(3, 0);
+
+                Commands.EndEvent();
+            }
+
+            //----------------------------------------------------------------------------------
+            // 2c. Optionally write the farthest stochastic depth of each pixel, the mask of
+            //     the saturated pixels, to reject the fragments behind all the samples by
+            //     tiles in the accumulation pass
+            //----------------------------------------------------------------------------------
+            if (m_FarthestDepthRejection && !m_SortedDepths)
+            {
+                Commands.BeginEvent(L"Farthest Stochastic Depth Pass");
+
+                Commands.SetRenderTargets(0, NULL, m_pFarthestDepth->pDSV);
+                Commands.SetDepthStencilState(m_pDepthAlwaysDS, 0);
+
+                Commands.SetVertexShader(m_pFullScreenTriangleVS);
+                Commands.SetPixelShader(m_pFarthestStochasticDepthPS);
+                Commands.SetPSResources(0, 1, &m_pStochasticDepth->pSRV);
+
+                Commands.Draw(3, 0);
+
+                Commands.EndEvent();
+
+                //Never farther than the opaque depth the stochastic depth was initialized with
+                pAccumulateDSV = m_pFarthestDepth->pDSV;
+            }
+
+            //----------------------------------------------------------------------------------
+            // 3. We Merge TotalAlpha And Accumulate Together
+            //----------------------------------------------------------------------------------
+			Commands.BeginEvent(L"TotalAlpha And Accumulate Pass");
+
+            float ClearStochasticColorAndCorrectTotalAlpha[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+            Commands.ClearRenderTarget(m_pStochasticColorAndCorrectTotalAlphaRenderTarget->pRTV, ClearStochasticColorAndCorrectTotalAlpha);
+
+            float ClearStochasticTotalAlpha[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            Commands.ClearRenderTarget(m_pStochasticTotalAlphaRenderTarget->pRTV, ClearStochasticTotalAlpha);
+
+			//UnBind Stochastic Depth
+			//DSV->SRV
+            RHIView *pRTVs[2] =
+            {
+            	m_pStochasticColorAndCorrectTotalAlphaRenderTarget->pRTV,
+            	m_pStochasticTotalAlphaRenderTarget->pRTV
+            };
+            Commands.SetRenderTargets(2, pRTVs, pAccumulateDSV);
+
+			Commands.SetBlendState(m_pTotalAlphaAndAccumulateBS, m_BlendFactor, 0xffffffff);
+            Commands.SetDepthStencilState(m_pDepthNoWriteDS, 0);
+
+			if (m_SortedDepths)
+			{
+				Commands.SetPixelShader(m_pAccumulateAndTotalAlphaSortedPS);
+
+				RHIView *pSRVs[NUM_SORTED_DEPTH_TARGETS];
+				for (UINT i = 0; i < NUM_SORTED_DEPTH_TARGETS; ++i)
+				{
+					pSRVs[i] = m_pSortedStochasticDepth[i]->pSRV;
+				}
+				Commands.SetPSResources(0, NUM_SORTED_DEPTH_TARGETS, pSRVs);
+			}
+			else
+			{
+				Commands.SetPixelShader(m_pTotalAlphaAndAccumulatePS);
+
+				RHIView *pSRVs[1] =
+				{
+					m_pStochasticDepth->pSRV
+				};
+				Commands.SetPSResources(0, 1, pSRVs);
+			}
+
+
+            Commands.DrawMesh();
+
+			Commands.EndEvent();
+        }
+
+		//UnBind SRV->RTV
+		RHIView *pNULLSRVs[3] =
+		{
+			NULL,
+			NULL,
+			NULL
+		};
+
+        //----------------------------------------------------------------------------------
+        // 4. Optionally filter U and U1 before the composite, guided by the transmittance
+        //    and the stochastic depths (see Denoiser.h)
+        //----------------------------------------------------------------------------------
+        if (m_Denoise)
+        {
+            Commands.BeginEvent(L"Denoise Pass");
+
+            RHIView *pDenoiseRTVs[2] =
+            {
+                m_pDenoisedColorAndCorrectTotalAlphaRenderTarget->pRTV,
+                m_pDenoisedTotalAlphaRenderTarget->pRTV
+            };
+            Commands.SetRenderTargets(2, pDenoiseRTVs, NULL);
+            Commands.SetDepthStencilState(m_pNoDepthNoStencilDS, 0);
+            Commands.SetBlendState(m_pNoBlendBS, m_BlendFactor, 0xffffffff);
+
+            Commands.SetVertexShader(m_pFullScreenTriangleVS);
+            Commands.SetPixelShader(m_pDenoisePS);
+            RHIView *pDenoiseSRVs[3] =
+            {
+                m_pStochasticDepth->pSRV,
+                m_pStochasticColorAndCorrectTotalAlphaRenderTarget->pSRV,
+                m_pStochasticTotalAlphaRenderTarget->pSRV
+            };
+            Commands.SetPSResources(0, 3, pDenoiseSRVs);
+
+            Commands.Draw(3, 0);
+
+            Commands.SetPSResources(0, 3, pNULLSRVs);
+
+            Commands.EndEvent();
+        }
+
+        //----------------------------------------------------------------------------------
+        // 5. Final full-screen pass, blending the transparent colors over the background
+        //----------------------------------------------------------------------------------
+		Commands.BeginEvent(L"Composite Pass"); //Total Alpha Correction And Under Operator
+
+		RHIView *pSRVs[3] =
+		{
+			m_pBackgroundRenderTarget->pSRV,
+			m_Denoise ? m_pDenoisedColorAndCorrectTotalAlphaRenderTarget->pSRV : m_pStochasticColorAndCorrectTotalAlphaRenderTarget->pSRV,
+			m_Denoise ? m_pDenoisedTotalAlphaRenderTarget->pSRV : m_pStochasticTotalAlphaRenderTarget->pSRV
+		};
+
+		//The temporal accumulation pass writes the final target
+		RHIView *pCompositeRTV = m_TemporalAccumulation ? m_pTemporalCurrent->pRTV : GetFinalTarget(pBackBuffer);
+
+		if (IsTileCompositeEnabled())
+		{
+			//The pixels without transparent fragment copy the background
+			RecordTileComposite(Commands, pCompositeRTV, m_pCompositePS, 3, pSRVs,
+				m_pStochasticColorAndCorrectTotalAlphaRenderTarget->pSRV,
+				m_OpaqueGeometry ? m_pBackgroundDepth->pSRV : NULL,
+				m_pBackgroundRenderTarget->pSRV);
+		}
+		else
+		{
+			Commands.SetRenderTargets(1, &pCompositeRTV, NULL);
+			Commands.SetDepthStencilState(m_pNoDepthNoStencilDS, 0);
+			Commands.SetBlendState(m_pNoBlendBS, m_BlendFactor, 0xffffffff);
+
+			Commands.SetVertexShader(m_pFullScreenTriangleVS);
+			Commands.SetPixelShader(m_pCompositePS);
+			Commands.SetPSResources(0, 3, pSRVs);
+
+			Commands.Draw(3, 0);
+		}
+
+		Commands.SetPSResources(0, 3, pNULLSRVs);
+
+		Commands.EndEvent();
+
+        //----------------------------------------------------------------------------------
+        // 6. Optionally blend the composite with the reprojected output of the previous
+        //    frames, into the final target and the history read by the next frame
+        //----------------------------------------------------------------------------------
+        if (m_TemporalAccumulation)
+        {
+            Commands.BeginEvent(L"Temporal Accumulation Pass");
+
+            RHIView *pTemporalRTVs[3] =
+            {
+                GetFinalTarget(pBackBuffer),
+                m_pTemporalHistory[m_HistoryIndex]->pRTV,
+                m_pTemporalDepth->pRTV
+            };
+            Commands.SetRenderTargets(m_TemporalDepthOutput ? 3 : 2, pTemporalRTVs, NULL);
+            Commands.SetDepthStencilState(m_pNoDepthNoStencilDS, 0);
+            Commands.SetBlendState(m_pNoBlendBS, m_BlendFactor, 0xffffffff);
+
+            Commands.SetVertexShader(m_pFullScreenTriangleVS);
+            Commands.SetPixelShader(m_TemporalDepthOutput ? m_pTemporalDepthPS : m_pTemporalPS);
+            RHIView *pTemporalSRVs[3] =
+            {
+                m_pTemporalCurrent->pSRV,
+                m_pTemporalHistory[m_HistoryIndex ^ 1]->pSRV,
+                m_pStochasticDepth->pSRV
+            };
+            Commands.SetPSResources(0, 3, pTemporalSRVs);
+
+            Commands.Draw(3, 0);
+
+            Commands.SetPSResources(0, 3, pNULLSRVs);
+
+            Commands.EndEvent();
+        }
+
+        //----------------------------------------------------------------------------------
+        // 6b. With progressive refinement, the largest change of the running mean in each
+        //     tile, read back by the application to stop rendering once it converged
+        //----------------------------------------------------------------------------------
+        if (m_TemporalAccumulation && m_ProgressiveRefinement)
+        {
+            Commands.BeginEvent(L"Progressive Change Pass");
+
+            Commands.SetRenderTargets(1, &m_pProgressiveChange->pRTV, NULL);
+            Commands.SetVertexShader(m_pFullScreenTriangleVS);
+            Commands.SetPixelShader(m_pProgressiveChangePS);
+            RHIView *pChangeSRVs[2] =
+            {
+                m_pTemporalHistory[m_HistoryIndex]->pSRV,
+                m_pTemporalHistory[m_HistoryIndex ^ 1]->pSRV
+            };
+            Commands.SetPSResources(0, 2, pChangeSRVs);
+
+            Commands.Draw(3, 0);
+
+            Commands.SetPSResources(0, 2, pNULLSRVs);
+
+            Commands.EndEvent();
+        }
+
+        //----------------------------------------------------------------------------------
+        // 7. Upsampling at a reduced resolution, guided by the opaque depth
+        //----------------------------------------------------------------------------------
+        RecordUpsample(Commands, pBackBuffer, m_OpaqueGeometry ? m_pBackgroundDepth->pSRV : NULL);
+    }
+
+    // Advances the temporal accumulation by one frame. The history targets are swapped
+    // every frame, and each parity has its own recorded passes (see GetCommandListIndex).
+    virtual void BeginFrame()
+    {
+        if (!m_TemporalAccumulation) return;
+
+        // Without history, the reprojection is the identity
+        DirectX::XMMATRIX WorldViewProj = DirectX::XMLoadFloat4x4(&CBData.worldViewProj);
+        DirectX::XMMATRIX PrevWorldViewProj = m_HistoryValid ? DirectX::XMLoadFloat4x4(&m_PrevWorldViewProj) : WorldViewProj;
+        DirectX::XMStoreFloat4x4(&CBData.currentToPrevious,
+                                 DirectX::XMMatrixMultiply(DirectX::XMMatrixInverse(NULL, WorldViewProj), PrevWorldViewProj));
+        m_PrevWorldViewProj = CBData.worldViewProj;
+
+        if (m_ProgressiveRefinement)
+        {
+            // Running mean: the history holds the mean of the N previous frames
+            const UINT N = m_HistoryValid ? m_NumProgressiveFrames : 0;
+            CBData.temporalParams = DirectX::XMFLOAT4((float)N / (float)(N + 1), 0.f, 0.f, 1.f);
+            m_NumProgressiveFrames = N + 1;
+        }
+        else
+        {
+            CBData.temporalParams = DirectX::XMFLOAT4(m_HistoryValid ? TEMPORAL_HISTORY_WEIGHT : 0.f,
+                                                      TEMPORAL_REJECTION_SCALE, TEMPORAL_VARIANCE_GAMMA, 0.f);
+        }
+
+        // New coverage masks every frame, so that the accumulated frames average out their noise
+        CBData.randomOffset += TEMPORAL_RANDOM_OFFSET_STEP;
+
+        m_HistoryIndex ^= 1;
+        m_HistoryValid = true;
+    }
+
+    // The passes bind the history targets by parity, so both parities are recorded once
+    virtual UINT GetCommandListIndex() const
+    {
+        return m_TemporalAccumulation ? m_HistoryIndex : 0;
+    }
+
+    void SetNumPasses(UINT NumPasses)
+    {
+
+    }
+
+    // Sorts the stochastic depths of each pixel before the accumulation pass,
+    // which then counts the visible samples with a binary search
+    void SetSortedDepths(bool SortedDepths)
+    {
+        if (SortedDepths != m_SortedDepths)
+        {
+            m_SortedDepths = SortedDepths;
+            InvalidateCommands();
+        }
+    }
+
+    // Depth-tests the accumulation pass against the farthest stochastic depth of each pixel
+    // instead of the opaque depth. Approximate: see FarthestStochasticDepthPS.
+    void SetFarthestDepthRejection(bool FarthestDepthRejection)
+    {
+        if (FarthestDepthRejection != m_FarthestDepthRejection)
+        {
+            m_FarthestDepthRejection = FarthestDepthRejection;
+            InvalidateCommands();
+        }
+    }
+
+    // Single-sampled D32_FLOAT depth of the opaque subsets, or NULL
+    virtual RHITexture* GetOpaqueDepth() const
+    {
+        return m_OpaqueGeometry ? m_pBackgroundDepth->pTexture : NULL;
+    }
+
+    // Filters the accumulation targets before the composite, at a fixed cost of 25 taps per pixel
+    void SetDenoise(bool Denoise)
+    {
+        if (Denoise != m_Denoise)
+        {
+            m_Denoise = Denoise;
+            InvalidateCommands();
+        }
+    }
+
+    // D16_UNORM halves the largest buffer of the technique and its reads in the accumulation pass.
+    // The precision relies on the depth range fitted to the scene by the projection matrix;
+    // reverse-Z would not help, as the UNORM values are evenly spaced.
+    void SetStochasticDepthFormat(RHIDevice* pDevice, RHIFormat Format)
+    {
+        assert(Format == RHI_FORMAT_D16_UNORM || Format == RHI_FORMAT_D32_FLOAT);
+        if (Format != GetStochasticDepthFormat())
+        {
+            const RHITextureDesc &Desc = m_pStochasticDepth->pTexture->GetDesc();
+            StochasticDepth *pStochasticDepth = new StochasticDepth(pDevice, Desc.Width, Desc.Height, Format);
+            SAFE_DELETE(m_pStochasticDepth);
+            m_pStochasticDepth = pStochasticDepth;
+
+            // One UNORM step: the depth test stores the depths rounded to the nearest value
+            CBData.stochasticDepthBias = (Format == RHI_FORMAT_D16_UNORM) ? 1.f / 65535.f : 0.f;
+            InvalidateCommands();
+        }
+    }
+
+    RHIFormat GetStochasticDepthFormat() const
+    {
+        return m_pStochasticDepth->pTexture->GetDesc().Format;
+    }
+
+    // Blends every frame with the reprojected output of the previous frames, with coverage
+    // masks that change every frame (see TemporalAccumulation.h). Enabling it drops the history.
+    void SetTemporalAccumulation(bool TemporalAccumulation)
+    {
+        if (TemporalAccumulation != m_TemporalAccumulation)
+        {
+            m_TemporalAccumulation = TemporalAccumulation;
+            m_HistoryValid = false;
+            CBData.randomOffset = 0;
+            InvalidateCommands();
+        }
+    }
+
+    bool GetTemporalAccumulation() const
+    {
+        return m_TemporalAccumulation;
+    }
+
+    // Turns the temporal accumulation, when enabled, into a running mean of the frames at the
+    // same pixel, which converges to the expected value of the stochastic composite while the
+    // view and the parameters are static. Enabling it drops the history.
+    void SetProgressiveRefinement(RHIDevice* pDevice, bool ProgressiveRefinement)
+    {
+        if (ProgressiveRefinement != m_ProgressiveRefinement)
+        {
+            m_ProgressiveRefinement = ProgressiveRefinement;
+            CreateTemporalHistory(pDevice);
+            m_HistoryValid = false;
+            m_NumProgressiveFrames = 0;
+        }
+    }
+
+    bool GetProgressiveRefinement() const
+    {
+        return m_ProgressiveRefinement;
+    }
+
+    // Drops the running mean after a change of the view or of the parameters.
+    // Without progressive refinement, the reprojection keeps the history valid.
+    void RestartProgressiveRefinement()
+    {
+        if (!m_ProgressiveRefinement) return;
+        m_HistoryValid = false;
+        m_NumProgressiveFrames = 0;
+    }
+
+    // Frames in the running mean, including the last one
+    UINT GetNumProgressiveFrames() const
+    {
+        return m_NumProgressiveFrames;
+    }
+
+    // R32_FLOAT target with the largest change of the running mean in each tile over the
+    // last frame (see GetNumTiles), or NULL without progressive refinement
+    RHITexture* GetProgressiveChange() const
+    {
+        return (m_TemporalAccumulation && m_ProgressiveRefinement) ? m_pProgressiveChange->pTexture : NULL;
+    }
+
+    // Also writes the nearest stochastic depths of the temporal pass, for the CPU reference
+    void SetTemporalDepthOutput(bool TemporalDepthOutput)
+    {
+        if (TemporalDepthOutput != m_TemporalDepthOutput)
+        {
+            m_TemporalDepthOutput = TemporalDepthOutput;
+            InvalidateCommands();
+        }
+    }
+
+    // Inputs, constants and output of the temporal pass of the last frame, for ResolveTemporal.
+    // The RGBA16F targets, and the RGBA32F histories of the progressive refinement, hold
+    // the transmittance in alpha; *ppDepth is R32_FLOAT.
+    void GetTemporalResolveInputs(RHITexture **ppCurrent, RHITexture **ppHistory, RHITexture **ppDepth, RHITexture **ppOutput,
+                                  DirectX::XMFLOAT4X4 *pCurrentToPrevious, DirectX::XMFLOAT4 *pParams) const
+    {
+        *ppCurrent = m_pTemporalCurrent->pTexture;
+        *ppHistory = m_pTemporalHistory[m_HistoryIndex ^ 1]->pTexture;
+        *ppDepth = m_pTemporalDepth->pTexture;
+        *ppOutput = m_pTemporalHistory[m_HistoryIndex]->pTexture;
+        *pCurrentToPrevious = CBData.currentToPrevious;
+        *pParams = CBData.temporalParams;
+    }
+
+    // Estimated bytes moved through the stochastic depths in a frame, without framebuffer
+    // compression, for NumFragments fragments per geometry pass with the given depth format:
+    // the clear, the depth test read and write of the covered samples (Alpha * S on average),
+    // and the S samples loaded per fragment by the accumulation pass, or the sort pass and
+    // the RGBA32F texels of the sorted depths, and the read of the farthest depth pass
+    // when it is not merged with the sort pass.
+    double GetStochasticDepthTraffic(double NumFragments, RHIFormat Format) const
+    {
+        const RHITextureDesc &Desc = m_pStochasticDepth->pTexture->GetDesc();
+        const double NumPixels = (double)Desc.Width * Desc.Height;
+        const double SampleSize = (double)GetFormatSize(Format);
+        const double PixelSize = SampleSize * NUM_MSAA_SAMPLES;
+
+        double Bytes = NumPixels * PixelSize;
+        Bytes += NumFragments * 2.0 * m_Alpha * PixelSize;
+        if (m_SortedDepths)
+        {
+            Bytes += NumPixels * (PixelSize + NUM_MSAA_SAMPLES * sizeof(float));
+            Bytes += NumFragments * NUM_MSAA_SAMPLES * sizeof(float);
+        }
+        else
+        {
+            Bytes += NumFragments * PixelSize;
+        }
+        if (m_FarthestDepthRejection && !m_SortedDepths)
+        {
+            Bytes += NumPixels * PixelSize;
+        }
+        return Bytes;
+    }
+
+    ~StochasticTransparency()
+    {
+		SAFE_DELETE(m_pBackgroundRenderTarget);
+		SAFE_DELETE(m_pBackgroundDepth);
+		SAFE_DELETE(m_pFarthestDepth);
+		SAFE_DELETE(m_pTemporalCurrent);
+		SAFE_DELETE(m_pTemporalHistory[0]);
+		SAFE_DELETE(m_pTemporalHistory[1]);
+		SAFE_DELETE(m_pTemporalDepth);
+		SAFE_DELETE(m_pProgressiveChange);
+		SAFE_DELETE(m_pStochasticDepth);
+		SAFE_DELETE(m_pStochasticColorAndCorrectTotalAlphaRenderTarget);
+        SAFE_DELETE(m_pStochasticTotalAlphaRenderTarget);
+		SAFE_DELETE(m_pDenoisedColorAndCorrectTotalAlphaRenderTarget);
+		SAFE_DELETE(m_pDenoisedTotalAlphaRenderTarget);
+		SAFE_DELETE(m_pStochasticDepthPS);
+		SAFE_DELETE(m_pTotalAlphaAndAccumulatePS);
+		SAFE_DELETE(m_pCompositePS);
+		SAFE_DELETE(m_pSortStochasticDepthPS);
+		SAFE_DELETE(m_pAccumulateAndTotalAlphaSortedPS);
+		SAFE_DELETE(m_pCopyOpaqueDepthPS);
+		SAFE_DELETE(m_pFarthestStochasticDepthPS);
+		SAFE_DELETE(m_pSortFarthestStochasticDepthPS);
+		SAFE_DELETE(m_pTemporalPS);
+		SAFE_DELETE(m_pTemporalDepthPS);
+		SAFE_DELETE(m_pProgressiveChangePS);
+		SAFE_DELETE(m_pDenoisePS);
+        for (UINT i = 0; i < NUM_SORTED_DEPTH_TARGETS; ++i)
+        {
+            SAFE_DELETE(m_pSortedStochasticDepth[i]);
+        }
+        SAFE_DELETE(m_pRndTextureSRV);
+        SAFE_DELETE(m_pRndTexture);
+        SAFE_DELETE(m_pTotalAlphaAndAccumulateBS);
+        SAFE_DELETE(m_pDepthNoWriteDS);
+        SAFE_DELETE(m_pDepthAlwaysDS);
+
+    }
+
+protected:
+    void CreateShaders(RHIDevice* pDevice)
+    {
+        m_pStochasticDepthPS = pDevice->CreatePixelShader(g_StochasticDepthPS, sizeof(g_StochasticDepthPS));
+
+        m_pTotalAlphaAndAccumulatePS = pDevice->CreatePixelShader(g_AccumulateAndTotalAlphaPS, sizeof(g_AccumulateAndTotalAlphaPS));
+
+        m_pCompositePS = pDevice->CreatePixelShader(g_CompositePS, sizeof(g_CompositePS));
+
+        m_pSortStochasticDepthPS = pDevice->CreatePixelShader(g_SortStochasticDepthPS, sizeof(g_SortStochasticDepthPS));
+
+        m_pAccumulateAndTotalAlphaSortedPS = pDevice->CreatePixelShader(g_AccumulateAndTotalAlphaSortedPS, sizeof(g_AccumulateAndTotalAlphaSortedPS));
+
+        m_pCopyOpaqueDepthPS = pDevice->CreatePixelShader(g_CopyOpaqueDepthPS, sizeof(g_CopyOpaqueDepthPS));
+
+        m_pFarthestStochasticDepthPS = pDevice->CreatePixelShader(g_FarthestStochasticDepthPS, sizeof(g_FarthestStochasticDepthPS));
+        m_pSortFarthestStochasticDepthPS = pDevice->CreatePixelShader(g_SortFarthestStochasticDepthPS, sizeof(g_SortFarthestStochasticDepthPS));
+
+        m_pTemporalPS = pDevice->CreatePixelShader(g_TemporalPS, sizeof(g_TemporalPS));
+        m_pTemporalDepthPS = pDevice->CreatePixelShader(g_TemporalDepthPS, sizeof(g_TemporalDepthPS));
+        m_pProgressiveChangePS = pDevice->CreatePixelShader(g_ProgressiveChangePS, sizeof(g_ProgressiveChangePS));
+
+        m_pDenoisePS = pDevice->CreatePixelShader(g_DenoisePS, sizeof(g_DenoisePS));
+
+    }
+
+    void CreateBlendStates(RHIDevice* pDevice)
+    {
+        RHIBlendDesc BlendStateDesc;
+        //To ensure uncorrelated, the AlphaToCoverage can't be used
+        BlendStateDesc.AlphaToCoverageEnable = false;
+
+        //0 For Accumulate
+        //1 For TotalAlpha
+        BlendStateDesc.IndependentBlendEnable = true;
+
+        //DestColor/*ToRT*/ = BlendOp(DestBlend*DestColor/*FromRT*/, SrcBlend*SrcColor/*FromPS*/)
+        //DestAlpha/*ToRT*/ = BlendOpAlpha(DestBlendAlpha*DestAlpha/*FromRT*/, SrcBlendAlpha*SrcAlpha/*FromPS*/)
+
+        //StochasticColor+CorrectTotalAlpha
+        BlendStateDesc.RenderTarget[0].BlendEnable = true;
+        BlendStateDesc.RenderTarget[0].SrcBlend = RHI_BLEND_ONE;
+        BlendStateDesc.RenderTarget[0].DestBlend = RHI_BLEND_ONE;
+        BlendStateDesc.RenderTarget[0].BlendOp = RHI_BLEND_OP_ADD;
+        BlendStateDesc.RenderTarget[0].SrcBlendAlpha = RHI_BLEND_ZERO;
+        BlendStateDesc.RenderTarget[0].DestBlendAlpha = RHI_BLEND_INV_SRC_ALPHA;
+        BlendStateDesc.RenderTarget[0].BlendOpAlpha = RHI_BLEND_OP_ADD;
+        BlendStateDesc.RenderTarget[0].RenderTargetWriteMask = RHI_COLOR_WRITE_ENABLE_ALL;
+
+        //StochasticTotalAlpha
+        BlendStateDesc.RenderTarget[1].BlendEnable = true;
+        BlendStateDesc.RenderTarget[1].SrcBlend = RHI_BLEND_ONE;
+        BlendStateDesc.RenderTarget[1].DestBlend = RHI_BLEND_ONE;
+        BlendStateDesc.RenderTarget[1].BlendOp = RHI_BLEND_OP_ADD;
+        BlendStateDesc.RenderTarget[1].SrcBlendAlpha = RHI_BLEND_ONE;
+        BlendStateDesc.RenderTarget[1].DestBlendAlpha = RHI_BLEND_ONE;
+        BlendStateDesc.RenderTarget[1].BlendOpAlpha = RHI_BLEND_OP_ADD;
+        BlendStateDesc.RenderTarget[1].RenderTargetWriteMask = RHI_COLOR_WRITE_ENABLE_ALL;
+
+        for (int i = 2; i < RHI_MAX_RENDER_TARGETS; ++i)
+        {
+        	BlendStateDesc.RenderTarget[i].BlendEnable = false;
+        	BlendStateDesc.RenderTarget[i].RenderTargetWriteMask = RHI_COLOR_WRITE_ENABLE_ALL;
+        }
+
+        m_pTotalAlphaAndAccumulateBS = pDevice->CreateBlendState(BlendStateDesc);
+    }
+
+    void CreateDepthStencilStates(RHIDevice* pDevice)
+    {
+        //Writes the copied opaque depths whatever the stochastic depths were
+        RHIDepthStencilDesc DepthStencilDesc;
+        DepthStencilDesc.DepthEnable = true;
+        DepthStencilDesc.DepthWriteEnable = true;
+        DepthStencilDesc.DepthFunc = RHI_COMPARISON_ALWAYS;
+        m_pDepthAlwaysDS = pDevice->CreateDepthStencilState(DepthStencilDesc);
+    }
+
+    void CreateRandomBitmasks(RHIDevice* pDevice)
+    {
+        // The CPU copy is kept for the CPU kernels (CoverageMasks.h)
+        BuildCoverageMaskTable(m_CoverageMasks, RANDOM_SIZE, ALPHA_VALUES, NUM_MSAA_SAMPLES);
+
+        RHITextureDesc texDesc;
+        texDesc.Width            = RANDOM_SIZE;
+        texDesc.Height           = ALPHA_VALUES + 1;
+        texDesc.ArraySize        = 1;
+        texDesc.Format           = RHI_FORMAT_R32_UINT;
+        texDesc.SampleCount      = 1;
+        texDesc.BindFlags        = RHI_BIND_SHADER_RESOURCE;
+
+        SAFE_DELETE(m_pRndTextureSRV);
+        SAFE_DELETE(m_pRndTexture);
+        m_pRndTexture = pDevice->CreateTexture2D(texDesc, &m_CoverageMasks.Masks[0], texDesc.Width * sizeof(unsigned int));
+        assert(m_pRndTexture);
+
+        m_pRndTextureSRV = pDevice->CreateShaderResourceView(m_pRndTexture);
+    }
+
+    void CreateFrameBuffer(RHIDevice* pDevice, UINT Width, UINT Height)
+    {
+		//Turning on MSAA in StochasticDepthPass is to random sample
+		//and the stochastic transparency intrinsically doesn't demand other passes to turn on the MSAA.
+        {
+        RHITextureDesc texDesc;
+        texDesc.Width = Width;
+        texDesc.Height = Height;
+        texDesc.ArraySize = 1;
+        texDesc.SampleCount = 1U;
+        texDesc.BindFlags = RHI_BIND_RENDER_TARGET | RHI_BIND_SHADER_RESOURCE;
+
+        m_pBackgroundRenderTarget = new SimpleRT(pDevice, &texDesc, RHI_FORMAT_R8G8B8A8_UNORM);
+        m_pStochasticColorAndCorrectTotalAlphaRenderTarget = new SimpleRT(pDevice, &texDesc, RHI_FORMAT_R8G8B8A8_UNORM);
+        m_pStochasticTotalAlphaRenderTarget = new SimpleRT(pDevice, &texDesc, RHI_FORMAT_R16_FLOAT); //STOCHASTIC_COLOR_FORMAT;
+
+        //The filtered U keeps the fractions of the 8-bit steps
+        m_pDenoisedColorAndCorrectTotalAlphaRenderTarget = new SimpleRT(pDevice, &texDesc, RHI_FORMAT_R16G16B16A16_FLOAT);
+        m_pDenoisedTotalAlphaRenderTarget = new SimpleRT(pDevice, &texDesc, RHI_FORMAT_R16_FLOAT);
+
+        //RGBA16F: the history accumulates differences below one 8-bit step
+        m_pTemporalCurrent = new SimpleRT(pDevice, &texDesc, RHI_FORMAT_R16G16B16A16_FLOAT);
+        m_pTemporalDepth = new SimpleRT(pDevice, &texDesc, RHI_FORMAT_R32_FLOAT);
+        CreateTemporalHistory(pDevice);
+
+        texDesc.Width = GetNumTiles(Width);
+        texDesc.Height = GetNumTiles(Height);
+        m_pProgressiveChange = new SimpleRT(pDevice, &texDesc, RHI_FORMAT_R32_FLOAT);
+        }
+
+        //Read by the copy to the stochastic depth
+        {
+        RHITextureDesc texDesc;
+        texDesc.ArraySize = 1;
+        texDesc.BindFlags = RHI_BIND_DEPTH_STENCIL | RHI_BIND_SHADER_RESOURCE;
+        texDesc.Format = RHI_FORMAT_D32_FLOAT;
+        texDesc.Width = Width;
+        texDesc.Height = Height;
+        texDesc.SampleCount = 1U;
+        m_pBackgroundDepth = new SimpleDepthStencil(pDevice, &texDesc);
+
+        texDesc.BindFlags = RHI_BIND_DEPTH_STENCIL;
+        m_pFarthestDepth = new SimpleDepthStencil(pDevice, &texDesc);
+        }
+    }
+
+    //RGBA32F for the progressive refinement: after N frames, a frame weighs 1 / N in the mean,
+    //below the 11-bit mantissa of RGBA16F after a few hundred frames
+    void CreateTemporalHistory(RHIDevice* pDevice)
+    {
+        const RHITextureDesc &Desc = m_pTemporalCurrent->pTexture->GetDesc();
+        RHITextureDesc texDesc;
+        texDesc.Width = Desc.Width;
+        texDesc.Height = Desc.Height;
+        texDesc.ArraySize = 1;
+        texDesc.SampleCount = 1U;
+        texDesc.BindFlags = RHI_BIND_RENDER_TARGET | RHI_BIND_SHADER_RESOURCE;
+
+        const RHIFormat Format = m_ProgressiveRefinement ? RHI_FORMAT_R32G32B32A32_FLOAT : RHI_FORMAT_R16G16B16A16_FLOAT;
+        for (UINT i = 0; i < 2; ++i)
+        {
+            SAFE_DELETE(m_pTemporalHistory[i]);
+            m_pTemporalHistory[i] = new SimpleRT(pDevice, &texDesc, Format);
+        }
+        InvalidateCommands();
+    }
+
+    void CreateStochasticDepth(RHIDevice* pDevice, UINT Width, UINT Height)
+    {
+        m_pStochasticDepth = new StochasticDepth(pDevice, Width, Height, RHI_FORMAT_D32_FLOAT);
+
+        //Full precision: the ranks are exact comparisons against the stochastic depths
+        RHITextureDesc texDesc;
+        texDesc.Width = Width;
+        texDesc.Height = Height;
+        texDesc.ArraySize = 1;
+        texDesc.SampleCount = 1U;
+        texDesc.BindFlags = RHI_BIND_RENDER_TARGET | RHI_BIND_SHADER_RESOURCE;
+        for (UINT i = 0; i < NUM_SORTED_DEPTH_TARGETS; ++i)
+        {
+            m_pSortedStochasticDepth[i] = new SimpleRT(pDevice, &texDesc, RHI_FORMAT_R32G32B32A32_FLOAT);
+        }
+    }
+	
+	SimpleRT *m_pBackgroundRenderTarget;
+	SimpleDepthStencil *m_pBackgroundDepth;
+	SimpleDepthStencil *m_pFarthestDepth;
+	SimpleRT *m_pTemporalCurrent;
+	SimpleRT *m_pTemporalHistory[2];
+	SimpleRT *m_pTemporalDepth;
+	SimpleRT *m_pProgressiveChange;
+    StochasticDepth* m_pStochasticDepth;
+	SimpleRT *m_pStochasticColorAndCorrectTotalAlphaRenderTarget;
+    SimpleRT *m_pStochasticTotalAlphaRenderTarget;
+	SimpleRT *m_pDenoisedColorAndCorrectTotalAlphaRenderTarget;
+	SimpleRT *m_pDenoisedTotalAlphaRenderTarget;
+
+	RHIShader *m_pStochasticDepthPS;
+	RHIShader *m_pTotalAlphaAndAccumulatePS;
+	RHIShader *m_pCompositePS;
+	RHIShader *m_pSortStochasticDepthPS;
+	RHIShader *m_pAccumulateAndTotalAlphaSortedPS;
+	RHIShader *m_pCopyOpaqueDepthPS;
+	RHIShader *m_pFarthestStochasticDepthPS;
+	RHIShader *m_pSortFarthestStochasticDepthPS;
+	RHIShader *m_pTemporalPS;
+	RHIShader *m_pTemporalDepthPS;
+	RHIShader *m_pProgressiveChangePS;
+	RHIShader *m_pDenoisePS;
+
+	SimpleRT *m_pSortedStochasticDepth[NUM_SORTED_DEPTH_TARGETS];
+	bool m_SortedDepths;
+	bool m_FarthestDepthRejection;
+	bool m_Denoise;
+
+	bool m_TemporalAccumulation;
+	bool m_TemporalDepthOutput;
+	bool m_HistoryValid;
+	UINT m_HistoryIndex;                        // Of the history written by the frame
+	DirectX::XMFLOAT4X4 m_PrevWorldViewProj;
+	bool m_ProgressiveRefinement;
+	UINT m_NumProgressiveFrames;                // In the running mean written by the frame
+
+	RHITexture *m_pRndTexture;
+	RHIView *m_pRndTextureSRV;
+	CoverageMaskTable m_CoverageMasks;
+
+	RHIBlendState *m_pTotalAlphaAndAccumulateBS;
+	RHIDepthStencilState *m_pDepthAlwaysDS;
+};
@@ -1,174 +1,553 @@
-// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
-//
-// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
-// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
-// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
-// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA 
-// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR  
-// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS 
-// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY 
-// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE, 
-// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
-//
-// Please direct any bugs or questions to SDKFeedback@nvidia.com
-
-#include "BaseTechnique.hlsli"
-
-// Assuming that tStochasticDepth  have 8 samples per pixel
-#define NUM_MSAA_SAMPLES 8
-
-// Alpha correction (Section 3.2 of the paper)
-// Removes noise for pixels with low depth complexity (1-2 layers / pixel)
-#define USE_ALPHA_CORRECTION 1
-
-Texture2D<uint>    tRandoms                                      : register(t0);
-Texture2DMS<float> tStochasticDepth                              : register(t0);
-Texture2D<float3>  tBackgroundColor                              : register(t0);
-Texture2D<float4>  tStochasticColorAndCorrectTotalAlphaBuffer    : register(t1);
-Texture2D<float>   tStochasticTotalAlphaBuffer                   : register(t2);
-
-// from http://www.concentric.net/~Ttwang/tech/inthash.htm
-uint ihash(uint seed)
-{
-    seed = (seed+0x7ed55d16u) + (seed<<12);
-    seed = (seed^0xc761c23cu) ^ (seed>>19);
-    seed = (seed+0x165667b1u) + (seed<<5);
-    seed = (seed+0xd3a2646cu) ^ (seed<<9);
-    seed = (seed+0xfd7046c5u) + (seed<<3);
-    seed = (seed^0xb55a4f09u) ^ (seed>>16);
-    return seed;
-}
-
-// pixelPos = 2D screen-space position for the current fragment
-// primID = auto-generated primitive id for the current fragment
-uint getlayerseed(uint2 pixelPos, int primID)
-{
-    // Seeding by primitive id, as described in Section 5 of the paper.
-    uint layerseed = primID * 32;
-
-    // For simulating more than 8 samples per pixel, the algorithm
-    // can be run in multiple passes with different random offsets.
-    layerseed += g_randomOffset;
-
-    layerseed += (pixelPos.x << 10) + (pixelPos.y << 20);
-    return layerseed;
-}
-
-// Compute mask based on primitive id and alpha
-uint randmaskwide(uint2 pixelPos, float alpha, int primID)
-{
-    // Generate seed based on fragment coords and primitive id
-    uint seed = getlayerseed(pixelPos, primID);
-
-    // Compute a hash with uniform distribution
-    seed = ihash(seed);
-
-    // Modulo operation
-    seed &= g_randMaskSizePowOf2MinusOne;
-
-    // Quantize alpha from [0.0,1.0] to [0,ALPHA_VALUES]
-    uint2 coords = uint2(seed, alpha * g_randMaskAlphaValues);
-
-    return tRandoms.Load(int3(coords, 0)).r;
-}
-
-//Stochastic Depth Pass
-struct Pixel_PSOut1
-{
-	float depth : SV_DEPTH;
-	//float depthge : SV_DepthGreaterEqual; //Conservative Depth
-	//float depthle : SV_DepthLessEqual; //Z-Reverse
-	uint coverage : SV_Coverage;
-};
-
-//[earlydepthstencil]
-Pixel_PSOut1 StochasticDepthPS ( Geometry_VSOut IN, uint PrimitiveID : SV_PrimitiveID )
-{
-	//AlphaToCoverage Is Uncorrelated!
-
-    float alpha = ShadeFragment(IN.Normal).a;
-	
-	Pixel_PSOut1 rtval;
-	//TODO: There still exist gaps between the triangles. This may be related to the Tie-Break rule. Try to use conservative rasterization.
-	rtval.depth = IN.HPosition.z; //interpolation centroid not sample 
-	//rtval.depthge = IN.HPosition.z; 
-	//rtval.depthle = IN.HPosition.z;
-	rtval.coverage = randmaskwide(uint2(IN.HPosition.xy), alpha, PrimitiveID);
-	return rtval;
-}
-
-//We Merge TotalAlpha Pass And Accumulation Pass Together.
-struct Pixel_PSOut
-{
-	float4 StochasticColorAndCorrectTotalAlpha : SV_Target0;
-	float4 StochasticTotalAlpha                : SV_Target1;
-};
-
-//TotalAlpha And Accumulate Pass
-Pixel_PSOut AccumulateAndTotalAlphaPS( Geometry_VSOut IN )
-{
-	//Estimate Visibility
-	//3.2 Stochastic Shadow Maps
-	//svis(z) = count(z<=zi)/S ≈ vis(z) //We may use Reverse-Z
-
-	int2 pos2d = int2(IN.HPosition.xy); //Sample 8 Times While Shading Once //We Cast From float To int
-	float z = IN.HPosition.z;
-	uint count = 0;
-	
-	[unroll]
-	for (uint sampleId = 0; sampleId < NUM_MSAA_SAMPLES; ++sampleId)
-	{
-		float zi = tStochasticDepth.Load(pos2d, sampleId).r;
-		if (z <= zi)
-		{
-			++count;
-		}
-	}
-
-	float visz = ((float)count) / ((float)NUM_MSAA_SAMPLES);
-
-	//3.4 Depth-Based Stochastic Transparency
-	//C = Σ vis(z)*a*c
-    float4 rgba = ShadeFragment(IN.Normal);
-	float3 c = rgba.rgb;
-	float a = rgba.a;
-
-	//4.2 Bias of Depth-Based Methods
-	//U = Σ visz * c * a
-	//U1 = Σ visz * a //The "R/S"
-	float ac = visz * a;
-
-	Pixel_PSOut rtval;
-	rtval.StochasticColorAndCorrectTotalAlpha = float4(ac * c, a);
-	rtval.StochasticTotalAlpha = float4(ac, ac, ac, ac);
-	return rtval;
-}
-
-float4 CompositePS(FullscreenVSOut IN) : SV_Target
-{
-    int2 pos2d = int2(IN.pos.xy);
-
-	//Step 1: Total Alpha Correction
-#if USE_ALPHA_CORRECTION
-	//4.2 Bias of Depth-Based Methods
-	float4 UAndT = tStochasticColorAndCorrectTotalAlphaBuffer.Load(int3(pos2d, 0));
-	float3 U = UAndT.rgb; //U = visz * c * a
-	float transmittance = UAndT.a; //TotalAlpha  
-	
-	float U1 = tStochasticTotalAlphaBuffer.Load(int3(pos2d, 0)).r; //U1 = visz * a //The "R/S"
-
-	float AC = 1.0 - transmittance; //TotalAlpha
-	float3 D = (U1 > 0.0) ? (AC*U / U1) : 0.0;
-
-	float3 transparentColor = D;
-#else
-	 //Too Dark
-	float4 UAndT = tStochasticColorAndCorrectTotalAlphaBuffer.Load(int3(pos2d, 0));
-	float3 transparentColor = UAndT.rgb; //U = visz * c * a
-	float transmittance = UAndT.a; //TotalAlpha  
-#endif
-
-	//Step 2: Under Operator
-	float3 backgroundColor = tBackgroundColor.Load(int3(pos2d, 0)).rgb;
-	return float4(transparentColor + transmittance * backgroundColor, 1.0);
-}
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA 
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR  
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS 
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY 
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE, 
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+#include "BaseTechnique.hlsli"
+
+// Assuming that tStochasticDepth  have 8 samples per pixel
+#define NUM_MSAA_SAMPLES 8
+
+// Alpha correction (Section 3.2 of the paper)
+// Removes noise for pixels with low depth complexity (1-2 layers / pixel)
+#define USE_ALPHA_CORRECTION 1
+
+Texture2D<uint>    tRandoms                                      : register(t0);
+Texture2DMS<float> tStochasticDepth                              : register(t0);
+Texture2D<float3>  tBackgroundColor                              : register(t0);
+Texture2D<float4>  tStochasticColorAndCorrectTotalAlphaBuffer    : register(t1);
+Texture2D<float>   tStochasticTotalAlphaBuffer                   : register(t2);
+Texture2D<float4>  tSortedStochasticDepth0                       : register(t0);
+Texture2D<float4>  tSortedStochasticDepth1                       : register(t1);
+Texture2D<float>   tOpaqueDepth                                  : register(t0);
+
+// from http://www.concentric.net/~Ttwang/tech/inthash.htm
+uint ihash(uint seed)
+{
+    seed = (seed+0x7ed55d16u) + (seed<<12);
+    seed = (seed^0xc761c23cu) ^ (seed>>19);
+    seed = (seed+0x165667b1u) + (seed<<5);
+    seed = (seed+0xd3a2646cu) ^ (seed<<9);
+    seed = (seed+0xfd7046c5u) + (seed<<3);
+    seed = (seed^0xb55a4f09u) ^ (seed>>16);
+    return seed;
+}
+
+// pixelPos = 2D screen-space position for the current fragment
+// primID = auto-generated primitive id for the current fragment
+uint getlayerseed(uint2 pixelPos, int primID)
+{
+    // Seeding by primitive id, as described in Section 5 of the paper.
+    uint layerseed = primID * 32;
+
+    // For simulating more than 8 samples per pixel, the algorithm
+    // can be run in multiple passes with different random offsets.
+    layerseed += g_randomOffset;
+
+    layerseed += (pixelPos.x << 10) + (pixelPos.y << 20);
+    return layerseed;
+}
+
+// Compute mask based on primitive id and alpha
+uint randmaskwide(uint2 pixelPos, float alpha, int primID)
+{
+    // Generate seed based on fragment coords and primitive id
+    uint seed = getlayerseed(pixelPos, primID);
+
+    // Compute a hash with uniform distribution
+    seed = ihash(seed);
+
+    // Modulo operation
+    seed &= g_randMaskSizePowOf2MinusOne;
+
+    // Quantize alpha from [0.0,1.0] to [0,ALPHA_VALUES]
+    uint2 coords = uint2(seed, alpha * g_randMaskAlphaValues);
+
+    return tRandoms.Load(int3(coords, 0)).r;
+}
+
+//Opaque Depth Copy
+//Initializes every sample of the stochastic depth with the depth of the opaque geometry,
+//so that the stochastic depth pass rejects the transparent fragments hidden by it.
+float CopyOpaqueDepthPS( FullscreenVSOut IN ) : SV_Depth
+{
+	return tOpaqueDepth.Load(int3(IN.pos.xy, 0));
+}
+
+//Stochastic Depth Pass
+struct Pixel_PSOut1
+{
+	float depth : SV_DEPTH;
+	//float depthge : SV_DepthGreaterEqual; //Conservative Depth
+	//float depthle : SV_DepthLessEqual; //Z-Reverse
+	uint coverage : SV_Coverage;
+};
+
+//[earlydepthstencil]
+Pixel_PSOut1 StochasticDepthPS ( Geometry_VSOut IN, uint PrimitiveID : SV_PrimitiveID )
+{
+	//AlphaToCoverage Is Uncorrelated!
+
+    float alpha = ShadeFragment(IN.Normal).a;
+	
+	Pixel_PSOut1 rtval;
+	//TODO: There still exist gaps between the triangles. This may be related to the Tie-Break rule. Try to use conservative rasterization.
+	rtval.depth = IN.HPosition.z; //interpolation centroid not sample 
+	//rtval.depthge = IN.HPosition.z; 
+	//rtval.depthle = IN.HPosition.z;
+	rtval.coverage = randmaskwide(uint2(IN.HPosition.xy), alpha, PrimitiveID);
+	return rtval;
+}
+
+//We Merge TotalAlpha Pass And Accumulation Pass Together.
+struct Pixel_PSOut
+{
+	float4 StochasticColorAndCorrectTotalAlpha : SV_Target0;
+	float4 StochasticTotalAlpha                : SV_Target1;
+};
+
+//TotalAlpha And Accumulate Pass, for a fragment with visibility visz
+Pixel_PSOut AccumulateFragment( Geometry_VSOut IN, float visz )
+{
+	//3.4 Depth-Based Stochastic Transparency
+	//C = Σ vis(z)*a*c
+    float4 rgba = ShadeFragment(IN.Normal);
+	float3 c = rgba.rgb;
+	float a = rgba.a;
+
+	//4.2 Bias of Depth-Based Methods
+	//U = Σ visz * c * a
+	//U1 = Σ visz * a //The "R/S"
+	float ac = visz * a;
+
+	Pixel_PSOut rtval;
+	rtval.StochasticColorAndCorrectTotalAlpha = float4(ac * c, a);
+	rtval.StochasticTotalAlpha = float4(ac, ac, ac, ac);
+	return rtval;
+}
+
+Pixel_PSOut AccumulateAndTotalAlphaPS( Geometry_VSOut IN )
+{
+	//Estimate Visibility
+	//3.2 Stochastic Shadow Maps
+	//svis(z) = count(z<=zi)/S ≈ vis(z) //We may use Reverse-Z
+
+	int2 pos2d = int2(IN.HPosition.xy); //Sample 8 Times While Shading Once //We Cast From float To int
+	//With D16, the fragment's own sample holds its depth rounded to the nearest UNORM value
+	float z = IN.HPosition.z - g_stochasticDepthBias;
+	uint count = 0;
+	
+	[unroll]
+	for (uint sampleId = 0; sampleId < NUM_MSAA_SAMPLES; ++sampleId)
+	{
+		float zi = tStochasticDepth.Load(pos2d, sampleId).r;
+		if (z <= zi)
+		{
+			++count;
+		}
+	}
+
+	float visz = ((float)count) / ((float)NUM_MSAA_SAMPLES);
+
+	return AccumulateFragment(IN, visz);
+}
+
+//Sorted Stochastic Depth Pass (optional)
+//Sorts the stochastic depths of each pixel once, so that the accumulation pass reads
+//them with 1-2 loads instead of NUM_MSAA_SAMPLES, whatever the depth complexity.
+#define CSWAP(a, b) { float t = min(a, b); b = max(a, b); a = t; }
+
+struct Pixel_PSOutSorted
+{
+	float4 SortedDepth0 : SV_Target0;
+#if NUM_MSAA_SAMPLES == 8
+	float4 SortedDepth1 : SV_Target1;
+#endif
+};
+
+Pixel_PSOutSorted SortStochasticDepth( int2 pos2d )
+{
+	float z[8];
+	[unroll]
+	for (uint sampleId = 0; sampleId < NUM_MSAA_SAMPLES; ++sampleId)
+	{
+		z[sampleId] = tStochasticDepth.Load(pos2d, sampleId).r;
+	}
+
+	Pixel_PSOutSorted rtval;
+#if NUM_MSAA_SAMPLES == 8
+	//Optimal sorting network for 8 inputs (19 comparators, depth 6)
+	CSWAP(z[0], z[2]); CSWAP(z[1], z[3]); CSWAP(z[4], z[6]); CSWAP(z[5], z[7]);
+	CSWAP(z[0], z[4]); CSWAP(z[1], z[5]); CSWAP(z[2], z[6]); CSWAP(z[3], z[7]);
+	CSWAP(z[0], z[1]); CSWAP(z[2], z[3]); CSWAP(z[4], z[5]); CSWAP(z[6], z[7]);
+	CSWAP(z[2], z[4]); CSWAP(z[3], z[5]);
+	CSWAP(z[1], z[4]); CSWAP(z[3], z[6]);
+	CSWAP(z[1], z[2]); CSWAP(z[3], z[4]); CSWAP(z[5], z[6]);
+	rtval.SortedDepth0 = float4(z[0], z[1], z[2], z[3]);
+	rtval.SortedDepth1 = float4(z[4], z[5], z[6], z[7]);
+#else
+	CSWAP(z[0], z[1]); CSWAP(z[2], z[3]);
+	CSWAP(z[0], z[2]); CSWAP(z[1], z[3]);
+	CSWAP(z[1], z[2]);
+	rtval.SortedDepth0 = float4(z[0], z[1], z[2], z[3]);
+#endif
+	return rtval;
+}
+
+Pixel_PSOutSorted SortStochasticDepthPS( FullscreenVSOut IN )
+{
+	return SortStochasticDepth(int2(IN.pos.xy));
+}
+
+//Farthest Stochastic Depth Pass (optional)
+//A fragment behind every stochastic sample of its pixel has a zero visibility, so the
+//accumulation pass can depth-test against the farthest sample, and the hierarchical Z of
+//the GPU then rejects such fragments by whole tiles. They are left out of the total alpha,
+//which is then too transparent where the samples are saturated.
+//A pixel is saturated when all its samples are covered nearer than the opaque depth they
+//were initialized with: only then is the farthest depth nearer than the opaque depth.
+float FarthestDepth( float zmax )
+{
+	//The accumulation pass compares z - g_stochasticDepthBias <= zi
+	return min(zmax + g_stochasticDepthBias, 1.0);
+}
+
+float FarthestStochasticDepthPS( FullscreenVSOut IN ) : SV_Depth
+{
+	int2 pos2d = int2(IN.pos.xy);
+
+	float zmax = 0.0;
+	[unroll]
+	for (uint sampleId = 0; sampleId < NUM_MSAA_SAMPLES; ++sampleId)
+	{
+		zmax = max(zmax, tStochasticDepth.Load(pos2d, sampleId).r);
+	}
+
+	return FarthestDepth(zmax);
+}
+
+//Both passes in one when the depths are sorted: the farthest depth is the last sorted one
+struct Pixel_PSOutSortedFarthest
+{
+	float4 SortedDepth0 : SV_Target0;
+#if NUM_MSAA_SAMPLES == 8
+	float4 SortedDepth1 : SV_Target1;
+#endif
+	float Depth         : SV_Depth;
+};
+
+Pixel_PSOutSortedFarthest SortFarthestStochasticDepthPS( FullscreenVSOut IN )
+{
+	Pixel_PSOutSorted sorted = SortStochasticDepth(int2(IN.pos.xy));
+
+	Pixel_PSOutSortedFarthest rtval;
+	rtval.SortedDepth0 = sorted.SortedDepth0;
+#if NUM_MSAA_SAMPLES == 8
+	rtval.SortedDepth1 = sorted.SortedDepth1;
+	rtval.Depth = FarthestDepth(sorted.SortedDepth1.w);
+#else
+	rtval.Depth = FarthestDepth(sorted.SortedDepth0.w);
+#endif
+	return rtval;
+}
+
+//TotalAlpha And Accumulate Pass on the sorted depths
+//count(z<=zi) = S - count(zi<z), where count(zi<z) is found by a binary search
+//made of selects only: no branches and no indexing of temporary arrays.
+Pixel_PSOut AccumulateAndTotalAlphaSortedPS( Geometry_VSOut IN )
+{
+	int2 pos2d = int2(IN.HPosition.xy);
+	float z = IN.HPosition.z - g_stochasticDepthBias;
+
+	float4 quad = tSortedStochasticDepth0.Load(int3(pos2d, 0));
+	uint rank = 0;
+#if NUM_MSAA_SAMPLES == 8
+	float4 upper = tSortedStochasticDepth1.Load(int3(pos2d, 0));
+	bool b4 = (quad.w < z);
+	quad = b4 ? upper : quad;
+	rank += b4 ? 4 : 0;
+#endif
+	bool b2 = (quad.y < z);
+	float2 pair = b2 ? quad.zw : quad.xy;
+	rank += b2 ? 2 : 0;
+	bool b1 = (pair.x < z);
+	rank += b1 ? 1 : 0;
+	rank += ((b1 ? pair.y : pair.x) < z) ? 1 : 0;
+
+	float visz = ((float)(NUM_MSAA_SAMPLES - rank)) / ((float)NUM_MSAA_SAMPLES);
+
+	return AccumulateFragment(IN, visz);
+}
+
+float4 CompositePS(FullscreenVSOut IN) : SV_Target
+{
+    int2 pos2d = int2(IN.pos.xy);
+
+	//Step 1: Total Alpha Correction
+#if USE_ALPHA_CORRECTION
+	//4.2 Bias of Depth-Based Methods
+	float4 UAndT = tStochasticColorAndCorrectTotalAlphaBuffer.Load(int3(pos2d, 0));
+	float3 U = UAndT.rgb; //U = visz * c * a
+	float transmittance = UAndT.a; //TotalAlpha  
+	
+	float U1 = tStochasticTotalAlphaBuffer.Load(int3(pos2d, 0)).r; //U1 = visz * a //The "R/S"
+
+	float AC = 1.0 - transmittance; //TotalAlpha
+	float3 D = (U1 > 0.0) ? (AC*U / U1) : 0.0;
+
+	float3 transparentColor = D;
+#else
+	 //Too Dark
+	float4 UAndT = tStochasticColorAndCorrectTotalAlphaBuffer.Load(int3(pos2d, 0));
+	float3 transparentColor = UAndT.rgb; //U = visz * c * a
+	float transmittance = UAndT.a; //TotalAlpha  
+#endif
+
+	//Step 2: Under Operator
+	//The transmittance goes to alpha for the temporal accumulation; the back buffer alpha is not presented
+	float3 backgroundColor = tBackgroundColor.Load(int3(pos2d, 0)).rgb;
+	return float4(transparentColor + transmittance * backgroundColor, transmittance);
+}
+
+//Denoise Pass (optional)
+//Edge-aware filter of U and U1 before the composite: 5x5 joint bilateral weights, stopped by
+//the changes of the total alpha, with a strength from the spread of the stochastic depths.
+//Reads tStochasticDepth, tStochasticColorAndCorrectTotalAlphaBuffer and tStochasticTotalAlphaBuffer.
+//Must match DenoisePixel and GetDenoiseStrength in Denoiser.h.
+#define DENOISE_RADIUS 2
+#define DENOISE_ALPHA_SCALE 8.0
+#define DENOISE_DEPTH_SCALE 64.0
+
+static const float DenoiseKernel[2 * DENOISE_RADIUS + 1] = { 1.0 / 16.0, 4.0 / 16.0, 6.0 / 16.0, 4.0 / 16.0, 1.0 / 16.0 };
+
+//The samples at the farthest depth are the uncovered ones, or the last layer
+float DenoiseStrength( int2 pos2d )
+{
+	float z[NUM_MSAA_SAMPLES];
+	float zmax = 0.0;
+	[unroll]
+	for (uint sampleId = 0; sampleId < NUM_MSAA_SAMPLES; ++sampleId)
+	{
+		z[sampleId] = tStochasticDepth.Load(pos2d, sampleId).r;
+		zmax = max(zmax, z[sampleId]);
+	}
+
+	float m1 = 0.0;
+	float m2 = 0.0;
+	float count = 0.0;
+	[unroll]
+	for (uint i = 0; i < NUM_MSAA_SAMPLES; ++i)
+	{
+		float nearer = (z[i] < zmax) ? 1.0 : 0.0;
+		m1 += nearer * z[i];
+		m2 += nearer * z[i] * z[i];
+		count += nearer;
+	}
+	if (count == 0.0) return 0.0;
+
+	m1 /= count;
+	m2 /= count;
+	return min(sqrt(max(m2 - m1 * m1, 0.0)) * DENOISE_DEPTH_SCALE, 1.0);
+}
+
+struct Pixel_PSOutDenoise
+{
+	float4 StochasticColorAndCorrectTotalAlpha : SV_Target0;
+	float  StochasticTotalAlpha                : SV_Target1;
+};
+
+Pixel_PSOutDenoise DenoisePS( FullscreenVSOut IN )
+{
+	int2 pos2d = int2(IN.pos.xy);
+	int2 maxPos = int2(g_screenSize.xy) - 1;
+
+	//The transmittance is exact: it guides the filter and is kept as is
+	float transmittance = tStochasticColorAndCorrectTotalAlphaBuffer.Load(int3(pos2d, 0)).a;
+	float strength = DenoiseStrength(pos2d);
+
+	float4 sum = 0.0; //U, U1
+	float sumW = 0.0;
+	[unroll]
+	for (int dy = -DENOISE_RADIUS; dy <= DENOISE_RADIUS; ++dy)
+	{
+		[unroll]
+		for (int dx = -DENOISE_RADIUS; dx <= DENOISE_RADIUS; ++dx)
+		{
+			int2 tap = clamp(pos2d + int2(dx, dy), 0, maxPos);
+			float4 UAndT = tStochasticColorAndCorrectTotalAlphaBuffer.Load(int3(tap, 0));
+			float U1 = tStochasticTotalAlphaBuffer.Load(int3(tap, 0)).r;
+
+			float w = DenoiseKernel[dy + DENOISE_RADIUS] * DenoiseKernel[dx + DENOISE_RADIUS];
+			if (dx != 0 || dy != 0)
+			{
+				w *= strength * saturate(1.0 - abs(UAndT.a - transmittance) * DENOISE_ALPHA_SCALE);
+			}
+			sum += w * float4(UAndT.rgb, U1);
+			sumW += w;
+		}
+	}
+
+	//The center weight is never 0
+	Pixel_PSOutDenoise rtval;
+	rtval.StochasticColorAndCorrectTotalAlpha = float4(sum.rgb / sumW, transmittance);
+	rtval.StochasticTotalAlpha = sum.a / sumW;
+	return rtval;
+}
+
+//Temporal Accumulation Pass (optional)
+//Blends the composite with the output of the previous frame, reprojected with the nearest
+//stochastic depth. Must match ResolveTemporal in TemporalAccumulation.h.
+Texture2D<float4>  tTemporalCurrent : register(t0); //Composite of the frame, with the transmittance in alpha
+Texture2D<float4>  tTemporalHistory : register(t1); //Output of the previous frame, idem
+Texture2DMS<float> tTemporalDepth   : register(t2);
+
+float NearestStochasticDepth( int2 pos2d )
+{
+	float z = 1.0;
+	[unroll]
+	for (uint sampleId = 0; sampleId < NUM_MSAA_SAMPLES; ++sampleId)
+	{
+		z = min(z, tTemporalDepth.Load(pos2d, sampleId).r);
+	}
+	return z;
+}
+
+//Bilinear fetch at a position in pixels, clamped to the edges
+float4 LoadHistory( float2 pixel )
+{
+	float2 p = pixel - 0.5;
+	int2 p0 = int2(floor(p));
+	float2 f = p - (float2)p0;
+	int2 maxPos = int2(g_screenSize.xy) - 1;
+
+	float4 h00 = tTemporalHistory.Load(int3(clamp(p0, 0, maxPos), 0));
+	float4 h10 = tTemporalHistory.Load(int3(clamp(p0 + int2(1, 0), 0, maxPos), 0));
+	float4 h01 = tTemporalHistory.Load(int3(clamp(p0 + int2(0, 1), 0, maxPos), 0));
+	float4 h11 = tTemporalHistory.Load(int3(clamp(p0 + int2(1, 1), 0, maxPos), 0));
+	return lerp(lerp(h00, h10, f.x), lerp(h01, h11, f.x), f.y);
+}
+
+float4 TemporalResolve( int2 pos2d, float z )
+{
+	float4 current = tTemporalCurrent.Load(int3(pos2d, 0));
+	int2 maxPos = int2(g_screenSize.xy) - 1;
+
+	//Progressive refinement: running mean of the frames of a static view, at the same pixel
+	if (g_temporalParams.w > 0.0)
+	{
+		float4 mean = tTemporalHistory.Load(int3(pos2d, 0));
+		return float4(current.rgb + (mean.rgb - current.rgb) * g_temporalParams.x, current.a);
+	}
+
+	//Variance clamping: the history is kept within the colors of the neighborhood
+	float3 m1 = 0.0;
+	float3 m2 = 0.0;
+	[unroll]
+	for (int dy = -1; dy <= 1; ++dy)
+	{
+		[unroll]
+		for (int dx = -1; dx <= 1; ++dx)
+		{
+			float3 c = tTemporalCurrent.Load(int3(clamp(pos2d + int2(dx, dy), 0, maxPos), 0)).rgb;
+			m1 += c;
+			m2 += c * c;
+		}
+	}
+	float3 mean = m1 / 9.0;
+	float3 sigma = sqrt(max(m2 / 9.0 - mean * mean, 0.0));
+
+	//Reprojection of the pixel center
+	float2 ndc = ((float2)pos2d + 0.5) * g_screenSize.zw * float2(2.0, -2.0) + float2(-1.0, 1.0);
+	float4 prev = mul(float4(ndc, z, 1.0), g_currentToPrevious);
+	float2 prevPixel = (prev.xy / prev.w * float2(0.5, -0.5) + 0.5) * g_screenSize.xy;
+
+	float weight = g_temporalParams.x;
+	float4 history = 0.0;
+	if (prev.w <= 0.0 || !(all(prevPixel >= 0.0) && all(prevPixel <= g_screenSize.xy)))
+	{
+		weight = 0.0;
+	}
+	else
+	{
+		//History rejection: the transmittance is exact, so its change means new layers
+		history = LoadHistory(prevPixel);
+		weight *= saturate(1.0 - abs(history.a - current.a) * g_temporalParams.y);
+	}
+
+	float3 clamped = clamp(history.rgb, mean - g_temporalParams.z * sigma, mean + g_temporalParams.z * sigma);
+	float3 color = (weight > 0.0) ? current.rgb + (clamped - current.rgb) * weight : current.rgb;
+	return float4(color, current.a);
+}
+
+struct Pixel_PSOutTemporal
+{
+	float4 Color   : SV_Target0;
+	float4 History : SV_Target1;
+};
+
+Pixel_PSOutTemporal TemporalPS( FullscreenVSOut IN )
+{
+	int2 pos2d = int2(IN.pos.xy);
+	float4 resolved = TemporalResolve(pos2d, NearestStochasticDepth(pos2d));
+
+	Pixel_PSOutTemporal rtval;
+	rtval.Color = float4(resolved.rgb, 1.0);
+	rtval.History = resolved;
+	return rtval;
+}
+
+//Also writes the nearest depths, for the CPU reference
+struct Pixel_PSOutTemporalDepth
+{
+	float4 Color   : SV_Target0;
+	float4 History : SV_Target1;
+	float  Depth   : SV_Target2;
+};
+
+Pixel_PSOutTemporalDepth TemporalDepthPS( FullscreenVSOut IN )
+{
+	int2 pos2d = int2(IN.pos.xy);
+	float z = NearestStochasticDepth(pos2d);
+	float4 resolved = TemporalResolve(pos2d, z);
+
+	Pixel_PSOutTemporalDepth rtval;
+	rtval.Color = float4(resolved.rgb, 1.0);
+	rtval.History = resolved;
+	rtval.Depth = z;
+	return rtval;
+}
+
+//Progressive Change Pass (progressive refinement only)
+//Largest change of the accumulated colors in each tile over the last frame,
+//rendered into one pixel per tile and read back for the convergence test
+Texture2D<float4>  tProgressiveHistory  : register(t0); //Running mean written by the frame
+Texture2D<float4>  tProgressivePrevious : register(t1); //Running mean of the previous frame
+
+float ProgressiveChangePS( FullscreenVSOut IN ) : SV_Target
+{
+	uint2 first = (uint2)IN.pos.xy * TILE_SIZE;
+	uint2 last = min(first + TILE_SIZE, (uint2)g_screenSize.xy);
+
+	float3 change = 0.0;
+	[loop]
+	for (uint y = first.y; y < last.y; ++y)
+	{
+		[loop]
+		for (uint x = first.x; x < last.x; ++x)
+		{
+			float3 history = tProgressiveHistory.Load(int3(x, y, 0)).rgb;
+			float3 previous = tProgressivePrevious.Load(int3(x, y, 0)).rgb;
+			change = max(change, abs(history - previous));
+		}
+	}
+	return max(change.r, max(change.g, change.b));
+}
@@ -0,0 +1 @@
+#include "StochasticTransparency.hlsli"
\ No newline at end of file
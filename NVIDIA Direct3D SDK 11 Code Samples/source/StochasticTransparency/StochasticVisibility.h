@@ -0,0 +1,294 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+#include "CoverageMasks.h"
+
+//--------------------------------------------------------------------------------------
+// CPU version of the visibility estimate of the accumulation pass, count(z<=zi) over the
+// 8 stochastic depths of a pixel, with and without the sorted depths fast path, and with
+// the early-out of the saturated pixels.
+// The depths are stored as the sorted depth targets: 8 consecutive floats per pixel.
+// The SIMD sorts run the same sorting network as SortStochasticDepthPS on 4 (SSE2) or
+// 8 (AVX2) pixels at a time, one register per sample; they use the dispatch of CoverageMasks.h.
+//--------------------------------------------------------------------------------------
+
+#define VISIBILITY_NUM_SAMPLES 8
+
+// Current loop: one compare per sample
+inline UINT CountVisibleSamples(const float *pDepths, float z)
+{
+    UINT Count = 0;
+    for (UINT SampleId = 0; SampleId < VISIBILITY_NUM_SAMPLES; ++SampleId)
+    {
+        if (z <= pDepths[SampleId]) ++Count;
+    }
+    return Count;
+}
+
+// Sorted fast path: S - count(zi<z), by a branch-free binary search (4 compares)
+inline UINT CountVisibleSamplesSorted(const float *pSortedDepths, float z)
+{
+    UINT Rank = 0;
+    Rank += (pSortedDepths[Rank + 3] < z) ? 4 : 0;
+    Rank += (pSortedDepths[Rank + 1] < z) ? 2 : 0;
+    Rank += (pSortedDepths[Rank] < z) ? 1 : 0;
+    Rank += (pSortedDepths[Rank] < z) ? 1 : 0;
+    return VISIBILITY_NUM_SAMPLES - Rank;
+}
+
+// Farthest of the stochastic depths of a pixel, the bound of FarthestStochasticDepthPS
+inline float GetFarthestDepth(const float *pDepths)
+{
+    float zmax = pDepths[0];
+    for (UINT SampleId = 1; SampleId < VISIBILITY_NUM_SAMPLES; ++SampleId)
+    {
+        zmax = std::max(zmax, pDepths[SampleId]);
+    }
+    return zmax;
+}
+
+// Saturated early-out: a fragment behind the farthest depth is behind all the samples,
+// which skips the loop for most of the fragments of the deep stacks
+inline UINT CountVisibleSamplesSaturated(const float *pDepths, float zmax, float z)
+{
+    if (z > zmax) return 0;
+    return CountVisibleSamples(pDepths, z);
+}
+
+// Optimal sorting network for 8 inputs (19 comparators, depth 6), as in the HLSL
+#define SORT_NETWORK_8(CSWAP, z) \
+    CSWAP(z[0], z[2]); CSWAP(z[1], z[3]); CSWAP(z[4], z[6]); CSWAP(z[5], z[7]); \
+    CSWAP(z[0], z[4]); CSWAP(z[1], z[5]); CSWAP(z[2], z[6]); CSWAP(z[3], z[7]); \
+    CSWAP(z[0], z[1]); CSWAP(z[2], z[3]); CSWAP(z[4], z[5]); CSWAP(z[6], z[7]); \
+    CSWAP(z[2], z[4]); CSWAP(z[3], z[5]); \
+    CSWAP(z[1], z[4]); CSWAP(z[3], z[6]); \
+    CSWAP(z[1], z[2]); CSWAP(z[3], z[4]); CSWAP(z[5], z[6]);
+
+#define SORT_CSWAP_SCALAR(a, b) { float t = std::min(a, b); b = std::max(a, b); a = t; }
+
+inline void SortStochasticDepthsScalar(float *pDepths, UINT NumPixels)
+{
+    for (UINT PixelId = 0; PixelId < NumPixels; ++PixelId)
+    {
+        float *z = pDepths + PixelId * VISIBILITY_NUM_SAMPLES;
+        SORT_NETWORK_8(SORT_CSWAP_SCALAR, z)
+    }
+}
+
+#if COVERAGE_MASKS_X86
+
+#define SORT_CSWAP_SSE(a, b) { __m128 t = _mm_min_ps(a, b); b = _mm_max_ps(a, b); a = t; }
+
+// 4 pixels: two 4x4 transposes give one register per sample
+inline void SortStochasticDepthsSSE2(float *pDepths, UINT NumPixels)
+{
+    UINT PixelId = 0;
+    for (; PixelId + 4 <= NumPixels; PixelId += 4)
+    {
+        float *p = pDepths + PixelId * VISIBILITY_NUM_SAMPLES;
+        __m128 z[8];
+        for (UINT i = 0; i < 4; ++i)
+        {
+            z[i] = _mm_loadu_ps(p + i * 8);
+            z[i + 4] = _mm_loadu_ps(p + i * 8 + 4);
+        }
+        _MM_TRANSPOSE4_PS(z[0], z[1], z[2], z[3]);
+        _MM_TRANSPOSE4_PS(z[4], z[5], z[6], z[7]);
+
+        SORT_NETWORK_8(SORT_CSWAP_SSE, z)
+
+        _MM_TRANSPOSE4_PS(z[0], z[1], z[2], z[3]);
+        _MM_TRANSPOSE4_PS(z[4], z[5], z[6], z[7]);
+        for (UINT i = 0; i < 4; ++i)
+        {
+            _mm_storeu_ps(p + i * 8, z[i]);
+            _mm_storeu_ps(p + i * 8 + 4, z[i + 4]);
+        }
+    }
+    SortStochasticDepthsScalar(pDepths + PixelId * VISIBILITY_NUM_SAMPLES, NumPixels - PixelId);
+}
+
+#define SORT_CSWAP_AVX(a, b) { __m256 t = _mm256_min_ps(a, b); b = _mm256_max_ps(a, b); a = t; }
+
+COVERAGE_MASKS_TARGET("avx2")
+inline void TransposeDepths8x8(__m256 z[8])
+{
+    __m256 t[8], u[8];
+    for (UINT i = 0; i < 8; i += 2)
+    {
+        t[i] = _mm256_unpacklo_ps(z[i], z[i + 1]);
+        t[i + 1] = _mm256_unpackhi_ps(z[i], z[i + 1]);
+    }
+    for (UINT i = 0; i < 8; i += 4)
+    {
+        u[i] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+        u[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+        u[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+        u[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+    }
+    for (UINT i = 0; i < 4; ++i)
+    {
+        z[i] = _mm256_permute2f128_ps(u[i], u[i + 4], 0x20);
+        z[i + 4] = _mm256_permute2f128_ps(u[i], u[i + 4], 0x31);
+    }
+}
+
+// 8 pixels: one 8x8 transpose gives one register per sample
+COVERAGE_MASKS_TARGET("avx2")
+inline void SortStochasticDepthsAVX2(float *pDepths, UINT NumPixels)
+{
+    UINT PixelId = 0;
+    for (; PixelId + 8 <= NumPixels; PixelId += 8)
+    {
+        float *p = pDepths + PixelId * VISIBILITY_NUM_SAMPLES;
+        __m256 z[8];
+        for (UINT i = 0; i < 8; ++i)
+        {
+            z[i] = _mm256_loadu_ps(p + i * 8);
+        }
+        TransposeDepths8x8(z);
+
+        SORT_NETWORK_8(SORT_CSWAP_AVX, z)
+
+        TransposeDepths8x8(z);
+        for (UINT i = 0; i < 8; ++i)
+        {
+            _mm256_storeu_ps(p + i * 8, z[i]);
+        }
+    }
+    SortStochasticDepthsScalar(pDepths + PixelId * VISIBILITY_NUM_SAMPLES, NumPixels - PixelId);
+}
+
+#endif
+
+// Sorts the depths of each pixel in place. The AVX2 kernel is also used on AVX-512 CPUs.
+inline void SortStochasticDepths(float *pDepths, UINT NumPixels, CoverageMaskISA Isa)
+{
+    assert(IsCoverageMaskISASupported(Isa));
+    switch (Isa)
+    {
+#if COVERAGE_MASKS_X86
+    case COVERAGE_MASK_SSE2:
+        SortStochasticDepthsSSE2(pDepths, NumPixels);
+        break;
+    case COVERAGE_MASK_AVX2:
+    case COVERAGE_MASK_AVX512:
+        SortStochasticDepthsAVX2(pDepths, NumPixels);
+        break;
+#endif
+    default:
+        SortStochasticDepthsScalar(pDepths, NumPixels);
+        break;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Microbenchmark of the accumulation pass at a given depth complexity, on the calling thread.
+// Each of the NumPixels pixels receives NumLayers fragments of opacity Alpha, submitted layer
+// after layer like the mesh draws. Returns the nanoseconds per fragment of the current loop (LoopNs), of
+// the sort followed by the binary searches (SortedNs) and of the farthest depths followed by
+// the saturated early-out (SaturatedNs), best of NumRuns, and the fraction of the fragments
+// rejected by the early-out (SaturatedFraction); false on a mismatch.
+//--------------------------------------------------------------------------------------
+inline bool BenchmarkSortedVisibility(CoverageMaskISA Isa, UINT NumLayers, float Alpha, double &LoopNs, double &SortedNs,
+                                      double &SaturatedNs, double &SaturatedFraction,
+                                      UINT NumPixels = 1 << 14, UINT NumRuns = 8)
+{
+    std::vector<float> Depths(NumPixels * VISIBILITY_NUM_SAMPLES), Sorted(Depths.size());
+    std::vector<float> Fragments(NumPixels * NumLayers), Farthest(NumPixels);
+    std::vector<UINT> LoopCounts(Fragments.size()), SortedCounts(Fragments.size()), SaturatedCounts(Fragments.size());
+
+    // Each stochastic depth is the nearest of the fragments covering the sample, each with
+    // a probability of Alpha, or the far plane: the samples saturate as the layers pile up
+    MTRand rng;
+    rng.seed((unsigned)2);
+    for (UINT i = 0; i < Fragments.size(); ++i)
+    {
+        Fragments[i] = rng.randExc();
+    }
+    for (UINT PixelId = 0; PixelId < NumPixels; ++PixelId)
+    {
+        for (UINT SampleId = 0; SampleId < VISIBILITY_NUM_SAMPLES; ++SampleId)
+        {
+            float z = 1.f;
+            for (UINT LayerId = 0; LayerId < NumLayers; ++LayerId)
+            {
+                if (rng.randExc() < Alpha) z = std::min(z, Fragments[LayerId * NumPixels + PixelId]);
+            }
+            Depths[PixelId * VISIBILITY_NUM_SAMPLES + SampleId] = z;
+        }
+    }
+
+    double BestLoop = 1e30;
+    double BestSorted = 1e30;
+    double BestSaturated = 1e30;
+    for (UINT Run = 0; Run < NumRuns; ++Run)
+    {
+        std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+        for (UINT LayerId = 0; LayerId < NumLayers; ++LayerId)
+        {
+            for (UINT PixelId = 0; PixelId < NumPixels; ++PixelId)
+            {
+                UINT i = LayerId * NumPixels + PixelId;
+                LoopCounts[i] = CountVisibleSamples(&Depths[PixelId * VISIBILITY_NUM_SAMPLES], Fragments[i]);
+            }
+        }
+        std::chrono::duration<double> Elapsed = std::chrono::high_resolution_clock::now() - Start;
+        BestLoop = std::min(BestLoop, Elapsed.count());
+
+        std::copy(Depths.begin(), Depths.end(), Sorted.begin());
+        Start = std::chrono::high_resolution_clock::now();
+        SortStochasticDepths(&Sorted[0], NumPixels, Isa);
+        for (UINT LayerId = 0; LayerId < NumLayers; ++LayerId)
+        {
+            for (UINT PixelId = 0; PixelId < NumPixels; ++PixelId)
+            {
+                UINT i = LayerId * NumPixels + PixelId;
+                SortedCounts[i] = CountVisibleSamplesSorted(&Sorted[PixelId * VISIBILITY_NUM_SAMPLES], Fragments[i]);
+            }
+        }
+        Elapsed = std::chrono::high_resolution_clock::now() - Start;
+        BestSorted = std::min(BestSorted, Elapsed.count());
+
+        Start = std::chrono::high_resolution_clock::now();
+        for (UINT PixelId = 0; PixelId < NumPixels; ++PixelId)
+        {
+            Farthest[PixelId] = GetFarthestDepth(&Depths[PixelId * VISIBILITY_NUM_SAMPLES]);
+        }
+        for (UINT LayerId = 0; LayerId < NumLayers; ++LayerId)
+        {
+            for (UINT PixelId = 0; PixelId < NumPixels; ++PixelId)
+            {
+                UINT i = LayerId * NumPixels + PixelId;
+                SaturatedCounts[i] = CountVisibleSamplesSaturated(&Depths[PixelId * VISIBILITY_NUM_SAMPLES], Farthest[PixelId], Fragments[i]);
+            }
+        }
+        Elapsed = std::chrono::high_resolution_clock::now() - Start;
+        BestSaturated = std::min(BestSaturated, Elapsed.count());
+    }
+
+    UINT NumRejected = 0;
+    for (UINT i = 0; i < Fragments.size(); ++i)
+    {
+        if (Fragments[i] > Farthest[i % NumPixels]) ++NumRejected;
+    }
+
+    LoopNs = BestLoop * 1e9 / Fragments.size();
+    SortedNs = BestSorted * 1e9 / Fragments.size();
+    SaturatedNs = BestSaturated * 1e9 / Fragments.size();
+    SaturatedFraction = (double)NumRejected / Fragments.size();
+    return (LoopCounts == SortedCounts) && (LoopCounts == SaturatedCounts);
+}
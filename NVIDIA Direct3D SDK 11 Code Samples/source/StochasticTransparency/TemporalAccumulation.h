@@ -0,0 +1,171 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <math.h>
+
+//--------------------------------------------------------------------------------------
+// Temporal accumulation of the stochastic transparency. The composite of each frame is
+// blended with the result of the previous frames, reprojected with the nearest stochastic
+// depth of the pixel, which amortizes the noise of a single pass over several frames.
+// The history is clamped to the color distribution of the 3x3 neighborhood of the pixel,
+// and rejected where the transmittance changed: unlike the colors, the transmittance of
+// the layers is exact, so a change means that the layers themselves changed.
+//
+// The progressive refinement replaces the blend with a running mean of the frames at the
+// same pixel while the view is static, which converges to the expected value of the
+// composite. The application stops rendering once the largest change of the mean over a
+// frame drops below PROGRESSIVE_CONVERGENCE_THRESHOLD, and restarts it on any change.
+//--------------------------------------------------------------------------------------
+
+// Weight of the history when it is valid: about 1 / (1 - 0.9) = 10 frames of accumulation
+#define TEMPORAL_HISTORY_WEIGHT 0.9f
+
+// Transmittance change that rejects the history entirely: 1 / 8
+#define TEMPORAL_REJECTION_SCALE 8.f
+
+// Half-width of the clamping box, in standard deviations of the neighborhood
+#define TEMPORAL_VARIANCE_GAMMA 1.25f
+
+// Step added to the random offset of the coverage masks every frame, to decorrelate
+// the noise of consecutive frames (see getlayerseed in StochasticTransparency.hlsli)
+#define TEMPORAL_RANDOM_OFFSET_STEP 0x9E3779B9U
+
+// Largest change of the running mean over a frame at convergence: half an 8-bit step
+#define PROGRESSIVE_CONVERGENCE_THRESHOLD (0.5f / 255.f)
+
+// Frames after which the running mean is considered converged regardless of the change
+#define PROGRESSIVE_MAX_FRAMES 4096
+
+// Frames between the copy of the progressive change to the CPU and its readback
+#define PROGRESSIVE_READBACK_LATENCY 3
+
+// Bilinear fetch of an RGBA image at a position in pixels, clamped to the edges
+inline void LoadBilinear(const float *pImage, UINT Width, UINT Height, float x, float y, float *pRGBA)
+{
+    const float px = x - 0.5f;
+    const float py = y - 0.5f;
+    const int x0 = (int)floorf(px);
+    const int y0 = (int)floorf(py);
+    const float fx = px - (float)x0;
+    const float fy = py - (float)y0;
+
+    for (UINT c = 0; c < 4; ++c)
+    {
+        float Rows[2];
+        for (int j = 0; j < 2; ++j)
+        {
+            const int yj = std::min(std::max(y0 + j, 0), (int)Height - 1);
+            const int xa = std::min(std::max(x0, 0), (int)Width - 1);
+            const int xb = std::min(std::max(x0 + 1, 0), (int)Width - 1);
+            const float a = pImage[(yj * Width + xa) * 4 + c];
+            const float b = pImage[(yj * Width + xb) * 4 + c];
+            Rows[j] = a + (b - a) * fx;
+        }
+        pRGBA[c] = Rows[0] + (Rows[1] - Rows[0]) * fy;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// CPU reference of TemporalResolve. pCurrent is the composite of the frame and pHistory the
+// output of the previous frame, both RGBA with the transmittance in alpha; pDepth holds the
+// nearest stochastic depth of each pixel. CurrentToPrevious maps the clip space of the frame
+// to the one of the previous frame (row vectors), and Params holds the history weight, the
+// rejection scale, the variance gamma and the progressive flag, with which the history weight
+// blends the history at the same pixel. pOutput gets the RGBA history of the frame.
+//--------------------------------------------------------------------------------------
+inline void ResolveTemporal(const float *pCurrent, const float *pHistory, const float *pDepth, UINT Width, UINT Height,
+                            const DirectX::XMFLOAT4X4 &CurrentToPrevious, const DirectX::XMFLOAT4 &Params, float *pOutput)
+{
+    const DirectX::XMFLOAT4X4 &M = CurrentToPrevious;
+
+    for (UINT y = 0; y < Height; ++y)
+    {
+        for (UINT x = 0; x < Width; ++x)
+        {
+            const float *pPixel = pCurrent + (y * Width + x) * 4;
+            float *pOut = pOutput + (y * Width + x) * 4;
+
+            // Running mean of the progressive refinement
+            if (Params.w > 0.f)
+            {
+                const float *pMean = pHistory + (y * Width + x) * 4;
+                for (UINT c = 0; c < 3; ++c)
+                {
+                    pOut[c] = pPixel[c] + (pMean[c] - pPixel[c]) * Params.x;
+                }
+                pOut[3] = pPixel[3];
+                continue;
+            }
+
+            // Moments of the 3x3 neighborhood
+            float m1[3] = { 0.f, 0.f, 0.f };
+            float m2[3] = { 0.f, 0.f, 0.f };
+            for (int dy = -1; dy <= 1; ++dy)
+            {
+                for (int dx = -1; dx <= 1; ++dx)
+                {
+                    const int nx = std::min(std::max((int)x + dx, 0), (int)Width - 1);
+                    const int ny = std::min(std::max((int)y + dy, 0), (int)Height - 1);
+                    const float *pNeighbor = pCurrent + (ny * Width + nx) * 4;
+                    for (UINT c = 0; c < 3; ++c)
+                    {
+                        m1[c] += pNeighbor[c];
+                        m2[c] += pNeighbor[c] * pNeighbor[c];
+                    }
+                }
+            }
+
+            // Reprojection of the pixel center at the nearest depth
+            const float ndc[4] =
+            {
+                ((float)x + 0.5f) / (float)Width * 2.f - 1.f,
+                1.f - ((float)y + 0.5f) / (float)Height * 2.f,
+                pDepth[y * Width + x],
+                1.f
+            };
+            float Prev[4];
+            for (UINT c = 0; c < 4; ++c)
+            {
+                Prev[c] = ndc[0] * M.m[0][c] + ndc[1] * M.m[1][c] + ndc[2] * M.m[2][c] + ndc[3] * M.m[3][c];
+            }
+
+            float Weight = Params.x;
+            float History[4] = { 0.f, 0.f, 0.f, 0.f };
+            const float PrevX = (Prev[0] / Prev[3] * 0.5f + 0.5f) * (float)Width;
+            const float PrevY = (0.5f - Prev[1] / Prev[3] * 0.5f) * (float)Height;
+            if (Prev[3] <= 0.f || !(PrevX >= 0.f && PrevY >= 0.f && PrevX <= (float)Width && PrevY <= (float)Height))
+            {
+                Weight = 0.f;
+            }
+            else
+            {
+                LoadBilinear(pHistory, Width, Height, PrevX, PrevY, History);
+                Weight *= std::min(std::max(1.f - fabsf(History[3] - pPixel[3]) * Params.y, 0.f), 1.f);
+            }
+
+            for (UINT c = 0; c < 3; ++c)
+            {
+                const float Mean = m1[c] / 9.f;
+                const float Sigma = sqrtf(std::max(m2[c] / 9.f - Mean * Mean, 0.f));
+                const float Clamped = std::min(std::max(History[c], Mean - Params.z * Sigma), Mean + Params.z * Sigma);
+                pOut[c] = (Weight > 0.f) ? pPixel[c] + (Clamped - pPixel[c]) * Weight : pPixel[c];
+            }
+            pOut[3] = pPixel[3];
+        }
+    }
+}
@@ -0,0 +1,224 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#include "TestCommon.h"
+#include "../CommandList.h"
+
+// The command list never dereferences the objects it records: any distinct addresses will do
+static char g_Objects[8];
+#define FAKE_OBJECT(Type, i) ((Type*)&g_Objects[i])
+
+//--------------------------------------------------------------------------------------
+// Sink tracking the bound state, and the state seen by each mesh draw
+//--------------------------------------------------------------------------------------
+struct DrawState
+{
+    void *pVS;
+    void *pPS;
+    void *pRTV;
+    void *pDSV;
+    UINT StencilRef;
+    UINT NumFrameConstantBinds;
+};
+
+class RecordingSink : public CommandSink
+{
+public:
+    RecordingSink()
+    {
+        ResetState();
+    }
+
+    // Matches the default state of a deferred context
+    void ResetState()
+    {
+        memset(&m_State, 0, sizeof(m_State));
+    }
+
+    virtual void Execute(const Command &Cmd)
+    {
+        m_Commands.push_back(Cmd.Type);
+        switch (Cmd.Type)
+        {
+        case CMD_SET_VERTEX_SHADER: m_State.pVS = Cmd.pObject; break;
+        case CMD_SET_PIXEL_SHADER: m_State.pPS = Cmd.pObject; break;
+        case CMD_SET_DEPTH_STENCIL_STATE: m_State.StencilRef = Cmd.Value; break;
+        case CMD_SET_RENDER_TARGETS:
+            m_State.pRTV = Cmd.Count ? Cmd.pObjects[0] : NULL;
+            m_State.pDSV = Cmd.pObject;
+            break;
+        case CMD_BIND_FRAME_CONSTANTS: ++m_State.NumFrameConstantBinds; break;
+        case CMD_DRAW_MESH: m_DrawStates.push_back(m_State); break;
+        default: break;
+        }
+    }
+
+    DrawState m_State;
+    std::vector<CommandType> m_Commands;
+    std::vector<DrawState> m_DrawStates;
+};
+
+static bool operator==(const DrawState &a, const DrawState &b)
+{
+    return a.pVS == b.pVS && a.pPS == b.pPS && a.pRTV == b.pRTV && a.pDSV == b.pDSV && a.StencilRef == b.StencilRef &&
+           (a.NumFrameConstantBinds > 0) == (b.NumFrameConstantBinds > 0);
+}
+
+static void RecordTestList(CommandList &Commands)
+{
+    const float Black[4] = { 0.f, 0.f, 0.f, 0.f };
+    RHIView *pRTV = FAKE_OBJECT(RHIView, 0);
+    RHIView *pDSV = FAKE_OBJECT(RHIView, 1);
+
+    Commands.BeginEvent(L"Test");
+    Commands.BindFrameConstants();
+    Commands.SetRenderTargets(1, &pRTV, pDSV);
+    Commands.ClearRenderTarget(pRTV, Black);
+    Commands.SetPixelShader(FAKE_OBJECT(RHIShader, 2));
+    Commands.SetDepthStencilState(FAKE_OBJECT(RHIDepthStencilState, 3), 1);
+    Commands.DrawMesh(MESH_DRAW_LIST_TRANSPARENT);
+    Commands.SetPixelShader(FAKE_OBJECT(RHIShader, 4));
+    Commands.SetVertexShader(FAKE_OBJECT(RHIShader, 5));
+    Commands.Draw(3, 0);
+    Commands.SetDepthStencilState(FAKE_OBJECT(RHIDepthStencilState, 3), 2);
+    Commands.DrawMesh(MESH_DRAW_LIST_OPAQUE);
+    Commands.EndEvent();
+}
+
+//--------------------------------------------------------------------------------------
+// Each mesh draw is split in chunks of at most PARALLEL_DRAWS_PER_SEGMENT draws
+// covering its draw list exactly once, and the trailing commands get a segment of their own
+//--------------------------------------------------------------------------------------
+static void TestSplitting()
+{
+    CommandList Commands;
+    RecordTestList(Commands);
+
+    const UINT P = PARALLEL_DRAWS_PER_SEGMENT;
+    const UINT Counts[][NUM_MESH_DRAW_LISTS] =
+    {
+        { 0, 0 }, { 1, 1 }, { P - 1, P }, { P + 1, 2 * P }, { 2 * P + 1, 3 * P - 1 },
+    };
+    for (UINT Case = 0; Case < sizeof(Counts) / sizeof(Counts[0]); ++Case)
+    {
+        const UINT *NumDraws = Counts[Case];
+        std::vector<CommandSegment> Segments;
+        Commands.BuildSegments(NumDraws, P, Segments);
+
+        const UINT NumChunks[NUM_MESH_DRAW_LISTS] =
+        {
+            std::max((NumDraws[0] + P - 1) / P, 1U),
+            std::max((NumDraws[1] + P - 1) / P, 1U),
+        };
+        CHECK(Segments.size() == NumChunks[0] + NumChunks[1] + 1);
+        if (Segments.size() != NumChunks[0] + NumChunks[1] + 1) continue;
+
+        size_t NextCommand = 0;
+        size_t s = 0;
+        for (UINT List = 0; List < NUM_MESH_DRAW_LISTS; ++List)
+        {
+            UINT NextDraw = 0;
+            for (UINT Chunk = 0; Chunk < NumChunks[List]; ++Chunk, ++s)
+            {
+                const CommandSegment &Segment = Segments[s];
+                CHECK(Segment.FirstDraw == NextDraw);
+                CHECK(Segment.EndDraw - Segment.FirstDraw <= P);
+                CHECK(Segment.EndDraw == std::min(NextDraw + P, NumDraws[List]));
+                NextDraw = Segment.EndDraw;
+
+                CHECK(Commands.GetCommand(Segment.End - 1).Type == CMD_DRAW_MESH);
+                CHECK(Commands.GetCommand(Segment.End - 1).Slot == List);
+                CHECK(Segment.StateEnd == Segment.Begin);
+                if (Chunk == 0)
+                {
+                    CHECK(Segment.Begin == NextCommand);
+                }
+                else
+                {
+                    // Continuations only draw: their state comes from the prefix
+                    CHECK(Segment.Begin == Segment.End - 1);
+                }
+                NextCommand = Segment.End;
+            }
+            CHECK(NextDraw == NumDraws[List]);
+        }
+
+        const CommandSegment &Last = Segments.back();
+        CHECK(Last.Begin == NextCommand && Last.End == Commands.GetNumCommands());
+        CHECK(Last.FirstDraw == 0 && Last.EndDraw == 0);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Replaying every segment on a context with the default state executes each non-state
+// command once, and each mesh draw sees the state of the full replay
+//--------------------------------------------------------------------------------------
+static void TestStatePrefixReplay()
+{
+    CommandList Commands;
+    RecordTestList(Commands);
+
+    RecordingSink Reference;
+    Commands.Replay(Reference);
+    CHECK(Reference.m_DrawStates.size() == 2);
+
+    const UINT P = PARALLEL_DRAWS_PER_SEGMENT;
+    const UINT NumDraws[NUM_MESH_DRAW_LISTS] = { 3 * P, P + 1 };
+    std::vector<CommandSegment> Segments;
+    Commands.BuildSegments(NumDraws, P, Segments);
+
+    UINT NumMeshDrawChunks = 0;
+    std::vector<UINT> NumExecuted(Commands.GetNumCommands(), 0);
+    for (size_t s = 0; s < Segments.size(); ++s)
+    {
+        RecordingSink Segment;
+        Commands.Replay(Segment, Segments[s]);
+
+        // Whatever is replayed before Begin must be state only
+        const size_t NumPrefix = Segment.m_Commands.size() - (Segments[s].End - Segments[s].Begin);
+        for (size_t i = 0; i < NumPrefix; ++i)
+        {
+            CHECK(CommandList::IsStateCommand(Segment.m_Commands[i]));
+        }
+        for (size_t i = Segments[s].Begin; i < Segments[s].End; ++i)
+        {
+            ++NumExecuted[i];
+        }
+
+        CHECK(Segment.m_DrawStates.size() <= 1);
+        if (Segment.m_DrawStates.size() == 1)
+        {
+            const UINT List = Commands.GetCommand(Segments[s].End - 1).Slot;
+            CHECK(Segment.m_DrawStates[0] == Reference.m_DrawStates[List]);
+            ++NumMeshDrawChunks;
+        }
+    }
+
+    for (size_t i = 0; i < NumExecuted.size(); ++i)
+    {
+        // The mesh draws are executed once per chunk, everything else exactly once
+        const bool IsMeshDraw = (Commands.GetCommand(i).Type == CMD_DRAW_MESH);
+        const UINT Expected = IsMeshDraw ? (NumDraws[Commands.GetCommand(i).Slot] + P - 1) / P : 1;
+        CHECK(NumExecuted[i] == Expected);
+    }
+    CHECK(NumMeshDrawChunks == 3 + 2);
+}
+
+int main()
+{
+    TestSplitting();
+    TestStatePrefixReplay();
+    return TestResult("CommandListTest");
+}
@@ -0,0 +1,155 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#include "TestCommon.h"
+#include "../ConstantAllocator.h"
+
+#include <vector>
+
+//--------------------------------------------------------------------------------------
+// Every allocation is CONSTANT_ALIGNMENT-aligned in offset and size
+//--------------------------------------------------------------------------------------
+static void TestAlignment()
+{
+    LinearConstantAllocator Allocator(16 * CONSTANT_ALIGNMENT);
+    const UINT Sizes[] = { 1, 16, 64, 255, 256, 257, 1000 };
+    for (UINT i = 0; i < sizeof(Sizes) / sizeof(Sizes[0]); ++i)
+    {
+        ConstantAllocation Allocation;
+        CHECK(Allocator.Allocate(Sizes[i], Allocation));
+        CHECK(Allocation.Offset % CONSTANT_ALIGNMENT == 0);
+        CHECK(Allocation.Size % CONSTANT_ALIGNMENT == 0);
+        CHECK(Allocation.Size >= Sizes[i] && Allocation.Size < Sizes[i] + CONSTANT_ALIGNMENT);
+        CHECK(Allocation.GetFirstConstant() * 16 == Allocation.Offset);
+        CHECK(Allocation.GetNumConstants() * 16 == Allocation.Size);
+    }
+
+    ConstantAllocation Allocation;
+    CHECK(!Allocator.Allocate(0, Allocation));
+}
+
+//--------------------------------------------------------------------------------------
+// An allocation that does not fit before the end of the ring restarts at 0 with a discard
+//--------------------------------------------------------------------------------------
+static void TestWrap()
+{
+    LinearConstantAllocator Allocator(4 * CONSTANT_ALIGNMENT);
+    ConstantAllocation Allocation;
+
+    CHECK(Allocator.Allocate(CONSTANT_ALIGNMENT, Allocation));
+    CHECK(Allocation.Offset == 0 && Allocation.Discard);
+    CHECK(Allocator.Allocate(2 * CONSTANT_ALIGNMENT, Allocation));
+    CHECK(Allocation.Offset == CONSTANT_ALIGNMENT && !Allocation.Discard);
+
+    // Exactly fills the ring: no wrap yet
+    CHECK(Allocator.Allocate(CONSTANT_ALIGNMENT, Allocation));
+    CHECK(Allocation.Offset == 3 * CONSTANT_ALIGNMENT && !Allocation.Discard);
+    CHECK(Allocator.GetHead() == Allocator.GetCapacity());
+
+    CHECK(Allocator.Allocate(CONSTANT_ALIGNMENT, Allocation));
+    CHECK(Allocation.Offset == 0 && Allocation.Discard);
+    CHECK(Allocator.GetNumDiscards() == 2);
+
+    // Does not fit in the 3 slots left: wraps even though the ring is not full
+    CHECK(Allocator.Allocate(2 * CONSTANT_ALIGNMENT, Allocation));
+    CHECK(Allocator.Allocate(2 * CONSTANT_ALIGNMENT, Allocation));
+    CHECK(Allocation.Offset == 0 && Allocation.Discard);
+
+    Allocator.Reset();
+    CHECK(Allocator.Allocate(CONSTANT_ALIGNMENT, Allocation));
+    CHECK(Allocation.Offset == 0 && Allocation.Discard);
+}
+
+//--------------------------------------------------------------------------------------
+// Ranges handed out for previous frames may still be read by the GPU: the allocator must
+// never return an overlapping range without a discard, and refuses what cannot fit at all
+//--------------------------------------------------------------------------------------
+static void TestNoOverwriteInFlight()
+{
+    LinearConstantAllocator Allocator(8 * CONSTANT_ALIGNMENT);
+    ConstantAllocation Allocation;
+
+    CHECK(!Allocator.Allocate(8 * CONSTANT_ALIGNMENT + 1, Allocation));
+    CHECK(Allocator.GetNumAllocatedBytes() == 0);
+
+    // Bytes written since the last discard, i.e. possibly in flight
+    std::vector<bool> InFlight(Allocator.GetCapacity(), false);
+    UINT NumDiscards = 0;
+    for (UINT Frame = 0; Frame < 64; ++Frame)
+    {
+        for (UINT Draw = 0; Draw < 5; ++Draw)
+        {
+            UINT Size = ((Frame * 7 + Draw * 3) % 5 + 1) * 100;
+            CHECK(Allocator.Allocate(Size, Allocation));
+            CHECK(Allocation.Offset + Allocation.Size <= Allocator.GetCapacity());
+
+            if (Allocation.Discard)
+            {
+                // The driver renames the buffer: nothing of the previous one is reachable
+                InFlight.assign(InFlight.size(), false);
+                ++NumDiscards;
+            }
+            for (UINT i = Allocation.Offset; i < Allocation.Offset + Allocation.Size; ++i)
+            {
+                CHECK(!InFlight[i]);
+                InFlight[i] = true;
+            }
+        }
+    }
+    CHECK(NumDiscards == Allocator.GetNumDiscards());
+    CHECK(NumDiscards > 1);
+}
+
+//--------------------------------------------------------------------------------------
+// The frame constants and one block per subset must fit in the ring: with 1024 subsets or
+// more they exceed CONSTANT_RING_SIZE, and the ring is grown for them
+//--------------------------------------------------------------------------------------
+static void TestGrowForSubsets()
+{
+    CHECK(LinearConstantAllocator::GetCapacityFor(1) == CONSTANT_RING_SIZE);
+    CHECK(LinearConstantAllocator::GetCapacityFor(CONSTANT_RING_SIZE / CONSTANT_RING_MIN_ALLOCATIONS) == CONSTANT_RING_SIZE);
+
+    const UINT NumSubsets = 5000;
+    const UINT UploadSize = CONSTANT_ALIGNMENT + NumSubsets * CONSTANT_ALIGNMENT;
+
+    LinearConstantAllocator Allocator;
+    ConstantAllocation Allocation;
+    CHECK(Allocator.Allocate(CONSTANT_ALIGNMENT, Allocation));
+    CHECK(!Allocator.Allocate(UploadSize, Allocation));
+
+    const UINT Capacity = LinearConstantAllocator::GetCapacityFor(UploadSize);
+    CHECK(Capacity % CONSTANT_ALIGNMENT == 0);
+    CHECK(Capacity >= CONSTANT_RING_MIN_ALLOCATIONS * UploadSize);
+
+    // The new buffer starts with a discard, then the frames are appended
+    Allocator.Resize(Capacity);
+    CHECK(Allocator.GetCapacity() == Capacity && Allocator.GetHead() == 0);
+    for (UINT Frame = 0; Frame < CONSTANT_RING_MIN_ALLOCATIONS; ++Frame)
+    {
+        CHECK(Allocator.Allocate(UploadSize, Allocation));
+        CHECK(Allocation.Offset == Frame * UploadSize);
+        CHECK(Allocation.Discard == (Frame == 0));
+    }
+    CHECK(Allocator.GetNumDiscards() == 1);
+}
+
+int main()
+{
+    TestAlignment();
+    TestWrap();
+    TestNoOverwriteInFlight();
+    TestGrowForSubsets();
+    return TestResult("ConstantAllocatorTest");
+}
@@ -0,0 +1,146 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+#include "TestCommon.h"
+#include "../CoverageMasks.h"
+
+#include <limits>
+
+//--------------------------------------------------------------------------------------
+// Every SIMD kernel supported by the CPU must match ComputeCoverageMask bit for bit,
+// including the fragments left to the scalar tail and the alphas out of [0,1]
+//--------------------------------------------------------------------------------------
+
+#define TEST_TABLE_SIZE 256
+#define TEST_ALPHA_VALUES 64
+#define TEST_NUM_SAMPLES 8
+#define TEST_MAX_FRAGMENTS 100
+
+static void CheckKernel(const CoverageMaskTable &Table, CoverageMaskISA Isa, const UINT *pX, const UINT *pY,
+                        const int *pPrimitiveIds, const float *pAlphas, UINT Count)
+{
+    // Past the end stays untouched
+    UINT Masks[TEST_MAX_FRAGMENTS + 1];
+    for (UINT i = 0; i <= TEST_MAX_FRAGMENTS; ++i) Masks[i] = 0xDEADBEEF;
+
+    GetCoverageMaskKernel(Isa)(Table, pX, pY, pPrimitiveIds, pAlphas, Count, Masks);
+
+    UINT NumMismatches = 0;
+    for (UINT i = 0; i < Count; ++i)
+    {
+        if (Masks[i] != ComputeCoverageMask(Table, pX[i], pY[i], pPrimitiveIds[i], pAlphas[i])) ++NumMismatches;
+    }
+    if (NumMismatches)
+    {
+        fprintf(stderr, "%ls: %u / %u masks differ\n", GetCoverageMaskISAName(Isa), NumMismatches, Count);
+    }
+    CHECK(NumMismatches == 0);
+    CHECK(Masks[Count] == 0xDEADBEEF);
+}
+
+static void TestKernels(const CoverageMaskTable &Table)
+{
+    const float Infinity = std::numeric_limits<float>::infinity();
+    const float SpecialAlphas[] =
+    {
+        0.f, -0.f, 1.f, 0.5f, 1e-30f, 0.99999994f, 1.00001f, 1.5f, 2.f, 1e30f, Infinity,
+        -1e-30f, -0.5f, -1.f, -1e30f, -Infinity, std::numeric_limits<float>::quiet_NaN(),
+        // Exactly on a row, and just below and above the last one
+        1.f / TEST_ALPHA_VALUES, (TEST_ALPHA_VALUES - 0.5f) / TEST_ALPHA_VALUES, (TEST_ALPHA_VALUES + 0.5f) / TEST_ALPHA_VALUES,
+        (TEST_ALPHA_VALUES + 1.f) / TEST_ALPHA_VALUES,
+    };
+    const UINT NumSpecialAlphas = sizeof(SpecialAlphas) / sizeof(SpecialAlphas[0]);
+
+    UINT X[TEST_MAX_FRAGMENTS], Y[TEST_MAX_FRAGMENTS];
+    int PrimitiveIds[TEST_MAX_FRAGMENTS];
+    float Alphas[TEST_MAX_FRAGMENTS];
+
+    MTRand rng;
+    rng.seed((unsigned)2);
+
+    UINT NumTestedIsas = 0;
+    for (int Isa = 0; Isa < NUM_COVERAGE_MASK_ISAS; ++Isa)
+    {
+        if (!IsCoverageMaskISASupported((CoverageMaskISA)Isa)) continue;
+        ++NumTestedIsas;
+        printf("Testing the %ls kernel\n", GetCoverageMaskISAName((CoverageMaskISA)Isa));
+
+        // Not multiples of the 4, 8 and 16 lanes, so that the scalar tails run
+        for (UINT Count = 0; Count <= TEST_MAX_FRAGMENTS; Count += (Count < 40) ? 1 : 29)
+        {
+            for (UINT Run = 0; Run < 8; ++Run)
+            {
+                for (UINT i = 0; i < Count; ++i)
+                {
+                    // Coordinates and primitives large enough to wrap the seed arithmetic
+                    X[i] = rng.randInt() % 8192;
+                    Y[i] = rng.randInt() % 8192;
+                    PrimitiveIds[i] = (int)rng.randInt();
+                    Alphas[i] = (Run & 1) ? SpecialAlphas[rng.randInt() % NumSpecialAlphas] : (float)rng.randExc() * 1.2f - 0.1f;
+                }
+                CheckKernel(Table, (CoverageMaskISA)Isa, X, Y, PrimitiveIds, Alphas, Count);
+            }
+        }
+
+        // Every special alpha in every lane
+        for (UINT Shift = 0; Shift < 16; ++Shift)
+        {
+            for (UINT i = 0; i < TEST_MAX_FRAGMENTS; ++i)
+            {
+                X[i] = i;
+                Y[i] = Shift;
+                PrimitiveIds[i] = (int)i - 50;
+                Alphas[i] = SpecialAlphas[(i + Shift) % NumSpecialAlphas];
+            }
+            CheckKernel(Table, (CoverageMaskISA)Isa, X, Y, PrimitiveIds, Alphas, TEST_MAX_FRAGMENTS);
+        }
+    }
+
+    CHECK(NumTestedIsas >= 1);
+    CHECK(IsCoverageMaskISASupported(GetBestCoverageMaskISA()));
+}
+
+//--------------------------------------------------------------------------------------
+// The scalar version itself: out-of-range alphas give an empty mask, as the texture load
+// out of bounds in the shader, and opaque fragments cover every sample
+//--------------------------------------------------------------------------------------
+static void TestScalar(const CoverageMaskTable &Table)
+{
+    const float Empty[] = { 0.f, -1.f, std::numeric_limits<float>::quiet_NaN(), 2.f, std::numeric_limits<float>::infinity() };
+    for (UINT i = 0; i < sizeof(Empty) / sizeof(Empty[0]); ++i)
+    {
+        CHECK(ComputeCoverageMask(Table, 3, 5, 7, Empty[i]) == 0);
+    }
+
+    const UINT AllSamples = (1U << TEST_NUM_SAMPLES) - 1;
+    for (UINT x = 0; x < 64; ++x)
+    {
+        CHECK(ComputeCoverageMask(Table, x, 2 * x, (int)x, 1.f) == AllSamples);
+    }
+}
+
+int main()
+{
+    CoverageMaskTable Table;
+    BuildCoverageMaskTable(Table, TEST_TABLE_SIZE, TEST_ALPHA_VALUES, TEST_NUM_SAMPLES);
+
+    TestScalar(Table);
+    TestKernels(Table);
+
+    // The seed of every frame of the temporal accumulation
+    Table.RandomOffset = 0x9E3779B9U;
+    TestKernels(Table);
+
+    return TestResult("CoverageMasksTest");
+}
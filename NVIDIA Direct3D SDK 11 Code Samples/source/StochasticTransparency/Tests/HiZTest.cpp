@@ -0,0 +1,157 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+#include "TestCommon.h"
+#include "../HiZ.h"
+
+//--------------------------------------------------------------------------------------
+// The SSE2 reduction must build the same pyramid as the scalar one, and every texel must
+// hold the nearest and farthest depths of the pixels it covers, for odd sizes as well
+//--------------------------------------------------------------------------------------
+
+// Depths in [0,1] with a padded row pitch, and some repeated values for the ties
+static void MakeDepth(UINT Width, UINT Height, UINT Seed, std::vector<float> &Depth, UINT &RowPitch)
+{
+    const UINT Pitch = Width + 3;
+    RowPitch = Pitch * sizeof(float);
+    Depth.assign(Pitch * Height, -1.f);
+    for (UINT y = 0; y < Height; ++y)
+    {
+        for (UINT x = 0; x < Width; ++x)
+        {
+            Seed = Seed * 1664525 + 1013904223;
+            Depth[y * Pitch + x] = (Seed % 5 == 0) ? 1.f : (float)(Seed >> 8) / (float)(1 << 24);
+        }
+    }
+}
+
+static void CheckAgainstPixels(const HiZPyramid &Pyramid, const std::vector<float> &Depth, UINT Width, UINT Height, UINT RowPitch)
+{
+    const UINT Pitch = RowPitch / sizeof(float);
+    for (UINT LevelId = 0; LevelId < Pyramid.GetNumLevels(); ++LevelId)
+    {
+        const HiZPyramid::Level &L = Pyramid.GetLevel(LevelId);
+        const UINT Size = 2U << LevelId;
+        CHECK(L.Width == (Width + Size - 1) / Size && L.Height == (Height + Size - 1) / Size);
+
+        for (UINT ty = 0; ty < L.Height; ++ty)
+        {
+            for (UINT tx = 0; tx < L.Width; ++tx)
+            {
+                float MinDepth = FLT_MAX;
+                float MaxDepth = -FLT_MAX;
+                for (UINT y = ty * Size; y < std::min((ty + 1) * Size, Height); ++y)
+                {
+                    for (UINT x = tx * Size; x < std::min((tx + 1) * Size, Width); ++x)
+                    {
+                        MinDepth = std::min(MinDepth, Depth[y * Pitch + x]);
+                        MaxDepth = std::max(MaxDepth, Depth[y * Pitch + x]);
+                    }
+                }
+                CHECK(L.MinDepth[ty * L.Width + tx] == MinDepth);
+                CHECK(L.MaxDepth[ty * L.Width + tx] == MaxDepth);
+            }
+        }
+    }
+
+    // The last level covers the whole depth buffer
+    CHECK(Pyramid.GetLevel(Pyramid.GetNumLevels() - 1).Width == 1);
+    CHECK(Pyramid.GetLevel(Pyramid.GetNumLevels() - 1).Height == 1);
+}
+
+static void TestReduction()
+{
+    const UINT Sizes[][2] =
+    {
+        { 1, 1 }, { 2, 1 }, { 1, 7 }, { 3, 3 }, { 8, 2 }, { 9, 5 }, { 15, 4 }, { 16, 16 },
+        { 17, 9 }, { 31, 33 }, { 64, 48 }, { 100, 1 }, { 257, 3 },
+    };
+
+    HiZPyramid Scalar, SIMD;
+    Scalar.SetSIMD(false);
+    SIMD.SetSIMD(true);
+    printf("Testing the %s reduction\n", SIMD.GetSIMD() ? "SSE2" : "scalar");
+
+    for (UINT i = 0; i < sizeof(Sizes) / sizeof(Sizes[0]); ++i)
+    {
+        const UINT Width = Sizes[i][0];
+        const UINT Height = Sizes[i][1];
+
+        std::vector<float> Depth;
+        UINT RowPitch;
+        MakeDepth(Width, Height, i + 1, Depth, RowPitch);
+
+        // The pyramids are reused across sizes, as when the window is resized
+        Scalar.Build(&Depth[0], Width, Height, RowPitch);
+        SIMD.Build(&Depth[0], Width, Height, RowPitch);
+        CheckAgainstPixels(Scalar, Depth, Width, Height, RowPitch);
+
+        CHECK(SIMD.GetNumLevels() == Scalar.GetNumLevels());
+        for (UINT LevelId = 0; LevelId < Scalar.GetNumLevels(); ++LevelId)
+        {
+            CHECK(SIMD.GetLevel(LevelId).MinDepth == Scalar.GetLevel(LevelId).MinDepth);
+            CHECK(SIMD.GetLevel(LevelId).MaxDepth == Scalar.GetLevel(LevelId).MaxDepth);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// The depth range of a rectangle contains the depths of all its pixels
+//--------------------------------------------------------------------------------------
+static void TestDepthRange()
+{
+    const UINT Width = 37;
+    const UINT Height = 21;
+    std::vector<float> Depth;
+    UINT RowPitch;
+    MakeDepth(Width, Height, 7, Depth, RowPitch);
+    const UINT Pitch = RowPitch / sizeof(float);
+
+    HiZPyramid Pyramid;
+    Pyramid.Build(&Depth[0], Width, Height, RowPitch);
+
+    UINT Seed = 3;
+    for (UINT Run = 0; Run < 1000; ++Run)
+    {
+        UINT Coords[4];
+        for (UINT c = 0; c < 4; ++c)
+        {
+            Seed = Seed * 1664525 + 1013904223;
+            Coords[c] = (Seed >> 8) % ((c & 1) ? Height : Width);
+        }
+        const UINT MinX = std::min(Coords[0], Coords[2]), MaxX = std::max(Coords[0], Coords[2]);
+        const UINT MinY = std::min(Coords[1], Coords[3]), MaxY = std::max(Coords[1], Coords[3]);
+
+        float MinDepth, MaxDepth;
+        Pyramid.GetDepthRange(MinX, MinY, MaxX, MaxY, MinDepth, MaxDepth);
+        for (UINT y = MinY; y <= MaxY; ++y)
+        {
+            for (UINT x = MinX; x <= MaxX; ++x)
+            {
+                CHECK(Depth[y * Pitch + x] >= MinDepth && Depth[y * Pitch + x] <= MaxDepth);
+            }
+        }
+
+        // Behind the farthest depth only
+        CHECK(Pyramid.IsRectOccluded(MinX, MinY, MaxX, MaxY, MaxDepth + 1e-3f));
+        CHECK(!Pyramid.IsRectOccluded(MinX, MinY, MaxX, MaxY, MaxDepth));
+    }
+}
+
+int main()
+{
+    TestReduction();
+    TestDepthRange();
+    return TestResult("HiZTest");
+}
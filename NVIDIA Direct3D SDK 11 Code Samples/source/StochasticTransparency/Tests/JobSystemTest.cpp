@@ -0,0 +1,115 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#include "TestCommon.h"
+#include "../JobSystem.h"
+
+#include <chrono>
+
+#define TEST_NUM_WORKERS 8
+#define TEST_NUM_ROUNDS 200
+
+struct VisitData
+{
+    std::vector<std::atomic<UINT> > NumVisits;
+    std::atomic<UINT> WorkerBusy[TEST_NUM_WORKERS];
+    std::atomic<UINT> NumOverlaps;
+    UINT NumSlowJobs;
+
+    VisitData(UINT NumJobs)
+        : NumVisits(NumJobs)
+        , NumOverlaps(0)
+        , NumSlowJobs(0)
+    {
+        for (UINT i = 0; i < NumJobs; ++i) NumVisits[i] = 0;
+        for (UINT i = 0; i < TEST_NUM_WORKERS; ++i) WorkerBusy[i] = 0;
+    }
+};
+
+static void VisitJob(void *pData, UINT JobIndex, UINT WorkerId)
+{
+    VisitData &Data = *(VisitData*)pData;
+
+    // Calls with the same WorkerId must not overlap
+    if (Data.WorkerBusy[WorkerId]++ != 0) ++Data.NumOverlaps;
+
+    ++Data.NumVisits[JobIndex];
+
+    // The first jobs all land in the queue of worker 0: the other workers run out
+    // of work immediately and have to steal them
+    if (JobIndex < Data.NumSlowJobs)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    --Data.WorkerBusy[WorkerId];
+}
+
+//--------------------------------------------------------------------------------------
+// Every index is visited exactly once, whatever the number of jobs per worker
+//--------------------------------------------------------------------------------------
+static void TestExactlyOnce()
+{
+    JobSystem Jobs(TEST_NUM_WORKERS);
+    CHECK(Jobs.GetNumWorkers() == TEST_NUM_WORKERS);
+
+    const UINT NumJobs[] = { 1, 3, TEST_NUM_WORKERS, TEST_NUM_WORKERS + 1, 1000, 4099 };
+    for (UINT Round = 0; Round < TEST_NUM_ROUNDS; ++Round)
+    {
+        const UINT Count = NumJobs[Round % (sizeof(NumJobs) / sizeof(NumJobs[0]))];
+        VisitData Data(Count);
+        Jobs.ParallelFor(VisitJob, &Data, Count);
+
+        for (UINT i = 0; i < Count; ++i)
+        {
+            CHECK(Data.NumVisits[i] == 1);
+        }
+        CHECK(Data.NumOverlaps == 0);
+    }
+
+    // Nothing to do: returns without calling the function
+    Jobs.ParallelFor(VisitJob, NULL, 0);
+}
+
+//--------------------------------------------------------------------------------------
+// Imbalanced queues are drained by stealing, still visiting every index once
+//--------------------------------------------------------------------------------------
+static void TestWorkStealing()
+{
+    JobSystem Jobs(TEST_NUM_WORKERS);
+    Jobs.ResetNumSteals();
+
+    const UINT NumJobs = 64 * TEST_NUM_WORKERS;
+    for (UINT Round = 0; Round < 10; ++Round)
+    {
+        VisitData Data(NumJobs);
+        Data.NumSlowJobs = NumJobs / TEST_NUM_WORKERS;
+        Jobs.ParallelFor(VisitJob, &Data, NumJobs);
+
+        for (UINT i = 0; i < NumJobs; ++i)
+        {
+            CHECK(Data.NumVisits[i] == 1);
+        }
+        CHECK(Data.NumOverlaps == 0);
+    }
+    CHECK(Jobs.GetNumSteals() > 0);
+}
+
+int main()
+{
+    TestExactlyOnce();
+    TestWorkStealing();
+    return TestResult("JobSystemTest");
+}
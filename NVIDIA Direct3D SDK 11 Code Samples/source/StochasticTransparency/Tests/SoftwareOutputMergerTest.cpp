@@ -0,0 +1,479 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#include "TestCommon.h"
+#include "../RHI_Software.h"
+
+//--------------------------------------------------------------------------------------
+// Format conversions
+//--------------------------------------------------------------------------------------
+
+static bool IsHalfNaN(unsigned short Half)
+{
+    return (Half & 0x7C00) == 0x7C00 && (Half & 0x3FF) != 0;
+}
+
+static void TestHalfConversions()
+{
+    // Every half except the NaNs survives a round trip, and NaNs stay NaNs
+    for (UINT Half = 0; Half <= 0xFFFF; ++Half)
+    {
+        const unsigned short Result = FloatToHalf(HalfToFloat((unsigned short)Half));
+        if (IsHalfNaN((unsigned short)Half)) CHECK(IsHalfNaN(Result));
+        else CHECK(Result == Half);
+    }
+
+    // Round to nearest even, overflow to infinity, and denormals
+    CHECK(FloatToHalf(1.f + ldexpf(1.f, -11)) == 0x3C00);
+    CHECK(FloatToHalf(1.f + 3.f * ldexpf(1.f, -11)) == 0x3C02);
+    CHECK(FloatToHalf(65504.f) == 0x7BFF);
+    CHECK(FloatToHalf(65519.f) == 0x7BFF);
+    CHECK(FloatToHalf(65520.f) == 0x7C00);
+    CHECK(FloatToHalf(-1e10f) == 0xFC00);
+    CHECK(FloatToHalf(ldexpf(1.f, -24)) == 0x0001);
+    CHECK(FloatToHalf(ldexpf(1.f, -25)) == 0x0000);
+    CHECK(FloatToHalf(3.f * ldexpf(1.f, -25)) == 0x0002);
+    CHECK(FloatToHalf(-0.f) == 0x8000);
+    CHECK(FloatToHalf(ldexpf(1.f, -26)) == 0x0000);
+    CHECK(FloatToHalf(-ldexpf(1.f, -40)) == 0x8000);
+    CHECK(HalfToFloat(0x0001) == ldexpf(1.f, -24));
+    CHECK(HalfToFloat(0x7C00) > 65504.f);
+}
+
+static void TestTexelConversions()
+{
+    // Half texels: decoding gives the nearest half, which encodes to the same bits
+    UINT Seed = 1;
+    for (int i = 0; i < 10000; ++i)
+    {
+        float Color[4];
+        for (int c = 0; c < 4; ++c)
+        {
+            Seed = Seed * 1664525 + 1013904223;
+            Color[c] = ldexpf((float)(int)(Seed >> 8) / (float)(1 << 24) - 0.25f, (int)(Seed % 40) - 24);
+        }
+
+        BYTE Texel[8], Texel2[8];
+        float Decoded[4];
+        EncodeTexel(RHI_FORMAT_R16G16B16A16_FLOAT, Color, Texel);
+        DecodeTexel(RHI_FORMAT_R16G16B16A16_FLOAT, Texel, Decoded);
+        EncodeTexel(RHI_FORMAT_R16G16B16A16_FLOAT, Decoded, Texel2);
+        CHECK(memcmp(Texel, Texel2, sizeof(Texel)) == 0);
+        for (int c = 0; c < 4; ++c)
+        {
+            CHECK(fabsf(Decoded[c] - Color[c]) <= fabsf(Color[c]) * ldexpf(1.f, -11) + ldexpf(1.f, -25));
+        }
+    }
+
+    // Every UNORM value survives a round trip
+    for (UINT Value = 0; Value <= 0xFF; ++Value)
+    {
+        const BYTE Texel[4] = { (BYTE)Value, (BYTE)(255 - Value), 0, 255 };
+        BYTE Texel2[4];
+        float Color[4];
+        DecodeTexel(RHI_FORMAT_R8G8B8A8_UNORM, Texel, Color);
+        EncodeTexel(RHI_FORMAT_R8G8B8A8_UNORM, Color, Texel2);
+        CHECK(memcmp(Texel, Texel2, sizeof(Texel)) == 0);
+    }
+    for (UINT Value = 0; Value <= 0xFFFF; ++Value)
+    {
+        const unsigned short Texel = (unsigned short)Value;
+        unsigned short Texel2;
+        float Color[4];
+        DecodeTexel(RHI_FORMAT_D16_UNORM, (const BYTE*)&Texel, Color);
+        EncodeTexel(RHI_FORMAT_D16_UNORM, Color, (BYTE*)&Texel2);
+        CHECK(Texel == Texel2);
+    }
+
+    // The stencil bits of D24S8 are kept
+    UINT Texel = 0xA5000000;
+    const float Depth[4] = { 0.5f, 0.f, 0.f, 0.f };
+    EncodeTexel(RHI_FORMAT_D24_UNORM_S8_UINT, Depth, (BYTE*)&Texel);
+    CHECK(Texel == (0xA5000000 | 0x800000));
+
+    // Saturation, and NaN to 0
+    const float NaN = sqrtf(-1.f);
+    CHECK(FloatToUNorm(NaN, 255) == 0);
+    CHECK(FloatToUNorm(-1.f, 255) == 0);
+    CHECK(FloatToUNorm(2.f, 255) == 255);
+    CHECK(FloatToUNorm(0.5f / 255.f, 255) == 1);
+    CHECK(FloatToUNorm(0.49f / 255.f, 255) == 0);
+}
+
+//--------------------------------------------------------------------------------------
+// Output merger, compared with a per-sample scalar reference.
+// This executable is also built with SOFTWARE_SSE2=0, so that both OMVector
+// implementations are checked against the same reference.
+//--------------------------------------------------------------------------------------
+
+struct MergerConfig
+{
+    const char *pName;
+    UINT SampleCount;
+    UINT NumRTVs;
+    RHIFormat RTFormats[2];
+    RHIFormat DepthFormat;      // RHI_FORMAT_UNKNOWN for no depth buffer
+    UINT SampleMask;
+    RHIBlendDesc BlendDesc;
+    RHIDepthStencilDesc DepthStencilDesc;
+};
+
+#define MERGER_SIZE 4
+
+static UINT g_Seed = 1;
+
+static float RandomFloat(float Min, float Max)
+{
+    g_Seed = g_Seed * 1664525 + 1013904223;
+    return Min + (Max - Min) * (float)(g_Seed >> 8) / (float)(1 << 24);
+}
+
+static UINT RandomUInt()
+{
+    g_Seed = g_Seed * 1664525 + 1013904223;
+    return g_Seed >> 8;
+}
+
+static float Saturate(float Value)
+{
+    return !(Value > 0.f) ? 0.f : (Value > 1.f) ? 1.f : Value;
+}
+
+static bool CompareDepth(RHIComparison Func, float Src, float Dst)
+{
+    switch (Func)
+    {
+    case RHI_COMPARISON_LESS:           return Src < Dst;
+    case RHI_COMPARISON_EQUAL:          return Src == Dst;
+    case RHI_COMPARISON_LESS_EQUAL:     return Src <= Dst;
+    case RHI_COMPARISON_GREATER:        return Src > Dst;
+    case RHI_COMPARISON_NOT_EQUAL:      return Src != Dst;
+    case RHI_COMPARISON_GREATER_EQUAL:  return Src >= Dst;
+    case RHI_COMPARISON_ALWAYS:         return true;
+    default:                            return false;
+    }
+}
+
+static float BlendFactor(RHIBlend Blend, float Src, float SrcAlpha, float Dst, float DstAlpha)
+{
+    switch (Blend)
+    {
+    case RHI_BLEND_ONE:             return 1.f;
+    case RHI_BLEND_SRC_COLOR:       return Src;
+    case RHI_BLEND_INV_SRC_COLOR:   return 1.f - Src;
+    case RHI_BLEND_SRC_ALPHA:       return SrcAlpha;
+    case RHI_BLEND_INV_SRC_ALPHA:   return 1.f - SrcAlpha;
+    case RHI_BLEND_DEST_ALPHA:      return DstAlpha;
+    case RHI_BLEND_INV_DEST_ALPHA:  return 1.f - DstAlpha;
+    case RHI_BLEND_DEST_COLOR:      return Dst;
+    case RHI_BLEND_INV_DEST_COLOR:  return 1.f - Dst;
+    default:                        return 0.f;
+    }
+}
+
+static float BlendOp(RHIBlendOp Op, float Src, float SrcFactor, float Dst, float DstFactor)
+{
+    switch (Op)
+    {
+    case RHI_BLEND_OP_SUBTRACT:     return Src * SrcFactor - Dst * DstFactor;
+    case RHI_BLEND_OP_REV_SUBTRACT: return Dst * DstFactor - Src * SrcFactor;
+    case RHI_BLEND_OP_MIN:          return (Src < Dst) ? Src : Dst;
+    case RHI_BLEND_OP_MAX:          return (Src > Dst) ? Src : Dst;
+    default:                        return Src * SrcFactor + Dst * DstFactor;
+    }
+}
+
+static UINT GetNumChannels(RHIFormat Format)
+{
+    return (Format == RHI_FORMAT_R8G8B8A8_UNORM || Format == RHI_FORMAT_R16G16B16A16_FLOAT) ? 4 : 1;
+}
+
+// One sample at a time, with EncodeTexel/DecodeTexel for all the conversions
+static UINT ReferenceMerge(const MergerConfig &Config, SoftwareTexture *const *ppRTs, SoftwareTexture *pDepth, const SoftwarePixelBatch &Batch)
+{
+    UINT NumPassed = 0;
+    for (UINT i = 0; i < Batch.NumPixels; ++i)
+    {
+        for (UINT Sample = 0; Sample < Config.SampleCount; ++Sample)
+        {
+            if (!((Batch.Coverage[i] & Config.SampleMask) >> Sample & 1)) continue;
+
+            if (pDepth && Config.DepthStencilDesc.DepthEnable)
+            {
+                BYTE *pTexel = pDepth->GetTexel(Batch.X[i], Batch.Y[i], Sample);
+                const float SrcDepth[4] = { Saturate(Batch.Depth[i]), 0.f, 0.f, 0.f };
+
+                // Compare the stored values, so that the UNORM depths are compared exactly
+                BYTE SrcTexel[4];
+                memcpy(SrcTexel, pTexel, sizeof(SrcTexel));
+                EncodeTexel(Config.DepthFormat, SrcDepth, SrcTexel);
+                float Src[4], Dst[4];
+                DecodeTexel(Config.DepthFormat, SrcTexel, Src);
+                DecodeTexel(Config.DepthFormat, pTexel, Dst);
+                if (!CompareDepth(Config.DepthStencilDesc.DepthFunc, Src[0], Dst[0])) continue;
+
+                if (Config.DepthStencilDesc.DepthWriteEnable)
+                {
+                    memcpy(pTexel, SrcTexel, GetFormatSize(Config.DepthFormat));
+                }
+            }
+            ++NumPassed;
+
+            for (UINT RT = 0; RT < Config.NumRTVs; ++RT)
+            {
+                const RHIRenderTargetBlendDesc &Desc = Config.BlendDesc.RenderTarget[Config.BlendDesc.IndependentBlendEnable ? RT : 0];
+                const RHIFormat Format = Config.RTFormats[RT];
+                const bool IsUNorm = (Format == RHI_FORMAT_R8G8B8A8_UNORM);
+                BYTE *pTexel = ppRTs[RT]->GetTexel(Batch.X[i], Batch.Y[i], Sample);
+
+                float Src[4], Dst[4], Result[4];
+                DecodeTexel(Format, pTexel, Dst);
+                for (int c = 0; c < 4; ++c)
+                {
+                    Src[c] = IsUNorm ? Saturate(Batch.Color[RT][c][i]) : Batch.Color[RT][c][i];
+                }
+                for (int c = 0; c < 4; ++c)
+                {
+                    Result[c] = Src[c];
+                    if (!Desc.BlendEnable) continue;
+
+                    const bool IsAlpha = (c == 3);
+                    const float SrcFactor = BlendFactor(IsAlpha ? Desc.SrcBlendAlpha : Desc.SrcBlend, Src[c], Src[3], Dst[c], Dst[3]);
+                    const float DstFactor = BlendFactor(IsAlpha ? Desc.DestBlendAlpha : Desc.DestBlend, Src[c], Src[3], Dst[c], Dst[3]);
+                    Result[c] = BlendOp(IsAlpha ? Desc.BlendOpAlpha : Desc.BlendOp, Src[c], SrcFactor, Dst[c], DstFactor);
+                }
+
+                // Only the channels of the write mask are copied to the texel
+                BYTE Texel[16];
+                EncodeTexel(Format, Result, Texel);
+                const UINT ChannelSize = GetFormatSize(Format) / GetNumChannels(Format);
+                for (UINT c = 0; c < GetNumChannels(Format); ++c)
+                {
+                    if (Desc.RenderTargetWriteMask & (1 << c)) memcpy(pTexel + c * ChannelSize, Texel + c * ChannelSize, ChannelSize);
+                }
+            }
+        }
+    }
+    return NumPassed;
+}
+
+static bool TexturesMatch(SoftwareTexture *pA, SoftwareTexture *pB)
+{
+    const RHITextureDesc &Desc = pA->GetDesc();
+    for (UINT y = 0; y < Desc.Height; ++y)
+    {
+        for (UINT x = 0; x < Desc.Width; ++x)
+        {
+            for (UINT Sample = 0; Sample < Desc.SampleCount; ++Sample)
+            {
+                if (memcmp(pA->GetTexel(x, y, Sample), pB->GetTexel(x, y, Sample), pA->GetTexelSize())) return false;
+            }
+        }
+    }
+    return true;
+}
+
+static SoftwareTexture* CreateTexture(SoftwareDevice &Device, RHIFormat Format, UINT SampleCount, UINT BindFlags)
+{
+    RHITextureDesc Desc;
+    Desc.Width = MERGER_SIZE;
+    Desc.Height = MERGER_SIZE;
+    Desc.SampleCount = SampleCount;
+    Desc.Format = Format;
+    Desc.BindFlags = BindFlags;
+    RHIDevice &RHI = Device;
+    return (SoftwareTexture*)RHI.CreateTexture2D(Desc);
+}
+
+static void TestMergeConfig(const MergerConfig &Config)
+{
+    SoftwareDevice Device;
+    RHIDevice &RHI = Device;
+
+    // The context merges into the bound textures, the reference into copies of them
+    SoftwareTexture *pRTs[2] = { NULL, NULL };
+    SoftwareTexture *pRefRTs[2] = { NULL, NULL };
+    RHIView *pRTVs[2] = { NULL, NULL };
+    for (UINT RT = 0; RT < Config.NumRTVs; ++RT)
+    {
+        pRTs[RT] = CreateTexture(Device, Config.RTFormats[RT], Config.SampleCount, RHI_BIND_RENDER_TARGET);
+        pRefRTs[RT] = CreateTexture(Device, Config.RTFormats[RT], Config.SampleCount, RHI_BIND_RENDER_TARGET);
+        pRTVs[RT] = RHI.CreateRenderTargetView(pRTs[RT]);
+
+        const float ClearColor[4] = { 0.25f, 0.5f, 0.75f, 0.5f };
+        pRTs[RT]->Fill(0, ClearColor);
+        pRefRTs[RT]->Fill(0, ClearColor);
+    }
+
+    SoftwareTexture *pDepth = NULL;
+    SoftwareTexture *pRefDepth = NULL;
+    RHIView *pDSV = NULL;
+    if (Config.DepthFormat != RHI_FORMAT_UNKNOWN)
+    {
+        pDepth = CreateTexture(Device, Config.DepthFormat, Config.SampleCount, RHI_BIND_DEPTH_STENCIL);
+        pRefDepth = CreateTexture(Device, Config.DepthFormat, Config.SampleCount, RHI_BIND_DEPTH_STENCIL);
+        pDSV = RHI.CreateDepthStencilView(pDepth);
+
+        const float ClearDepth[4] = { 0.5f, 0.f, 0.f, 0.f };
+        pDepth->Fill(0, ClearDepth);
+        pRefDepth->Fill(0, ClearDepth);
+    }
+
+    RHIBlendState *pBS = RHI.CreateBlendState(Config.BlendDesc);
+    RHIDepthStencilState *pDSS = RHI.CreateDepthStencilState(Config.DepthStencilDesc);
+
+    // The state is bound as the techniques bind it, through a command list
+    CommandList Commands;
+    const float BlendFactor[4] = { 1.f, 1.f, 1.f, 1.f };
+    Commands.SetBlendState(pBS, BlendFactor, Config.SampleMask);
+    Commands.SetDepthStencilState(pDSS, 0);
+    Commands.SetRenderTargets(Config.NumRTVs, pRTVs, pDSV);
+
+    SoftwareContext Context;
+    Context.Submit(Commands, false);
+
+    UINT NumPassed = 0;
+    UINT RefNumPassed = 0;
+    for (int BatchIndex = 0; BatchIndex < 200; ++BatchIndex)
+    {
+        SoftwarePixelBatch Batch;
+        memset(&Batch, 0, sizeof(Batch));
+        Batch.NumPixels = 1 + RandomUInt() % SOFTWARE_PIXEL_BATCH_SIZE;
+
+        // Distinct pixels, by a random rotation of the pixel indices
+        const UINT FirstPixel = RandomUInt();
+        for (UINT i = 0; i < Batch.NumPixels; ++i)
+        {
+            const UINT Pixel = (FirstPixel + i * 3) % (MERGER_SIZE * MERGER_SIZE);
+            Batch.X[i] = Pixel % MERGER_SIZE;
+            Batch.Y[i] = Pixel / MERGER_SIZE;
+            Batch.Coverage[i] = RandomUInt();
+            Batch.Depth[i] = RandomFloat(-0.1f, 1.1f);
+            for (UINT RT = 0; RT < Config.NumRTVs; ++RT)
+            {
+                for (int c = 0; c < 4; ++c)
+                {
+                    Batch.Color[RT][c][i] = RandomFloat(-0.25f, 1.25f);
+                }
+            }
+        }
+
+        const UINT NumMergedSamples = (UINT)Context.GetStats().NumMergedSamples;
+        Context.MergePixels(Batch);
+        NumPassed += (UINT)Context.GetStats().NumMergedSamples - NumMergedSamples;
+        RefNumPassed += ReferenceMerge(Config, pRefRTs, pRefDepth, Batch);
+    }
+
+    bool Match = (NumPassed == RefNumPassed) && NumPassed > 0;
+    for (UINT RT = 0; RT < Config.NumRTVs; ++RT)
+    {
+        Match = Match && TexturesMatch(pRTs[RT], pRefRTs[RT]);
+    }
+    if (pDepth)
+    {
+        Match = Match && TexturesMatch(pDepth, pRefDepth);
+    }
+    if (!Match)
+    {
+        fprintf(stderr, "%s: %u samples merged, %u in the reference\n", Config.pName, NumPassed, RefNumPassed);
+    }
+    CHECK(Match);
+
+    SAFE_DELETE(pBS);
+    SAFE_DELETE(pDSS);
+    SAFE_DELETE(pDSV);
+    SAFE_DELETE(pDepth);
+    SAFE_DELETE(pRefDepth);
+    for (UINT RT = 0; RT < Config.NumRTVs; ++RT)
+    {
+        SAFE_DELETE(pRTVs[RT]);
+        SAFE_DELETE(pRTs[RT]);
+        SAFE_DELETE(pRefRTs[RT]);
+    }
+}
+
+static void TestMergePixels()
+{
+    MergerConfig Config;
+
+    // Alpha blending over MSAA, as PlainAlphaBlending
+    Config = MergerConfig();
+    Config.pName = "AlphaBlending";
+    Config.SampleCount = 4;
+    Config.NumRTVs = 1;
+    Config.RTFormats[0] = RHI_FORMAT_R8G8B8A8_UNORM;
+    Config.DepthFormat = RHI_FORMAT_D32_FLOAT;
+    Config.SampleMask = 0xFFFFFFFF;
+    Config.BlendDesc.RenderTarget[0].BlendEnable = true;
+    Config.BlendDesc.RenderTarget[0].SrcBlend = RHI_BLEND_SRC_ALPHA;
+    Config.BlendDesc.RenderTarget[0].DestBlend = RHI_BLEND_INV_SRC_ALPHA;
+    Config.BlendDesc.RenderTarget[0].DestBlendAlpha = RHI_BLEND_INV_SRC_ALPHA;
+    Config.DepthStencilDesc.DepthFunc = RHI_COMPARISON_LESS;
+    TestMergeConfig(Config);
+
+    // Additive half accumulation and a MIN target, as the stochastic accumulation passes
+    Config = MergerConfig();
+    Config.pName = "Accumulation";
+    Config.SampleCount = 1;
+    Config.NumRTVs = 2;
+    Config.RTFormats[0] = RHI_FORMAT_R16G16B16A16_FLOAT;
+    Config.RTFormats[1] = RHI_FORMAT_R32_FLOAT;
+    Config.DepthFormat = RHI_FORMAT_UNKNOWN;
+    Config.SampleMask = 0xFFFFFFFF;
+    Config.BlendDesc.IndependentBlendEnable = true;
+    Config.BlendDesc.RenderTarget[0].BlendEnable = true;
+    Config.BlendDesc.RenderTarget[0].DestBlend = RHI_BLEND_ONE;
+    Config.BlendDesc.RenderTarget[0].DestBlendAlpha = RHI_BLEND_ONE;
+    Config.BlendDesc.RenderTarget[0].RenderTargetWriteMask = 0x7;
+    Config.BlendDesc.RenderTarget[1].BlendEnable = true;
+    Config.BlendDesc.RenderTarget[1].BlendOp = RHI_BLEND_OP_MIN;
+    Config.BlendDesc.RenderTarget[1].BlendOpAlpha = RHI_BLEND_OP_MIN;
+    TestMergeConfig(Config);
+
+    // Multiplicative transmittance with a sample mask and a read-only depth buffer
+    Config = MergerConfig();
+    Config.pName = "Transmittance";
+    Config.SampleCount = 8;
+    Config.NumRTVs = 1;
+    Config.RTFormats[0] = RHI_FORMAT_R16_FLOAT;
+    Config.DepthFormat = RHI_FORMAT_D16_UNORM;
+    Config.SampleMask = 0x55;
+    Config.BlendDesc.RenderTarget[0].BlendEnable = true;
+    Config.BlendDesc.RenderTarget[0].SrcBlend = RHI_BLEND_ZERO;
+    Config.BlendDesc.RenderTarget[0].DestBlend = RHI_BLEND_INV_SRC_COLOR;
+    Config.DepthStencilDesc.DepthWriteEnable = false;
+    Config.DepthStencilDesc.DepthFunc = RHI_COMPARISON_LESS_EQUAL;
+    TestMergeConfig(Config);
+
+    // No blending, partial write mask, and D24 with GREATER
+    Config = MergerConfig();
+    Config.pName = "WriteMask";
+    Config.SampleCount = 2;
+    Config.NumRTVs = 1;
+    Config.RTFormats[0] = RHI_FORMAT_R8G8B8A8_UNORM;
+    Config.DepthFormat = RHI_FORMAT_D24_UNORM_S8_UINT;
+    Config.SampleMask = 0xFFFFFFFF;
+    Config.BlendDesc.RenderTarget[0].RenderTargetWriteMask = 0xA;
+    Config.DepthStencilDesc.DepthFunc = RHI_COMPARISON_GREATER;
+    TestMergeConfig(Config);
+}
+
+int main()
+{
+    TestHalfConversions();
+    TestTexelConversions();
+    TestMergePixels();
+    return TestResult(SOFTWARE_SSE2 ? "SoftwareOutputMergerTest (SSE2)" : "SoftwareOutputMergerTest (scalar)");
+}
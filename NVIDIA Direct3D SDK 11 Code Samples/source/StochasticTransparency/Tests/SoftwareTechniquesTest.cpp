@@ -0,0 +1,221 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#include "TestCommon.h"
+#include "../RHI_Software.h"
+#include "../DualDepthPeeling.h"
+#include "../StochasticTransparency.h"
+#include "../PlainAlphaBlending.h"
+#include "../DepthComplexity.h"
+
+//--------------------------------------------------------------------------------------
+// Headless run of the techniques on the software backend, a validation mock that executes
+// the clears and resolves and checks every draw against the bound state without rasterizing:
+// no draw may read a texture bound as render target or depth buffer, in any configuration
+// of the sample UI. The rendered images are not checked.
+//--------------------------------------------------------------------------------------
+
+#define TEST_WIDTH 64
+#define TEST_HEIGHT 32
+#define TEST_NUM_DRAWS 10
+#define TEST_NUM_ORDERED_DRAWS 12
+#define TEST_NUM_OPAQUE_DRAWS 3
+
+UINT BaseTechnique::m_NumGeomPasses;
+float BaseTechnique::m_Alpha = 0.6f;
+
+static void RenderFrames(SoftwareContext &Context, BaseTechnique &Technique, RHIView *pBackBufferRTV, UINT NumFrames, const char *pConfig)
+{
+    for (UINT Frame = 0; Frame < NumFrames; ++Frame)
+    {
+        Context.ResetState();
+        Context.ResetStats();
+        BaseTechnique::ResetNumGeometryPasses();
+        Technique.Render(Context, pBackBufferRTV);
+
+        const SoftwareStats &Stats = Context.GetStats();
+        if (Stats.NumHazards != 0)
+        {
+            fprintf(stderr, "%s, frame %u: %u hazards\n", pConfig, Frame, Stats.NumHazards);
+        }
+        CHECK(Stats.NumHazards == 0);
+        CHECK(Stats.NumDraws > 0);
+        CHECK(Stats.NumMeshDraws > 0);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// All the techniques, at full and reduced resolution, with and without the opaque
+// subsets and the tile classification
+//--------------------------------------------------------------------------------------
+static void TestTechniques(SoftwareDevice &Device, SoftwareContext &Context, RHIView *pBackBufferRTV)
+{
+    const char *Names[3] = { "StochasticTransparency", "DualDepthPeeling", "PlainAlphaBlending" };
+    for (UINT Scale = 1; Scale <= 2; ++Scale)
+    {
+        StochasticTransparency ST(&Device, TEST_WIDTH, TEST_HEIGHT, Scale);
+        DualDepthPeeling DDP(&Device, TEST_WIDTH, TEST_HEIGHT, Scale);
+        PlainAlphaBlending PAB(&Device, TEST_WIDTH, TEST_HEIGHT, Scale);
+        BaseTechnique *Techniques[3] = { &ST, &DDP, &PAB };
+        for (UINT t = 0; t < 3; ++t)
+        {
+            for (UINT Config = 0; Config < 4; ++Config)
+            {
+                const bool Opaque = (Config & 1) != 0;
+                const bool Tiles = (Config & 2) != 0;
+                Techniques[t]->SetOpaqueGeometry(Opaque);
+                Techniques[t]->SetTileClassification(Tiles);
+                Context.SetGeometry(TEST_NUM_DRAWS, TEST_NUM_ORDERED_DRAWS, Opaque ? TEST_NUM_OPAQUE_DRAWS : 0);
+
+                char sz[100];
+                snprintf(sz, sizeof(sz), "%s, scale %u, opaque %d, tiles %d", Names[t], Scale, (int)Opaque, (int)Tiles);
+                RenderFrames(Context, *Techniques[t], pBackBufferRTV, 2, sz);
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// The options of the stochastic transparency, alone and combined
+//--------------------------------------------------------------------------------------
+static void TestStochasticOptions(SoftwareDevice &Device, SoftwareContext &Context, RHIView *pBackBufferRTV)
+{
+    StochasticTransparency Technique(&Device, TEST_WIDTH, TEST_HEIGHT);
+    Context.SetGeometry(TEST_NUM_DRAWS, TEST_NUM_ORDERED_DRAWS, TEST_NUM_OPAQUE_DRAWS);
+
+    for (UINT Config = 0; Config < 64; ++Config)
+    {
+        const bool Sorted = (Config & 1) != 0;
+        const bool Farthest = (Config & 2) != 0;
+        const bool Depth16 = (Config & 4) != 0;
+        const bool Temporal = (Config & 8) != 0;
+        const bool Denoise = (Config & 16) != 0;
+        const bool Progressive = (Config & 32) != 0;
+
+        Technique.SetSortedDepths(Sorted);
+        Technique.SetFarthestDepthRejection(Farthest);
+        Technique.SetStochasticDepthFormat(&Device, Depth16 ? RHI_FORMAT_D16_UNORM : RHI_FORMAT_D32_FLOAT);
+        Technique.SetTemporalAccumulation(Temporal || Progressive);
+        Technique.SetProgressiveRefinement(&Device, Progressive);
+        Technique.SetDenoise(Denoise);
+        Technique.SetOpaqueGeometry(true);
+        Technique.SetTileClassification((Config % 3) == 0);
+
+        char sz[100];
+        snprintf(sz, sizeof(sz), "StochasticTransparency, options 0x%02x", Config);
+
+        // Enough frames for both history parities
+        RenderFrames(Context, Technique, pBackBufferRTV, 3, sz);
+
+        // The technique selection predicts the cost of the stochastic transparency with it
+        CHECK(Technique.GetCommands().GetNumMeshDraws(MESH_DRAW_LIST_TRANSPARENT) == NUM_STOCHASTIC_GEOMETRY_PASSES);
+
+        if (Temporal)
+        {
+            Technique.SetTemporalDepthOutput(true);
+            RenderFrames(Context, Technique, pBackBufferRTV, 1, sz);
+            Technique.SetTemporalDepthOutput(false);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// With temporal accumulation, the frames alternate between the two recorded parities,
+// which are only recorded again after a settings change
+//--------------------------------------------------------------------------------------
+static bool SameCommands(const CommandList &a, const CommandList &b)
+{
+    if (a.GetNumCommands() != b.GetNumCommands()) return false;
+    for (size_t i = 0; i < a.GetNumCommands(); ++i)
+    {
+        if (memcmp(&a.GetCommand(i), &b.GetCommand(i), sizeof(Command))) return false;
+    }
+    return true;
+}
+
+static void TestTemporalCommandLists(SoftwareDevice &Device, SoftwareContext &Context, RHIView *pBackBufferRTV)
+{
+    StochasticTransparency Technique(&Device, TEST_WIDTH, TEST_HEIGHT);
+    Context.SetGeometry(TEST_NUM_DRAWS, TEST_NUM_ORDERED_DRAWS, TEST_NUM_OPAQUE_DRAWS);
+    Technique.SetTemporalAccumulation(true);
+
+    const CommandList *pLists[4];
+    CommandList Copies[2];
+    for (UINT Frame = 0; Frame < 4; ++Frame)
+    {
+        RenderFrames(Context, Technique, pBackBufferRTV, 1, "StochasticTransparency, temporal");
+        pLists[Frame] = &Technique.GetCommands();
+        if (Frame < 2) Copies[Frame] = *pLists[Frame];
+    }
+    CHECK(pLists[0] != pLists[1]);
+    CHECK(pLists[0] == pLists[2] && pLists[1] == pLists[3]);
+    CHECK(!SameCommands(Copies[0], Copies[1]));
+    CHECK(SameCommands(Copies[0], *pLists[2]) && SameCommands(Copies[1], *pLists[3]));
+
+    // A settings change records both parities again
+    Technique.SetTemporalDepthOutput(true);
+    RenderFrames(Context, Technique, pBackBufferRTV, 2, "StochasticTransparency, temporal depth");
+    CHECK(!SameCommands(Technique.GetCommands(), Copies[1]));
+}
+
+//--------------------------------------------------------------------------------------
+// The probe of the automatic selection, after the frame of a technique
+//--------------------------------------------------------------------------------------
+static void TestDepthComplexityProbe(SoftwareDevice &Device, SoftwareContext &Context, RHIView *pBackBufferRTV)
+{
+    DualDepthPeeling Technique(&Device, TEST_WIDTH, TEST_HEIGHT);
+    DepthComplexityProbe Probe(&Device, TEST_WIDTH, TEST_HEIGHT);
+    for (UINT Opaque = 0; Opaque < 2; ++Opaque)
+    {
+        Probe.SetOpaqueGeometry(Opaque == 1);
+        Context.SetGeometry(TEST_NUM_DRAWS, TEST_NUM_ORDERED_DRAWS, Opaque ? TEST_NUM_OPAQUE_DRAWS : 0);
+        Context.ResetState();
+        Context.ResetStats();
+        Technique.Render(Context, pBackBufferRTV);
+        Probe.Render(Context);
+        CHECK(Context.GetStats().NumHazards == 0);
+    }
+
+    // Counts above MAX_DEPTH_COMPLEXITY are clamped in the mean as in the histogram
+    const float Counts[4] = { 0.f, 2.f, 1000.f, (float)MAX_DEPTH_COMPLEXITY };
+    DepthComplexityStats Stats;
+    Stats.Add(Counts, 4);
+    CHECK(Stats.GetNumCoveredPixels() == 3);
+    CHECK(Stats.GetMaxLayers() == MAX_DEPTH_COMPLEXITY);
+    CHECK(Stats.GetMeanLayers() == (2.f + 2.f * MAX_DEPTH_COMPLEXITY) / 3.f);
+}
+
+int main()
+{
+    SoftwareDevice Device;
+    SoftwareContext Context;
+    RHIDevice &RHI = Device;
+
+    RHITextureDesc Desc;
+    Desc.Width = TEST_WIDTH;
+    Desc.Height = TEST_HEIGHT;
+    Desc.Format = RHI_FORMAT_R8G8B8A8_UNORM;
+    RHITexture *pBackBuffer = RHI.CreateTexture2D(Desc);
+    RHIView *pBackBufferRTV = RHI.CreateRenderTargetView(pBackBuffer);
+
+    TestTechniques(Device, Context, pBackBufferRTV);
+    TestStochasticOptions(Device, Context, pBackBufferRTV);
+    TestTemporalCommandLists(Device, Context, pBackBufferRTV);
+    TestDepthComplexityProbe(Device, Context, pBackBufferRTV);
+
+    SAFE_DELETE(pBackBufferRTV);
+    SAFE_DELETE(pBackBuffer);
+    return TestResult("SoftwareTechniquesTest");
+}
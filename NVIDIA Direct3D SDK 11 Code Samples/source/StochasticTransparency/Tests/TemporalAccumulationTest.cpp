@@ -0,0 +1,221 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+#include "TestCommon.h"
+#include "../TemporalAccumulation.h"
+
+#include <vector>
+
+//--------------------------------------------------------------------------------------
+// CPU reference of the temporal resolve on small synthetic images: the GPU result is only
+// compared with it by the Verify Temporal button of the sample, so it is checked here
+//--------------------------------------------------------------------------------------
+
+#define TEST_WIDTH 6
+#define TEST_HEIGHT 4
+#define TEST_TOLERANCE 1e-5f
+
+static DirectX::XMFLOAT4X4 Identity()
+{
+    DirectX::XMFLOAT4X4 M;
+    for (UINT i = 0; i < 4; ++i)
+    {
+        for (UINT j = 0; j < 4; ++j)
+        {
+            M.m[i][j] = (i == j) ? 1.f : 0.f;
+        }
+    }
+    return M;
+}
+
+static void Fill(std::vector<float> &Image, float Red, float Transmittance)
+{
+    Image.resize(TEST_WIDTH * TEST_HEIGHT * 4);
+    for (UINT i = 0; i < TEST_WIDTH * TEST_HEIGHT; ++i)
+    {
+        Image[i * 4 + 0] = Red;
+        Image[i * 4 + 1] = 0.25f;
+        Image[i * 4 + 2] = 0.75f;
+        Image[i * 4 + 3] = Transmittance;
+    }
+}
+
+// Red checkerboard: every interior pixel has 4 or 5 red pixels in its 3x3 neighborhood
+static void FillChecker(std::vector<float> &Image, float Transmittance)
+{
+    Fill(Image, 0.f, Transmittance);
+    for (UINT y = 0; y < TEST_HEIGHT; ++y)
+    {
+        for (UINT x = 0; x < TEST_WIDTH; ++x)
+        {
+            Image[(y * TEST_WIDTH + x) * 4] = ((x + y) & 1) ? 1.f : 0.f;
+        }
+    }
+}
+
+static const float* Pixel(const std::vector<float> &Image, UINT x, UINT y)
+{
+    return &Image[(y * TEST_WIDTH + x) * 4];
+}
+
+static void Resolve(const std::vector<float> &Current, const std::vector<float> &History, const DirectX::XMFLOAT4X4 &CurrentToPrevious,
+                    float HistoryWeight, bool Progressive, std::vector<float> &Output)
+{
+    const std::vector<float> Depth(TEST_WIDTH * TEST_HEIGHT, 0.5f);
+    const DirectX::XMFLOAT4 Params(HistoryWeight, TEMPORAL_REJECTION_SCALE, TEMPORAL_VARIANCE_GAMMA, Progressive ? 1.f : 0.f);
+    Output.assign(TEST_WIDTH * TEST_HEIGHT * 4, -1.f);
+    ResolveTemporal(&Current[0], &History[0], &Depth[0], TEST_WIDTH, TEST_HEIGHT, CurrentToPrevious, Params, &Output[0]);
+}
+
+//--------------------------------------------------------------------------------------
+// The history is clamped to the mean of the 3x3 neighborhood plus or minus
+// TEMPORAL_VARIANCE_GAMMA standard deviations, channel by channel
+//--------------------------------------------------------------------------------------
+static void TestVarianceClamping()
+{
+    std::vector<float> Current, History, Output;
+    FillChecker(Current, 0.5f);
+
+    // Pixel (1,1) is black, with its 4 direct neighbors red: mean 4/9, variance 20/81
+    const float Mean = 4.f / 9.f;
+    const float Sigma = sqrtf(20.f) / 9.f;
+    const float W = TEMPORAL_HISTORY_WEIGHT;
+
+    // Far above the box: clamped to its top
+    Fill(History, 10.f, 0.5f);
+    Resolve(Current, History, Identity(), W, false, Output);
+    CHECK(fabsf(Pixel(Output, 1, 1)[0] - (Mean + TEMPORAL_VARIANCE_GAMMA * Sigma) * W) < TEST_TOLERANCE);
+
+    // Far below: clamped to its bottom
+    Fill(History, -10.f, 0.5f);
+    Resolve(Current, History, Identity(), W, false, Output);
+    CHECK(fabsf(Pixel(Output, 1, 1)[0] - (Mean - TEMPORAL_VARIANCE_GAMMA * Sigma) * W) < TEST_TOLERANCE);
+
+    // Inside the box: blended as is
+    Fill(History, 0.5f, 0.5f);
+    Resolve(Current, History, Identity(), W, false, Output);
+    CHECK(fabsf(Pixel(Output, 1, 1)[0] - 0.5f * W) < TEST_TOLERANCE);
+
+    // Uniform channels have no variance: the history collapses to the current color
+    for (UINT i = 0; i < TEST_WIDTH * TEST_HEIGHT; ++i)
+    {
+        CHECK(fabsf(Output[i * 4 + 1] - 0.25f) < TEST_TOLERANCE);
+        CHECK(fabsf(Output[i * 4 + 2] - 0.75f) < TEST_TOLERANCE);
+        CHECK(Output[i * 4 + 3] == 0.5f);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// A change of transmittance scales the history weight down, by TEMPORAL_REJECTION_SCALE
+// per unit of change, and history reprojected off screen is dropped
+//--------------------------------------------------------------------------------------
+static void TestHistoryRejection()
+{
+    std::vector<float> Current, History, Output;
+    FillChecker(Current, 0.5f);
+    const float W = TEMPORAL_HISTORY_WEIGHT;
+
+    // Same transmittance: full weight
+    Fill(History, 0.5f, 0.5f);
+    Resolve(Current, History, Identity(), W, false, Output);
+    CHECK(fabsf(Pixel(Output, 1, 1)[0] - 0.5f * W) < TEST_TOLERANCE);
+
+    // Half of the rejection range: half of the weight
+    Fill(History, 0.5f, 0.5f + 0.5f / TEMPORAL_REJECTION_SCALE);
+    Resolve(Current, History, Identity(), W, false, Output);
+    CHECK(fabsf(Pixel(Output, 1, 1)[0] - 0.5f * W * 0.5f) < TEST_TOLERANCE);
+
+    // The whole range or more, in either direction: the current frame only
+    const float Changes[] = { 1.f / TEMPORAL_REJECTION_SCALE, -0.4f, 0.5f };
+    for (UINT i = 0; i < sizeof(Changes) / sizeof(Changes[0]); ++i)
+    {
+        Fill(History, 0.5f, 0.5f + Changes[i]);
+        Resolve(Current, History, Identity(), W, false, Output);
+        for (UINT p = 0; p < TEST_WIDTH * TEST_HEIGHT * 4; ++p)
+        {
+            CHECK(Output[p] == Current[p]);
+        }
+    }
+
+    // Moved by a whole screen width in NDC: nothing to reproject
+    DirectX::XMFLOAT4X4 Translation = Identity();
+    Translation.m[3][0] = 2.f;
+    Fill(History, 0.5f, 0.5f);
+    Resolve(Current, History, Translation, W, false, Output);
+    for (UINT p = 0; p < TEST_WIDTH * TEST_HEIGHT * 4; ++p)
+    {
+        CHECK(Output[p] == Current[p]);
+    }
+
+    // Moved by one pixel to the right: each pixel reads the history one pixel to the right
+    for (UINT y = 0; y < TEST_HEIGHT; ++y)
+    {
+        for (UINT x = 0; x < TEST_WIDTH; ++x)
+        {
+            History[(y * TEST_WIDTH + x) * 4] = 0.1f * (float)x;
+        }
+    }
+    Translation.m[3][0] = 2.f / (float)TEST_WIDTH;
+    Resolve(Current, History, Translation, 1.f, false, Output);
+    CHECK(fabsf(Pixel(Output, 1, 1)[0] - 0.2f) < TEST_TOLERANCE);
+    CHECK(fabsf(Pixel(Output, 2, 1)[0] - 0.3f) < TEST_TOLERANCE);
+
+    // No history yet
+    Resolve(Current, History, Identity(), 0.f, false, Output);
+    for (UINT p = 0; p < TEST_WIDTH * TEST_HEIGHT * 4; ++p)
+    {
+        CHECK(Output[p] == Current[p]);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// With the weights of StochasticTransparency::BeginFrame, N / (N + 1) after N frames, the
+// progressive refinement gives the mean of the frames at each pixel, without clamping
+// or rejection
+//--------------------------------------------------------------------------------------
+static void TestProgressiveMean()
+{
+    const UINT NumFrames = 64;
+    const UINT NumValues = TEST_WIDTH * TEST_HEIGHT * 4;
+
+    std::vector<float> Frame(NumValues), History(NumValues, 0.f), Output;
+    std::vector<double> Sum(NumValues, 0.0);
+    UINT Seed = 1;
+    for (UINT N = 0; N < NumFrames; ++N)
+    {
+        for (UINT i = 0; i < NumValues; ++i)
+        {
+            Seed = Seed * 1664525 + 1013904223;
+            Frame[i] = (float)(Seed >> 8) / (float)(1 << 24);
+            Sum[i] += Frame[i];
+        }
+
+        // The first frame ignores whatever the history holds
+        Resolve(Frame, History, Identity(), (float)N / (float)(N + 1), true, Output);
+        for (UINT i = 0; i < NumValues; ++i)
+        {
+            if (i % 4 == 3) CHECK(Output[i] == Frame[i]);
+            else CHECK(fabsf(Output[i] - (float)(Sum[i] / (N + 1))) < 1e-4f);
+        }
+        History.swap(Output);
+    }
+}
+
+int main()
+{
+    TestVarianceClamping();
+    TestHistoryRejection();
+    TestProgressiveMean();
+    return TestResult("TemporalAccumulationTest");
+}
@@ -0,0 +1,41 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+// UINT and BYTE outside of Windows
+#include "../RHI.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//--------------------------------------------------------------------------------------
+// Minimal checks for the device-free unit tests: a failed CHECK prints its location
+// and the test executable returns a non-zero exit code, which is all ctest looks at.
+//--------------------------------------------------------------------------------------
+static int g_NumFailedChecks = 0;
+
+#define CHECK(Condition) \
+    do { if (!(Condition)) { fprintf(stderr, "%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #Condition); ++g_NumFailedChecks; } } while (0)
+
+inline int TestResult(const char *Name)
+{
+    printf("%s: %s\n", Name, g_NumFailedChecks ? "FAILED" : "passed");
+    return g_NumFailedChecks ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+#include "TestCommon.h"
+#include "../TileClassification.h"
+
+#include <math.h>
+
+//--------------------------------------------------------------------------------------
+// CPU reference of the tile classes, which the Verify Tile Classes button of the sample
+// compares with the GPU. The screen is not a multiple of TILE_SIZE, so the last row and
+// column of tiles are partial.
+//--------------------------------------------------------------------------------------
+
+#define TEST_WIDTH (2 * TILE_SIZE + 8)
+#define TEST_HEIGHT (TILE_SIZE + 4)
+#define TEST_TILES_X 3
+#define TEST_TILES_Y 2
+
+struct TestImages
+{
+    std::vector<BYTE> Transmittance;
+    std::vector<float> OpaqueDepth;
+
+    // Nothing transparent, and everything covered by the opaque geometry
+    TestImages(UINT Width = TEST_WIDTH, UINT Height = TEST_HEIGHT)
+        : Transmittance(Width * Height * 4, 255)
+        , OpaqueDepth(Width * Height, 0.5f)
+    {
+    }
+};
+
+static void TestClasses()
+{
+    CHECK(GetNumTiles(TEST_WIDTH) == TEST_TILES_X && GetNumTiles(TEST_HEIGHT) == TEST_TILES_Y);
+    CHECK(GetNumTiles(TILE_SIZE) == 1 && GetNumTiles(TILE_SIZE + 1) == 2 && GetNumTiles(0) == 0);
+
+    TestImages Images;
+    std::vector<UINT> Classes;
+
+    ClassifyTiles(&Images.Transmittance[0], &Images.OpaqueDepth[0], TEST_WIDTH, TEST_HEIGHT, Classes);
+    CHECK(Classes.size() == TEST_TILES_X * TEST_TILES_Y);
+    for (size_t i = 0; i < Classes.size(); ++i)
+    {
+        CHECK(Classes[i] == TILE_OPAQUE);
+    }
+
+    // Last pixel of tile (1,0), just below 1.0
+    Images.Transmittance[((TILE_SIZE - 1) * TEST_WIDTH + 2 * TILE_SIZE - 1) * 4 + 3] = 254;
+    // First pixel of the partial tile (0,1), fully opaque transparent layers
+    Images.Transmittance[(TILE_SIZE * TEST_WIDTH) * 4 + 3] = 0;
+    // Only the color changed in tile (2,0): still not transparent
+    Images.Transmittance[(3 * TEST_WIDTH + 2 * TILE_SIZE + 1) * 4] = 0;
+    // One background pixel in tile (2,0), and in the transparent tile (1,0)
+    Images.OpaqueDepth[5 * TEST_WIDTH + TEST_WIDTH - 1] = 1.f;
+    Images.OpaqueDepth[TILE_SIZE] = 1.f;
+
+    ClassifyTiles(&Images.Transmittance[0], &Images.OpaqueDepth[0], TEST_WIDTH, TEST_HEIGHT, Classes);
+    const UINT Expected[TEST_TILES_X * TEST_TILES_Y] =
+    {
+        TILE_OPAQUE, TILE_TRANSPARENT, TILE_EMPTY,
+        TILE_TRANSPARENT, TILE_OPAQUE, TILE_OPAQUE,
+    };
+    for (UINT i = 0; i < TEST_TILES_X * TEST_TILES_Y; ++i)
+    {
+        CHECK(Classes[i] == Expected[i]);
+    }
+
+    // Without opaque geometry, no tile is opaque
+    ClassifyTiles(&Images.Transmittance[0], NULL, TEST_WIDTH, TEST_HEIGHT, Classes);
+    for (UINT i = 0; i < TEST_TILES_X * TEST_TILES_Y; ++i)
+    {
+        CHECK(Classes[i] == ((Expected[i] == TILE_TRANSPARENT) ? TILE_TRANSPARENT : TILE_EMPTY));
+    }
+
+    TileStats Stats;
+    Stats.Add(&Classes[0], (UINT)Classes.size());
+    CHECK(Stats.NumTiles[TILE_EMPTY] == 4 && Stats.NumTiles[TILE_TRANSPARENT] == 2 && Stats.NumTiles[TILE_OPAQUE] == 0);
+    CHECK(Stats.GetTotal() == 6);
+    CHECK(fabsf(Stats.GetSkippedFraction() - 4.f / 6.f) < 1e-6f);
+}
+
+//--------------------------------------------------------------------------------------
+// Random images: every pixel of a tile decides its class, whatever its position
+//--------------------------------------------------------------------------------------
+static void TestRandomImages()
+{
+    const UINT Sizes[][2] = { { 1, 1 }, { TILE_SIZE, TILE_SIZE }, { TILE_SIZE + 1, 3 }, { 50, 37 } };
+    UINT Seed = 1;
+    for (UINT s = 0; s < sizeof(Sizes) / sizeof(Sizes[0]); ++s)
+    {
+        const UINT Width = Sizes[s][0];
+        const UINT Height = Sizes[s][1];
+        for (UINT Run = 0; Run < 50; ++Run)
+        {
+            TestImages Images(Width, Height);
+            for (UINT i = 0; i < Width * Height; ++i)
+            {
+                Seed = Seed * 1664525 + 1013904223;
+                if ((Seed >> 8) % 300 == 0) Images.Transmittance[i * 4 + 3] = (BYTE)(Seed >> 24) % 255;
+                if ((Seed >> 12) % 200 == 0) Images.OpaqueDepth[i] = 1.f;
+            }
+
+            std::vector<UINT> Classes;
+            ClassifyTiles(&Images.Transmittance[0], &Images.OpaqueDepth[0], Width, Height, Classes);
+            CHECK(Classes.size() == GetNumTiles(Width) * GetNumTiles(Height));
+
+            for (UINT i = 0; i < Classes.size(); ++i)
+            {
+                const UINT TileX = i % GetNumTiles(Width);
+                const UINT TileY = i / GetNumTiles(Width);
+                bool Transparent = false;
+                bool Covered = true;
+                for (UINT y = TileY * TILE_SIZE; y < std::min((TileY + 1) * TILE_SIZE, Height); ++y)
+                {
+                    for (UINT x = TileX * TILE_SIZE; x < std::min((TileX + 1) * TILE_SIZE, Width); ++x)
+                    {
+                        Transparent = Transparent || Images.Transmittance[(y * Width + x) * 4 + 3] < 255;
+                        Covered = Covered && Images.OpaqueDepth[y * Width + x] < 1.f;
+                    }
+                }
+                CHECK(Classes[i] == (Transparent ? (UINT)TILE_TRANSPARENT : Covered ? (UINT)TILE_OPAQUE : (UINT)TILE_EMPTY));
+            }
+        }
+    }
+}
+
+int main()
+{
+    TestClasses();
+    TestRandomImages();
+    return TestResult("TileClassificationTest");
+}
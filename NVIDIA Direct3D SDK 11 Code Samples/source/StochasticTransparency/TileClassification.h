@@ -0,0 +1,111 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <string.h>
+
+//--------------------------------------------------------------------------------------
+// The composite passes first classify the screen in tiles, into an R32_UINT target with
+// one texel per tile, then draw one quad per tile: the transparent tiles run the composite
+// shader and the other ones copy the background (see RecordTileComposite in BaseTechnique.h).
+//--------------------------------------------------------------------------------------
+
+// Must match TILE_SIZE and the TILE_* classes in BaseTechnique.hlsli
+#define TILE_SIZE 16
+
+// Frames between the copy of the tile classes to the CPU and their readback
+#define TILE_READBACK_LATENCY 3
+
+enum TileClass
+{
+    TILE_EMPTY,             // No transparent fragment
+    TILE_TRANSPARENT,       // At least one pixel with a transparent fragment
+    TILE_OPAQUE,            // No transparent fragment, and all the pixels covered by the opaque geometry
+    NUM_TILE_CLASSES
+};
+
+inline UINT GetNumTiles(UINT NumPixels)
+{
+    return (NumPixels + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+//--------------------------------------------------------------------------------------
+// CPU reference of ClassifyTile. pTransmittance is the RGBA8 target with the transmittance
+// of the transparent layers in alpha, pOpaqueDepth the D32_FLOAT depth of the opaque
+// geometry or NULL, both tightly packed. Classes gets one TileClass per tile, in rows.
+//--------------------------------------------------------------------------------------
+inline void ClassifyTiles(const BYTE *pTransmittance, const float *pOpaqueDepth, UINT Width, UINT Height, std::vector<UINT> &Classes)
+{
+    const UINT TilesX = GetNumTiles(Width);
+    const UINT TilesY = GetNumTiles(Height);
+    Classes.assign(TilesX * TilesY, TILE_EMPTY);
+
+    for (UINT TileY = 0; TileY < TilesY; ++TileY)
+    {
+        for (UINT TileX = 0; TileX < TilesX; ++TileX)
+        {
+            const UINT EndX = std::min((TileX + 1) * TILE_SIZE, Width);
+            const UINT EndY = std::min((TileY + 1) * TILE_SIZE, Height);
+
+            bool Transparent = false;
+            bool Covered = (pOpaqueDepth != NULL);
+            for (UINT y = TileY * TILE_SIZE; y < EndY && !Transparent; ++y)
+            {
+                for (UINT x = TileX * TILE_SIZE; x < EndX && !Transparent; ++x)
+                {
+                    // Transmittance below 1.0 in UNORM8
+                    Transparent = (pTransmittance[(y * Width + x) * 4 + 3] != 255);
+                    Covered = Covered && (pOpaqueDepth[y * Width + x] < 1.f);
+                }
+            }
+
+            UINT &Class = Classes[TileY * TilesX + TileX];
+            Class = Transparent ? TILE_TRANSPARENT : (Covered ? TILE_OPAQUE : TILE_EMPTY);
+        }
+    }
+}
+
+// Number of tiles of each class over a frame
+struct TileStats
+{
+    UINT NumTiles[NUM_TILE_CLASSES];
+
+    TileStats()
+    {
+        memset(NumTiles, 0, sizeof(NumTiles));
+    }
+
+    void Add(const UINT *pClasses, UINT Count)
+    {
+        for (UINT i = 0; i < Count; ++i)
+        {
+            if (pClasses[i] < NUM_TILE_CLASSES) ++NumTiles[pClasses[i]];
+        }
+    }
+
+    UINT GetTotal() const
+    {
+        return NumTiles[TILE_EMPTY] + NumTiles[TILE_TRANSPARENT] + NumTiles[TILE_OPAQUE];
+    }
+
+    // Fraction of the tiles that skip the composite shader
+    float GetSkippedFraction() const
+    {
+        const UINT Total = GetTotal();
+        return Total ? (float)(Total - NumTiles[TILE_TRANSPARENT]) / (float)Total : 0.f;
+    }
+};
@@ -0,0 +1,213 @@
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE,
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+
+#pragma once
+
+// Inputs and derived matrices of the camera/model chain
+enum TransformId
+{
+    // Inputs
+    TRANSFORM_WORLD,
+    TRANSFORM_VIEW,
+    TRANSFORM_PROJ,
+    // Derived
+    TRANSFORM_WORLD_I,
+    TRANSFORM_VIEW_I,
+    TRANSFORM_VIEW_PROJ,
+    TRANSFORM_VIEW_PROJ_I,
+    TRANSFORM_WORLD_VIEW,
+    TRANSFORM_WORLD_VIEW_I,
+    TRANSFORM_WORLD_VIEW_IT,
+    TRANSFORM_WORLD_VIEW_PROJ,
+    TRANSFORM_WORLD_VIEW_PROJ_I,
+    NUM_TRANSFORMS
+};
+
+#define TRANSFORM_BIT(Id) (1U << (Id))
+
+// Must match InstanceTransform in BaseTechnique.hlsli
+struct InstanceTransform
+{
+    DirectX::XMFLOAT4X4 WorldViewProj;
+    DirectX::XMFLOAT4X4 WorldViewIT;
+};
+
+//--------------------------------------------------------------------------------------
+// Batch computation of the per-instance transforms. Only the upper 3x3 of WorldViewIT
+// is used (for the normals, which are renormalized), so the cofactor matrix is used
+// instead of a full 4x4 inverse: 3 cross products per instance.
+//--------------------------------------------------------------------------------------
+inline void ComputeInstanceTransforms(const DirectX::XMFLOAT4X4 *pLocal, const UINT *pInstanceIds, UINT NumInstances,
+                                      DirectX::CXMMATRIX WorldView, DirectX::CXMMATRIX Proj, InstanceTransform *pOut)
+{
+    using namespace DirectX;
+
+    for (UINT i = 0; i < NumInstances; ++i)
+    {
+        XMMATRIX LocalWorldView = XMMatrixMultiply(XMLoadFloat4x4(&pLocal[pInstanceIds[i]]), WorldView);
+        XMStoreFloat4x4(&pOut[i].WorldViewProj, XMMatrixMultiply(LocalWorldView, Proj));
+
+        // Rows of the inverse-transpose, up to the determinant: r1 x r2, r2 x r0, r0 x r1.
+        // The sign of the determinant keeps the normals oriented for mirroring transforms.
+        XMVECTOR R0 = LocalWorldView.r[0];
+        XMVECTOR R1 = LocalWorldView.r[1];
+        XMVECTOR R2 = LocalWorldView.r[2];
+        XMMATRIX Cofactor;
+        Cofactor.r[0] = XMVector3Cross(R1, R2);
+        Cofactor.r[1] = XMVector3Cross(R2, R0);
+        Cofactor.r[2] = XMVector3Cross(R0, R1);
+        Cofactor.r[3] = XMVectorSet(0.f, 0.f, 0.f, 1.f);
+        if (XMVectorGetX(XMVector3Dot(R0, Cofactor.r[0])) < 0.f)
+        {
+            Cofactor.r[0] = XMVectorNegate(Cofactor.r[0]);
+            Cofactor.r[1] = XMVectorNegate(Cofactor.r[1]);
+            Cofactor.r[2] = XMVectorNegate(Cofactor.r[2]);
+        }
+        Cofactor.r[0] = XMVectorSetW(Cofactor.r[0], 0.f);
+        Cofactor.r[1] = XMVectorSetW(Cofactor.r[1], 0.f);
+        Cofactor.r[2] = XMVectorSetW(Cofactor.r[2], 0.f);
+        XMStoreFloat4x4(&pOut[i].WorldViewIT, Cofactor);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Lazily derived transforms with dirty tracking. Setting an input only invalidates the
+// matrices depending on it, and only if its value changed. A derived matrix is computed
+// on the first Get after an invalidation, so the matrices nobody asks for are never computed.
+// The versions let the consumers (constant buffers, instance buffers) skip their updates
+// when a matrix did not change since their last upload.
+//--------------------------------------------------------------------------------------
+class TransformState
+{
+public:
+    TransformState()
+        : m_ValidMask(0)
+        , m_NumDerivations(0)
+    {
+        for (UINT Id = 0; Id < NUM_TRANSFORMS; ++Id)
+        {
+            m_Matrices[Id] = DirectX::XMMatrixIdentity();
+            m_Versions[Id] = 0;
+        }
+        m_ValidMask = TRANSFORM_BIT(TRANSFORM_WORLD) | TRANSFORM_BIT(TRANSFORM_VIEW) | TRANSFORM_BIT(TRANSFORM_PROJ);
+    }
+
+    void SetWorld(DirectX::CXMMATRIX World) { SetInput(TRANSFORM_WORLD, World); }
+    void SetView(DirectX::CXMMATRIX View)   { SetInput(TRANSFORM_VIEW, View); }
+    void SetProj(DirectX::CXMMATRIX Proj)   { SetInput(TRANSFORM_PROJ, Proj); }
+
+    DirectX::XMMATRIX Get(TransformId Id)
+    {
+        if (!(m_ValidMask & TRANSFORM_BIT(Id)))
+        {
+            m_Matrices[Id] = Derive(Id);
+            m_ValidMask |= TRANSFORM_BIT(Id);
+            ++m_NumDerivations;
+        }
+        return m_Matrices[Id];
+    }
+
+    void Get(TransformId Id, DirectX::XMFLOAT4X4 &Matrix)
+    {
+        DirectX::XMStoreFloat4x4(&Matrix, Get(Id));
+    }
+
+    // Changes whenever the value of the matrix may have changed
+    UINT GetVersion(TransformId Id) const
+    {
+        UINT Version = 0;
+        for (UINT Input = TRANSFORM_WORLD; Input <= TRANSFORM_PROJ; ++Input)
+        {
+            if (GetDependents((TransformId)Input) & TRANSFORM_BIT(Id))
+            {
+                Version += m_Versions[Input];
+            }
+        }
+        return Version;
+    }
+
+    // Batch path for the instance chain: Local * World * View * Proj for each instance
+    void GetInstanceTransforms(const DirectX::XMFLOAT4X4 *pLocal, const UINT *pInstanceIds, UINT NumInstances, InstanceTransform *pOut)
+    {
+        ComputeInstanceTransforms(pLocal, pInstanceIds, NumInstances, Get(TRANSFORM_WORLD_VIEW), Get(TRANSFORM_PROJ), pOut);
+        m_NumDerivations += NumInstances;
+    }
+
+    // Number of matrices computed since the last reset, for profiling
+    UINT GetNumDerivations() const { return m_NumDerivations; }
+    void ResetNumDerivations() { m_NumDerivations = 0; }
+
+protected:
+    // Input itself and all the matrices derived from it
+    static UINT GetDependents(TransformId Input)
+    {
+        switch (Input)
+        {
+        case TRANSFORM_WORLD:
+            return TRANSFORM_BIT(TRANSFORM_WORLD) | TRANSFORM_BIT(TRANSFORM_WORLD_I) |
+                   TRANSFORM_BIT(TRANSFORM_WORLD_VIEW) | TRANSFORM_BIT(TRANSFORM_WORLD_VIEW_I) | TRANSFORM_BIT(TRANSFORM_WORLD_VIEW_IT) |
+                   TRANSFORM_BIT(TRANSFORM_WORLD_VIEW_PROJ) | TRANSFORM_BIT(TRANSFORM_WORLD_VIEW_PROJ_I);
+        case TRANSFORM_VIEW:
+            return TRANSFORM_BIT(TRANSFORM_VIEW) | TRANSFORM_BIT(TRANSFORM_VIEW_I) |
+                   TRANSFORM_BIT(TRANSFORM_VIEW_PROJ) | TRANSFORM_BIT(TRANSFORM_VIEW_PROJ_I) |
+                   TRANSFORM_BIT(TRANSFORM_WORLD_VIEW) | TRANSFORM_BIT(TRANSFORM_WORLD_VIEW_I) | TRANSFORM_BIT(TRANSFORM_WORLD_VIEW_IT) |
+                   TRANSFORM_BIT(TRANSFORM_WORLD_VIEW_PROJ) | TRANSFORM_BIT(TRANSFORM_WORLD_VIEW_PROJ_I);
+        case TRANSFORM_PROJ:
+            return TRANSFORM_BIT(TRANSFORM_PROJ) |
+                   TRANSFORM_BIT(TRANSFORM_VIEW_PROJ) | TRANSFORM_BIT(TRANSFORM_VIEW_PROJ_I) |
+                   TRANSFORM_BIT(TRANSFORM_WORLD_VIEW_PROJ) | TRANSFORM_BIT(TRANSFORM_WORLD_VIEW_PROJ_I);
+        default:
+            return 0;
+        }
+    }
+
+    void SetInput(TransformId Input, DirectX::CXMMATRIX Matrix)
+    {
+        DirectX::XMFLOAT4X4 Old, New;
+        DirectX::XMStoreFloat4x4(&Old, m_Matrices[Input]);
+        DirectX::XMStoreFloat4x4(&New, Matrix);
+        if (memcmp(&Old, &New, sizeof(New)) == 0) return;
+
+        m_Matrices[Input] = Matrix;
+        m_ValidMask &= ~(GetDependents(Input) & ~TRANSFORM_BIT(Input));
+        ++m_Versions[Input];
+    }
+
+    DirectX::XMMATRIX Derive(TransformId Id)
+    {
+        using namespace DirectX;
+
+        switch (Id)
+        {
+        case TRANSFORM_WORLD_I:             return XMMatrixInverse(NULL, Get(TRANSFORM_WORLD));
+        case TRANSFORM_VIEW_I:              return XMMatrixInverse(NULL, Get(TRANSFORM_VIEW));
+        case TRANSFORM_VIEW_PROJ:           return XMMatrixMultiply(Get(TRANSFORM_VIEW), Get(TRANSFORM_PROJ));
+        case TRANSFORM_VIEW_PROJ_I:         return XMMatrixInverse(NULL, Get(TRANSFORM_VIEW_PROJ));
+        case TRANSFORM_WORLD_VIEW:          return XMMatrixMultiply(Get(TRANSFORM_WORLD), Get(TRANSFORM_VIEW));
+        case TRANSFORM_WORLD_VIEW_I:        return XMMatrixInverse(NULL, Get(TRANSFORM_WORLD_VIEW));
+        case TRANSFORM_WORLD_VIEW_IT:       return XMMatrixTranspose(Get(TRANSFORM_WORLD_VIEW_I));
+        case TRANSFORM_WORLD_VIEW_PROJ:     return XMMatrixMultiply(Get(TRANSFORM_WORLD_VIEW), Get(TRANSFORM_PROJ));
+        case TRANSFORM_WORLD_VIEW_PROJ_I:   return XMMatrixInverse(NULL, Get(TRANSFORM_WORLD_VIEW_PROJ));
+        default:
+            assert(0);
+            return m_Matrices[Id];
+        }
+    }
+
+    DirectX::XMMATRIX m_Matrices[NUM_TRANSFORMS];
+    UINT m_Versions[NUM_TRANSFORMS];    // Only used for the inputs
+    UINT m_ValidMask;
+    UINT m_NumDerivations;
+};
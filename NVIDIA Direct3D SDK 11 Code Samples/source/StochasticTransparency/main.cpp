@@ -1,592 +1,1731 @@
-// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
-//
-// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
-// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
-// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
-// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA 
-// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR  
-// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS 
-// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY 
-// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE, 
-// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
-//
-// Please direct any bugs or questions to SDKFeedback@nvidia.com
-
-#include "DXUT.h"
-#include "DXUTcamera.h"
-#include "DXUTgui.h"
-#include "DXUTsettingsdlg.h"
-#include "SDKmisc.h"
-#ifndef __ID3DUserDefinedAnnotation_INTERFACE_DEFINED__
-#define __ID3DUserDefinedAnnotation_INTERFACE_DEFINED__
-MIDL_INTERFACE("b2daad8b-03d4-4dbf-95eb-32ab4b63d0ab")
-ID3DUserDefinedAnnotation : public IUnknown
-{
-	virtual INT STDMETHODCALLTYPE BeginEvent(LPCWSTR Name) = 0;
-	virtual INT STDMETHODCALLTYPE EndEvent(void) = 0;
-	virtual void STDMETHODCALLTYPE SetMarker(LPCWSTR Name) = 0;
-	virtual BOOL STDMETHODCALLTYPE GetStatus(void) = 0;
-};
-#endif
-#include "DualDepthPeeling.h"
-#include "StochasticTransparency.h"
-#include "PlainAlphaBlending.h"
-#include <strsafe.h>
-
-typedef struct
-{
-    WCHAR* pName;
-    BaseTechnique *pEngine;
-} TechniqueUI;
-
-enum
-{
-    STOCHASTIC_TRANSPARENCY,
-    DUAL_DEPTH_PEELING,
-    PLAIN_ALPHA_BLENDING,
-    NUM_TECHNIQUES
-};
-
-//--------------------------------------------------------------------------------------
-// Global variables
-//--------------------------------------------------------------------------------------
-
-CDXUTDialogResourceManager  g_DialogResourceManager;    // manager for shared resources of dialogs
-CModelViewerCamera          g_Camera;                   // A model viewing camera
-CD3DSettingsDlg             g_D3DSettingsDlg;           // Device settings dialog
-CDXUTDialog                 g_HUD;                      // dialog for standard controls
-CDXUTDialog                 g_SampleUI;                 // dialog for sample specific controls
-CDXUTTextHelper*            g_pTxtHelper = NULL;
-bool                        g_ShowUI = true;
-DirectX::XMFLOAT3           g_ModelOffset;
-
-TechniqueUI                 g_Techniques[NUM_TECHNIQUES];
-StochasticTransparency      *g_pStochasticTransparency = NULL;
-DualDepthPeeling            *g_pDualDepthPeeling = NULL;
-PlainAlphaBlending          *g_pPlainAlphaBlending = NULL;
-BaseTechnique               *g_pCurrentEngine = NULL;
-
-UINT                        BaseTechnique::m_NumGeomPasses;
-float                       BaseTechnique::m_Alpha;
-CDXUTSDKMesh                Scene::m_Mesh;
-
-//--------------------------------------------------------------------------------------
-// Defines
-//--------------------------------------------------------------------------------------
-
-#define IMAGE_WIDTH 1280
-#define IMAGE_HEIGHT 720
-
-#define ZNEAR 0.1f
-#define ZFAR 100.0f
-
-#define MAX_NUM_PEELING_PASSES 8
-#define NUM_PEELING_PASSES 4
-
-#define MAX_NUM_STOCHASTIC_PASSES 8
-#define NUM_STOCHASTIC_PASSES 1
-
-#define AUTO_ROTATION_RATE 0.05f
-#define WORLD_OFFSET 0.01f
-
-//--------------------------------------------------------------------------------------
-// UI control IDs
-//--------------------------------------------------------------------------------------
-enum {
-    IDC_TOGGLEFULLSCREEN = 1,
-    IDC_TOGGLEREF,
-    IDC_CHANGEDEVICE,
-    IDC_USE_STOCHASTIC_TRANSPARENCY,
-    IDC_USE_DUAL_DEPTH_PEELING,
-    IDC_USE_PLAIN_ALPHA_BLENDING,
-    IDC_NUM_PEELING_PASSES_STATIC,
-    IDC_NUM_PEELING_PASSES_SLIDER,
-    IDC_NUM_STOCHASTIC_PASSES_STATIC,
-    IDC_NUM_STOCHASTIC_PASSES_SLIDER,
-    IDC_ALPHA_STATIC,
-    IDC_ALPHA_SLIDER,
-    IDC_AUTO_ROTATE
-};
-
-//--------------------------------------------------------------------------------------
-// Forward declarations 
-//--------------------------------------------------------------------------------------
-bool CALLBACK ModifyDeviceSettings(DXUTDeviceSettings* pDeviceSettings, void* pUserContext);
-void CALLBACK OnFrameMove(double fTime, float fElapsedTime, void* pUserContext);
-LRESULT CALLBACK MsgProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam, bool* pbNoFurtherProcessing,
-                         void* pUserContext);
-void CALLBACK OnGUIEvent(UINT nEvent, int nControlID, CDXUTControl* pControl, void* pUserContext);
-
-bool CALLBACK IsD3D11DeviceAcceptable(const CD3D11EnumAdapterInfo *AdapterInfo, UINT Output, const CD3D11EnumDeviceInfo *DeviceInfo,
-                                      DXGI_FORMAT BackBufferFormat, bool bWindowed, void* pUserContext);
-HRESULT CALLBACK OnD3D11CreateDevice(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc,
-                                     void* pUserContext);
-HRESULT CALLBACK OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, IDXGISwapChain* pSwapChain,
-                                         const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc, void* pUserContext);
-void CALLBACK OnD3D11ReleasingSwapChain(void* pUserContext);
-void CALLBACK OnD3D11DestroyDevice(void* pUserContext);
-void CALLBACK OnD3D11FrameRender(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext, double fTime,
-                                 float fElapsedTime, void* pUserContext);
-
-void InitGUI();
-void RenderText();
-
-//--------------------------------------------------------------------------------------
-// Handle key presses
-//--------------------------------------------------------------------------------------
-void CALLBACK OnKeyboard(UINT nChar, bool bKeyDown, bool bAltDown, void* pUserContext)
-{
-    if(bKeyDown)
-    {
-        switch(nChar)
-        {
-        case VK_ESCAPE:
-            PostQuitMessage(0);
-            break;
-        case 'U':
-            g_ShowUI = !g_ShowUI;
-            break;
-        case 'A':
-            g_ModelOffset.x -= WORLD_OFFSET;
-            break;
-        case 'D':
-            g_ModelOffset.x += WORLD_OFFSET;
-            break;
-        case 'W':
-            g_ModelOffset.y += WORLD_OFFSET;
-            break;
-        case 'S':
-            g_ModelOffset.y -= WORLD_OFFSET;
-            break;
-        case 'Q':
-            g_ModelOffset.z -= WORLD_OFFSET;
-            break;
-        case 'E':
-            g_ModelOffset.z += WORLD_OFFSET;
-            break;
-        }
-    }
-}
-
-//--------------------------------------------------------------------------------------
-// Entry point to the program. Initializes everything and goes into a message processing 
-// loop. Idle time is used to render the scene.
-//--------------------------------------------------------------------------------------
-int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow)
-{
-    HRESULT hr;
-    V_RETURN(DXUTSetMediaSearchPath(L"..\\Source\\StochasticTransparency"));
-    // Enable run-time memory check for debug builds.
-#if defined(DEBUG) | defined(_DEBUG)
-    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
-#endif
-
-    // Disable gamma correction on this sample
-    DXUTSetIsInGammaCorrectMode(false);
-
-    DXUTSetCallbackDeviceChanging(ModifyDeviceSettings);
-    DXUTSetCallbackMsgProc(MsgProc);
-    DXUTSetCallbackKeyboard(OnKeyboard);
-    DXUTSetCallbackFrameMove(OnFrameMove);
-    
-    DXUTSetCallbackD3D11DeviceAcceptable(IsD3D11DeviceAcceptable);
-    DXUTSetCallbackD3D11DeviceCreated(OnD3D11CreateDevice);
-    DXUTSetCallbackD3D11SwapChainResized(OnD3D11ResizedSwapChain);
-    DXUTSetCallbackD3D11FrameRender(OnD3D11FrameRender);
-    DXUTSetCallbackD3D11SwapChainReleasing(OnD3D11ReleasingSwapChain);
-    DXUTSetCallbackD3D11DeviceDestroyed(OnD3D11DestroyDevice);
-
-    InitGUI();
-
-    DXUTInit(true, true, NULL); // Parse the command line, show msgboxes on error
-    DXUTSetCursorSettings(true, true); // Show the cursor and clip it when in full screen
-    DXUTCreateWindow(L"Stochastic Transparency");
-    DXUTCreateDevice(D3D_FEATURE_LEVEL_11_0, true, IMAGE_WIDTH, IMAGE_HEIGHT);
-    DXUTMainLoop(); // Enter into the DXUT render loop
-
-    return DXUTGetExitCode();
-}
-
-//--------------------------------------------------------------------------------------
-void InitGUI()
-{
-    g_D3DSettingsDlg.Init(&g_DialogResourceManager);
-    g_HUD.Init(&g_DialogResourceManager);
-    g_HUD.SetCallback(OnGUIEvent);
-    
-    int iY = 20;
-    g_HUD.AddButton(IDC_TOGGLEFULLSCREEN, L"Toggle full screen", 0, iY, 170, 23);
-    g_HUD.AddButton(IDC_TOGGLEREF, L"Toggle REF (F3)", 0, iY += 26, 170, 23, VK_F3);
-    g_HUD.AddButton(IDC_CHANGEDEVICE, L"Change device (F2)", 0, iY += 26, 170, 23, VK_F2);
-
-    g_SampleUI.Init(&g_DialogResourceManager);
-    g_SampleUI.SetCallback(OnGUIEvent); 
-
-    iY = 0;
-    g_SampleUI.AddRadioButton(IDC_USE_STOCHASTIC_TRANSPARENCY,     0, L"Depth-Based Stochastic Transparency" , 10, iY += 24, 125, 22, true);
-    g_SampleUI.AddRadioButton(IDC_USE_DUAL_DEPTH_PEELING,          0, L"Dual Depth Peeling" , 10, iY += 24, 125, 22, false);
-    g_SampleUI.AddRadioButton(IDC_USE_PLAIN_ALPHA_BLENDING,        0, L"Plain Alpha Blending" , 10, iY += 24, 125, 22, false);
-
-    iY += 40;
-    g_SampleUI.AddStatic(IDC_NUM_PEELING_PASSES_STATIC, L"", 30, iY, 125, 22);
-    g_SampleUI.AddStatic(IDC_NUM_STOCHASTIC_PASSES_STATIC, L"", 30, iY, 125, 22);
-
-    iY += 24;
-    g_SampleUI.AddSlider(IDC_NUM_PEELING_PASSES_SLIDER, 50, iY, 100, 22, 1, MAX_NUM_PEELING_PASSES, NUM_PEELING_PASSES);
-    g_SampleUI.AddSlider(IDC_NUM_STOCHASTIC_PASSES_SLIDER, 50, iY, 100, 22, 1, MAX_NUM_STOCHASTIC_PASSES, NUM_STOCHASTIC_PASSES);
-
-    g_SampleUI.AddStatic(IDC_ALPHA_STATIC, L"", 30, iY += 24, 125, 22);
-    g_SampleUI.AddSlider(IDC_ALPHA_SLIDER, 50, iY += 24, 100, 22, 0, 100, 60);
-
-    g_SampleUI.AddCheckBox(IDC_AUTO_ROTATE, L"Auto Rotate", 35, iY += 26, 125, 22, false);
-}
-
-//--------------------------------------------------------------------------------------
-// This callback function is called immediately before a device is created to allow the 
-// application to modify the device settings. The supplied pDeviceSettings parameter 
-// contains the settings that the framework has selected for the new device, and the 
-// application can make any desired changes directly to this structure.  Note however that 
-// DXUT will not correct invalid device settings so care must be taken 
-// to return valid device settings, otherwise CreateDevice() will fail.  
-//--------------------------------------------------------------------------------------
-bool CALLBACK ModifyDeviceSettings(DXUTDeviceSettings* pDeviceSettings, void* pUserContext)
-{    
-    // Disable vsync
-    pDeviceSettings->d3d11.SyncInterval = 0;
-
-    // For the first device created if it is a REF device, optionally display a warning dialog box
-    static bool s_bFirstTime = true;
-    if(s_bFirstTime)
-    {
-        s_bFirstTime = false;
-		pDeviceSettings->d3d11.CreateFlags = 0; //D3D11_CREATE_DEVICE_DEBUG
-		pDeviceSettings->d3d11.sd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    }
-
-    return true;
-}
-
-//--------------------------------------------------------------------------------------
-// This callback function will be called once at the beginning of every frame. This is the
-// best location for your application to handle updates to the scene, but is not 
-// intended to contain actual rendering calls, which should instead be placed in the 
-// OnFrameRender callback.  
-//--------------------------------------------------------------------------------------
-void CALLBACK OnFrameMove(double fTime, float fElapsedTime, void* pUserContext)
-{
-    // Update the camera's position based on user input 
-    g_Camera.FrameMove(fElapsedTime);
-}
-
-//--------------------------------------------------------------------------------------
-// Render text for the UI
-//--------------------------------------------------------------------------------------
-void RenderText()
-{
-    g_pTxtHelper->Begin();
-    g_pTxtHelper->SetInsertionPos(2, 0);
-    g_pTxtHelper->SetForegroundColor(DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
-    g_pTxtHelper->DrawTextLine(DXUTGetFrameStats(DXUTIsVsyncEnabled()));
-    g_pTxtHelper->DrawTextLine(DXUTGetDeviceStats());
-
-    g_pTxtHelper->End();
-}
-
-//--------------------------------------------------------------------------------------
-// Before handling window messages, DXUT passes incoming windows 
-// messages to the application through this callback function. If the application sets 
-// *pbNoFurtherProcessing to TRUE, then DXUT will not process this message.
-//--------------------------------------------------------------------------------------
-LRESULT CALLBACK MsgProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam, bool* pbNoFurtherProcessing,
-                         void* pUserContext)
-{
-    // Pass messages to dialog resource manager calls so GUI state is updated correctly
-    *pbNoFurtherProcessing = g_DialogResourceManager.MsgProc(hWnd, uMsg, wParam, lParam);
-    if(*pbNoFurtherProcessing)
-        return 0;
-
-    // Pass messages to settings dialog if its active
-    if(g_D3DSettingsDlg.IsActive())
-    {
-        g_D3DSettingsDlg.MsgProc(hWnd, uMsg, wParam, lParam);
-        return 0;
-    }
-
-    // Give the dialogs a chance to handle the message first
-    *pbNoFurtherProcessing = g_HUD.MsgProc(hWnd, uMsg, wParam, lParam);
-    if(*pbNoFurtherProcessing)
-        return 0;
-    *pbNoFurtherProcessing = g_SampleUI.MsgProc(hWnd, uMsg, wParam, lParam);
-    if(*pbNoFurtherProcessing)
-        return 0;
-
-    // Pass all windows messages to camera so it can respond to user input
-    g_Camera.HandleMessages(hWnd, uMsg, wParam, lParam);
-
-    return 0;
-}
-
-//--------------------------------------------------------------------------------------
-// Handles the GUI events
-//--------------------------------------------------------------------------------------
-void CALLBACK OnGUIEvent(UINT nEvent, int nControlID, CDXUTControl* pControl, void* pUserContext)
-{
-    switch(nControlID)
-    {
-        case IDC_TOGGLEFULLSCREEN:
-        {
-            DXUTToggleFullScreen();
-            break;
-        }
-        case IDC_TOGGLEREF:
-        {
-            DXUTToggleREF();
-            break;
-        }
-        case IDC_CHANGEDEVICE:
-        {
-            g_D3DSettingsDlg.SetActive(!g_D3DSettingsDlg.IsActive());
-            break;
-        }
-        case IDC_USE_STOCHASTIC_TRANSPARENCY:
-        {
-            g_pCurrentEngine = g_Techniques[STOCHASTIC_TRANSPARENCY].pEngine;
-            break;
-        }
-        case IDC_USE_DUAL_DEPTH_PEELING:
-        {
-            g_pCurrentEngine = g_Techniques[DUAL_DEPTH_PEELING].pEngine;
-            break;
-        }
-        case IDC_USE_PLAIN_ALPHA_BLENDING:
-        {
-            g_pCurrentEngine = g_Techniques[PLAIN_ALPHA_BLENDING].pEngine;
-            break;
-        }
-    }
-}
-
-bool CALLBACK IsD3D11DeviceAcceptable(const CD3D11EnumAdapterInfo *AdapterInfo, UINT Output, const CD3D11EnumDeviceInfo *DeviceInfo,
-                                      DXGI_FORMAT BackBufferFormat, bool bWindowed, void* pUserContext)
-{
-    return true;
-}
-
-//--------------------------------------------------------------------------------------
-// This callback function will be called immediately after the Direct3D device has been 
-// created, which will happen during application initialization and windowed/full screen 
-// toggles. This is the best location to create D3DPOOL_MANAGED resources since these 
-// resources need to be reloaded whenever the device is destroyed. Resources created  
-// here should be released in the OnD3D11DestroyDevice callback. 
-//--------------------------------------------------------------------------------------
-HRESULT CALLBACK OnD3D11CreateDevice(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc,
-                                     void* pUserContext)
-{
-    HRESULT hr;
-
-    ID3D11DeviceContext* pd3dImmediateContext = DXUTGetD3D11DeviceContext();
-    V_RETURN(g_DialogResourceManager.OnD3D11CreateDevice(pd3dDevice, pd3dImmediateContext));
-    V_RETURN(g_D3DSettingsDlg.OnD3D11CreateDevice(pd3dDevice));
-    g_pTxtHelper = new CDXUTTextHelper(pd3dDevice, pd3dImmediateContext, &g_DialogResourceManager, 15);
-
-    g_Camera.SetRadius(1.5f, 0.1f);
-    Scene::CreateMesh(pd3dDevice);
-
-    return S_OK;
-}
-
-//--------------------------------------------------------------------------------------
-// Called whenever the swap chain is resized.  
-//--------------------------------------------------------------------------------------
-HRESULT CALLBACK OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, IDXGISwapChain* pSwapChain,
-                                         const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc, void* pUserContext)
-{
-    HRESULT hr;
-
-    V_RETURN(g_DialogResourceManager.OnD3D11ResizedSwapChain(pd3dDevice, pBackBufferSurfaceDesc));
-    V_RETURN(g_D3DSettingsDlg.OnD3D11ResizedSwapChain(pd3dDevice, pBackBufferSurfaceDesc));
-
-    // Setup the camera's projection parameters    
-    float fAspectRatio = pBackBufferSurfaceDesc->Width / (FLOAT)pBackBufferSurfaceDesc->Height;
-    g_Camera.SetProjParams(DirectX::XM_PI / 4, fAspectRatio, ZNEAR, ZFAR);
-    g_Camera.SetWindow(pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height);
-
-    g_HUD.SetLocation(pBackBufferSurfaceDesc->Width - 170, 0);
-    g_HUD.SetSize(170, 170);
-
-    const UINT Width = 256;
-    const UINT Height = 256;
-    g_SampleUI.SetLocation(pBackBufferSurfaceDesc->Width - Width, 150);
-    g_SampleUI.SetSize(Width, Height);
-    g_SampleUI.SetBackgroundColors(D3DCOLOR_RGBA(116,183,27,255));
-
-    SAFE_DELETE(g_pDualDepthPeeling);
-    g_pDualDepthPeeling = new DualDepthPeeling(pd3dDevice, pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height);
-    g_Techniques[DUAL_DEPTH_PEELING].pEngine = g_pDualDepthPeeling;
-
-    SAFE_DELETE(g_pStochasticTransparency);
-    g_pStochasticTransparency = new StochasticTransparency(pd3dDevice, pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height);
-    g_Techniques[STOCHASTIC_TRANSPARENCY].pEngine = g_pStochasticTransparency;
-
-    SAFE_DELETE(g_pPlainAlphaBlending);
-    g_pPlainAlphaBlending = new PlainAlphaBlending(pd3dDevice, pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height);
-    g_Techniques[PLAIN_ALPHA_BLENDING].pEngine = g_pPlainAlphaBlending;
-
-    g_pCurrentEngine = g_Techniques[0].pEngine;
-
-    return S_OK;
-}
-
-//--------------------------------------------------------------------------------------
-void UpdateUI()
-{
-    float alpha = (float)g_SampleUI.GetSlider(IDC_ALPHA_SLIDER)->GetValue() * 0.01f;
-    BaseTechnique::SetAlpha(alpha);
-
-    UINT NumPeelingPasses = g_SampleUI.GetSlider(IDC_NUM_PEELING_PASSES_SLIDER)->GetValue();
-    g_pDualDepthPeeling->SetNumGeometryPasses(NumPeelingPasses);
-
-    UINT NumStochasticPasses = g_SampleUI.GetSlider(IDC_NUM_STOCHASTIC_PASSES_SLIDER)->GetValue();
-    g_pStochasticTransparency->SetNumPasses(NumStochasticPasses);
-
-    bool IsDepthPeelingEnabled = (g_pCurrentEngine == g_pDualDepthPeeling);
-    g_SampleUI.GetStatic(IDC_NUM_PEELING_PASSES_STATIC)->SetVisible(IsDepthPeelingEnabled);
-    g_SampleUI.GetSlider(IDC_NUM_PEELING_PASSES_SLIDER)->SetVisible(IsDepthPeelingEnabled);
-    g_SampleUI.GetStatic(IDC_NUM_STOCHASTIC_PASSES_STATIC)->SetVisible(!IsDepthPeelingEnabled);
-    g_SampleUI.GetSlider(IDC_NUM_STOCHASTIC_PASSES_SLIDER)->SetVisible(!IsDepthPeelingEnabled);
-
-    WCHAR sz[100];
-    StringCchPrintf(sz, 100, L"Num geometry passes: %d", BaseTechnique::GetNumGeometryPasses());
-    g_SampleUI.GetStatic(IDC_NUM_PEELING_PASSES_STATIC)->SetText(sz);
-    g_SampleUI.GetStatic(IDC_NUM_STOCHASTIC_PASSES_STATIC)->SetText(sz);
-
-    StringCchPrintf(sz, 100, L"Alpha: %.2f", BaseTechnique::GetAlpha());
-    g_SampleUI.GetStatic(IDC_ALPHA_STATIC)->SetText(sz);
-}
-
-//--------------------------------------------------------------------------------------
-DirectX::XMMATRIX OffsetWorldMatrix()
-{
-	DirectX::XMMATRIX TranslationMatrix;
-	TranslationMatrix = DirectX::XMMatrixTranslation(g_ModelOffset.x, g_ModelOffset.y, g_ModelOffset.z);
-	DirectX::XMMATRIX WorldMatrix = TranslationMatrix * (g_Camera.GetWorldMatrix());
-
-    static float s_Angle = 0.0f;
-    if (g_SampleUI.GetCheckBox(IDC_AUTO_ROTATE)->GetChecked())
-    {
-        s_Angle += AUTO_ROTATION_RATE / DXUTGetFPS();
-        if (s_Angle > DirectX::XM_PI*2.0f) s_Angle = 0.0;
-    }
-
-	DirectX::XMMATRIX mWorld;
-    DirectX::XMMATRIX mRotation;
-	mRotation = DirectX::XMMatrixRotationY(s_Angle + DirectX::XM_PI);
-	mWorld = DirectX::XMMatrixMultiply(mRotation, WorldMatrix);
-	return mWorld;
-}
-
-//--------------------------------------------------------------------------------------
-void UpdateMatrices()
-{
-    DirectX::XMMATRIX mProj = g_Camera.GetProjMatrix();
-	DirectX::XMMATRIX mView = g_Camera.GetViewMatrix();
-	DirectX::XMMATRIX mWorld = OffsetWorldMatrix();
-
-	DirectX::XMMATRIX mViewI, mViewIT, mViewProj, mViewProjI;
-	DirectX::XMMATRIX mWorldI, mWorldIT;
-	DirectX::XMMATRIX mWorldView, mWorldViewI, mWorldViewIT;
-	DirectX::XMMATRIX mWorldViewProj, mWorldViewProjI;
-
-	mViewI = DirectX::XMMatrixInverse(NULL, mView);
-	mViewIT = DirectX::XMMatrixTranspose(mViewI);
-	mViewProj = DirectX::XMMatrixMultiply(mView, mProj);
-	mViewProjI = DirectX::XMMatrixInverse(NULL, mViewProj);
-	mWorldI = DirectX::XMMatrixInverse(NULL, mWorld);
-	mWorldIT = DirectX::XMMatrixTranspose(mWorldI);
-	mWorldView = DirectX::XMMatrixMultiply(mWorld, mView);
-	mWorldViewI = DirectX::XMMatrixInverse(NULL, mWorldView);
-	mWorldViewIT = DirectX::XMMatrixTranspose(mWorldViewI);
-	mWorldViewProj = DirectX::XMMatrixMultiply(mWorldView, mProj);
-	mWorldViewProjI = DirectX::XMMatrixInverse(NULL, mWorldViewProj);
-
-	DirectX::XMFLOAT4X4 ModelViewProj;
-	DirectX::XMFLOAT4X4 ModelViewIT;
-	DirectX::XMStoreFloat4x4(&ModelViewProj, mWorldViewProj);
-	DirectX::XMStoreFloat4x4(&ModelViewIT, mWorldViewIT);
-
-    for (int i = 0; i < NUM_TECHNIQUES; ++i)
-    {
-        g_Techniques[i].pEngine->UpdateMatrices(ModelViewProj, ModelViewIT);
-    }
-}
-
-//--------------------------------------------------------------------------------------
-// Callback function that renders the frame.  This function sets up the rendering 
-// matrices and renders the scene and UI.
-//--------------------------------------------------------------------------------------
-void CALLBACK OnD3D11FrameRender(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext, double fTime,
-                                 float fElapsedTime, void* pUserContext)
-{
-    // If the settings dialog is being shown, then render it instead of rendering the app's scene
-    if(g_D3DSettingsDlg.IsActive())
-    {
-        g_D3DSettingsDlg.OnRender(fElapsedTime);
-        return;
-    }
-
-    UpdateUI();
-    UpdateMatrices();
-
-    // Store off original render target and depth/stencil
-    ID3D11RenderTargetView* pOrigRTV = NULL;
-    ID3D11DepthStencilView* pOrigDSV = NULL;
-    pd3dImmediateContext->OMGetRenderTargets(1, &pOrigRTV, &pOrigDSV);
-
-    BaseTechnique::ResetNumGeometryPasses();
-    g_pCurrentEngine->Render(pd3dImmediateContext, pOrigRTV);
-
-    // Restore original render targets
-    pd3dImmediateContext->OMSetRenderTargets(1, &pOrigRTV, pOrigDSV);
-    SAFE_RELEASE(pOrigRTV);
-    SAFE_RELEASE(pOrigDSV);
-
-    // Reset SRVs to avoid D3D runtime warnings
-    ID3D11ShaderResourceView* pNullSRVs[2] = { NULL, NULL };
-    pd3dImmediateContext->PSSetShaderResources(0, 2, pNullSRVs);
-
-    if (g_ShowUI)
-    {
-        DXUT_BeginPerfEvent(DXUT_PERFEVENTCOLOR, L"HUD / Stats");
-        g_HUD.OnRender(fElapsedTime);
-        g_SampleUI.OnRender(fElapsedTime);
-        RenderText();
-        DXUT_EndPerfEvent();
-    }
-}
-
-//--------------------------------------------------------------------------------------
-// This callback function will be called immediately after the Direct3D device has 
-// been destroyed, which generally happens as a result of application termination or 
-// windowed/full screen toggles. Resources created in the OnD3D11CreateDevice callback 
-// should be released here, which generally includes all D3DPOOL_MANAGED resources. 
-//--------------------------------------------------------------------------------------
-void CALLBACK OnD3D11DestroyDevice(void* pUserContext)
-{
-    g_DialogResourceManager.OnD3D11DestroyDevice();
-    g_D3DSettingsDlg.OnD3D11DestroyDevice();
-    DXUTGetGlobalResourceCache().OnDestroyDevice();
-    SAFE_DELETE(g_pTxtHelper);
-
-    SAFE_DELETE(g_pStochasticTransparency);
-    SAFE_DELETE(g_pDualDepthPeeling);
-    SAFE_DELETE(g_pPlainAlphaBlending);
-    Scene::ReleaseMesh();
-}
-
-//--------------------------------------------------------------------------------------
-// Release the swap chain
-//--------------------------------------------------------------------------------------
-void CALLBACK OnD3D11ReleasingSwapChain(void* pUserContext)
-{
-    g_DialogResourceManager.OnD3D11ReleasingSwapChain();
-}
+// Copyright (c) 2011 NVIDIA Corporation. All rights reserved.
+//
+// TO  THE MAXIMUM  EXTENT PERMITTED  BY APPLICABLE  LAW, THIS SOFTWARE  IS PROVIDED
+// *AS IS*  AND NVIDIA AND  ITS SUPPLIERS DISCLAIM  ALL WARRANTIES,  EITHER  EXPRESS
+// OR IMPLIED, INCLUDING, BUT NOT LIMITED  TO, NONINFRINGEMENT,IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.  IN NO EVENT SHALL  NVIDIA 
+// OR ITS SUPPLIERS BE  LIABLE  FOR  ANY  DIRECT, SPECIAL,  INCIDENTAL,  INDIRECT,  OR  
+// CONSEQUENTIAL DAMAGES WHATSOEVER (INCLUDING, WITHOUT LIMITATION,  DAMAGES FOR LOSS 
+// OF BUSINESS PROFITS, BUSINESS INTERRUPTION, LOSS OF BUSINESS INFORMATION, OR ANY 
+// OTHER PECUNIARY LOSS) ARISING OUT OF THE  USE OF OR INABILITY  TO USE THIS SOFTWARE, 
+// EVEN IF NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
+//
+// Please direct any bugs or questions to SDKFeedback@nvidia.com
+
+#include "DXUT.h"
+#include "DXUTcamera.h"
+#include "DXUTgui.h"
+#include "DXUTsettingsdlg.h"
+#include "SDKmisc.h"
+#ifndef __ID3DUserDefinedAnnotation_INTERFACE_DEFINED__
+#define __ID3DUserDefinedAnnotation_INTERFACE_DEFINED__
+MIDL_INTERFACE("b2daad8b-03d4-4dbf-95eb-32ab4b63d0ab")
+ID3DUserDefinedAnnotation : public IUnknown
+{
+	virtual INT STDMETHODCALLTYPE BeginEvent(LPCWSTR Name) = 0;
+	virtual INT STDMETHODCALLTYPE EndEvent(void) = 0;
+	virtual void STDMETHODCALLTYPE SetMarker(LPCWSTR Name) = 0;
+	virtual BOOL STDMETHODCALLTYPE GetStatus(void) = 0;
+};
+#endif
+#include "DualDepthPeeling.h"
+#include "StochasticTransparency.h"
+#include "PlainAlphaBlending.h"
+#include "RHI_D3D11.h"
+#include "Scene.h"
+#include "StochasticVisibility.h"
+#include "FrameBudget.h"
+#include "DepthComplexity.h"
+#include "StagingReadback.h"
+#include <DirectXPackedVector.h>
+#include <strsafe.h>
+
+typedef struct
+{
+    WCHAR* pName;
+    BaseTechnique *pEngine;
+    UINT ResolutionLevel;           // Internal render targets at 1 / 2^ResolutionLevel of the back buffer size
+    float GPUTime;                  // Average of the submissions of the technique, 0 until measured
+    UINT NumGeometryPasses;         // Of the last measured submission
+} TechniqueUI;
+
+enum
+{
+    STOCHASTIC_TRANSPARENCY,
+    DUAL_DEPTH_PEELING,
+    PLAIN_ALPHA_BLENDING,
+    NUM_TECHNIQUES
+};
+
+//--------------------------------------------------------------------------------------
+// Global variables
+//--------------------------------------------------------------------------------------
+
+CDXUTDialogResourceManager  g_DialogResourceManager;    // manager for shared resources of dialogs
+CModelViewerCamera          g_Camera;                   // A model viewing camera
+CD3DSettingsDlg             g_D3DSettingsDlg;           // Device settings dialog
+CDXUTDialog                 g_HUD;                      // dialog for standard controls
+CDXUTDialog                 g_SampleUI;                 // dialog for sample specific controls
+CDXUTTextHelper*            g_pTxtHelper = NULL;
+bool                        g_ShowUI = true;
+DirectX::XMFLOAT3           g_ModelOffset;
+float                       g_AspectRatio = 1.0f;
+float                       g_ZNear;
+float                       g_ZFar;
+TransformState              g_Transforms;
+UINT                        g_TechniqueMatricesVersion = ~0U;  // Version of the matrices in the techniques' CBData
+JobSystem                   *g_pJobSystem = NULL;
+CoverageMaskISA             g_CoverageMaskISA = COVERAGE_MASK_SCALAR;
+double                      g_CoverageMaskRate = 0.0;           // Fragments per second per core
+double                      g_VisibilityLoopNs = 0.0;           // Per fragment, at VISIBILITY_BENCHMARK_LAYERS
+double                      g_VisibilitySortedNs = 0.0;
+double                      g_VisibilitySaturatedNs = 0.0;
+double                      g_VisibilitySaturatedFraction = 0.0;  // Of the fragments rejected by the early-out
+double                      g_DenoiseScalarMs = 0.0;           // At DENOISE_BENCHMARK_WIDTH x DENOISE_BENCHMARK_HEIGHT
+double                      g_DenoiseParallelMs = 0.0;
+bool                        g_CompareDepthFormats = false;
+WCHAR                       g_DepthFormatError[100] = L"";     // Last D16 versus D32 comparison
+bool                        g_CompareSubmission = false;
+WCHAR                       g_SubmissionError[100] = L"";      // Last parallel versus serial submission comparison
+StagingReadback             g_TileClassesReadback(TILE_READBACK_LATENCY);
+TileStats                   g_TileStats;                        // Of the last tile classes read back
+bool                        g_VerifyTileClasses = false;
+WCHAR                       g_TileClassesError[100] = L"";     // Last comparison with the CPU reference
+bool                        g_VerifyTemporal = false;
+WCHAR                       g_TemporalError[100] = L"";        // Last comparison with the CPU reference
+FrameBudgetGovernor         g_FrameBudget;
+DepthComplexityProbe        *g_pDepthComplexityProbe = NULL;
+StagingReadback             g_DepthComplexityReadback(DEPTH_COMPLEXITY_READBACK_LATENCY);
+DepthComplexityStats        g_DepthComplexityStats;             // Of the last counts read back
+bool                        g_HasDepthComplexityStats = false;
+UINT                        g_NumMeasuredFrames = 0;            // Since the last technique switch
+int                         g_AutoCandidate = -1;               // Last decision of the automatic selection
+UINT                        g_NumAutoConfirmations = 0;         // Consecutive readbacks with the same decision
+int                         g_AutoTechnique = -1;               // Last decision applied, -1 until then
+UINT                        g_AutoLayers = 0;                   // Probed layers of the last decision applied
+float                       g_AutoPredictedTime = 0.f;
+StagingReadback             g_ProgressiveReadback(PROGRESSIVE_READBACK_LATENCY);  // Tagged with the frames in the mean
+float                       g_ProgressiveChange = 0.f;          // Of the last change read back
+UINT                        g_ProgressiveChangeFrames = 0;      // Frames in the mean of the last change read back
+UINT                        g_ProgressiveViewVersion = ~0U;     // Of the world and view matrices of the running mean
+bool                        g_RestartProgressive = true;        // Set by any change of the settings
+bool                        g_ProgressiveConverged = false;
+bool                        g_IdleRenderingPaused = false;      // By PauseIdleRendering
+ID3D11Texture2D             *g_pConvergedImage = NULL;         // Copy of the back buffer at convergence
+D3D11Device                 *g_pRHIDevice = NULL;
+D3D11Context                *g_pRHIContext = NULL;
+RHIView                     *g_pBackBufferView = NULL;         // Wraps g_pBackBufferRTV
+ID3D11RenderTargetView      *g_pBackBufferRTV = NULL;          // Not referenced, only compared
+
+TechniqueUI                 g_Techniques[NUM_TECHNIQUES];
+StochasticTransparency      *g_pStochasticTransparency = NULL;
+DualDepthPeeling            *g_pDualDepthPeeling = NULL;
+PlainAlphaBlending          *g_pPlainAlphaBlending = NULL;
+BaseTechnique               *g_pCurrentEngine = NULL;
+
+UINT                        BaseTechnique::m_NumGeomPasses;
+float                       BaseTechnique::m_Alpha;
+CDXUTSDKMesh                Scene::m_Mesh;
+CompactMesh                 Scene::m_CompactMesh;
+MeshletCuller               Scene::m_MeshletCuller;
+InstanceBuffer              Scene::m_Instances;
+bool                        Scene::m_EnableClusterCulling = true;
+bool                        Scene::m_EnableOpaqueSubsets = false;
+bool                        Scene::m_EnableOcclusionCulling = true;
+HiZReadback                 Scene::m_HiZReadback;
+MeshDrawList                Scene::m_TransparentDrawLists[2];
+MeshDrawList                Scene::m_OpaqueDrawList;
+
+//--------------------------------------------------------------------------------------
+// Defines
+//--------------------------------------------------------------------------------------
+
+#define IMAGE_WIDTH 1280
+#define IMAGE_HEIGHT 720
+
+#define FOVY (DirectX::XM_PI / 4)
+#define ZNEAR 0.1f
+#define ZFAR 100.0f
+
+// Relative margin added around the fitted depth range
+#define DEPTH_RANGE_MARGIN 0.01f
+
+#define MAX_NUM_PEELING_PASSES 8
+#define NUM_PEELING_PASSES 4
+
+#define MAX_NUM_STOCHASTIC_PASSES 8
+#define NUM_STOCHASTIC_PASSES 1
+
+// Internal render targets down to 1/4 of the back buffer size
+#define MAX_RESOLUTION_LEVEL 2
+
+// GPU time of the technique's passes targeted by the frame budget governor, in milliseconds
+#define MIN_FRAME_BUDGET 2
+#define MAX_FRAME_BUDGET 33
+#define FRAME_BUDGET 16
+
+// Automatic technique selection: the layers of 95% of the covered pixels decide, a new decision
+// is applied after 8 consecutive readbacks agree, and the GPU time of a technique is averaged
+// over its submissions once the statistics of the previous technique are out of the way
+#define AUTO_SELECT_PERCENTILE 0.95f
+#define AUTO_SELECT_CONFIRMATIONS 8
+#define AUTO_SELECT_SMOOTHING 0.1f
+#define AUTO_SELECT_SKIPPED_FRAMES (STATS_QUERY_LATENCY + 1)
+
+// Highest depth complexity of the CPU visibility benchmark
+#define VISIBILITY_BENCHMARK_LAYERS 64
+#define VISIBILITY_BENCHMARK_ALPHA 0.6f     // The default of the alpha slider
+
+// Image size of the CPU denoiser benchmark
+#define DENOISE_BENCHMARK_WIDTH 1280
+#define DENOISE_BENCHMARK_HEIGHT 720
+
+#define AUTO_ROTATION_RATE 0.05f
+#define WORLD_OFFSET 0.01f
+
+//--------------------------------------------------------------------------------------
+// UI control IDs
+//--------------------------------------------------------------------------------------
+enum {
+    IDC_TOGGLEFULLSCREEN = 1,
+    IDC_TOGGLEREF,
+    IDC_CHANGEDEVICE,
+    IDC_USE_STOCHASTIC_TRANSPARENCY,
+    IDC_USE_DUAL_DEPTH_PEELING,
+    IDC_USE_PLAIN_ALPHA_BLENDING,
+    IDC_NUM_PEELING_PASSES_STATIC,
+    IDC_NUM_PEELING_PASSES_SLIDER,
+    IDC_NUM_STOCHASTIC_PASSES_STATIC,
+    IDC_NUM_STOCHASTIC_PASSES_SLIDER,
+    IDC_ALPHA_STATIC,
+    IDC_ALPHA_SLIDER,
+    IDC_NUM_INSTANCES_STATIC,
+    IDC_NUM_INSTANCES_SLIDER,
+    IDC_RESOLUTION_STATIC,
+    IDC_RESOLUTION_SLIDER,
+    IDC_AUTO_ROTATE,
+    IDC_CLUSTER_CULLING,
+    IDC_OPAQUE_SUBSETS,
+    IDC_OCCLUSION_CULLING,
+    IDC_FIT_DEPTH_RANGE,
+    IDC_PARALLEL_SUBMISSION,
+    IDC_COMPARE_SUBMISSION,
+    IDC_SORTED_DEPTHS,
+    IDC_STOCHASTIC_DEPTH_16,
+    IDC_FARTHEST_DEPTH_REJECTION,
+    IDC_COMPARE_DEPTH_FORMATS,
+    IDC_TILE_CLASSIFICATION,
+    IDC_VERIFY_TILE_CLASSES,
+    IDC_TEMPORAL_ACCUMULATION,
+    IDC_VERIFY_TEMPORAL,
+    IDC_DENOISE,
+    IDC_FRAME_BUDGET,
+    IDC_FRAME_BUDGET_STATIC,
+    IDC_FRAME_BUDGET_SLIDER,
+    IDC_AUTO_SELECT,
+    IDC_PROGRESSIVE_REFINEMENT
+};
+
+//--------------------------------------------------------------------------------------
+// Forward declarations 
+//--------------------------------------------------------------------------------------
+bool CALLBACK ModifyDeviceSettings(DXUTDeviceSettings* pDeviceSettings, void* pUserContext);
+void CALLBACK OnFrameMove(double fTime, float fElapsedTime, void* pUserContext);
+LRESULT CALLBACK MsgProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam, bool* pbNoFurtherProcessing,
+                         void* pUserContext);
+void CALLBACK OnGUIEvent(UINT nEvent, int nControlID, CDXUTControl* pControl, void* pUserContext);
+
+bool CALLBACK IsD3D11DeviceAcceptable(const CD3D11EnumAdapterInfo *AdapterInfo, UINT Output, const CD3D11EnumDeviceInfo *DeviceInfo,
+                                      DXGI_FORMAT BackBufferFormat, bool bWindowed, void* pUserContext);
+HRESULT CALLBACK OnD3D11CreateDevice(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc,
+                                     void* pUserContext);
+HRESULT CALLBACK OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, IDXGISwapChain* pSwapChain,
+                                         const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc, void* pUserContext);
+void CALLBACK OnD3D11ReleasingSwapChain(void* pUserContext);
+void CALLBACK OnD3D11DestroyDevice(void* pUserContext);
+void CALLBACK OnD3D11FrameRender(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext, double fTime,
+                                 float fElapsedTime, void* pUserContext);
+
+void InitGUI();
+void RenderText();
+
+//--------------------------------------------------------------------------------------
+// Handle key presses
+//--------------------------------------------------------------------------------------
+void CALLBACK OnKeyboard(UINT nChar, bool bKeyDown, bool bAltDown, void* pUserContext)
+{
+    if(bKeyDown)
+    {
+        switch(nChar)
+        {
+        case VK_ESCAPE:
+            PostQuitMessage(0);
+            break;
+        case 'U':
+            g_ShowUI = !g_ShowUI;
+            break;
+        case 'A':
+            g_ModelOffset.x -= WORLD_OFFSET;
+            break;
+        case 'D':
+            g_ModelOffset.x += WORLD_OFFSET;
+            break;
+        case 'W':
+            g_ModelOffset.y += WORLD_OFFSET;
+            break;
+        case 'S':
+            g_ModelOffset.y -= WORLD_OFFSET;
+            break;
+        case 'Q':
+            g_ModelOffset.z -= WORLD_OFFSET;
+            break;
+        case 'E':
+            g_ModelOffset.z += WORLD_OFFSET;
+            break;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Entry point to the program. Initializes everything and goes into a message processing 
+// loop. Idle time is used to render the scene.
+//--------------------------------------------------------------------------------------
+int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow)
+{
+    HRESULT hr;
+    V_RETURN(DXUTSetMediaSearchPath(L"..\\Source\\StochasticTransparency"));
+    // Enable run-time memory check for debug builds.
+#if defined(DEBUG) | defined(_DEBUG)
+    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+
+    // Disable gamma correction on this sample
+    DXUTSetIsInGammaCorrectMode(false);
+
+    DXUTSetCallbackDeviceChanging(ModifyDeviceSettings);
+    DXUTSetCallbackMsgProc(MsgProc);
+    DXUTSetCallbackKeyboard(OnKeyboard);
+    DXUTSetCallbackFrameMove(OnFrameMove);
+    
+    DXUTSetCallbackD3D11DeviceAcceptable(IsD3D11DeviceAcceptable);
+    DXUTSetCallbackD3D11DeviceCreated(OnD3D11CreateDevice);
+    DXUTSetCallbackD3D11SwapChainResized(OnD3D11ResizedSwapChain);
+    DXUTSetCallbackD3D11FrameRender(OnD3D11FrameRender);
+    DXUTSetCallbackD3D11SwapChainReleasing(OnD3D11ReleasingSwapChain);
+    DXUTSetCallbackD3D11DeviceDestroyed(OnD3D11DestroyDevice);
+
+    InitGUI();
+
+    DXUTInit(true, true, NULL); // Parse the command line, show msgboxes on error
+    DXUTSetCursorSettings(true, true); // Show the cursor and clip it when in full screen
+    DXUTCreateWindow(L"Stochastic Transparency");
+    DXUTCreateDevice(D3D_FEATURE_LEVEL_11_0, true, IMAGE_WIDTH, IMAGE_HEIGHT);
+    DXUTMainLoop(); // Enter into the DXUT render loop
+
+    return DXUTGetExitCode();
+}
+
+//--------------------------------------------------------------------------------------
+void InitGUI()
+{
+    g_D3DSettingsDlg.Init(&g_DialogResourceManager);
+    g_HUD.Init(&g_DialogResourceManager);
+    g_HUD.SetCallback(OnGUIEvent);
+    
+    int iY = 20;
+    g_HUD.AddButton(IDC_TOGGLEFULLSCREEN, L"Toggle full screen", 0, iY, 170, 23);
+    g_HUD.AddButton(IDC_TOGGLEREF, L"Toggle REF (F3)", 0, iY += 26, 170, 23, VK_F3);
+    g_HUD.AddButton(IDC_CHANGEDEVICE, L"Change device (F2)", 0, iY += 26, 170, 23, VK_F2);
+
+    g_SampleUI.Init(&g_DialogResourceManager);
+    g_SampleUI.SetCallback(OnGUIEvent); 
+
+    iY = 0;
+    g_SampleUI.AddRadioButton(IDC_USE_STOCHASTIC_TRANSPARENCY,     0, L"Depth-Based Stochastic Transparency" , 10, iY += 24, 125, 22, true);
+    g_SampleUI.AddRadioButton(IDC_USE_DUAL_DEPTH_PEELING,          0, L"Dual Depth Peeling" , 10, iY += 24, 125, 22, false);
+    g_SampleUI.AddRadioButton(IDC_USE_PLAIN_ALPHA_BLENDING,        0, L"Plain Alpha Blending" , 10, iY += 24, 125, 22, false);
+
+    iY += 40;
+    g_SampleUI.AddStatic(IDC_NUM_PEELING_PASSES_STATIC, L"", 30, iY, 125, 22);
+    g_SampleUI.AddStatic(IDC_NUM_STOCHASTIC_PASSES_STATIC, L"", 30, iY, 125, 22);
+
+    iY += 24;
+    g_SampleUI.AddSlider(IDC_NUM_PEELING_PASSES_SLIDER, 50, iY, 100, 22, 1, MAX_NUM_PEELING_PASSES, NUM_PEELING_PASSES);
+    g_SampleUI.AddSlider(IDC_NUM_STOCHASTIC_PASSES_SLIDER, 50, iY, 100, 22, 1, MAX_NUM_STOCHASTIC_PASSES, NUM_STOCHASTIC_PASSES);
+
+    g_SampleUI.AddStatic(IDC_ALPHA_STATIC, L"", 30, iY += 24, 125, 22);
+    g_SampleUI.AddSlider(IDC_ALPHA_SLIDER, 50, iY += 24, 100, 22, 0, 100, 60);
+
+    g_SampleUI.AddStatic(IDC_NUM_INSTANCES_STATIC, L"", 30, iY += 24, 125, 22);
+    g_SampleUI.AddSlider(IDC_NUM_INSTANCES_SLIDER, 50, iY += 24, 100, 22, 1, MAX_INSTANCE_GRID_SIZE, 1);
+
+    g_SampleUI.AddStatic(IDC_RESOLUTION_STATIC, L"", 30, iY += 24, 125, 22);
+    g_SampleUI.AddSlider(IDC_RESOLUTION_SLIDER, 50, iY += 24, 100, 22, 0, MAX_RESOLUTION_LEVEL, 0);
+
+    g_SampleUI.AddCheckBox(IDC_AUTO_ROTATE, L"Auto Rotate", 35, iY += 26, 125, 22, false);
+    g_SampleUI.AddCheckBox(IDC_CLUSTER_CULLING, L"Cluster Culling", 35, iY += 26, 125, 22, true);
+    g_SampleUI.AddCheckBox(IDC_OPAQUE_SUBSETS, L"Opaque Subsets", 35, iY += 26, 125, 22, false);
+    g_SampleUI.AddCheckBox(IDC_OCCLUSION_CULLING, L"Hi-Z Occlusion Culling", 35, iY += 26, 125, 22, true);
+    g_SampleUI.AddCheckBox(IDC_FIT_DEPTH_RANGE, L"Fit Depth Range", 35, iY += 26, 125, 22, true);
+    g_SampleUI.AddCheckBox(IDC_PARALLEL_SUBMISSION, L"Parallel Submission", 35, iY += 26, 125, 22, false);
+    g_SampleUI.AddButton(IDC_COMPARE_SUBMISSION, L"Compare Submission", 35, iY += 26, 125, 22);
+    g_SampleUI.AddCheckBox(IDC_SORTED_DEPTHS, L"Sorted Stochastic Depths", 35, iY += 26, 125, 22, false);
+    g_SampleUI.AddCheckBox(IDC_STOCHASTIC_DEPTH_16, L"16-bit Stochastic Depth", 35, iY += 26, 125, 22, false);
+    g_SampleUI.AddCheckBox(IDC_FARTHEST_DEPTH_REJECTION, L"Farthest Depth Rejection", 35, iY += 26, 125, 22, false);
+    g_SampleUI.AddButton(IDC_COMPARE_DEPTH_FORMATS, L"Compare Depth Formats", 35, iY += 26, 125, 22);
+    g_SampleUI.AddCheckBox(IDC_TILE_CLASSIFICATION, L"Tile Classification", 35, iY += 26, 125, 22, true);
+    g_SampleUI.AddButton(IDC_VERIFY_TILE_CLASSES, L"Verify Tile Classes", 35, iY += 26, 125, 22);
+    g_SampleUI.AddCheckBox(IDC_TEMPORAL_ACCUMULATION, L"Temporal Accumulation", 35, iY += 26, 125, 22, false);
+    g_SampleUI.AddButton(IDC_VERIFY_TEMPORAL, L"Verify Temporal", 35, iY += 26, 125, 22);
+    g_SampleUI.AddCheckBox(IDC_DENOISE, L"Denoise", 35, iY += 26, 125, 22, false);
+    g_SampleUI.AddCheckBox(IDC_FRAME_BUDGET, L"Frame Budget Governor", 35, iY += 26, 125, 22, false);
+    g_SampleUI.AddStatic(IDC_FRAME_BUDGET_STATIC, L"", 30, iY += 24, 125, 22);
+    g_SampleUI.AddSlider(IDC_FRAME_BUDGET_SLIDER, 50, iY += 24, 100, 22, MIN_FRAME_BUDGET, MAX_FRAME_BUDGET, FRAME_BUDGET);
+    g_SampleUI.AddCheckBox(IDC_AUTO_SELECT, L"Automatic Technique", 35, iY += 26, 125, 22, false);
+    g_SampleUI.AddCheckBox(IDC_PROGRESSIVE_REFINEMENT, L"Progressive Refinement", 35, iY += 26, 125, 22, false);
+
+    g_FrameBudget.SetLimits(MAX_NUM_PEELING_PASSES, MAX_RESOLUTION_LEVEL);
+}
+
+//--------------------------------------------------------------------------------------
+// This callback function is called immediately before a device is created to allow the 
+// application to modify the device settings. The supplied pDeviceSettings parameter 
+// contains the settings that the framework has selected for the new device, and the 
+// application can make any desired changes directly to this structure.  Note however that 
+// DXUT will not correct invalid device settings so care must be taken 
+// to return valid device settings, otherwise CreateDevice() will fail.  
+//--------------------------------------------------------------------------------------
+bool CALLBACK ModifyDeviceSettings(DXUTDeviceSettings* pDeviceSettings, void* pUserContext)
+{    
+    // Disable vsync
+    pDeviceSettings->d3d11.SyncInterval = 0;
+
+    // For the first device created if it is a REF device, optionally display a warning dialog box
+    static bool s_bFirstTime = true;
+    if(s_bFirstTime)
+    {
+        s_bFirstTime = false;
+		pDeviceSettings->d3d11.CreateFlags = 0; //D3D11_CREATE_DEVICE_DEBUG
+		pDeviceSettings->d3d11.sd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// This callback function will be called once at the beginning of every frame. This is the
+// best location for your application to handle updates to the scene, but is not 
+// intended to contain actual rendering calls, which should instead be placed in the 
+// OnFrameRender callback.  
+//--------------------------------------------------------------------------------------
+void CALLBACK OnFrameMove(double fTime, float fElapsedTime, void* pUserContext)
+{
+    // Update the camera's position based on user input 
+    g_Camera.FrameMove(fElapsedTime);
+}
+
+//--------------------------------------------------------------------------------------
+// Render text for the UI
+//--------------------------------------------------------------------------------------
+void RenderText()
+{
+    g_pTxtHelper->Begin();
+    g_pTxtHelper->SetInsertionPos(2, 0);
+    g_pTxtHelper->SetForegroundColor(DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+    g_pTxtHelper->DrawTextLine(DXUTGetFrameStats(DXUTIsVsyncEnabled()));
+    g_pTxtHelper->DrawTextLine(DXUTGetDeviceStats());
+
+    const CompactMesh &Mesh = Scene::GetCompactMesh();
+    WCHAR sz[100];
+    StringCchPrintf(sz, 100, L"Vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+                    Mesh.GetStatsBefore().GetACMR(), Mesh.GetStatsAfter().GetACMR(),
+                    Mesh.GetStatsBefore().GetATVR(), Mesh.GetStatsAfter().GetATVR());
+    g_pTxtHelper->DrawTextLine(sz);
+    StringCchPrintf(sz, 100, L"Compact vertices: %u bytes, max error %g (position), %.4f rad (normal)",
+                    (UINT)sizeof(CompactVertex), Mesh.GetMaxPositionError(), Mesh.GetMaxNormalError());
+    g_pTxtHelper->DrawTextLine(sz);
+
+    const InstanceBuffer &Instances = Scene::GetInstances();
+    if (Instances.GetNumInstances() > 1)
+    {
+        StringCchPrintf(sz, 100, L"Instances: %u / %u visible",
+                        Instances.GetNumVisibleInstances(), Instances.GetNumInstances());
+    }
+    else
+    {
+        const MeshletCuller &Culler = Scene::GetMeshletCuller();
+        StringCchPrintf(sz, 100, L"Clusters: %u / %u visible, %u triangles",
+                        Culler.GetNumVisibleMeshlets(), Culler.GetNumMeshlets(), Culler.GetNumVisibleTriangles());
+    }
+    g_pTxtHelper->DrawTextLine(sz);
+
+    if (Scene::GetOcclusionCulling() && Scene::GetOpaqueSubsets())
+    {
+        const HiZReadback &Readback = Scene::GetHiZReadback();
+        UINT NumOccluded = (Instances.GetNumInstances() > 1) ? Instances.GetNumOccludedInstances() :
+                                                               Scene::GetMeshletCuller().GetNumOccludedMeshlets();
+        StringCchPrintf(sz, 100, L"Hi-Z (%s): %u occluded, built in %.2f ms",
+                        Readback.GetPyramid().GetSIMD() ? L"SSE2" : L"Scalar",
+                        NumOccluded, Readback.GetBuildTime() * 1e3);
+        g_pTxtHelper->DrawTextLine(sz);
+    }
+
+    StringCchPrintf(sz, 100, L"Depth range: %.3f - %.3f", g_ZNear, g_ZFar);
+    g_pTxtHelper->DrawTextLine(sz);
+
+    if (g_pRHIContext->GetParallelSubmission())
+    {
+        StringCchPrintf(sz, 100, L"Parallel submission: %u segments on %u threads",
+                        g_pRHIContext->GetNumSubmittedSegments(), g_pJobSystem->GetNumWorkers());
+        g_pTxtHelper->DrawTextLine(sz);
+    }
+
+    if (g_SubmissionError[0])
+    {
+        g_pTxtHelper->DrawTextLine(g_SubmissionError);
+    }
+
+    if (g_pRHIContext->GetNumConstantFallbacks())
+    {
+        StringCchPrintf(sz, 100, L"Constants: UpdateSubresource per subset draw, %u uploads",
+                        g_pRHIContext->GetNumConstantFallbacks());
+    }
+    else
+    {
+        StringCchPrintf(sz, 100, L"Constants: %u KB ring", g_pRHIContext->GetConstantRingCapacity() / 1024);
+    }
+    g_pTxtHelper->DrawTextLine(sz);
+
+    StringCchPrintf(sz, 100, L"CPU coverage masks (%s): %.0f Mfragments/s per core",
+                    GetCoverageMaskISAName(g_CoverageMaskISA), g_CoverageMaskRate * 1e-6);
+    g_pTxtHelper->DrawTextLine(sz);
+
+    StringCchPrintf(sz, 100, L"CPU visibility (%u layers): loop %.2f ns, sorted %.2f ns per fragment",
+                    VISIBILITY_BENCHMARK_LAYERS, g_VisibilityLoopNs, g_VisibilitySortedNs);
+    g_pTxtHelper->DrawTextLine(sz);
+
+    StringCchPrintf(sz, 100, L"CPU saturated early-out: %.2f ns per fragment, %.0f%% rejected",
+                    g_VisibilitySaturatedNs, g_VisibilitySaturatedFraction * 100.0);
+    g_pTxtHelper->DrawTextLine(sz);
+
+    StringCchPrintf(sz, 100, L"CPU denoise (%ux%u): scalar %.2f ms, %s %.2f ms on %u threads",
+                    DENOISE_BENCHMARK_WIDTH, DENOISE_BENCHMARK_HEIGHT, g_DenoiseScalarMs,
+                    GetCoverageMaskISAName(g_CoverageMaskISA), g_DenoiseParallelMs, g_pJobSystem->GetNumWorkers());
+    g_pTxtHelper->DrawTextLine(sz);
+
+    // Fragments per transparent geometry pass, from the pixel shader invocations of the last frame
+    // read back, minus one per pixel for each fullscreen draw. The depth pre-pass leaves at most
+    // one shaded fragment per pixel in the opaque color pass, so it is counted as a fullscreen draw.
+    D3D11SubmitStats Stats;
+    if (g_pCurrentEngine == g_pStochasticTransparency &&
+        g_pRHIContext->GetLastSubmitStats(Stats) &&
+        Stats.NumMeshDraws > Stats.NumOpaqueMeshDraws)
+    {
+        const DXGI_SURFACE_DESC *pBackBufferDesc = DXUTGetDXGIBackBufferSurfaceDesc();
+        const UINT ResolutionScale = g_pStochasticTransparency->GetResolutionScale();
+        double NumPixels = (double)GetReducedSize(pBackBufferDesc->Width, ResolutionScale) * GetReducedSize(pBackBufferDesc->Height, ResolutionScale);
+        UINT NumTransparentDraws = Stats.NumMeshDraws - Stats.NumOpaqueMeshDraws;
+        UINT NumFullscreenDraws = Stats.NumDraws - Stats.NumMeshDraws + Stats.NumOpaqueMeshDraws / 2;
+        if (g_pStochasticTransparency->GetTileClasses())
+        {
+            // The two tile draws cover the screen once, and the classification shades one pixel per tile
+            NumFullscreenDraws -= 2;
+        }
+        if (g_pStochasticTransparency->GetProgressiveChange())
+        {
+            // The progressive change shades one pixel per tile
+            NumFullscreenDraws -= 1;
+        }
+        double NumFragments = ((double)Stats.PSInvocations - NumFullscreenDraws * NumPixels) / NumTransparentDraws;
+        NumFragments = std::max(NumFragments, 0.0);
+
+        RHIFormat Format = g_pStochasticTransparency->GetStochasticDepthFormat();
+        StringCchPrintf(sz, 100, L"Stochastic depth: %s, %.1f MB/frame (D32: %.1f MB)",
+                        (Format == RHI_FORMAT_D16_UNORM) ? L"D16" : L"D32",
+                        g_pStochasticTransparency->GetStochasticDepthTraffic(NumFragments, Format) * 1e-6,
+                        g_pStochasticTransparency->GetStochasticDepthTraffic(NumFragments, RHI_FORMAT_D32_FLOAT) * 1e-6);
+        g_pTxtHelper->DrawTextLine(sz);
+    }
+
+    if (g_SampleUI.GetCheckBox(IDC_FRAME_BUDGET)->GetChecked())
+    {
+        StringCchPrintf(sz, 100, L"Frame budget: GPU %.2f ms, %.2f ms per pass, %u changes, last predicted %.2f ms",
+                        g_FrameBudget.GetAverageTime(), g_FrameBudget.GetPassTime(),
+                        g_FrameBudget.GetNumChanges(), g_FrameBudget.GetPredictedTime());
+        g_pTxtHelper->DrawTextLine(sz);
+    }
+
+    if (g_SampleUI.GetCheckBox(IDC_AUTO_SELECT)->GetChecked() && g_AutoTechnique >= 0)
+    {
+        const WCHAR *pNames[NUM_TECHNIQUES] = { L"stochastic", L"dual depth peeling", L"alpha blending" };
+        StringCchPrintf(sz, 100, L"Auto: %s for %u layers (%.0f%% covered), predicted %.2f ms, measured %.2f ms",
+                        pNames[g_AutoTechnique], g_AutoLayers, g_DepthComplexityStats.GetCoveredFraction() * 100.f,
+                        g_AutoPredictedTime, g_Techniques[g_AutoTechnique].GPUTime);
+        g_pTxtHelper->DrawTextLine(sz);
+    }
+
+    if (g_SampleUI.GetCheckBox(IDC_PROGRESSIVE_REFINEMENT)->GetChecked())
+    {
+        if (g_ProgressiveConverged)
+        {
+            StringCchPrintf(sz, 100, L"Progressive: converged after %u frames, idle",
+                            g_pCurrentEngine == g_pStochasticTransparency ? g_pStochasticTransparency->GetNumProgressiveFrames() : 1U);
+        }
+        else
+        {
+            StringCchPrintf(sz, 100, L"Progressive: %u frames, max change %.2f / 255 after %u frames",
+                            g_pStochasticTransparency->GetNumProgressiveFrames(), g_ProgressiveChange * 255.f, g_ProgressiveChangeFrames);
+        }
+        g_pTxtHelper->DrawTextLine(sz);
+    }
+
+    if (g_DepthFormatError[0])
+    {
+        g_pTxtHelper->DrawTextLine(g_DepthFormatError);
+    }
+
+    if (g_pCurrentEngine->GetTileClasses())
+    {
+        StringCchPrintf(sz, 100, L"Tiles: %.1f%% skipped (%u empty, %u opaque, %u transparent)",
+                        100.f * g_TileStats.GetSkippedFraction(), g_TileStats.NumTiles[TILE_EMPTY],
+                        g_TileStats.NumTiles[TILE_OPAQUE], g_TileStats.NumTiles[TILE_TRANSPARENT]);
+        g_pTxtHelper->DrawTextLine(sz);
+
+        if (g_TileClassesError[0])
+        {
+            g_pTxtHelper->DrawTextLine(g_TileClassesError);
+        }
+    }
+
+    if (g_TemporalError[0])
+    {
+        g_pTxtHelper->DrawTextLine(g_TemporalError);
+    }
+
+    g_pTxtHelper->End();
+}
+
+//--------------------------------------------------------------------------------------
+// Measures the CPU kernels with the best instruction set of this CPU: the coverage masks,
+// on the stochastic depth table, the visibility estimate with and without the sorted depths,
+// and the denoiser. The results are shown by RenderText.
+//--------------------------------------------------------------------------------------
+void BenchmarkCoverageMaskKernels()
+{
+    CoverageMaskTable Table;
+    BuildCoverageMaskTable(Table, RANDOM_SIZE, ALPHA_VALUES, NUM_MSAA_SAMPLES);
+
+    g_CoverageMaskISA = GetBestCoverageMaskISA();
+    g_CoverageMaskRate = BenchmarkCoverageMasks(Table, g_CoverageMaskISA);
+    assert(g_CoverageMaskRate > 0.0);
+
+    // Current visibility loop versus sorted depths and saturated early-out
+    bool Match = BenchmarkSortedVisibility(g_CoverageMaskISA, VISIBILITY_BENCHMARK_LAYERS, VISIBILITY_BENCHMARK_ALPHA,
+                                           g_VisibilityLoopNs, g_VisibilitySortedNs, g_VisibilitySaturatedNs, g_VisibilitySaturatedFraction);
+    assert(Match);
+
+    // Scalar on one thread versus SIMD on all the workers
+    Match = BenchmarkDenoise(*g_pJobSystem, g_CoverageMaskISA, DENOISE_BENCHMARK_WIDTH, DENOISE_BENCHMARK_HEIGHT,
+                             g_DenoiseScalarMs, g_DenoiseParallelMs);
+    assert(Match);
+}
+
+//--------------------------------------------------------------------------------------
+// Copies a single-sampled render target or depth buffer to the CPU, tightly packed
+//--------------------------------------------------------------------------------------
+void ReadRenderTarget(ID3D11DeviceContext* pd3dImmediateContext, RHITexture *pTexture, std::vector<BYTE> &Texels)
+{
+    HRESULT hr;
+    const UINT TexelSize = GetFormatSize(pTexture->GetDesc().Format);
+
+    ID3D11Texture2D *pSrc = D3D11Device::GetTexture2D(pTexture);
+    D3D11_TEXTURE2D_DESC Desc;
+    pSrc->GetDesc(&Desc);
+    Desc.Usage = D3D11_USAGE_STAGING;
+    Desc.BindFlags = 0;
+    Desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    Desc.MiscFlags = 0;
+
+    ID3D11Texture2D *pStaging = NULL;
+    V( DXUTGetD3D11Device()->CreateTexture2D(&Desc, NULL, &pStaging) );
+    pd3dImmediateContext->CopyResource(pStaging, pSrc);
+
+    Texels.resize(Desc.Width * Desc.Height * TexelSize);
+    D3D11_MAPPED_SUBRESOURCE Mapped;
+    V( pd3dImmediateContext->Map(pStaging, 0, D3D11_MAP_READ, 0, &Mapped) );
+    for (UINT y = 0; y < Desc.Height; ++y)
+    {
+        memcpy(&Texels[y * Desc.Width * TexelSize], (BYTE*)Mapped.pData + y * Mapped.RowPitch, Desc.Width * TexelSize);
+    }
+    pd3dImmediateContext->Unmap(pStaging, 0);
+    SAFE_RELEASE(pStaging);
+}
+
+//--------------------------------------------------------------------------------------
+// Renders the current view with the 32-bit and the 16-bit stochastic depths and
+// measures the difference of the final images
+//--------------------------------------------------------------------------------------
+void CompareStochasticDepthFormats(ID3D11DeviceContext* pd3dImmediateContext)
+{
+    const DXGI_SURFACE_DESC *pBackBufferDesc = DXUTGetDXGIBackBufferSurfaceDesc();
+    RHITextureDesc TexDesc;
+    TexDesc.Width = pBackBufferDesc->Width;
+    TexDesc.Height = pBackBufferDesc->Height;
+    SimpleRT Target(g_pRHIDevice, &TexDesc, RHI_FORMAT_R8G8B8A8_UNORM);
+
+    const RHIFormat Formats[2] = { RHI_FORMAT_D32_FLOAT, RHI_FORMAT_D16_UNORM };
+    std::vector<BYTE> Images[2];
+    RHIFormat PrevFormat = g_pStochasticTransparency->GetStochasticDepthFormat();
+
+    // The temporal accumulation would blend the second image with the first one
+    bool TemporalAccumulation = g_pStochasticTransparency->GetTemporalAccumulation();
+    g_pStochasticTransparency->SetTemporalAccumulation(false);
+    for (UINT i = 0; i < 2; ++i)
+    {
+        g_pStochasticTransparency->SetStochasticDepthFormat(g_pRHIDevice, Formats[i]);
+        BaseTechnique::ResetNumGeometryPasses();
+        g_pStochasticTransparency->Render(*g_pRHIContext, Target.pRTV);
+        ReadRenderTarget(pd3dImmediateContext, Target.pTexture, Images[i]);
+    }
+    g_pStochasticTransparency->SetStochasticDepthFormat(g_pRHIDevice, PrevFormat);
+    g_pStochasticTransparency->SetTemporalAccumulation(TemporalAccumulation);
+
+    // RGB error, in 8-bit units
+    double SumSquares = 0.0;
+    UINT MaxDiff = 0;
+    UINT NumDiffPixels = 0;
+    const UINT NumPixels = TexDesc.Width * TexDesc.Height;
+    for (UINT PixelId = 0; PixelId < NumPixels; ++PixelId)
+    {
+        UINT PixelMaxDiff = 0;
+        for (UINT c = 0; c < 3; ++c)
+        {
+            int Diff = (int)Images[0][PixelId * 4 + c] - (int)Images[1][PixelId * 4 + c];
+            SumSquares += (double)(Diff * Diff);
+            PixelMaxDiff = std::max(PixelMaxDiff, (UINT)abs(Diff));
+        }
+        MaxDiff = std::max(MaxDiff, PixelMaxDiff);
+        if (PixelMaxDiff) ++NumDiffPixels;
+    }
+    double RMSE = sqrt(SumSquares / (NumPixels * 3.0));
+    double PSNR = (RMSE > 0.0) ? 20.0 * log10(255.0 / RMSE) : 0.0;
+
+    StringCchPrintf(g_DepthFormatError, 100, L"D16 vs D32: RMSE %.3f, max %u, %.2f%% pixels differ, PSNR %.1f dB",
+                    RMSE, MaxDiff, 100.0 * NumDiffPixels / NumPixels, PSNR);
+}
+
+//--------------------------------------------------------------------------------------
+// Renders the current view with the serial and the parallel submission, which must
+// produce identical pixels
+//--------------------------------------------------------------------------------------
+void CompareSubmissionModes(ID3D11DeviceContext* pd3dImmediateContext)
+{
+    const DXGI_SURFACE_DESC *pBackBufferDesc = DXUTGetDXGIBackBufferSurfaceDesc();
+    RHITextureDesc TexDesc;
+    TexDesc.Width = pBackBufferDesc->Width;
+    TexDesc.Height = pBackBufferDesc->Height;
+    SimpleRT Target(g_pRHIDevice, &TexDesc, RHI_FORMAT_R8G8B8A8_UNORM);
+
+    std::vector<BYTE> Images[2];
+    bool ParallelSubmission = g_pRHIContext->GetParallelSubmission();
+
+    // The temporal accumulation would blend the second image with the first one
+    bool TemporalAccumulation = g_pStochasticTransparency->GetTemporalAccumulation();
+    g_pStochasticTransparency->SetTemporalAccumulation(false);
+    for (UINT i = 0; i < 2; ++i)
+    {
+        g_pRHIContext->SetParallelSubmission(i == 1);
+        BaseTechnique::ResetNumGeometryPasses();
+        g_pCurrentEngine->Render(*g_pRHIContext, Target.pRTV);
+        ReadRenderTarget(pd3dImmediateContext, Target.pTexture, Images[i]);
+    }
+    g_pRHIContext->SetParallelSubmission(ParallelSubmission);
+    g_pStochasticTransparency->SetTemporalAccumulation(TemporalAccumulation);
+
+    UINT NumDiffPixels = 0;
+    const UINT NumPixels = TexDesc.Width * TexDesc.Height;
+    for (UINT PixelId = 0; PixelId < NumPixels; ++PixelId)
+    {
+        if (memcmp(&Images[0][PixelId * 4], &Images[1][PixelId * 4], 4) != 0) ++NumDiffPixels;
+    }
+
+    StringCchPrintf(g_SubmissionError, 100, L"Parallel vs serial submission: %u of %u pixels differ (%u segments)",
+                    NumDiffPixels, NumPixels, g_pRHIContext->GetNumSubmittedSegments());
+}
+
+//--------------------------------------------------------------------------------------
+// Decoders of the staging readbacks (see StagingReadback.h), called with the copy
+// made a few frames earlier
+//--------------------------------------------------------------------------------------
+
+// Counts the classes of the tile classes
+void DecodeTileClasses(const BYTE *pData, UINT RowPitch, UINT Width, UINT Height, UINT /*Tag*/)
+{
+    g_TileStats = TileStats();
+    for (UINT y = 0; y < Height; ++y)
+    {
+        g_TileStats.Add((const UINT*)(pData + y * RowPitch), Width);
+    }
+}
+
+// Builds the histogram of the fragment counts of the depth complexity probe
+void DecodeDepthComplexity(const BYTE *pData, UINT RowPitch, UINT Width, UINT Height, UINT /*Tag*/)
+{
+    g_DepthComplexityStats = DepthComplexityStats();
+    for (UINT y = 0; y < Height; ++y)
+    {
+        g_DepthComplexityStats.Add((const float*)(pData + y * RowPitch), Width);
+    }
+    g_HasDepthComplexityStats = true;
+}
+
+// Takes the largest progressive change, of a running mean of NumFrames frames
+void DecodeProgressiveChange(const BYTE *pData, UINT RowPitch, UINT Width, UINT Height, UINT NumFrames)
+{
+    g_ProgressiveChange = 0.f;
+    for (UINT y = 0; y < Height; ++y)
+    {
+        const float *pRow = (const float*)(pData + y * RowPitch);
+        for (UINT x = 0; x < Width; ++x)
+        {
+            g_ProgressiveChange = std::max(g_ProgressiveChange, pRow[x]);
+        }
+    }
+    g_ProgressiveChangeFrames = NumFrames;
+}
+
+//--------------------------------------------------------------------------------------
+// Keeps the back buffer of the converged frame, presented by the following frames
+// until the progressive refinement restarts
+//--------------------------------------------------------------------------------------
+void SaveConvergedImage(ID3D11DeviceContext* pd3dImmediateContext, ID3D11RenderTargetView *pBackBufferRTV)
+{
+    HRESULT hr;
+
+    if (!g_pConvergedImage)
+    {
+        const DXGI_SURFACE_DESC *pBackBufferDesc = DXUTGetDXGIBackBufferSurfaceDesc();
+        D3D11_TEXTURE2D_DESC Desc;
+        Desc.Width = pBackBufferDesc->Width;
+        Desc.Height = pBackBufferDesc->Height;
+        Desc.MipLevels = 1;
+        Desc.ArraySize = 1;
+        Desc.Format = pBackBufferDesc->Format;
+        Desc.SampleDesc = pBackBufferDesc->SampleDesc;
+        Desc.Usage = D3D11_USAGE_DEFAULT;
+        Desc.BindFlags = 0;
+        Desc.CPUAccessFlags = 0;
+        Desc.MiscFlags = 0;
+        V( DXUTGetD3D11Device()->CreateTexture2D(&Desc, NULL, &g_pConvergedImage) );
+        if (!g_pConvergedImage) return;
+    }
+
+    ID3D11Resource *pBackBuffer = NULL;
+    pBackBufferRTV->GetResource(&pBackBuffer);
+    pd3dImmediateContext->CopyResource(g_pConvergedImage, pBackBuffer);
+    SAFE_RELEASE(pBackBuffer);
+    g_ProgressiveConverged = true;
+}
+
+//--------------------------------------------------------------------------------------
+// Once the progressive refinement converged, DXUT stops calling the render callback and
+// the last frame stays on screen, until an input or a new swap chain resumes the rendering.
+// DXUTPause counts its calls, so each pause is matched by a single resume.
+//--------------------------------------------------------------------------------------
+void PauseIdleRendering()
+{
+    if (g_IdleRenderingPaused) return;
+    DXUTPause(false, true);
+    g_IdleRenderingPaused = true;
+}
+
+void ResumeIdleRendering()
+{
+    if (!g_IdleRenderingPaused) return;
+    DXUTPause(false, false);
+    g_IdleRenderingPaused = false;
+}
+
+//--------------------------------------------------------------------------------------
+// Classifies the tiles of the last frame with the CPU reference, and compares the result
+// with the tile classes of the current technique
+//--------------------------------------------------------------------------------------
+void VerifyTileClasses(ID3D11DeviceContext* pd3dImmediateContext)
+{
+    RHITexture *pTransmittance = NULL;
+    RHITexture *pOpaqueDepth = NULL;
+    g_pCurrentEngine->GetTileClassificationInputs(&pTransmittance, &pOpaqueDepth);
+
+    std::vector<BYTE> Transmittance, OpaqueDepth, GPUClasses;
+    ReadRenderTarget(pd3dImmediateContext, pTransmittance, Transmittance);
+    if (pOpaqueDepth)
+    {
+        ReadRenderTarget(pd3dImmediateContext, pOpaqueDepth, OpaqueDepth);
+    }
+    ReadRenderTarget(pd3dImmediateContext, g_pCurrentEngine->GetTileClasses(), GPUClasses);
+
+    const RHITextureDesc &Desc = pTransmittance->GetDesc();
+    std::vector<UINT> Classes;
+    ClassifyTiles(&Transmittance[0], pOpaqueDepth ? (const float*)&OpaqueDepth[0] : NULL, Desc.Width, Desc.Height, Classes);
+
+    const UINT *pGPUClasses = (const UINT*)&GPUClasses[0];
+    UINT NumMismatches = 0;
+    for (size_t i = 0; i < Classes.size(); ++i)
+    {
+        if (Classes[i] != pGPUClasses[i]) ++NumMismatches;
+    }
+
+    StringCchPrintf(g_TileClassesError, 100, L"Tile classes: %u / %u differ from the CPU reference",
+                    NumMismatches, (UINT)Classes.size());
+}
+
+//--------------------------------------------------------------------------------------
+// Copies an RGBA16F or RGBA32F render target to the CPU, as floats
+//--------------------------------------------------------------------------------------
+void ReadRenderTargetRGBA(ID3D11DeviceContext* pd3dImmediateContext, RHITexture *pTexture, std::vector<float> &Values)
+{
+    std::vector<BYTE> Texels;
+    ReadRenderTarget(pd3dImmediateContext, pTexture, Texels);
+
+    if (pTexture->GetDesc().Format == RHI_FORMAT_R32G32B32A32_FLOAT)
+    {
+        Values.resize(Texels.size() / sizeof(float));
+        memcpy(&Values[0], &Texels[0], Texels.size());
+        return;
+    }
+
+    const DirectX::PackedVector::HALF *pHalfs = (const DirectX::PackedVector::HALF*)&Texels[0];
+    Values.resize(Texels.size() / sizeof(DirectX::PackedVector::HALF));
+    DirectX::PackedVector::XMConvertHalfToFloatStream(&Values[0], sizeof(float), pHalfs, sizeof(DirectX::PackedVector::HALF), Values.size());
+}
+
+//--------------------------------------------------------------------------------------
+// Runs the CPU reference of the temporal pass on the inputs of the last frame, and compares
+// the result with the history written by the GPU
+//--------------------------------------------------------------------------------------
+void VerifyTemporal(ID3D11DeviceContext* pd3dImmediateContext)
+{
+    RHITexture *pCurrent, *pHistory, *pDepth, *pOutput;
+    DirectX::XMFLOAT4X4 CurrentToPrevious;
+    DirectX::XMFLOAT4 Params;
+    g_pStochasticTransparency->GetTemporalResolveInputs(&pCurrent, &pHistory, &pDepth, &pOutput, &CurrentToPrevious, &Params);
+
+    std::vector<float> Current, History, GPUOutput;
+    std::vector<BYTE> Depth;
+    ReadRenderTargetRGBA(pd3dImmediateContext, pCurrent, Current);
+    ReadRenderTargetRGBA(pd3dImmediateContext, pHistory, History);
+    ReadRenderTargetRGBA(pd3dImmediateContext, pOutput, GPUOutput);
+    ReadRenderTarget(pd3dImmediateContext, pDepth, Depth);
+
+    const RHITextureDesc &Desc = pCurrent->GetDesc();
+    std::vector<float> Output(Current.size());
+    ResolveTemporal(&Current[0], &History[0], (const float*)&Depth[0], Desc.Width, Desc.Height, CurrentToPrevious, Params, &Output[0]);
+
+    // RGB error, in 8-bit units: the GPU output is rounded to half floats
+    float MaxDiff = 0.f;
+    UINT NumDiffPixels = 0;
+    const UINT NumPixels = Desc.Width * Desc.Height;
+    for (UINT PixelId = 0; PixelId < NumPixels; ++PixelId)
+    {
+        float PixelMaxDiff = 0.f;
+        for (UINT c = 0; c < 3; ++c)
+        {
+            PixelMaxDiff = std::max(PixelMaxDiff, fabsf(Output[PixelId * 4 + c] - GPUOutput[PixelId * 4 + c]) * 255.f);
+        }
+        MaxDiff = std::max(MaxDiff, PixelMaxDiff);
+        if (PixelMaxDiff >= 1.f) ++NumDiffPixels;
+    }
+
+    StringCchPrintf(g_TemporalError, 100, L"Temporal vs CPU reference: max %.2f, %.2f%% pixels differ by 1 or more",
+                    MaxDiff, 100.0 * NumDiffPixels / NumPixels);
+}
+
+//--------------------------------------------------------------------------------------
+// Before handling window messages, DXUT passes incoming windows 
+// messages to the application through this callback function. If the application sets 
+// *pbNoFurtherProcessing to TRUE, then DXUT will not process this message.
+//--------------------------------------------------------------------------------------
+LRESULT CALLBACK MsgProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam, bool* pbNoFurtherProcessing,
+                         void* pUserContext)
+{
+    // Any input may move the camera or change a setting, and the UI needs frames to respond
+    if ((uMsg >= WM_KEYFIRST && uMsg <= WM_KEYLAST) || (uMsg >= WM_MOUSEFIRST && uMsg <= WM_MOUSELAST))
+    {
+        ResumeIdleRendering();
+    }
+
+    // Pass messages to dialog resource manager calls so GUI state is updated correctly
+    *pbNoFurtherProcessing = g_DialogResourceManager.MsgProc(hWnd, uMsg, wParam, lParam);
+    if(*pbNoFurtherProcessing)
+        return 0;
+
+    // Pass messages to settings dialog if its active
+    if(g_D3DSettingsDlg.IsActive())
+    {
+        g_D3DSettingsDlg.MsgProc(hWnd, uMsg, wParam, lParam);
+        return 0;
+    }
+
+    // Give the dialogs a chance to handle the message first
+    *pbNoFurtherProcessing = g_HUD.MsgProc(hWnd, uMsg, wParam, lParam);
+    if(*pbNoFurtherProcessing)
+        return 0;
+    *pbNoFurtherProcessing = g_SampleUI.MsgProc(hWnd, uMsg, wParam, lParam);
+    if(*pbNoFurtherProcessing)
+        return 0;
+
+    // Pass all windows messages to camera so it can respond to user input
+    g_Camera.HandleMessages(hWnd, uMsg, wParam, lParam);
+
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Switches to a technique with the settings it had, as the IDC_USE_* radio buttons do.
+// The radio buttons are in the order of the techniques.
+//--------------------------------------------------------------------------------------
+void SetCurrentTechnique(int TechniqueId)
+{
+    g_pCurrentEngine = g_Techniques[TechniqueId].pEngine;
+    g_SampleUI.GetRadioButton(IDC_USE_STOCHASTIC_TRANSPARENCY + TechniqueId)->SetChecked(true);
+    g_SampleUI.GetSlider(IDC_RESOLUTION_SLIDER)->SetValue(g_Techniques[TechniqueId].ResolutionLevel);
+    g_FrameBudget.Reset();
+    g_NumMeasuredFrames = 0;
+    g_RestartProgressive = true;
+}
+
+//--------------------------------------------------------------------------------------
+// Handles the GUI events
+//--------------------------------------------------------------------------------------
+void CALLBACK OnGUIEvent(UINT nEvent, int nControlID, CDXUTControl* pControl, void* pUserContext)
+{
+    // Any setting may change the image. The verifications only need one more frame,
+    // which keeps adding to the running mean.
+    if (nControlID == IDC_VERIFY_TILE_CLASSES || nControlID == IDC_VERIFY_TEMPORAL)
+    {
+        g_ProgressiveConverged = false;
+    }
+    else
+    {
+        g_RestartProgressive = true;
+    }
+
+    switch(nControlID)
+    {
+        case IDC_TOGGLEFULLSCREEN:
+        {
+            DXUTToggleFullScreen();
+            break;
+        }
+        case IDC_TOGGLEREF:
+        {
+            DXUTToggleREF();
+            break;
+        }
+        case IDC_CHANGEDEVICE:
+        {
+            g_D3DSettingsDlg.SetActive(!g_D3DSettingsDlg.IsActive());
+            break;
+        }
+        case IDC_USE_STOCHASTIC_TRANSPARENCY:
+        case IDC_USE_DUAL_DEPTH_PEELING:
+        case IDC_USE_PLAIN_ALPHA_BLENDING:
+        {
+            // A manual choice overrides the automatic selection
+            g_SampleUI.GetCheckBox(IDC_AUTO_SELECT)->SetChecked(false);
+            SetCurrentTechnique(nControlID - IDC_USE_STOCHASTIC_TRANSPARENCY);
+            break;
+        }
+        case IDC_COMPARE_DEPTH_FORMATS:
+        {
+            g_CompareDepthFormats = true;
+            break;
+        }
+        case IDC_COMPARE_SUBMISSION:
+        {
+            g_CompareSubmission = true;
+            break;
+        }
+        case IDC_TILE_CLASSIFICATION:
+        {
+            g_TileClassesError[0] = 0;
+            break;
+        }
+        case IDC_VERIFY_TILE_CLASSES:
+        {
+            g_VerifyTileClasses = true;
+            break;
+        }
+        case IDC_TEMPORAL_ACCUMULATION:
+        {
+            g_TemporalError[0] = 0;
+            break;
+        }
+        case IDC_VERIFY_TEMPORAL:
+        {
+            g_VerifyTemporal = true;
+            break;
+        }
+        case IDC_FRAME_BUDGET:
+        {
+            g_FrameBudget.Reset();
+            break;
+        }
+        case IDC_AUTO_SELECT:
+        {
+            g_AutoCandidate = -1;
+            g_NumAutoConfirmations = 0;
+            g_AutoTechnique = -1;
+            g_HasDepthComplexityStats = false;
+            break;
+        }
+    }
+}
+
+bool CALLBACK IsD3D11DeviceAcceptable(const CD3D11EnumAdapterInfo *AdapterInfo, UINT Output, const CD3D11EnumDeviceInfo *DeviceInfo,
+                                      DXGI_FORMAT BackBufferFormat, bool bWindowed, void* pUserContext)
+{
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// This callback function will be called immediately after the Direct3D device has been 
+// created, which will happen during application initialization and windowed/full screen 
+// toggles. This is the best location to create D3DPOOL_MANAGED resources since these 
+// resources need to be reloaded whenever the device is destroyed. Resources created  
+// here should be released in the OnD3D11DestroyDevice callback. 
+//--------------------------------------------------------------------------------------
+HRESULT CALLBACK OnD3D11CreateDevice(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc,
+                                     void* pUserContext)
+{
+    HRESULT hr;
+
+    ID3D11DeviceContext* pd3dImmediateContext = DXUTGetD3D11DeviceContext();
+    V_RETURN(g_DialogResourceManager.OnD3D11CreateDevice(pd3dDevice, pd3dImmediateContext));
+    V_RETURN(g_D3DSettingsDlg.OnD3D11CreateDevice(pd3dDevice));
+    g_pTxtHelper = new CDXUTTextHelper(pd3dDevice, pd3dImmediateContext, &g_DialogResourceManager, 15);
+
+    g_Camera.SetRadius(1.5f, 0.1f);
+    Scene::CreateMesh(pd3dDevice);
+
+    g_pRHIDevice = new D3D11Device(pd3dDevice);
+    g_pRHIContext = new D3D11Context(pd3dDevice, pd3dImmediateContext);
+
+    g_pJobSystem = new JobSystem();
+    g_pRHIContext->CreateDeferredContexts(g_pJobSystem);
+
+    BenchmarkCoverageMaskKernels();
+
+    return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+// (Re)creates one technique for a Width x Height back buffer, at its resolution level.
+// The other techniques keep their resources.
+//--------------------------------------------------------------------------------------
+void CreateTechnique(int TechniqueId, UINT Width, UINT Height)
+{
+    bool IsCurrentEngine = (g_pCurrentEngine == g_Techniques[TechniqueId].pEngine);
+    UINT ResolutionScale = 1U << g_Techniques[TechniqueId].ResolutionLevel;
+
+    switch (TechniqueId)
+    {
+        case STOCHASTIC_TRANSPARENCY:
+        {
+            SAFE_DELETE(g_pStochasticTransparency);
+            g_pStochasticTransparency = new StochasticTransparency(g_pRHIDevice, Width, Height, ResolutionScale);
+            g_Techniques[STOCHASTIC_TRANSPARENCY].pEngine = g_pStochasticTransparency;
+            break;
+        }
+        case DUAL_DEPTH_PEELING:
+        {
+            SAFE_DELETE(g_pDualDepthPeeling);
+            g_pDualDepthPeeling = new DualDepthPeeling(g_pRHIDevice, Width, Height, ResolutionScale);
+            g_Techniques[DUAL_DEPTH_PEELING].pEngine = g_pDualDepthPeeling;
+            break;
+        }
+        case PLAIN_ALPHA_BLENDING:
+        {
+            SAFE_DELETE(g_pPlainAlphaBlending);
+            g_pPlainAlphaBlending = new PlainAlphaBlending(g_pRHIDevice, Width, Height, ResolutionScale);
+            g_Techniques[PLAIN_ALPHA_BLENDING].pEngine = g_pPlainAlphaBlending;
+            break;
+        }
+    }
+
+    const CompactMesh &Mesh = Scene::GetCompactMesh();
+    g_Techniques[TechniqueId].pEngine->SetPositionDequantization(Mesh.GetPositionScale(), Mesh.GetPositionBias());
+    g_TechniqueMatricesVersion = ~0U;
+
+    // The GPU time measured with the previous resources no longer applies
+    g_Techniques[TechniqueId].GPUTime = 0.f;
+
+    if (IsCurrentEngine)
+    {
+        g_pCurrentEngine = g_Techniques[TechniqueId].pEngine;
+        g_NumMeasuredFrames = 0;
+        g_RestartProgressive = true;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Called whenever the swap chain is resized.  
+//--------------------------------------------------------------------------------------
+HRESULT CALLBACK OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, IDXGISwapChain* pSwapChain,
+                                         const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc, void* pUserContext)
+{
+    HRESULT hr;
+
+    V_RETURN(g_DialogResourceManager.OnD3D11ResizedSwapChain(pd3dDevice, pBackBufferSurfaceDesc));
+    V_RETURN(g_D3DSettingsDlg.OnD3D11ResizedSwapChain(pd3dDevice, pBackBufferSurfaceDesc));
+
+    // Setup the camera's projection parameters    
+    float fAspectRatio = pBackBufferSurfaceDesc->Width / (FLOAT)pBackBufferSurfaceDesc->Height;
+    g_Camera.SetProjParams(FOVY, fAspectRatio, ZNEAR, ZFAR);
+    g_AspectRatio = fAspectRatio;
+    g_Transforms.SetProj(g_Camera.GetProjMatrix());
+    g_Camera.SetWindow(pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height);
+
+    g_HUD.SetLocation(pBackBufferSurfaceDesc->Width - 170, 0);
+    g_HUD.SetSize(170, 170);
+
+    const UINT Width = 256;
+    const UINT Height = 256;
+    g_SampleUI.SetLocation(pBackBufferSurfaceDesc->Width - Width, 150);
+    g_SampleUI.SetSize(Width, Height);
+    g_SampleUI.SetBackgroundColors(D3DCOLOR_RGBA(116,183,27,255));
+
+    // Keeps the technique and its resolution level across the resize; the first one initially
+    int CurrentTechnique = 0;
+    for (int i = 0; i < NUM_TECHNIQUES; ++i)
+    {
+        if (g_pCurrentEngine && g_Techniques[i].pEngine == g_pCurrentEngine)
+        {
+            CurrentTechnique = i;
+        }
+    }
+
+    for (int i = 0; i < NUM_TECHNIQUES; ++i)
+    {
+        CreateTechnique(i, pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height);
+    }
+
+    SAFE_DELETE(g_pDepthComplexityProbe);
+    g_pDepthComplexityProbe = new DepthComplexityProbe(g_pRHIDevice, pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height);
+
+    SetCurrentTechnique(CurrentTechnique);
+
+    return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+// Geometry passes of dual depth peeling that peel NumLayers: the first pass initializes
+// the nearest and farthest depths, and every following pass peels two layers
+//--------------------------------------------------------------------------------------
+UINT GetNumPeelingPasses(UINT NumLayers)
+{
+    return (NumLayers + 1) / 2 + 1;
+}
+
+//--------------------------------------------------------------------------------------
+// Picks the cheapest technique that renders NumLayers per pixel: plain alpha blending without
+// overlapping layers, dual depth peeling if it can peel all of them, and the stochastic
+// transparency in any case. Every technique costs its average GPU time per geometry pass
+// times its geometry passes; until it ran, it costs the time per pass of the current one.
+//--------------------------------------------------------------------------------------
+int SelectTechnique(UINT NumLayers, UINT &NumPeelingPasses, float &PredictedTime)
+{
+    float CurrentPassTime = 0.f;
+    for (int i = 0; i < NUM_TECHNIQUES; ++i)
+    {
+        if (g_Techniques[i].pEngine == g_pCurrentEngine && g_Techniques[i].NumGeometryPasses)
+        {
+            CurrentPassTime = g_Techniques[i].GPUTime / (float)g_Techniques[i].NumGeometryPasses;
+        }
+    }
+
+    UINT NumGeometryPasses[NUM_TECHNIQUES];
+    NumGeometryPasses[STOCHASTIC_TRANSPARENCY] = g_Techniques[STOCHASTIC_TRANSPARENCY].GPUTime > 0.f ?
+                                                 g_Techniques[STOCHASTIC_TRANSPARENCY].NumGeometryPasses :
+                                                 NUM_STOCHASTIC_GEOMETRY_PASSES;
+    NumGeometryPasses[DUAL_DEPTH_PEELING] = GetNumPeelingPasses(NumLayers);
+    NumGeometryPasses[PLAIN_ALPHA_BLENDING] = 1;
+
+    bool Exact[NUM_TECHNIQUES];
+    Exact[STOCHASTIC_TRANSPARENCY] = true;
+    Exact[DUAL_DEPTH_PEELING] = (NumGeometryPasses[DUAL_DEPTH_PEELING] <= MAX_NUM_PEELING_PASSES);
+    Exact[PLAIN_ALPHA_BLENDING] = (NumLayers <= 1);
+
+    int Selected = STOCHASTIC_TRANSPARENCY;
+    PredictedTime = FLT_MAX;
+    for (int i = 0; i < NUM_TECHNIQUES; ++i)
+    {
+        if (!Exact[i]) continue;
+
+        // The measured time of a dual depth peeling with other passes is rescaled per pass
+        const TechniqueUI &Technique = g_Techniques[i];
+        float PassTime = (Technique.GPUTime > 0.f && Technique.NumGeometryPasses) ?
+                         Technique.GPUTime / (float)Technique.NumGeometryPasses : CurrentPassTime;
+        float Time = PassTime * (float)NumGeometryPasses[i];
+        if (Time < PredictedTime)
+        {
+            PredictedTime = Time;
+            Selected = i;
+        }
+    }
+
+    NumPeelingPasses = NumGeometryPasses[DUAL_DEPTH_PEELING];
+    return Selected;
+}
+
+//--------------------------------------------------------------------------------------
+// Measures the GPU time of the current technique, and switches to the technique selected
+// for the last depth complexity read back once enough consecutive readbacks agree
+//--------------------------------------------------------------------------------------
+void UpdateTechniqueSelection()
+{
+    D3D11SubmitStats Stats;
+    if (g_pRHIContext->GetLastSubmitStats(Stats) && Stats.GPUTime > 0.f &&
+        ++g_NumMeasuredFrames > AUTO_SELECT_SKIPPED_FRAMES)
+    {
+        for (int i = 0; i < NUM_TECHNIQUES; ++i)
+        {
+            if (g_Techniques[i].pEngine != g_pCurrentEngine) continue;
+
+            TechniqueUI &Technique = g_Techniques[i];
+            Technique.GPUTime = (Technique.GPUTime > 0.f) ?
+                                Technique.GPUTime + (Stats.GPUTime - Technique.GPUTime) * AUTO_SELECT_SMOOTHING :
+                                Stats.GPUTime;
+            Technique.NumGeometryPasses = std::max(Stats.NumMeshDraws - Stats.NumOpaqueMeshDraws, 1U);
+        }
+    }
+
+    if (!g_SampleUI.GetCheckBox(IDC_AUTO_SELECT)->GetChecked() || !g_HasDepthComplexityStats) return;
+    g_HasDepthComplexityStats = false;
+
+    UINT NumLayers = g_DepthComplexityStats.GetPercentileLayers(AUTO_SELECT_PERCENTILE);
+    UINT NumPeelingPasses;
+    float PredictedTime;
+    int TechniqueId = SelectTechnique(NumLayers, NumPeelingPasses, PredictedTime);
+
+    g_NumAutoConfirmations = (TechniqueId == g_AutoCandidate) ? g_NumAutoConfirmations + 1 : 1;
+    g_AutoCandidate = TechniqueId;
+    if (g_NumAutoConfirmations != AUTO_SELECT_CONFIRMATIONS) return;
+
+    g_AutoTechnique = TechniqueId;
+    g_AutoLayers = NumLayers;
+    g_AutoPredictedTime = PredictedTime;
+    if (g_Techniques[TechniqueId].pEngine != g_pCurrentEngine)
+    {
+        SetCurrentTechnique(TechniqueId);
+    }
+
+    // The frame budget governor owns the peeling passes when enabled
+    if (TechniqueId == DUAL_DEPTH_PEELING && !g_SampleUI.GetCheckBox(IDC_FRAME_BUDGET)->GetChecked())
+    {
+        g_SampleUI.GetSlider(IDC_NUM_PEELING_PASSES_SLIDER)->SetValue(NumPeelingPasses);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+void UpdateUI()
+{
+    // Nothing is submitted while the converged image is presented: the statistics are stale
+    if (!g_ProgressiveConverged)
+    {
+        UpdateTechniqueSelection();
+    }
+
+    // The governor moves the sliders, which are then applied as if set by the user
+    g_FrameBudget.SetTargetTime((float)g_SampleUI.GetSlider(IDC_FRAME_BUDGET_SLIDER)->GetValue());
+    D3D11SubmitStats Stats;
+    if (g_SampleUI.GetCheckBox(IDC_FRAME_BUDGET)->GetChecked() && !g_ProgressiveConverged &&
+        g_pRHIContext->GetLastSubmitStats(Stats))
+    {
+        FrameBudgetSettings Settings;
+        Settings.NumPeelingPasses = g_SampleUI.GetSlider(IDC_NUM_PEELING_PASSES_SLIDER)->GetValue();
+        Settings.ResolutionLevel = g_SampleUI.GetSlider(IDC_RESOLUTION_SLIDER)->GetValue();
+        if (g_FrameBudget.Update(Stats.GPUTime, Stats.NumMeshDraws - Stats.NumOpaqueMeshDraws,
+                                 g_pCurrentEngine == g_pDualDepthPeeling, Settings))
+        {
+            g_SampleUI.GetSlider(IDC_NUM_PEELING_PASSES_SLIDER)->SetValue(Settings.NumPeelingPasses);
+            g_SampleUI.GetSlider(IDC_RESOLUTION_SLIDER)->SetValue(Settings.ResolutionLevel);
+        }
+    }
+
+    // Only the current technique is recreated when its resolution changes
+    UINT ResolutionLevel = g_SampleUI.GetSlider(IDC_RESOLUTION_SLIDER)->GetValue();
+    for (int i = 0; i < NUM_TECHNIQUES; ++i)
+    {
+        if (g_Techniques[i].pEngine == g_pCurrentEngine && g_Techniques[i].ResolutionLevel != ResolutionLevel)
+        {
+            g_Techniques[i].ResolutionLevel = ResolutionLevel;
+            const DXGI_SURFACE_DESC *pBackBufferDesc = DXUTGetDXGIBackBufferSurfaceDesc();
+            CreateTechnique(i, pBackBufferDesc->Width, pBackBufferDesc->Height);
+            break;
+        }
+    }
+
+    float alpha = (float)g_SampleUI.GetSlider(IDC_ALPHA_SLIDER)->GetValue() * 0.01f;
+    BaseTechnique::SetAlpha(alpha);
+
+    UINT NumPeelingPasses = g_SampleUI.GetSlider(IDC_NUM_PEELING_PASSES_SLIDER)->GetValue();
+    g_pDualDepthPeeling->SetNumGeometryPasses(NumPeelingPasses);
+
+    UINT NumStochasticPasses = g_SampleUI.GetSlider(IDC_NUM_STOCHASTIC_PASSES_SLIDER)->GetValue();
+    g_pStochasticTransparency->SetNumPasses(NumStochasticPasses);
+    g_pStochasticTransparency->SetSortedDepths(g_SampleUI.GetCheckBox(IDC_SORTED_DEPTHS)->GetChecked());
+    g_pStochasticTransparency->SetStochasticDepthFormat(g_pRHIDevice,
+        g_SampleUI.GetCheckBox(IDC_STOCHASTIC_DEPTH_16)->GetChecked() ? RHI_FORMAT_D16_UNORM : RHI_FORMAT_D32_FLOAT);
+    g_pStochasticTransparency->SetFarthestDepthRejection(g_SampleUI.GetCheckBox(IDC_FARTHEST_DEPTH_REJECTION)->GetChecked());
+    g_pStochasticTransparency->SetDenoise(g_SampleUI.GetCheckBox(IDC_DENOISE)->GetChecked());
+
+    Scene::SetClusterCulling(g_SampleUI.GetCheckBox(IDC_CLUSTER_CULLING)->GetChecked());
+
+    bool OpaqueSubsets = g_SampleUI.GetCheckBox(IDC_OPAQUE_SUBSETS)->GetChecked();
+    Scene::SetOpaqueSubsets(OpaqueSubsets);
+    for (int i = 0; i < NUM_TECHNIQUES; ++i)
+    {
+        g_Techniques[i].pEngine->SetOpaqueGeometry(OpaqueSubsets);
+    }
+    g_pDepthComplexityProbe->SetOpaqueGeometry(OpaqueSubsets);
+    Scene::SetOcclusionCulling(g_SampleUI.GetCheckBox(IDC_OCCLUSION_CULLING)->GetChecked());
+
+    bool TileClassification = g_SampleUI.GetCheckBox(IDC_TILE_CLASSIFICATION)->GetChecked();
+    for (int i = 0; i < NUM_TECHNIQUES; ++i)
+    {
+        g_Techniques[i].pEngine->SetTileClassification(TileClassification);
+    }
+
+    // The history of the other techniques' frames would be stale.
+    // The progressive refinement accumulates through the temporal pass.
+    bool ProgressiveRefinement = g_SampleUI.GetCheckBox(IDC_PROGRESSIVE_REFINEMENT)->GetChecked();
+    g_pStochasticTransparency->SetProgressiveRefinement(g_pRHIDevice, ProgressiveRefinement);
+    g_pStochasticTransparency->SetTemporalAccumulation((g_SampleUI.GetCheckBox(IDC_TEMPORAL_ACCUMULATION)->GetChecked() || ProgressiveRefinement) &&
+                                                       g_pCurrentEngine == g_pStochasticTransparency);
+
+    g_pRHIContext->SetParallelSubmission(g_SampleUI.GetCheckBox(IDC_PARALLEL_SUBMISSION)->GetChecked());
+
+    UINT InstanceGridSize = g_SampleUI.GetSlider(IDC_NUM_INSTANCES_SLIDER)->GetValue();
+    Scene::SetInstanceGridSize(InstanceGridSize);
+
+    bool IsDepthPeelingEnabled = (g_pCurrentEngine == g_pDualDepthPeeling);
+    g_SampleUI.GetStatic(IDC_NUM_PEELING_PASSES_STATIC)->SetVisible(IsDepthPeelingEnabled);
+    g_SampleUI.GetSlider(IDC_NUM_PEELING_PASSES_SLIDER)->SetVisible(IsDepthPeelingEnabled);
+    g_SampleUI.GetStatic(IDC_NUM_STOCHASTIC_PASSES_STATIC)->SetVisible(!IsDepthPeelingEnabled);
+    g_SampleUI.GetSlider(IDC_NUM_STOCHASTIC_PASSES_SLIDER)->SetVisible(!IsDepthPeelingEnabled);
+
+    WCHAR sz[100];
+    StringCchPrintf(sz, 100, L"Num geometry passes: %d", BaseTechnique::GetNumGeometryPasses());
+    g_SampleUI.GetStatic(IDC_NUM_PEELING_PASSES_STATIC)->SetText(sz);
+    g_SampleUI.GetStatic(IDC_NUM_STOCHASTIC_PASSES_STATIC)->SetText(sz);
+
+    StringCchPrintf(sz, 100, L"Alpha: %.2f", BaseTechnique::GetAlpha());
+    g_SampleUI.GetStatic(IDC_ALPHA_STATIC)->SetText(sz);
+
+    StringCchPrintf(sz, 100, L"Instances: %d", Scene::GetInstances().GetNumInstances());
+    g_SampleUI.GetStatic(IDC_NUM_INSTANCES_STATIC)->SetText(sz);
+
+    StringCchPrintf(sz, 100, L"Resolution: 1/%u", g_pCurrentEngine->GetResolutionScale());
+    g_SampleUI.GetStatic(IDC_RESOLUTION_STATIC)->SetText(sz);
+
+    StringCchPrintf(sz, 100, L"Budget: %.0f ms", g_FrameBudget.GetTargetTime());
+    g_SampleUI.GetStatic(IDC_FRAME_BUDGET_STATIC)->SetText(sz);
+}
+
+//--------------------------------------------------------------------------------------
+DirectX::XMMATRIX OffsetWorldMatrix()
+{
+	DirectX::XMMATRIX TranslationMatrix;
+	TranslationMatrix = DirectX::XMMatrixTranslation(g_ModelOffset.x, g_ModelOffset.y, g_ModelOffset.z);
+	DirectX::XMMATRIX WorldMatrix = TranslationMatrix * (g_Camera.GetWorldMatrix());
+
+    static float s_Angle = 0.0f;
+    if (g_SampleUI.GetCheckBox(IDC_AUTO_ROTATE)->GetChecked())
+    {
+        s_Angle += AUTO_ROTATION_RATE / DXUTGetFPS();
+        if (s_Angle > DirectX::XM_PI*2.0f) s_Angle = 0.0;
+    }
+
+	DirectX::XMMATRIX mWorld;
+    DirectX::XMMATRIX mRotation;
+	mRotation = DirectX::XMMatrixRotationY(s_Angle + DirectX::XM_PI);
+	mWorld = DirectX::XMMatrixMultiply(mRotation, WorldMatrix);
+	return mWorld;
+}
+
+//--------------------------------------------------------------------------------------
+// Fits the near and far planes to the depth range of the visible geometry, for a better
+// depth precision. Falls back to ZNEAR/ZFAR if the range is unknown.
+//--------------------------------------------------------------------------------------
+DirectX::XMMATRIX FitProjectionMatrix()
+{
+    g_ZNear = ZNEAR;
+    g_ZFar = ZFAR;
+
+    float MinDepth, MaxDepth;
+    if (g_SampleUI.GetCheckBox(IDC_FIT_DEPTH_RANGE)->GetChecked() &&
+        Scene::GetDepthRange(MinDepth, MaxDepth) &&
+        MaxDepth > ZNEAR)
+    {
+        g_ZNear = std::min(std::max(MinDepth * (1.0f - DEPTH_RANGE_MARGIN), ZNEAR), ZFAR);
+        g_ZFar = std::min(std::max(MaxDepth * (1.0f + DEPTH_RANGE_MARGIN), g_ZNear * (1.0f + DEPTH_RANGE_MARGIN)), ZFAR);
+    }
+
+    return DirectX::XMMatrixPerspectiveFovLH(FOVY, g_AspectRatio, g_ZNear, g_ZFar);
+}
+
+//--------------------------------------------------------------------------------------
+// Only the matrices consumed by the techniques and the culling are derived,
+// and only when the camera or the model moved
+//--------------------------------------------------------------------------------------
+void UpdateMatrices(ID3D11DeviceContext* pd3dImmediateContext)
+{
+    g_Transforms.SetWorld(OffsetWorldMatrix());
+    g_Transforms.SetView(g_Camera.GetViewMatrix());
+
+    // The frustum side planes do not depend on the depth range,
+    // so the culling can use the projection of the previous frame
+    Scene::CullMeshlets(pd3dImmediateContext, g_Transforms);
+    g_Transforms.SetProj(FitProjectionMatrix());
+
+    Scene::UpdateInstances(pd3dImmediateContext, g_Transforms);
+    Scene::SplitDrawLists();
+
+    UINT Version = g_Transforms.GetVersion(TRANSFORM_WORLD_VIEW_PROJ);
+    if (Version != g_TechniqueMatricesVersion)
+    {
+        g_TechniqueMatricesVersion = Version;
+
+        DirectX::XMFLOAT4X4 ModelViewProj;
+        DirectX::XMFLOAT4X4 ModelViewIT;
+        g_Transforms.Get(TRANSFORM_WORLD_VIEW_PROJ, ModelViewProj);
+        g_Transforms.Get(TRANSFORM_WORLD_VIEW_IT, ModelViewIT);
+
+        for (int i = 0; i < NUM_TECHNIQUES; ++i)
+        {
+            g_Techniques[i].pEngine->UpdateMatrices(ModelViewProj, ModelViewIT);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Restarts the progressive refinement when the world or view matrices or any setting changed.
+// The projection is left out: the fitted depth range moves it without changing the image.
+//--------------------------------------------------------------------------------------
+void UpdateProgressiveRefinement()
+{
+    UINT Version = g_Transforms.GetVersion(TRANSFORM_WORLD_VIEW);
+    if (Version == g_ProgressiveViewVersion && !g_RestartProgressive) return;
+
+    g_ProgressiveViewVersion = Version;
+    g_RestartProgressive = false;
+    g_ProgressiveConverged = false;
+    g_pStochasticTransparency->RestartProgressiveRefinement();
+
+    // The changes copied before the restart measured the previous mean
+    g_ProgressiveReadback.Invalidate();
+    g_ProgressiveChange = 0.f;
+    g_ProgressiveChangeFrames = 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Callback function that renders the frame.  This function sets up the rendering 
+// matrices and renders the scene and UI.
+//--------------------------------------------------------------------------------------
+void CALLBACK OnD3D11FrameRender(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext, double fTime,
+                                 float fElapsedTime, void* pUserContext)
+{
+    // If the settings dialog is being shown, then render it instead of rendering the app's scene
+    if(g_D3DSettingsDlg.IsActive())
+    {
+        g_D3DSettingsDlg.OnRender(fElapsedTime);
+        return;
+    }
+
+    UpdateUI();
+    UpdateMatrices(pd3dImmediateContext);
+    UpdateProgressiveRefinement();
+
+    // Store off original render target, depth/stencil and viewport
+    ID3D11RenderTargetView* pOrigRTV = NULL;
+    ID3D11DepthStencilView* pOrigDSV = NULL;
+    pd3dImmediateContext->OMGetRenderTargets(1, &pOrigRTV, &pOrigDSV);
+    D3D11_VIEWPORT OrigViewport;
+    UINT NumOrigViewports = 1;
+    pd3dImmediateContext->RSGetViewports(&NumOrigViewports, &OrigViewport);
+
+    // The back buffer view only changes with the swap chain
+    if (pOrigRTV != g_pBackBufferRTV)
+    {
+        SAFE_DELETE(g_pBackBufferView);
+        g_pBackBufferView = g_pRHIDevice->WrapRenderTargetView(pOrigRTV);
+        g_pBackBufferRTV = pOrigRTV;
+    }
+
+    // Once converged, the frame presents the converged image without any work of the technique,
+    // and the rendering pauses after it until the next input
+    if (g_ProgressiveConverged)
+    {
+        ID3D11Resource *pBackBuffer = NULL;
+        pOrigRTV->GetResource(&pBackBuffer);
+        pd3dImmediateContext->CopyResource(pBackBuffer, g_pConvergedImage);
+        SAFE_RELEASE(pBackBuffer);
+        PauseIdleRendering();
+    }
+    else
+    {
+        g_pRHIContext->SetGeometry(Scene::GetCompactMesh(), Scene::GetInstances(), Scene::GetDrawList(false), Scene::GetDrawList(true),
+                                    Scene::GetOpaqueDrawList());
+
+        if (g_CompareDepthFormats)
+        {
+            g_CompareDepthFormats = false;
+            CompareStochasticDepthFormats(pd3dImmediateContext);
+        }
+
+        if (g_CompareSubmission)
+        {
+            g_CompareSubmission = false;
+            CompareSubmissionModes(pd3dImmediateContext);
+        }
+
+        // The temporal pass also writes the depths read by the CPU reference
+        bool VerifyTemporalPass = g_VerifyTemporal && g_pStochasticTransparency->GetTemporalAccumulation();
+        g_pStochasticTransparency->SetTemporalDepthOutput(VerifyTemporalPass);
+        g_VerifyTemporal = false;
+
+        BaseTechnique::ResetNumGeometryPasses();
+        g_pCurrentEngine->Render(*g_pRHIContext, g_pBackBufferView);
+
+        if (VerifyTemporalPass)
+        {
+            VerifyTemporal(pd3dImmediateContext);
+            g_pStochasticTransparency->SetTemporalDepthOutput(false);
+        }
+
+        if (g_SampleUI.GetCheckBox(IDC_PROGRESSIVE_REFINEMENT)->GetChecked())
+        {
+            // The other techniques are deterministic: their first frame is converged
+            bool Converged = true;
+            RHITexture *pProgressiveChange = g_pStochasticTransparency->GetProgressiveChange();
+            if (pProgressiveChange)
+            {
+                UINT NumFrames = g_pStochasticTransparency->GetNumProgressiveFrames();
+                g_ProgressiveReadback.ReadBack(pd3dImmediateContext, D3D11Device::GetTexture2D(pProgressiveChange), NumFrames,
+                                               DecodeProgressiveChange);
+
+                // The change of the first frame compares with the history of another view
+                Converged = (g_ProgressiveChangeFrames > 1 && g_ProgressiveChange < PROGRESSIVE_CONVERGENCE_THRESHOLD) ||
+                            NumFrames >= PROGRESSIVE_MAX_FRAMES;
+            }
+            if (Converged)
+            {
+                SaveConvergedImage(pd3dImmediateContext, pOrigRTV);
+            }
+        }
+
+        // Left out of the statistics of the technique, which the selection and the governor measure
+        if (g_SampleUI.GetCheckBox(IDC_AUTO_SELECT)->GetChecked())
+        {
+            g_pRHIContext->SetSubmitStats(false);
+            g_pDepthComplexityProbe->Render(*g_pRHIContext);
+            g_pRHIContext->SetSubmitStats(true);
+            g_DepthComplexityReadback.ReadBack(pd3dImmediateContext, D3D11Device::GetTexture2D(g_pDepthComplexityProbe->GetCounts()), 1,
+                                               DecodeDepthComplexity);
+        }
+
+        // Read back on the CPU a few frames later, for the Hi-Z occlusion culling
+        RHITexture *pOpaqueDepth = g_pCurrentEngine->GetOpaqueDepth();
+        if (pOpaqueDepth)
+        {
+            Scene::CopyOpaqueDepth(pd3dImmediateContext, D3D11Device::GetTexture2D(pOpaqueDepth),
+                                   g_Transforms.GetVersion(TRANSFORM_WORLD_VIEW_PROJ));
+        }
+
+        RHITexture *pTileClasses = g_pCurrentEngine->GetTileClasses();
+        if (pTileClasses)
+        {
+            g_TileClassesReadback.ReadBack(pd3dImmediateContext, D3D11Device::GetTexture2D(pTileClasses), 1, DecodeTileClasses);
+
+            if (g_VerifyTileClasses)
+            {
+                VerifyTileClasses(pd3dImmediateContext);
+            }
+        }
+        g_VerifyTileClasses = false;
+    }
+
+    // Restore original render targets and viewport: the reduced-resolution passes and
+    // the parallel submission leave other ones bound
+    pd3dImmediateContext->OMSetRenderTargets(1, &pOrigRTV, pOrigDSV);
+    if (NumOrigViewports)
+    {
+        pd3dImmediateContext->RSSetViewports(1, &OrigViewport);
+    }
+    SAFE_RELEASE(pOrigRTV);
+    SAFE_RELEASE(pOrigDSV);
+
+    // Reset SRVs to avoid D3D runtime warnings
+    ID3D11ShaderResourceView* pNullSRVs[2] = { NULL, NULL };
+    pd3dImmediateContext->PSSetShaderResources(0, 2, pNullSRVs);
+
+    if (g_ShowUI)
+    {
+        DXUT_BeginPerfEvent(DXUT_PERFEVENTCOLOR, L"HUD / Stats");
+        g_HUD.OnRender(fElapsedTime);
+        g_SampleUI.OnRender(fElapsedTime);
+        RenderText();
+        DXUT_EndPerfEvent();
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// This callback function will be called immediately after the Direct3D device has 
+// been destroyed, which generally happens as a result of application termination or 
+// windowed/full screen toggles. Resources created in the OnD3D11CreateDevice callback 
+// should be released here, which generally includes all D3DPOOL_MANAGED resources. 
+//--------------------------------------------------------------------------------------
+void CALLBACK OnD3D11DestroyDevice(void* pUserContext)
+{
+    g_DialogResourceManager.OnD3D11DestroyDevice();
+    g_D3DSettingsDlg.OnD3D11DestroyDevice();
+    DXUTGetGlobalResourceCache().OnDestroyDevice();
+    SAFE_DELETE(g_pTxtHelper);
+
+    SAFE_DELETE(g_pStochasticTransparency);
+    SAFE_DELETE(g_pDualDepthPeeling);
+    SAFE_DELETE(g_pPlainAlphaBlending);
+    SAFE_DELETE(g_pDepthComplexityProbe);
+    Scene::ReleaseMesh();
+
+    g_TileClassesReadback.Destroy();
+    g_DepthComplexityReadback.Destroy();
+    g_ProgressiveReadback.Destroy();
+    SAFE_RELEASE(g_pConvergedImage);
+    g_ProgressiveConverged = false;
+    ResumeIdleRendering();
+
+    SAFE_DELETE(g_pBackBufferView);
+    g_pBackBufferRTV = NULL;
+    SAFE_DELETE(g_pRHIContext);
+    SAFE_DELETE(g_pRHIDevice);
+    SAFE_DELETE(g_pJobSystem);
+}
+
+//--------------------------------------------------------------------------------------
+// Release the swap chain
+//--------------------------------------------------------------------------------------
+void CALLBACK OnD3D11ReleasingSwapChain(void* pUserContext)
+{
+    g_DialogResourceManager.OnD3D11ReleasingSwapChain();
+
+    // Holds a reference on the back buffer
+    SAFE_DELETE(g_pBackBufferView);
+    g_pBackBufferRTV = NULL;
+
+    // At the size of the back buffer
+    SAFE_RELEASE(g_pConvergedImage);
+    g_ProgressiveConverged = false;
+    ResumeIdleRendering();
+}